@@ -5,6 +5,7 @@
 #include "Token.h"
 #include "fmt/format.h"
 #include "iface/Visitor.h"
+#include "infra/Interner.h"
 #include "infra/Log.h"
 #include <sstream>
 #include <utility>
@@ -16,6 +17,17 @@
     x = nullptr;                                                               \
   } while (0)
 
+// destroy the rest of list one by one, long list doesn't recurse
+#define DESTROY_LIST(T, x)                                                     \
+  do {                                                                         \
+    while (x) {                                                                \
+      T *e = x;                                                                \
+      x = e->next;                                                             \
+      e->next = nullptr;                                                       \
+      delete e;                                                                \
+    }                                                                          \
+  } while (0)
+
 #define PARENT(x)                                                              \
   do {                                                                         \
     if (x) {                                                                   \
@@ -81,6 +93,10 @@ bool Ast::isExpr(Ast *e) {
   case AstKind::Infix:
   case AstKind::Call:
   case AstKind::Exprs:
+  case AstKind::Index:
+  case AstKind::New:
+  case AstKind::Delete:
+  case AstKind::Await:
     return true;
   default:
     return false;
@@ -118,7 +134,10 @@ bool Ast::isDecl(Ast *e) {
   return false;
 }
 
-bool Ast::isType(Ast *e) { return e && e->kind() == (+AstKind::PlainType); }
+bool Ast::isType(Ast *e) {
+  return e && (e->kind() == (+AstKind::PlainType) ||
+               e->kind() == (+AstKind::ArrayType));
+}
 
 // Ast }
 
@@ -225,7 +244,11 @@ A_Float::A_Float(const Cowstr &literal, const Location &location)
     endPosition = (int)literal.length();
   } else {
     bit_ = 32;
-    endPosition = (int)literal.length() - 1;
+    // float literal in source has no suffix, an `f` suffix is optional
+    std::vector<Cowstr> floatPostfix = {"f", "F"};
+    if (literal.endWithAnyOf(floatPostfix.begin(), floatPostfix.end())) {
+      endPosition = (int)literal.length() - 1;
+    }
   }
 
   parsed_ = literal.subString(startPosition, endPosition - startPosition);
@@ -324,12 +347,14 @@ void A_Void::accept(Visitor *visitor) { visitor->visitVoid(this); }
 // A_VarId {
 
 A_VarId::A_VarId(const Cowstr &literal, const Location &location)
-    : Ast(literal, location) {}
+    : Ast(literal, location), nameId_(Interner::intern(literal)) {}
 
 AstKind A_VarId::kind() const { return AstKind::VarId; }
 
 void A_VarId::accept(Visitor *visitor) { visitor->visitVarId(this); }
 
+int A_VarId::nameId() const { return nameId_; }
+
 // A_VarId }
 
 // id }
@@ -440,6 +465,13 @@ A_Infix::A_Infix(Ast *a_left, int a_infixOp, Ast *a_right,
 }
 
 A_Infix::~A_Infix() {
+  // left-associative chain (a + b + c + ...) is destroyed one by one
+  while (left && left->kind() == (+AstKind::Infix)) {
+    A_Infix *e = static_cast<A_Infix *>(left);
+    left = e->left;
+    e->left = nullptr;
+    delete e;
+  }
   DESTROY(left);
   DESTROY(right);
 }
@@ -497,7 +529,7 @@ A_Exprs::A_Exprs(Ast *a_expr, A_Exprs *a_next, const Location &location)
 
 A_Exprs::~A_Exprs() {
   DESTROY(expr);
-  DESTROY(next);
+  DESTROY_LIST(A_Exprs, next);
 }
 
 AstKind A_Exprs::kind() const { return AstKind::Exprs; }
@@ -506,6 +538,80 @@ void A_Exprs::accept(Visitor *visitor) { visitor->visitExprs(this); }
 
 // A_Exprs }
 
+// A_Index {
+
+A_Index::A_Index(Ast *a_expr, Ast *a_index, const Location &location)
+    : Ast("index", location), expr(a_expr), index(a_index) {
+  LOG_ASSERT(expr, "expr must not null");
+  LOG_ASSERT(index, "index must not null");
+  PARENT(expr);
+  PARENT(index);
+}
+
+A_Index::~A_Index() {
+  DESTROY(expr);
+  DESTROY(index);
+}
+
+AstKind A_Index::kind() const { return AstKind::Index; }
+
+void A_Index::accept(Visitor *visitor) { visitor->visitIndex(this); }
+
+// A_Index }
+
+// A_New {
+
+A_New::A_New(Ast *a_type, Ast *a_count, const Location &location)
+    : Ast("new", location), type(a_type), count(a_count), stack(false) {
+  LOG_ASSERT(type, "type must not null");
+  LOG_ASSERT(count, "count must not null");
+  PARENT(type);
+  PARENT(count);
+}
+
+A_New::~A_New() {
+  DESTROY(type);
+  DESTROY(count);
+}
+
+AstKind A_New::kind() const { return AstKind::New; }
+
+void A_New::accept(Visitor *visitor) { visitor->visitNew(this); }
+
+// A_New }
+
+// A_Delete {
+
+A_Delete::A_Delete(Ast *a_expr, const Location &location)
+    : Ast("delete", location), expr(a_expr), stack(false), region(false) {
+  LOG_ASSERT(expr, "expr must not null");
+  PARENT(expr);
+}
+
+A_Delete::~A_Delete() { DESTROY(expr); }
+
+AstKind A_Delete::kind() const { return AstKind::Delete; }
+
+void A_Delete::accept(Visitor *visitor) { visitor->visitDelete(this); }
+
+// A_Delete }
+
+// A_Await {
+
+A_Await::A_Await(Ast *a_expr, const Location &location)
+    : Ast("await", location), expr(a_expr) {
+  LOG_ASSERT(expr, "expr must not null");
+  PARENT(expr);
+}
+
+A_Await::~A_Await() { DESTROY(expr); }
+
+AstKind A_Await::kind() const { return AstKind::Await; }
+
+void A_Await::accept(Visitor *visitor) { visitor->visitAwait(this); }
+
+// A_Await }
+
 // A_If {
 
 A_If::A_If(Ast *a_condition, Ast *a_thenp, Ast *a_elsep,
@@ -534,15 +640,28 @@ void A_If::accept(Visitor *visitor) { visitor->visitIf(this); }
 // A_Loop {
 
 A_Loop::A_Loop(Ast *a_condition, Ast *a_body, const Location &location)
-    : Ast("loop", location), condition(a_condition), body(a_body) {
+    : Ast("loop", location), condition(a_condition), reductions(nullptr),
+      body(a_body), parallel(false) {
+  LOG_ASSERT(condition, "condition must not null");
+  LOG_ASSERT(body, "body must not null");
+  PARENT(condition);
+  PARENT(body);
+}
+
+A_Loop::A_Loop(Ast *a_condition, A_Exprs *a_reductions, Ast *a_body,
+               const Location &location)
+    : Ast("loop", location), condition(a_condition), reductions(a_reductions),
+      body(a_body), parallel(true) {
   LOG_ASSERT(condition, "condition must not null");
   LOG_ASSERT(body, "body must not null");
   PARENT(condition);
+  PARENT(reductions);
   PARENT(body);
 }
 
 A_Loop::~A_Loop() {
   DESTROY(condition);
+  DESTROY(reductions);
   DESTROY(body);
 }
 
@@ -669,7 +788,7 @@ void A_Try::accept(Visitor *visitor) { visitor->visitTry(this); }
 // A_Block {
 
 A_Block::A_Block(A_BlockStats *a_blockStats, const Location &location)
-    : Ast("block", location), blockStats(a_blockStats) {
+    : Ast("block", location), blockStats(a_blockStats), region(false) {
   PARENT(blockStats);
 }
 
@@ -693,7 +812,7 @@ A_BlockStats::A_BlockStats(Ast *a_blockStat, A_BlockStats *a_next,
 
 A_BlockStats::~A_BlockStats() {
   DESTROY(blockStat);
-  DESTROY(next);
+  DESTROY_LIST(A_BlockStats, next);
 }
 
 AstKind A_BlockStats::kind() const { return AstKind::BlockStats; }
@@ -721,14 +840,37 @@ void A_PlainType::accept(Visitor *visitor) { visitor->visitPlainType(this); }
 
 // A_PlainType }
 
+// A_ArrayType {
+
+A_ArrayType::A_ArrayType(Ast *a_elementType, const Location &location)
+    : A_ArrayType(a_elementType, -1, location) {}
+
+A_ArrayType::A_ArrayType(Ast *a_elementType, int64_t a_length,
+                         const Location &location)
+    : Ast(a_elementType->name() + "[" +
+              (a_length < 0 ? Cowstr() : Cowstr::from(a_length)) + "]",
+          location),
+      elementType(a_elementType), length(a_length) {
+  PARENT(elementType);
+}
+
+A_ArrayType::~A_ArrayType() { DESTROY(elementType); }
+
+AstKind A_ArrayType::kind() const { return AstKind::ArrayType; }
+
+void A_ArrayType::accept(Visitor *visitor) { visitor->visitArrayType(this); }
+
+// A_ArrayType }
+
 // type }
 
 // definition and declaration {
 
 A_FuncDef::A_FuncDef(Ast *a_funcSign, Ast *a_resultType, Ast *a_body,
-                     const Location &location)
-    : Ast("funcDef", location), funcSign(a_funcSign), resultType(a_resultType),
-      body(a_body) {
+                     const Location &location, bool a_compileTime)
+    : Ast(a_compileTime ? "constFuncDef" : "funcDef", location),
+      funcSign(a_funcSign), resultType(a_resultType), body(a_body),
+      compileTime(a_compileTime), async(false) {
   LOG_ASSERT(funcSign, "funcSign must not null");
   LOG_ASSERT(resultType, "resultType must not null");
   LOG_ASSERT(body, "body must not null");
@@ -792,7 +934,7 @@ A_Params::A_Params(A_Param *a_param, A_Params *a_next, const Location &location)
 
 A_Params::~A_Params() {
   DESTROY(param);
-  DESTROY(next);
+  DESTROY_LIST(A_Params, next);
 }
 
 AstKind A_Params::kind() const { return AstKind::Params; }
@@ -817,8 +959,9 @@ AstKind A_Param::kind() const { return AstKind::Param; }
 void A_Param::accept(Visitor *visitor) { visitor->visitParam(this); }
 
 A_VarDef::A_VarDef(Ast *a_id, Ast *a_type, Ast *a_expr,
-                   const Location &location)
-    : Ast("varDef", location), id(a_id), type(a_type), expr(a_expr) {
+                   const Location &location, bool a_immutable)
+    : Ast(a_immutable ? "valDef" : "varDef", location), id(a_id), type(a_type),
+      expr(a_expr), immutable(a_immutable) {
   LOG_ASSERT(id, "id must not null");
   LOG_ASSERT(type, "type must not null");
   LOG_ASSERT(expr, "expr must not null");
@@ -851,7 +994,7 @@ A_TopStats::A_TopStats(Ast *a_topStat, A_TopStats *a_next,
 
 A_TopStats::~A_TopStats() {
   DESTROY(topStat);
-  DESTROY(next);
+  DESTROY_LIST(A_TopStats, next);
 }
 
 AstKind A_TopStats::kind() const { return AstKind::TopStats; }
@@ -9,6 +9,7 @@
 #include "iface/Locationable.h"
 #include "iface/Nameable.h"
 #include "iface/Scoped.h"
+#include "iface/Slotable.h"
 #include "iface/Symbolizable.h"
 #include "iface/TypeSymbolizable.h"
 #include "infra/Cowstr.h"
@@ -32,12 +33,12 @@ BETTER_ENUM(AstKind, int,
             VarId,
             // expr without block
             Throw, Return, Break, Continue, Assign, Postfix, Prefix, Infix,
-            Call, Exprs,
+            Call, Exprs, Index, New, Delete, Await,
             // expr with block
             If, Loop, Yield, LoopCondition, LoopEnumerator, DoWhile, Try, Block,
             BlockStats,
             // type
-            PlainType,
+            PlainType, ArrayType,
             // declaration and definition
             FuncDef, FuncSign, Params, Param, VarDef,
             // compile unit
@@ -199,12 +200,21 @@ public:
 //   nullptr); virtual ~AstId() = default;
 // };
 
-class A_VarId : public Ast, public Symbolizable, public TypeSymbolizable {
+class A_VarId : public Ast,
+                public Symbolizable,
+                public TypeSymbolizable,
+                public Slotable {
 public:
   A_VarId(const Cowstr &literal, const Location &location);
   virtual ~A_VarId() = default;
   virtual AstKind kind() const;
   virtual void accept(Visitor *visitor);
+
+  // interned name id, see Interner
+  virtual int nameId() const;
+
+private:
+  int nameId_;
 };
 
 // id }
@@ -316,6 +326,59 @@ public:
   A_Exprs *next;
 };
 
+// a[i]
+class A_Index : public Ast {
+public:
+  A_Index(Ast *a_expr, Ast *a_index, const Location &location);
+  virtual ~A_Index();
+  virtual AstKind kind() const;
+  virtual void accept(Visitor *visitor);
+
+  Ast *expr;
+  Ast *index;
+};
+
+// new T[n], allocates array of n elements from runtime
+class A_New : public Ast {
+public:
+  A_New(Ast *a_type, Ast *a_count, const Location &location);
+  virtual ~A_New();
+  virtual AstKind kind() const;
+  virtual void accept(Visitor *visitor);
+
+  Ast *type; // element type
+  Ast *count;
+  // array doesn't escape its function, allocated on stack, see EscapeAnalysis
+  bool stack;
+};
+
+// delete a, returns memory of array to runtime
+class A_Delete : public Ast {
+public:
+  A_Delete(Ast *a_expr, const Location &location);
+  virtual ~A_Delete();
+  virtual AstKind kind() const;
+  virtual void accept(Visitor *visitor);
+
+  Ast *expr;
+  // array is allocated on stack, nothing to free, see EscapeAnalysis
+  bool stack;
+  // array is allocated in region, freed at region exit, see EscapeAnalysis
+  bool region;
+};
+
+// await expr, async calls in expr run as concurrent tasks, expr is evaluated
+// with their results after all of them complete
+class A_Await : public Ast {
+public:
+  A_Await(Ast *a_expr, const Location &location);
+  virtual ~A_Await();
+  virtual AstKind kind() const;
+  virtual void accept(Visitor *visitor);
+
+  Ast *expr;
+};
+
 // simple expression without block }
 
 // statement like expression with block {
@@ -336,12 +399,20 @@ public:
 class A_Loop : public Ast, public Scoped {
 public:
   A_Loop(Ast *a_condition, Ast *a_body, const Location &location);
+  // parallel `foreach`
+  A_Loop(Ast *a_condition, A_Exprs *a_reductions, Ast *a_body,
+         const Location &location);
   virtual ~A_Loop();
   virtual AstKind kind() const;
   virtual void accept(Visitor *visitor);
 
   Ast *condition;
+  // reductions of parallel loop, `+ s`, `min s` and `max s` are prefix
+  // expressions of `+`, `<` and `>`
+  A_Exprs *reductions;
   Ast *body;
+  // iterations run in parallel on runtime workers, see rt/Parallel.h
+  bool parallel;
 };
 
 class A_Yield : public Ast {
@@ -411,6 +482,8 @@ public:
   virtual void accept(Visitor *visitor);
 
   A_BlockStats *blockStats;
+  // `region { ... }`, memory of `new` inside is released at block exit
+  bool region;
 };
 
 class A_BlockStats : public Ast {
@@ -446,6 +519,20 @@ public:
   int token;
 };
 
+// T[] or T[N]
+class A_ArrayType : public Ast {
+public:
+  A_ArrayType(Ast *a_elementType, const Location &location);
+  A_ArrayType(Ast *a_elementType, int64_t a_length, const Location &location);
+  virtual ~A_ArrayType();
+  virtual AstKind kind() const;
+  virtual void accept(Visitor *visitor);
+
+  Ast *elementType;
+  // length of fixed-size array `T[N]`, -1 for slice `T[]`
+  int64_t length;
+};
+
 // type }
 
 // definition and declaration {
@@ -453,7 +540,7 @@ public:
 class A_FuncDef : public Ast {
 public:
   A_FuncDef(Ast *a_funcSign, Ast *a_resultType, Ast *a_body,
-            const Location &location);
+            const Location &location, bool a_compileTime = false);
   virtual ~A_FuncDef();
   virtual AstKind kind() const;
   virtual void accept(Visitor *visitor);
@@ -466,6 +553,11 @@ public:
   Ast *funcSign;
   Ast *resultType;
   Ast *body;
+  // defined by `const def`, call with constant arguments is evaluated at
+  // compile time
+  bool compileTime;
+  // defined by `async def`, its call runs as a task inside `await`
+  bool async;
 };
 
 class A_FuncSign : public Ast {
@@ -503,7 +595,8 @@ public:
 
 class A_VarDef : public Ast {
 public:
-  A_VarDef(Ast *a_id, Ast *a_type, Ast *a_expr, const Location &location);
+  A_VarDef(Ast *a_id, Ast *a_type, Ast *a_expr, const Location &location,
+           bool a_immutable = false);
   virtual ~A_VarDef();
   virtual AstKind kind() const;
   virtual void accept(Visitor *visitor);
@@ -511,6 +604,8 @@ public:
   Ast *id;
   Ast *type;
   Ast *expr;
+  // defined by `val`, cannot be assigned
+  bool immutable;
 };
 
 // definition and declaration }
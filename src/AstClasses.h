@@ -28,6 +28,10 @@ class A_Assign;
 class A_Postfix;
 class A_Infix;
 class A_Prefix;
+class A_Index;
+class A_New;
+class A_Delete;
+class A_Await;
 
 /* expression with block */
 class A_Call;
@@ -45,6 +49,7 @@ class A_BlockStats;
 /* type */
 // class AstType;
 class A_PlainType;
+class A_ArrayType;
 
 /* declaration and definition */
 class A_FuncDef;
@@ -0,0 +1,275 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "AstWalker.h"
+#include "infra/Log.h"
+#include <initializer_list>
+
+AstWalker::AstWalker(const std::vector<FusiblePhase *> &phases)
+    : enters_(AstKind::_size()), leaves_(AstKind::_size()) {
+  for (int i = 0; i < (int)phases.size(); i++) {
+    FusiblePhase *p = phases[i];
+    LOG_ASSERT(p, "phases[{}] must not null", i);
+    for (int j = 0; j < (int)AstKind::_size(); j++) {
+      AstKind kind = AstKind::_from_integral((+AstKind::Integer) + j);
+      if (!p->interest(kind)) {
+        continue;
+      }
+      if (p->order() != +PhaseOrder::PostOrder) {
+        enters_[j].push_back(p);
+      }
+      if (p->order() != +PhaseOrder::PreOrder) {
+        leaves_[j].push_back(p);
+      }
+    }
+  }
+}
+
+void AstWalker::walk(Ast *ast) {
+  if (!ast) {
+    return;
+  }
+
+  // walk with a heap allocated stack, deep ast tree (long statement list,
+  // nested expressions) doesn't overflow native stack.
+  // the bool is true when node is entered, and its children are pushed
+  std::vector<std::pair<Ast *, bool>> stack;
+  stack.push_back(std::make_pair(ast, false));
+
+  while (!stack.empty()) {
+    Ast *e = stack.back().first;
+    int k = index(e->kind());
+    if (stack.back().second) {
+      stack.pop_back();
+      for (int i = 0; i < (int)leaves_[k].size(); i++) {
+        leaves_[k][i]->leave(e);
+      }
+      continue;
+    }
+    stack.back().second = true;
+    for (int i = 0; i < (int)enters_[k].size(); i++) {
+      enters_[k][i]->enter(e);
+    }
+    // push in reverse order, so children are popped in order
+    Ast *c[3];
+    int n = children(e, c);
+    for (int i = n - 1; i >= 0; i--) {
+      if (c[i]) {
+        stack.push_back(std::make_pair(c[i], false));
+      }
+    }
+  }
+}
+
+#define CHILD1(T, a)                                                           \
+  do {                                                                         \
+    T *e = static_cast<T *>(ast);                                              \
+    result[0] = e->a;                                                          \
+    return 1;                                                                  \
+  } while (0)
+
+#define CHILD2(T, a, b)                                                        \
+  do {                                                                         \
+    T *e = static_cast<T *>(ast);                                              \
+    result[0] = e->a;                                                          \
+    result[1] = e->b;                                                          \
+    return 2;                                                                  \
+  } while (0)
+
+#define CHILD3(T, a, b, c)                                                     \
+  do {                                                                         \
+    T *e = static_cast<T *>(ast);                                              \
+    result[0] = e->a;                                                          \
+    result[1] = e->b;                                                          \
+    result[2] = e->c;                                                          \
+    return 3;                                                                  \
+  } while (0)
+
+int AstWalker::children(Ast *ast, Ast *result[3]) {
+  switch (ast->kind()) {
+  case AstKind::Throw:
+    CHILD1(A_Throw, expr);
+  case AstKind::Return:
+    CHILD1(A_Return, expr);
+  case AstKind::Assign:
+    CHILD2(A_Assign, assignee, assignor);
+  case AstKind::Postfix:
+    CHILD1(A_Postfix, expr);
+  case AstKind::Prefix:
+    CHILD1(A_Prefix, expr);
+  case AstKind::Infix:
+    CHILD2(A_Infix, left, right);
+  case AstKind::Call:
+    CHILD2(A_Call, id, args);
+  case AstKind::Exprs:
+    CHILD2(A_Exprs, expr, next);
+  case AstKind::Index:
+    CHILD2(A_Index, expr, index);
+  case AstKind::New:
+    CHILD2(A_New, type, count);
+  case AstKind::Delete:
+    CHILD1(A_Delete, expr);
+  case AstKind::Await:
+    CHILD1(A_Await, expr);
+  case AstKind::If:
+    CHILD3(A_If, condition, thenp, elsep);
+  case AstKind::Loop:
+    CHILD3(A_Loop, condition, reductions, body);
+  case AstKind::Yield:
+    CHILD1(A_Yield, expr);
+  case AstKind::LoopCondition:
+    CHILD3(A_LoopCondition, init, condition, update);
+  case AstKind::LoopEnumerator:
+    CHILD3(A_LoopEnumerator, id, type, expr);
+  case AstKind::DoWhile:
+    CHILD2(A_DoWhile, body, condition);
+  case AstKind::Try:
+    CHILD3(A_Try, tryp, catchp, finallyp);
+  case AstKind::Block:
+    CHILD1(A_Block, blockStats);
+  case AstKind::BlockStats:
+    CHILD2(A_BlockStats, blockStat, next);
+  case AstKind::ArrayType:
+    CHILD1(A_ArrayType, elementType);
+  case AstKind::FuncDef:
+    CHILD3(A_FuncDef, funcSign, resultType, body);
+  case AstKind::FuncSign:
+    CHILD2(A_FuncSign, id, params);
+  case AstKind::Params:
+    CHILD2(A_Params, param, next);
+  case AstKind::Param:
+    CHILD2(A_Param, id, type);
+  case AstKind::VarDef:
+    CHILD3(A_VarDef, id, type, expr);
+  case AstKind::TopStats:
+    CHILD2(A_TopStats, topStat, next);
+  case AstKind::CompileUnit:
+    CHILD1(A_CompileUnit, topStats);
+  default:
+    return 0;
+  }
+}
+
+// find the field of parent points to ast
+static Ast **find(Ast *ast, std::initializer_list<Ast **> fields) {
+  for (Ast **field : fields) {
+    if (*field == ast) {
+      return field;
+    }
+  }
+  return nullptr;
+}
+
+#define FIELD1(T, a)                                                           \
+  do {                                                                         \
+    T *e = static_cast<T *>(parent);                                           \
+    field = find(ast, {&e->a});                                                \
+  } while (0)
+
+#define FIELD2(T, a, b)                                                        \
+  do {                                                                         \
+    T *e = static_cast<T *>(parent);                                           \
+    field = find(ast, {&e->a, &e->b});                                         \
+  } while (0)
+
+#define FIELD3(T, a, b, c)                                                     \
+  do {                                                                         \
+    T *e = static_cast<T *>(parent);                                           \
+    field = find(ast, {&e->a, &e->b, &e->c});                                  \
+  } while (0)
+
+void AstWalker::replace(Ast *ast, Ast *replacement) {
+  Ast *parent = ast->parent();
+  LOG_ASSERT(parent, "ast {}:{} parent must not null", ast->name(),
+             ast->location());
+  LOG_ASSERT(replacement, "replacement must not null");
+  Ast **field = nullptr;
+  switch (parent->kind()) {
+  case AstKind::Throw:
+    FIELD1(A_Throw, expr);
+    break;
+  case AstKind::Return:
+    FIELD1(A_Return, expr);
+    break;
+  case AstKind::Assign:
+    FIELD2(A_Assign, assignee, assignor);
+    break;
+  case AstKind::Postfix:
+    FIELD1(A_Postfix, expr);
+    break;
+  case AstKind::Prefix:
+    FIELD1(A_Prefix, expr);
+    break;
+  case AstKind::Infix:
+    FIELD2(A_Infix, left, right);
+    break;
+  case AstKind::Call:
+    FIELD1(A_Call, id);
+    break;
+  case AstKind::Exprs:
+    FIELD1(A_Exprs, expr);
+    break;
+  case AstKind::Index:
+    FIELD2(A_Index, expr, index);
+    break;
+  case AstKind::New:
+    FIELD2(A_New, type, count);
+    break;
+  case AstKind::Delete:
+    FIELD1(A_Delete, expr);
+    break;
+  case AstKind::Await:
+    FIELD1(A_Await, expr);
+    break;
+  case AstKind::If:
+    FIELD3(A_If, condition, thenp, elsep);
+    break;
+  case AstKind::Loop:
+    FIELD2(A_Loop, condition, body);
+    break;
+  case AstKind::Yield:
+    FIELD1(A_Yield, expr);
+    break;
+  case AstKind::LoopCondition:
+    FIELD3(A_LoopCondition, init, condition, update);
+    break;
+  case AstKind::LoopEnumerator:
+    FIELD3(A_LoopEnumerator, id, type, expr);
+    break;
+  case AstKind::DoWhile:
+    FIELD2(A_DoWhile, body, condition);
+    break;
+  case AstKind::Try:
+    FIELD3(A_Try, tryp, catchp, finallyp);
+    break;
+  case AstKind::BlockStats:
+    FIELD1(A_BlockStats, blockStat);
+    break;
+  case AstKind::FuncDef:
+    FIELD3(A_FuncDef, funcSign, resultType, body);
+    break;
+  case AstKind::FuncSign:
+    FIELD1(A_FuncSign, id);
+    break;
+  case AstKind::Param:
+    FIELD2(A_Param, id, type);
+    break;
+  case AstKind::VarDef:
+    FIELD3(A_VarDef, id, type, expr);
+    break;
+  case AstKind::TopStats:
+    FIELD1(A_TopStats, topStat);
+    break;
+  default:
+    break;
+  }
+  LOG_ASSERT(field, "ast {}:{} cannot be replaced in parent {}:{}",
+             ast->name(), ast->location(), parent->name(), parent->location());
+  *field = replacement;
+  replacement->parent() = parent;
+  ast->parent() = nullptr;
+}
+
+int AstWalker::index(AstKind kind) {
+  return kind._to_integral() - (+AstKind::Integer)._to_integral();
+}
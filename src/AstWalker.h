@@ -0,0 +1,38 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "Ast.h"
+#include "AstClasses.h"
+#include "iface/Phase.h"
+#include <vector>
+
+/**
+ * AstWalker walks the ast tree once, children are visited in source order, and
+ * dispatches enter/leave events of each node to the fusible phases in the
+ * order they are added.
+ *
+ * It doesn't recurse, the walk is driven by a heap allocated stack.
+ */
+class AstWalker {
+public:
+  AstWalker(const std::vector<FusiblePhase *> &phases);
+  virtual ~AstWalker() = default;
+  virtual void walk(Ast *ast);
+
+  // get children of ast in source order, null child is included
+  // returns children count, at most 3
+  static int children(Ast *ast, Ast *result[3]);
+
+  // replace ast with replacement in its parent, ast is detached but not
+  // deleted. list nodes (BlockStats, TopStats, ...) cannot be replaced.
+  static void replace(Ast *ast, Ast *replacement);
+
+  // ast kind index, starts from 0
+  static int index(AstKind kind);
+
+private:
+  // phases need enter/leave event, indexed by ast kind
+  std::vector<std::vector<FusiblePhase *>> enters_;
+  std::vector<std::vector<FusiblePhase *>> leaves_;
+};
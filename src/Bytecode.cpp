@@ -0,0 +1,66 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Bytecode.h"
+#include "fmt/format.h"
+#include "infra/Log.h"
+#include <sstream>
+
+namespace bytecode {
+
+#define BYTECODE_NAME(op) #op,
+static const char *OpcodeNames[] = {BYTECODE_OPS(BYTECODE_NAME)};
+#undef BYTECODE_NAME
+
+const char *opcodeName(int op) {
+  LOG_ASSERT(op >= 0 && op < OPCODES, "invalid opcode {}", op);
+  return OpcodeNames[op];
+}
+
+Cowstr Instruction::str() const {
+  return fmt::format("{} {} {} {}", opcodeName(op), a, b, c);
+}
+
+Function::Function(const Cowstr &a_name, int a_params)
+    : name(a_name), params(a_params), registers(a_params) {}
+
+Cowstr Function::str() const {
+  std::stringstream ss;
+  ss << fmt::format("function {} params:{} registers:{}\n", name, params,
+                    registers);
+  for (int i = 0; i < (int)constants.size(); i++) {
+    ss << fmt::format("  k{}: {}\n", i, constants[i].i);
+  }
+  for (int i = 0; i < (int)code.size(); i++) {
+    ss << fmt::format("  {}: {}\n", i, code[i].str());
+  }
+  return ss.str();
+}
+
+Module::Module() : globals(0) {}
+
+Module::~Module() {
+  for (int i = 0; i < (int)functions.size(); i++) {
+    delete functions[i];
+  }
+}
+
+int Module::find(const Cowstr &name) const {
+  for (int i = 0; i < (int)functions.size(); i++) {
+    if (functions[i]->name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+Cowstr Module::str() const {
+  std::stringstream ss;
+  ss << fmt::format("globals:{}\n", globals);
+  for (int i = 0; i < (int)functions.size(); i++) {
+    ss << functions[i]->str();
+  }
+  return ss.str();
+}
+
+} // namespace bytecode
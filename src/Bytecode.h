@@ -0,0 +1,127 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "infra/Cowstr.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Bytecode is a compact register-based instruction set, it's compiled from the
+ * resolved ast tree by BytecodeBuilder and executed by Vm without LLVM.
+ *
+ * Instruction: `op a b c`, each operand is 16-bit:
+ *    a: destination register, condition register of jump.
+ *    b, c: source registers, constant index, function index or jump target.
+ *
+ * Registers of a function are 64-bit values, parameters are the first ones:
+ *    signed int is sign-extended, unsigned int is zero-extended.
+ *    float is stored as double, rounded to float precision.
+ *    boolean is 0 or 1.
+ *
+ * 32-bit integer arithmetic runs on 64-bit registers, followed by SEXT32 or
+ * ZEXT32 to wrap around, float arithmetic is followed by FROUND32.
+ */
+
+// X-macro list of opcodes, the dispatch table of Vm follows the same order
+#define BYTECODE_OPS(X)                                                        \
+  X(NOP)      /* */                                                            \
+  X(MOV)      /* r[a] = r[b] */                                                \
+  X(LOADK)    /* r[a] = k[b] */                                                \
+  X(GETG)     /* r[a] = g[b] */                                                \
+  X(SETG)     /* g[b] = r[a] */                                                \
+  X(ADD)      /* r[a] = r[b] + r[c] */                                         \
+  X(SUB)      /* r[a] = r[b] - r[c] */                                         \
+  X(MUL)      /* r[a] = r[b] * r[c] */                                         \
+  X(SDIV)     /* r[a] = r[b] / r[c], signed */                                 \
+  X(UDIV)     /* r[a] = r[b] / r[c], unsigned */                               \
+  X(SREM)     /* r[a] = r[b] % r[c], signed */                                 \
+  X(UREM)     /* r[a] = r[b] % r[c], unsigned */                               \
+  X(AND)      /* r[a] = r[b] & r[c] */                                         \
+  X(OR)       /* r[a] = r[b] | r[c] */                                         \
+  X(XOR)      /* r[a] = r[b] ^ r[c] */                                         \
+  X(EQ)       /* r[a] = r[b] == r[c] */                                        \
+  X(NE)       /* r[a] = r[b] != r[c] */                                        \
+  X(SLT)      /* r[a] = r[b] < r[c], signed */                                 \
+  X(SLE)      /* r[a] = r[b] <= r[c], signed */                                \
+  X(ULT)      /* r[a] = r[b] < r[c], unsigned */                               \
+  X(ULE)      /* r[a] = r[b] <= r[c], unsigned */                              \
+  X(NEG)      /* r[a] = -r[b] */                                               \
+  X(BNOT)     /* r[a] = ~r[b] */                                               \
+  X(LNOT)     /* r[a] = !r[b] */                                               \
+  X(SEXT32)   /* r[a] = sign-extend low 32 bits of r[a] */                     \
+  X(ZEXT32)   /* r[a] = zero-extend low 32 bits of r[a] */                     \
+  X(FADD)     /* r[a] = r[b] + r[c] */                                         \
+  X(FSUB)     /* r[a] = r[b] - r[c] */                                         \
+  X(FMUL)     /* r[a] = r[b] * r[c] */                                         \
+  X(FDIV)     /* r[a] = r[b] / r[c] */                                         \
+  X(FREM)     /* r[a] = fmod(r[b], r[c]) */                                    \
+  X(FEQ)      /* r[a] = r[b] == r[c] */                                        \
+  X(FNE)      /* r[a] = r[b] != r[c] */                                        \
+  X(FLT)      /* r[a] = r[b] < r[c] */                                         \
+  X(FLE)      /* r[a] = r[b] <= r[c] */                                        \
+  X(FNEG)     /* r[a] = -r[b] */                                               \
+  X(FROUND32) /* r[a] = round r[a] to float precision */                       \
+  X(JMP)      /* pc = b */                                                     \
+  X(JT)       /* if r[a] then pc = b */                                        \
+  X(JF)       /* if !r[a] then pc = b */                                       \
+  X(CALL)     /* r[a] = function b, arguments start at r[c] */                 \
+  X(RET)      /* return r[a] */                                                \
+  X(RETV)     /* return void */                                                \
+  X(TRAP)     /* end of function without return */
+
+namespace bytecode {
+
+#define BYTECODE_ENUM(op) op,
+enum Opcode : uint16_t { BYTECODE_OPS(BYTECODE_ENUM) OPCODES };
+#undef BYTECODE_ENUM
+
+const char *opcodeName(int op);
+
+struct Instruction {
+  uint16_t op;
+  uint16_t a;
+  uint16_t b;
+  uint16_t c;
+
+  Cowstr str() const;
+};
+
+union Value {
+  int64_t i;
+  uint64_t u;
+  double d;
+};
+
+struct Function {
+  Cowstr name;
+  int params;
+  // registers including parameters
+  int registers;
+  std::vector<Instruction> code;
+  std::vector<Value> constants;
+
+  Function(const Cowstr &a_name, int a_params);
+  virtual ~Function() = default;
+
+  Cowstr str() const;
+};
+
+/**
+ * Module owns the functions compiled from a compile unit. The first function
+ * initializes global variables in source order.
+ */
+struct Module {
+  std::vector<Function *> functions;
+  int globals;
+
+  Module();
+  virtual ~Module();
+
+  // function index by name, or -1
+  int find(const Cowstr &name) const;
+
+  Cowstr str() const;
+};
+
+} // namespace bytecode
@@ -0,0 +1,720 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "BytecodeBuilder.h"
+#include "Ast.h"
+#include "Constant.h"
+#include "Symbol.h"
+#include "Token.h"
+#include "infra/Log.h"
+#include <limits>
+
+using namespace bytecode;
+
+// plain type symbol of literal
+static const TypeSymbol *typeOf(const Constant &c) {
+  switch (c.kind()) {
+  case Constant::INTEGER:
+    if (c.bit() == 32) {
+      return c.isSigned() ? TypeSymbol::ts_int() : TypeSymbol::ts_uint();
+    }
+    return c.isSigned() ? TypeSymbol::ts_long() : TypeSymbol::ts_ulong();
+  case Constant::FLOAT:
+    return c.bit() == 32 ? TypeSymbol::ts_float() : TypeSymbol::ts_double();
+  case Constant::BOOLEAN:
+    return TypeSymbol::ts_boolean();
+  default:
+    LOG_ASSERT(false, "invalid constant kind:{}", c.kind());
+  }
+  return nullptr;
+}
+
+static bool isInteger(const TypeSymbol *ts) {
+  return ts == TypeSymbol::ts_int() || ts == TypeSymbol::ts_uint() ||
+         ts == TypeSymbol::ts_long() || ts == TypeSymbol::ts_ulong();
+}
+
+static bool isUnsigned(const TypeSymbol *ts) {
+  return ts == TypeSymbol::ts_uint() || ts == TypeSymbol::ts_ulong();
+}
+
+static bool isFloat(const TypeSymbol *ts) {
+  return ts == TypeSymbol::ts_float() || ts == TypeSymbol::ts_double();
+}
+
+static bool isBoolean(const TypeSymbol *ts) {
+  return ts == TypeSymbol::ts_boolean();
+}
+
+static void unsupported(Ast *ast) {
+  LOG_ASSERT(false, "ast {}:{} is not supported in bytecode", ast->name(),
+             ast->location());
+}
+
+BytecodeBuilder::BytecodeBuilder()
+    : Phase("BytecodeBuilder"), module_(nullptr) {}
+
+BytecodeBuilder::~BytecodeBuilder() { delete module_; }
+
+void BytecodeBuilder::run(Ast *ast) { visit(ast); }
+
+Module *BytecodeBuilder::module() const { return module_; }
+
+const Symbol *BytecodeBuilder::symbol(int function) const {
+  LOG_ASSERT(function >= 0 && function < (int)symbols_.size(),
+             "invalid function index {}", function);
+  return symbols_[function];
+}
+
+void BytecodeBuilder::visitInteger(A_Integer *ast) { literal(ast); }
+
+void BytecodeBuilder::visitFloat(A_Float *ast) { literal(ast); }
+
+void BytecodeBuilder::visitBoolean(A_Boolean *ast) { literal(ast); }
+
+void BytecodeBuilder::visitCharacter(A_Character *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitString(A_String *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitNil(A_Nil *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitVoid(A_Void *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitVarId(A_VarId *ast) {
+  results_.push_back(readVariable(ast));
+}
+
+void BytecodeBuilder::visitBreak(A_Break *ast) {
+  LOG_ASSERT(!state().loops.empty(), "ast {}:{} break outside of loop",
+             ast->name(), ast->location());
+  state().loops.back().breaks.push_back(emit(JMP));
+}
+
+void BytecodeBuilder::visitContinue(A_Continue *ast) {
+  LOG_ASSERT(!state().loops.empty(), "ast {}:{} continue outside of loop",
+             ast->name(), ast->location());
+  state().loops.back().continues.push_back(emit(JMP));
+}
+
+void BytecodeBuilder::visitThrow(A_Throw *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitReturn(A_Return *ast) {
+  if (ast->expr) {
+    emit(RET, expression(ast->expr).reg);
+  } else {
+    emit(RETV);
+  }
+}
+
+void BytecodeBuilder::visitAssign(A_Assign *ast) {
+  LOG_ASSERT(ast->assignee->kind() == +AstKind::VarId,
+             "ast {}:{} assignee must be VarId", ast->name(),
+             ast->location());
+  A_VarId *varId = static_cast<A_VarId *>(ast->assignee);
+
+  int op = 0;
+  switch (ast->assignOp) {
+  case T_EQUAL: // =
+    break;
+  case T_PLUS_EQUAL: // +=
+    op = T_PLUS;
+    break;
+  case T_MINUS_EQUAL: // -=
+    op = T_MINUS;
+    break;
+  case T_ASTERISK_EQUAL: // *=
+    op = T_ASTERISK;
+    break;
+  case T_SLASH_EQUAL: // /=
+    op = T_SLASH;
+    break;
+  case T_PERCENT_EQUAL: // %=
+    op = T_PERCENT;
+    break;
+  case T_AMPERSAND_EQUAL: // &=
+    op = T_AMPERSAND;
+    break;
+  case T_BAR_EQUAL: // |=
+    op = T_BAR;
+    break;
+  case T_CARET_EQUAL: // ^=
+    op = T_CARET;
+    break;
+  default:
+    LOG_ASSERT(false, "invalid assignOp {} in ast {}:{}",
+               tokenName(ast->assignOp), ast->name(), ast->location());
+  }
+
+  // assignee is read before assignor, compound assignment writes to its
+  // register directly
+  Operand a = op ? readVariable(varId) : Operand{0, nullptr};
+  Operand v = expression(ast->assignor);
+  if (op) {
+    v = binary(op, a, v, a.reg, ast);
+  }
+  writeVariable(varId, v);
+  results_.push_back(v);
+}
+
+void BytecodeBuilder::visitPostfix(A_Postfix *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitInfix(A_Infix *ast) {
+  postorderInfix(ast, this, [this](A_Infix *e) { infix(e); });
+}
+
+void BytecodeBuilder::infix(A_Infix *ast) {
+  // right operand is visited last
+  Operand b = pop();
+  Operand a = pop();
+  results_.push_back(binary(ast->infixOp, a, b, allocate(), ast));
+}
+
+BytecodeBuilder::Operand BytecodeBuilder::binary(int op, const Operand &a,
+                                                 const Operand &b, int dest,
+                                                 Ast *ast) {
+  LOG_ASSERT(a.type == b.type, "ast {}:{} operand types {} != {}", ast->name(),
+             ast->location(), a.type->name(), b.type->name());
+  const TypeSymbol *ts = a.type;
+  bool integer = isInteger(ts);
+  bool unsignedInteger = isUnsigned(ts);
+  bool floating = isFloat(ts);
+  bool boolean = isBoolean(ts);
+
+  int code = NOP;
+  bool swap = false;
+  bool compare = false;
+  switch (op) {
+  case T_PLUS: // +
+    code = floating ? FADD : ADD;
+    break;
+  case T_MINUS: // -
+    code = floating ? FSUB : SUB;
+    break;
+  case T_ASTERISK: // *
+    code = floating ? FMUL : MUL;
+    break;
+  case T_SLASH: // /
+    code = floating ? FDIV : (unsignedInteger ? UDIV : SDIV);
+    break;
+  case T_PERCENT: // %
+    code = floating ? FREM : (unsignedInteger ? UREM : SREM);
+    break;
+  case T_BAR2:
+  case T_OR: // || or
+    code = boolean ? OR : NOP;
+    break;
+  case T_AMPERSAND2:
+  case T_AND: // && and
+    code = boolean ? AND : NOP;
+    break;
+  case T_BAR: // |
+    code = floating ? NOP : OR;
+    break;
+  case T_AMPERSAND: // &
+    code = floating ? NOP : AND;
+    break;
+  case T_CARET: // ^
+    code = floating ? NOP : XOR;
+    break;
+  case T_EQ: // ==
+    code = floating ? FEQ : EQ;
+    compare = true;
+    break;
+  case T_NEQ: // !=
+    code = floating ? FNE : NE;
+    compare = true;
+    break;
+  case T_GT: // >
+    swap = true;
+    // fallthrough
+  case T_LT: // <
+    code = floating ? FLT : (unsignedInteger ? ULT : SLT);
+    compare = true;
+    break;
+  case T_GE: // >=
+    swap = true;
+    // fallthrough
+  case T_LE: // <=
+    code = floating ? FLE : (unsignedInteger ? ULE : SLE);
+    compare = true;
+    break;
+  default:
+    break;
+  }
+  // arithmetic needs numbers, boolean only has logical and equality operators
+  bool arithmetic = code != AND && code != OR && code != XOR && !compare;
+  LOG_ASSERT(code != NOP && (integer || floating || boolean) &&
+                 !(boolean && arithmetic) &&
+                 !(boolean && compare && code != EQ && code != NE),
+             "invalid infixOp {} of type {} in ast {}:{}", tokenName(op),
+             ts->name(), ast->name(), ast->location());
+
+  if (swap) {
+    emit(code, dest, b.reg, a.reg);
+  } else {
+    emit(code, dest, a.reg, b.reg);
+  }
+  if (compare) {
+    return Operand{dest, TypeSymbol::ts_boolean()};
+  }
+  if (arithmetic) {
+    wrap(dest, ts);
+  }
+  return Operand{dest, ts};
+}
+
+void BytecodeBuilder::visitPrefix(A_Prefix *ast) {
+  Operand a = expression(ast->expr);
+  const TypeSymbol *ts = a.type;
+  if (ast->prefixOp == T_PLUS) {
+    LOG_ASSERT(isInteger(ts) || isFloat(ts),
+               "invalid prefixOp + of type {} in ast {}:{}", ts->name(),
+               ast->name(), ast->location());
+    results_.push_back(a);
+    return;
+  }
+  int dest = allocate();
+  switch (ast->prefixOp) {
+  case T_MINUS: // -
+    LOG_ASSERT(isInteger(ts) || isFloat(ts),
+               "invalid prefixOp - of type {} in ast {}:{}", ts->name(),
+               ast->name(), ast->location());
+    emit(isFloat(ts) ? FNEG : NEG, dest, a.reg);
+    break;
+  case T_TILDE: // ~
+    LOG_ASSERT(isInteger(ts), "invalid prefixOp ~ of type {} in ast {}:{}",
+               ts->name(), ast->name(), ast->location());
+    emit(BNOT, dest, a.reg);
+    break;
+  case T_EXCLAM:
+  case T_NOT: // ! not
+    LOG_ASSERT(isBoolean(ts), "invalid prefixOp ! of type {} in ast {}:{}",
+               ts->name(), ast->name(), ast->location());
+    emit(LNOT, dest, a.reg);
+    break;
+  default:
+    LOG_ASSERT(false, "invalid prefixOp {} in ast {}:{}",
+               tokenName(ast->prefixOp), ast->name(), ast->location());
+  }
+  wrap(dest, ts);
+  results_.push_back(Operand{dest, ts});
+}
+
+void BytecodeBuilder::visitCall(A_Call *ast) {
+  LOG_ASSERT(ast->id->kind() == +AstKind::VarId,
+             "ast {}:{} callee must be VarId", ast->name(), ast->location());
+  A_VarId *funcId = static_cast<A_VarId *>(ast->id);
+  auto it = functions_.find(funcId->symbol());
+  LOG_ASSERT(it != functions_.end(),
+             "ast {}:{} function {} must be defined before call", ast->name(),
+             ast->location(), funcId->name());
+  Function *callee = module_->functions[it->second];
+
+  // arguments are evaluated into the top registers, they're parameters of
+  // callee in place
+  int dest = allocate();
+  int base = state().next;
+  int n = 0;
+  for (A_Exprs *e = ast->args; e; e = e->next) {
+    n++;
+  }
+  LOG_ASSERT(n == callee->params, "ast {}:{} function {} arguments {} != {}",
+             ast->name(), ast->location(), funcId->name(), n,
+             callee->params);
+  for (int i = 0; i < n; i++) {
+    allocate();
+  }
+  int i = 0;
+  for (A_Exprs *e = ast->args; e; e = e->next, i++) {
+    move(base + i, expression(e->expr));
+    state().next = base + n;
+  }
+  emit(CALL, dest, it->second, base);
+  state().next = base;
+
+  const Ts_Func *funcType =
+      static_cast<const Ts_Func *>(funcId->symbol()->type());
+  if (funcType->result != TypeSymbol::ts_void()) {
+    results_.push_back(Operand{dest, funcType->result});
+  }
+}
+
+void BytecodeBuilder::visitExprs(A_Exprs *ast) {
+  // value of parenthesized expressions is the last one
+  for (A_Exprs *e = ast; e; e = e->next) {
+    if (e->next) {
+      statement(e->expr);
+    } else {
+      e->expr->accept(this);
+    }
+  }
+}
+
+void BytecodeBuilder::visitIndex(A_Index *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitNew(A_New *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitDelete(A_Delete *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitAwait(A_Await *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitIf(A_If *ast) {
+  int next = state().next;
+  Operand condition = expression(ast->condition);
+  int jumpElse = emit(JF, condition.reg);
+  state().next = next;
+
+  // if-else expression has a value when both branches have
+  int dest = allocate();
+  int results = (int)results_.size();
+  ast->thenp->accept(this);
+  const TypeSymbol *thenType = nullptr;
+  if ((int)results_.size() > results) {
+    thenType = results_.back().type;
+    move(dest, results_.back());
+  }
+  results_.resize(results);
+  state().next = dest + 1;
+
+  if (ast->elsep) {
+    int jumpEnd = emit(JMP);
+    patch(jumpElse, here());
+    ast->elsep->accept(this);
+    const TypeSymbol *elseType = nullptr;
+    if ((int)results_.size() > results) {
+      elseType = results_.back().type;
+      move(dest, results_.back());
+    }
+    results_.resize(results);
+    state().next = dest + 1;
+    patch(jumpEnd, here());
+    if (thenType && thenType == elseType) {
+      results_.push_back(Operand{dest, thenType});
+    }
+  } else {
+    patch(jumpElse, here());
+  }
+}
+
+void BytecodeBuilder::visitLoop(A_Loop *ast) {
+  LOG_ASSERT(ast->condition->kind() == +AstKind::LoopCondition,
+             "ast {}:{} is not supported in bytecode", ast->name(),
+             ast->location());
+  A_LoopCondition *loopCondition =
+      static_cast<A_LoopCondition *>(ast->condition);
+  if (loopCondition->init) {
+    statement(loopCondition->init);
+  }
+
+  int condPosition = here();
+  int jumpEnd = -1;
+  if (loopCondition->condition) {
+    int next = state().next;
+    Operand condition = expression(loopCondition->condition);
+    jumpEnd = emit(JF, condition.reg);
+    state().next = next;
+  }
+
+  state().loops.push_back(Loop());
+  statement(ast->body);
+  int continuePosition = here();
+  if (loopCondition->update) {
+    statement(loopCondition->update);
+  }
+  emit(JMP, 0, condPosition);
+
+  int endPosition = here();
+  Loop loop = state().loops.back();
+  state().loops.pop_back();
+  for (int pc : loop.breaks) {
+    patch(pc, endPosition);
+  }
+  for (int pc : loop.continues) {
+    patch(pc, continuePosition);
+  }
+  if (jumpEnd >= 0) {
+    patch(jumpEnd, endPosition);
+  }
+}
+
+void BytecodeBuilder::visitYield(A_Yield *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitLoopEnumerator(A_LoopEnumerator *ast) {
+  unsupported(ast);
+}
+
+void BytecodeBuilder::visitDoWhile(A_DoWhile *ast) {
+  int bodyPosition = here();
+  state().loops.push_back(Loop());
+  statement(ast->body);
+
+  int condPosition = here();
+  int next = state().next;
+  Operand condition = expression(ast->condition);
+  emit(JT, condition.reg, bodyPosition);
+  state().next = next;
+
+  int endPosition = here();
+  Loop loop = state().loops.back();
+  state().loops.pop_back();
+  for (int pc : loop.breaks) {
+    patch(pc, endPosition);
+  }
+  for (int pc : loop.continues) {
+    patch(pc, condPosition);
+  }
+}
+
+void BytecodeBuilder::visitTry(A_Try *ast) { unsupported(ast); }
+
+void BytecodeBuilder::visitBlock(A_Block *ast) {
+  if (ast->blockStats) {
+    ast->blockStats->accept(this);
+  }
+}
+
+void BytecodeBuilder::visitBlockStats(A_BlockStats *ast) {
+  // iterate the list, long block doesn't recurse
+  for (A_BlockStats *e = ast; e; e = e->next) {
+    statement(e->blockStat);
+  }
+}
+
+void BytecodeBuilder::visitFuncDef(A_FuncDef *ast) {
+  A_VarId *funcId = static_cast<A_VarId *>(ast->getId());
+  std::vector<std::pair<Ast *, Ast *>> funcArgs = ast->getArguments();
+  Function *func = module_->functions[function(ast)];
+
+  // each function has its own registers and loops, nested function cannot
+  // access local variables of outer function
+  FunctionState fs;
+  fs.function = func;
+  fs.next = 0;
+  states_.push_back(fs);
+  for (int i = 0; i < (int)funcArgs.size(); i++) {
+    A_VarId *argId = static_cast<A_VarId *>(funcArgs[i].first);
+    state().locals[argId->symbol()] = allocate();
+  }
+
+  // results of expression statements are not used
+  int results = (int)results_.size();
+  ast->body->accept(this);
+  const Ts_Func *funcType =
+      static_cast<const Ts_Func *>(funcId->symbol()->type());
+  if (funcType->result == TypeSymbol::ts_void()) {
+    emit(RETV);
+  } else if (ast->body->kind() != +AstKind::Block &&
+             (int)results_.size() > results) {
+    // function body is an expression
+    emit(RET, pop().reg);
+  } else {
+    // reached end of function without return
+    emit(TRAP);
+  }
+  results_.resize(results);
+  states_.pop_back();
+}
+
+void BytecodeBuilder::visitVarDef(A_VarDef *ast) {
+  A_VarId *varId = static_cast<A_VarId *>(ast->id);
+  if (ast->parent()->kind() == (+AstKind::TopStats) ||
+      ast->parent()->kind() == (+AstKind::CompileUnit)) {
+    // global variable is initialized by the first function
+    int index = module_->globals++;
+    globals_[varId->symbol()] = index;
+    Operand v = expression(ast->expr);
+    emit(SETG, v.reg, index);
+    return;
+  }
+  // local variable keeps its register after the statement
+  int reg = allocate();
+  Operand v = expression(ast->expr);
+  move(reg, v);
+  state().next = reg + 1;
+  state().locals[varId->symbol()] = reg;
+}
+
+void BytecodeBuilder::visitCompileUnit(A_CompileUnit *ast) {
+  delete module_;
+  module_ = new Module();
+  states_.clear();
+  results_.clear();
+  functions_.clear();
+  symbols_.clear();
+  globals_.clear();
+
+  FunctionState fs;
+  fs.function = new Function("@init", 0);
+  fs.next = 0;
+  module_->functions.push_back(fs.function);
+  symbols_.push_back(nullptr);
+  states_.push_back(fs);
+
+  // top-level functions can be called before definition
+  for (A_TopStats *e = ast->topStats; e; e = e->next) {
+    if (e->topStat->kind() == +AstKind::FuncDef) {
+      function(static_cast<A_FuncDef *>(e->topStat));
+    }
+  }
+  for (A_TopStats *e = ast->topStats; e; e = e->next) {
+    statement(e->topStat);
+  }
+  emit(RETV);
+  states_.pop_back();
+}
+
+BytecodeBuilder::FunctionState &BytecodeBuilder::state() {
+  LOG_ASSERT(!states_.empty(), "states_ must not empty");
+  return states_.back();
+}
+
+int BytecodeBuilder::emit(int op, int a, int b, int c) {
+  std::vector<Instruction> &code = state().function->code;
+  LOG_ASSERT(code.size() < std::numeric_limits<uint16_t>::max(),
+             "function {} is too large", state().function->name);
+  code.push_back(Instruction{(uint16_t)op, (uint16_t)a, (uint16_t)b,
+                             (uint16_t)c});
+  return (int)code.size() - 1;
+}
+
+int BytecodeBuilder::here() { return (int)state().function->code.size(); }
+
+void BytecodeBuilder::patch(int pc, int target) {
+  state().function->code[pc].b = (uint16_t)target;
+}
+
+int BytecodeBuilder::allocate() {
+  FunctionState &fs = state();
+  LOG_ASSERT(fs.next < std::numeric_limits<uint16_t>::max(),
+             "function {} has too many registers", fs.function->name);
+  int reg = fs.next++;
+  fs.function->registers = std::max(fs.function->registers, fs.next);
+  return reg;
+}
+
+int BytecodeBuilder::constant(Value value) {
+  std::vector<Value> &constants = state().function->constants;
+  for (int i = 0; i < (int)constants.size(); i++) {
+    if (constants[i].u == value.u) {
+      return i;
+    }
+  }
+  LOG_ASSERT(constants.size() < std::numeric_limits<uint16_t>::max(),
+             "function {} has too many constants", state().function->name);
+  constants.push_back(value);
+  return (int)constants.size() - 1;
+}
+
+int BytecodeBuilder::function(A_FuncDef *funcDef) {
+  A_VarId *funcId = static_cast<A_VarId *>(funcDef->getId());
+  auto it = functions_.find(funcId->symbol());
+  if (it != functions_.end()) {
+    return it->second;
+  }
+  int index = (int)module_->functions.size();
+  module_->functions.push_back(
+      new Function(funcId->name(), (int)funcDef->getArguments().size()));
+  functions_[funcId->symbol()] = index;
+  symbols_.push_back(funcId->symbol());
+  return index;
+}
+
+BytecodeBuilder::Operand BytecodeBuilder::pop() {
+  LOG_ASSERT(!results_.empty(), "results_ must not empty");
+  Operand result = results_.back();
+  results_.pop_back();
+  return result;
+}
+
+BytecodeBuilder::Operand BytecodeBuilder::expression(Ast *ast) {
+  int results = (int)results_.size();
+  ast->accept(this);
+  LOG_ASSERT((int)results_.size() > results, "ast {}:{} has no value",
+             ast->name(), ast->location());
+  Operand result = pop();
+  results_.resize(results);
+  return result;
+}
+
+void BytecodeBuilder::statement(Ast *ast) {
+  // local variable defined by the statement is not released
+  int next = state().next;
+  int results = (int)results_.size();
+  ast->accept(this);
+  results_.resize(results);
+  if (ast->kind() != +AstKind::VarDef) {
+    state().next = next;
+  }
+}
+
+void BytecodeBuilder::move(int dest, const Operand &src) {
+  if (dest != src.reg) {
+    emit(MOV, dest, src.reg);
+  }
+}
+
+void BytecodeBuilder::wrap(int reg, const TypeSymbol *type) {
+  if (type == TypeSymbol::ts_int()) {
+    emit(SEXT32, reg);
+  } else if (type == TypeSymbol::ts_uint()) {
+    emit(ZEXT32, reg);
+  } else if (type == TypeSymbol::ts_float()) {
+    emit(FROUND32, reg);
+  }
+}
+
+BytecodeBuilder::Operand BytecodeBuilder::readVariable(A_VarId *varId) {
+  Symbol *symbol = varId->symbol();
+  const TypeSymbol *ts = symbol->type();
+  LOG_ASSERT(isInteger(ts) || isFloat(ts) || isBoolean(ts),
+             "ast {}:{} type {} is not supported in bytecode", varId->name(),
+             varId->location(), ts->name());
+  auto local = state().locals.find(symbol);
+  if (local != state().locals.end()) {
+    return Operand{local->second, ts};
+  }
+  auto global = globals_.find(symbol);
+  LOG_ASSERT(global != globals_.end(),
+             "ast {}:{} symbol {}:{} is not a local or global variable",
+             varId->name(), varId->location(), symbol->name(),
+             symbol->location());
+  int reg = allocate();
+  emit(GETG, reg, global->second);
+  return Operand{reg, ts};
+}
+
+void BytecodeBuilder::writeVariable(A_VarId *varId, const Operand &value) {
+  Symbol *symbol = varId->symbol();
+  auto local = state().locals.find(symbol);
+  if (local != state().locals.end()) {
+    move(local->second, value);
+    return;
+  }
+  auto global = globals_.find(symbol);
+  LOG_ASSERT(global != globals_.end(),
+             "ast {}:{} symbol {}:{} is not a local or global variable",
+             varId->name(), varId->location(), symbol->name(),
+             symbol->location());
+  emit(SETG, value.reg, global->second);
+}
+
+void BytecodeBuilder::literal(Ast *ast) {
+  Constant c = Constant::fromAst(ast);
+  Value value;
+  switch (c.kind()) {
+  case Constant::INTEGER:
+    value.u = c.asUInt64();
+    break;
+  case Constant::FLOAT:
+    value.d = c.bit() == 32 ? (double)c.asFloat() : c.asDouble();
+    break;
+  case Constant::BOOLEAN:
+    value.u = c.asBoolean() ? 1 : 0;
+    break;
+  default:
+    unsupported(ast);
+  }
+  int reg = allocate();
+  emit(LOADK, reg, constant(value));
+  results_.push_back(Operand{reg, typeOf(c)});
+}
@@ -0,0 +1,127 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "AstClasses.h"
+#include "Bytecode.h"
+#include "SymbolClasses.h"
+#include "iface/Phase.h"
+#include "iface/Visitor.h"
+#include <unordered_map>
+#include <vector>
+
+/**
+ * BytecodeBuilder compiles the resolved compile unit into a bytecode module,
+ * it's the backend of `dimc --interpret` next to IrBuilder.
+ *
+ * Registers are allocated like a stack: a local variable takes the next free
+ * register until its enclosing statement ends, temporaries of an expression
+ * are released after the statement. Arguments of a call are evaluated into
+ * the top registers of caller, so they are parameters of callee in place, see
+ * Vm.
+ *
+ * Only the subset lowered by IrBuilder is supported: integer, float and
+ * boolean values, operators, control flow, global variables and calls of
+ * functions.
+ */
+class BytecodeBuilder : public Phase, public Visitor {
+public:
+  BytecodeBuilder();
+  virtual ~BytecodeBuilder();
+  virtual void run(Ast *ast);
+  virtual bytecode::Module *module() const;
+  // function symbol of bytecode function, null for initializer
+  const Symbol *symbol(int function) const;
+
+  virtual void visitInteger(A_Integer *ast);
+  virtual void visitFloat(A_Float *ast);
+  virtual void visitBoolean(A_Boolean *ast);
+  virtual void visitCharacter(A_Character *ast);
+  virtual void visitString(A_String *ast);
+  virtual void visitNil(A_Nil *ast);
+  virtual void visitVoid(A_Void *ast);
+  virtual void visitVarId(A_VarId *ast);
+  virtual void visitBreak(A_Break *ast);
+  virtual void visitContinue(A_Continue *ast);
+
+  virtual void visitThrow(A_Throw *ast);
+  virtual void visitReturn(A_Return *ast);
+  virtual void visitAssign(A_Assign *ast);
+  virtual void visitPostfix(A_Postfix *ast);
+  virtual void visitInfix(A_Infix *ast);
+  virtual void visitPrefix(A_Prefix *ast);
+  virtual void visitCall(A_Call *ast);
+  virtual void visitExprs(A_Exprs *ast);
+  virtual void visitIndex(A_Index *ast);
+  virtual void visitNew(A_New *ast);
+  virtual void visitDelete(A_Delete *ast);
+  virtual void visitAwait(A_Await *ast);
+  virtual void visitIf(A_If *ast);
+  virtual void visitLoop(A_Loop *ast);
+  virtual void visitYield(A_Yield *ast);
+  virtual void visitLoopEnumerator(A_LoopEnumerator *ast);
+  virtual void visitDoWhile(A_DoWhile *ast);
+  virtual void visitTry(A_Try *ast);
+  virtual void visitBlock(A_Block *ast);
+  virtual void visitBlockStats(A_BlockStats *ast);
+  virtual void visitFuncDef(A_FuncDef *ast);
+  virtual void visitVarDef(A_VarDef *ast);
+  virtual void visitCompileUnit(A_CompileUnit *ast);
+
+private:
+  // register holds the value of visited expression
+  struct Operand {
+    int reg;
+    const TypeSymbol *type;
+  };
+
+  // pending jumps of break/continue in a loop
+  struct Loop {
+    std::vector<int> breaks;
+    std::vector<int> continues;
+  };
+
+  // function being compiled, nested function pushes a new one
+  struct FunctionState {
+    bytecode::Function *function;
+    std::unordered_map<const Symbol *, int> locals;
+    // next free register
+    int next;
+    std::vector<Loop> loops;
+  };
+
+  FunctionState &state();
+  int emit(int op, int a = 0, int b = 0, int c = 0);
+  // position of next instruction
+  int here();
+  // set jump target of instruction at pc
+  void patch(int pc, int target);
+  int allocate();
+  int constant(bytecode::Value value);
+  // index of function, it's added to module at first time
+  int function(A_FuncDef *funcDef);
+
+  Operand pop();
+  // visit expression, its value is popped
+  Operand expression(Ast *ast);
+  // visit statement, its temporaries are released
+  void statement(Ast *ast);
+  void move(int dest, const Operand &src);
+  // wrap around integer or round float after arithmetic
+  void wrap(int reg, const TypeSymbol *type);
+  // combine infix node from its visited operands
+  void infix(A_Infix *ast);
+  Operand binary(int op, const Operand &a, const Operand &b, int dest,
+                 Ast *ast);
+  Operand readVariable(A_VarId *varId);
+  void writeVariable(A_VarId *varId, const Operand &value);
+  void literal(Ast *ast);
+
+  bytecode::Module *module_;
+  std::vector<FunctionState> states_;
+  // visited expressions, each pushes one result
+  std::vector<Operand> results_;
+  std::unordered_map<const Symbol *, int> functions_;
+  std::vector<const Symbol *> symbols_;
+  std::unordered_map<const Symbol *, int> globals_;
+};
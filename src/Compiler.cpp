@@ -2,15 +2,27 @@
 // Apache License Version 2.0
 
 #include "Compiler.h"
+#include "BytecodeBuilder.h"
+#include "ConstantFolder.h"
 #include "Dumper.h"
+#include "EscapeAnalysis.h"
 #include "IrBuilder.h"
+#include "ObjectCache.h"
+#include "PerfMap.h"
+#include "Repl.h"
+#include "RuntimeSymbols.h"
 #include "Scanner.h"
+#include "Symbol.h"
 #include "SymbolBuilder.h"
 #include "SymbolResolver.h"
+#include "Tiering.h"
+#include "Vm.h"
 #include "iface/Phase.h"
 #include "infra/Files.h"
 #include "infra/Log.h"
 #include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/CodeGen.h"
 #include "llvm/Support/FileSystem.h"
@@ -20,13 +32,16 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
 #include <string>
 #include <system_error>
 
 void Compiler::createObjectFile(const Cowstr &inputFile,
                                 const Cowstr &outputFile, int optLevel,
                                 bool debugInfo, const Cowstr &cpu,
-                                const Cowstr &features) {
+                                const Cowstr &features, int jobs) {
   Cowstr dest = outputFile.empty() ? (inputFile + ".o") : outputFile;
 
   llvm::InitializeNativeTarget();
@@ -51,13 +66,26 @@ void Compiler::createObjectFile(const Cowstr &inputFile,
 
   SymbolBuilder symbolBuilder;
   SymbolResolver symbolResolver;
+  ParallelSymbolResolver parallelSymbolResolver(jobs);
+  ConstantFolder constantFolder;
+  EscapeAnalysis escapeAnalysis;
   IrBuilder irBuilder(optLevel > 0);
+  ParallelIrBuilder parallelIrBuilder(optLevel > 0, jobs);
 
-  PhaseManager pm({&symbolBuilder, &symbolResolver, &irBuilder});
+  PhaseManager pm;
+  pm.add(&symbolBuilder);
+  pm.add(jobs > 1 ? static_cast<Phase *>(&parallelSymbolResolver)
+                  : static_cast<Phase *>(&symbolResolver));
+  pm.add(&constantFolder);
+  pm.add(&escapeAnalysis);
+  pm.add(jobs > 1 ? static_cast<Phase *>(&parallelIrBuilder)
+                  : static_cast<Phase *>(&irBuilder));
   pm.run(scanner.compileUnit());
+  llvm::Module *llvmModule =
+      jobs > 1 ? parallelIrBuilder.llvmModule() : irBuilder.llvmModule();
 
-  irBuilder.llvmModule()->setDataLayout(targetMachine->createDataLayout());
-  irBuilder.llvmModule()->setTargetTriple(targetTriple);
+  llvmModule->setDataLayout(targetMachine->createDataLayout());
+  llvmModule->setTargetTriple(targetTriple);
 
   std::error_code dest_errcode;
   llvm::raw_fd_ostream dest_os(dest.str(), dest_errcode,
@@ -76,14 +104,14 @@ void Compiler::createObjectFile(const Cowstr &inputFile,
                                              objFileType),
          "error: LLVM target machine cannot emit object file");
 
-  passManager.run(*irBuilder.llvmModule());
+  passManager.run(*llvmModule);
   dest_os.flush();
   dest_os.close();
 }
 
 void Compiler::create_llvm_ll_file(const Cowstr &inputFile,
                                    const Cowstr &outputFile,
-                                   bool enableFunctionPass) {
+                                   bool enableFunctionPass, int jobs) {
   Cowstr dest = outputFile.empty() ? (inputFile + ".ll") : outputFile;
 
   Scanner scanner(inputFile);
@@ -91,13 +119,26 @@ void Compiler::create_llvm_ll_file(const Cowstr &inputFile,
 
   SymbolBuilder symbolBuilder;
   SymbolResolver symbolResolver;
+  ParallelSymbolResolver parallelSymbolResolver(jobs);
+  ConstantFolder constantFolder;
+  EscapeAnalysis escapeAnalysis;
   IrBuilder irBuilder(enableFunctionPass);
+  ParallelIrBuilder parallelIrBuilder(enableFunctionPass, jobs);
 
-  PhaseManager pm({&symbolBuilder, &symbolResolver, &irBuilder});
+  PhaseManager pm;
+  pm.add(&symbolBuilder);
+  pm.add(jobs > 1 ? static_cast<Phase *>(&parallelSymbolResolver)
+                  : static_cast<Phase *>(&symbolResolver));
+  pm.add(&constantFolder);
+  pm.add(&escapeAnalysis);
+  pm.add(jobs > 1 ? static_cast<Phase *>(&parallelIrBuilder)
+                  : static_cast<Phase *>(&irBuilder));
   pm.run(scanner.compileUnit());
+  llvm::Module *llvmModule =
+      jobs > 1 ? parallelIrBuilder.llvmModule() : irBuilder.llvmModule();
 
   FileWriter fwriter(dest);
-  fwriter.write(Cowstr::from(irBuilder.llvmModule()));
+  fwriter.write(Cowstr::from(llvmModule));
 }
 
 void Compiler::dumpAst(const Cowstr &inputFile) {
@@ -114,3 +155,141 @@ void Compiler::dumpAst(const Cowstr &inputFile) {
     PRINT("{}\n", dumper.dump()[i]);
   }
 }
+
+int Compiler::interpret(const Cowstr &inputFile, int jobs, int tier) {
+  Scanner scanner(inputFile);
+  ASSERT(scanner.parse() == 0, "error: syntax error in {}\n", inputFile);
+
+  SymbolBuilder symbolBuilder;
+  SymbolResolver symbolResolver;
+  ParallelSymbolResolver parallelSymbolResolver(jobs);
+  ConstantFolder constantFolder;
+  BytecodeBuilder bytecodeBuilder;
+
+  PhaseManager pm;
+  pm.add(&symbolBuilder);
+  pm.add(jobs > 1 ? static_cast<Phase *>(&parallelSymbolResolver)
+                  : static_cast<Phase *>(&symbolResolver));
+  pm.add(&constantFolder);
+  pm.add(&bytecodeBuilder);
+  pm.run(scanner.compileUnit());
+
+  bytecode::Module *module = bytecodeBuilder.module();
+  Vm vm(module);
+  std::unique_ptr<Tiering> tiering(
+      tier > 0 ? new Tiering(&vm, scanner.compileUnit(), &bytecodeBuilder, tier)
+               : nullptr);
+  int main = module->find("main");
+  int result = 0;
+  if (main < 0) {
+    vm.initialize();
+  } else {
+    ASSERT(module->functions[main]->params == 0,
+           "error: main function cannot have parameters\n");
+    result = (int)vm.call(main, {}).i;
+  }
+  if (tiering) {
+    tiering->wait();
+    LOG_INFO("{}", tiering->stats().str());
+  }
+  return result;
+}
+
+int Compiler::run(const Cowstr &inputFile, int optLevel, int jobs,
+                  const Cowstr &cacheDirectory) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmParser();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  Scanner scanner(inputFile);
+  ASSERT(scanner.parse() == 0, "error: syntax error in {}\n", inputFile);
+
+  SymbolBuilder symbolBuilder;
+  SymbolResolver symbolResolver;
+  ParallelSymbolResolver parallelSymbolResolver(jobs);
+  ConstantFolder constantFolder;
+  EscapeAnalysis escapeAnalysis;
+  IrBuilder irBuilder(optLevel > 0);
+  ParallelIrBuilder parallelIrBuilder(optLevel > 0, jobs);
+
+  PhaseManager pm;
+  pm.add(&symbolBuilder);
+  pm.add(jobs > 1 ? static_cast<Phase *>(&parallelSymbolResolver)
+                  : static_cast<Phase *>(&symbolResolver));
+  pm.add(&constantFolder);
+  pm.add(&escapeAnalysis);
+  pm.add(jobs > 1 ? static_cast<Phase *>(&parallelIrBuilder)
+                  : static_cast<Phase *>(&irBuilder));
+  pm.run(scanner.compileUnit());
+
+  std::unique_ptr<llvm::LLVMContext> context(new llvm::LLVMContext());
+  std::unique_ptr<llvm::Module> llvmModule =
+      jobs > 1 ? parallelIrBuilder.copyModule(*context)
+               : irBuilder.copyModule(*context);
+
+  llvm::Expected<llvm::orc::JITTargetMachineBuilder> targetMachineBuilder =
+      llvm::orc::JITTargetMachineBuilder::detectHost();
+  ASSERT(targetMachineBuilder, "error: {}\n",
+         llvm::toString(targetMachineBuilder.takeError()));
+  static const llvm::CodeGenOpt::Level codeGenOptLevels[] = {
+      llvm::CodeGenOpt::None, llvm::CodeGenOpt::Less,
+      llvm::CodeGenOpt::Default, llvm::CodeGenOpt::Aggressive};
+  targetMachineBuilder->setCodeGenOptLevel(
+      codeGenOptLevels[std::max(0, std::min(optLevel, 3))]);
+
+  std::unique_ptr<ObjectCache> cache;
+  llvm::orc::LLJITBuilder jitBuilder;
+  if (!cacheDirectory.empty()) {
+    cache.reset(new ObjectCache(
+        cacheDirectory,
+        fmt::format("{}-{}-{}-O{}",
+                    targetMachineBuilder->getTargetTriple().str(),
+                    llvm::sys::getHostCPUName().str(),
+                    targetMachineBuilder->getFeatures().getString(),
+                    optLevel)));
+    jitBuilder.setCompileFunctionCreator(cache->compileFunction());
+  }
+  jitBuilder.setJITTargetMachineBuilder(std::move(*targetMachineBuilder));
+  PerfMap::setup(jitBuilder);
+  llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>> jit = jitBuilder.create();
+  ASSERT(jit, "error: cannot create JIT: {}\n",
+         llvm::toString(jit.takeError()));
+  RuntimeSymbols::define(**jit);
+
+  llvmModule->setDataLayout((*jit)->getDataLayout());
+  llvm::Error error = (*jit)->addIRModule(
+      llvm::orc::ThreadSafeModule(std::move(llvmModule), std::move(context)));
+  ASSERT(!error, "error: {}\n", llvm::toString(std::move(error)));
+
+  int result = 0;
+  Scope *global =
+      static_cast<A_CompileUnit *>(scanner.compileUnit())->scope();
+  Symbol *main = global->s_resolve("main");
+  if (main && main->kind() == +SymbolKind::Func) {
+    const Ts_Func *type = static_cast<const Ts_Func *>(main->type());
+    ASSERT(type->params.empty(),
+           "error: main function cannot have parameters\n");
+    llvm::Expected<llvm::JITEvaluatedSymbol> symbol =
+        (*jit)->lookup(IrBuilder::linkName(main).str());
+    ASSERT(symbol, "error: {}\n", llvm::toString(symbol.takeError()));
+    uint64_t address = symbol->getAddress();
+    if (type->result == TypeSymbol::ts_int()) {
+      result = reinterpret_cast<int32_t (*)()>(address)();
+    } else if (type->result == TypeSymbol::ts_long()) {
+      result = (int)reinterpret_cast<int64_t (*)()>(address)();
+    } else {
+      ASSERT(type->result == TypeSymbol::ts_void(),
+             "error: main function must return int, long or void\n");
+      reinterpret_cast<void (*)()>(address)();
+    }
+  }
+  if (cache) {
+    LOG_INFO("{}", cache->stats().str());
+  }
+  return result;
+}
+
+void Compiler::repl() {
+  Repl repl;
+  repl.run(std::cin, std::cout);
+}
@@ -10,11 +10,27 @@ public:
                                const Cowstr &outputFile = "", int optLevel = 0,
                                bool debugInfo = false,
                                const Cowstr &cpu = "generic",
-                               const Cowstr &features = "");
+                               const Cowstr &features = "", int jobs = 1);
 
   static void create_llvm_ll_file(const Cowstr &inputFile,
                                   const Cowstr &outputFile = "",
-                                  bool enableFunctionPass = false);
+                                  bool enableFunctionPass = false,
+                                  int jobs = 1);
 
   static void dumpAst(const Cowstr &inputFile);
+
+  // compile into bytecode and run `main` function without LLVM, returns the
+  // result of `main` or 0. with `tier` > 0, functions hot after `tier`
+  // invocations and backedges are compiled by LLVM JIT in background
+  static int interpret(const Cowstr &inputFile, int jobs = 1, int tier = 0);
+
+  // compile with LLVM JIT and run `main` function, returns the result of
+  // `main` or 0. compiled machine code is kept in `cacheDirectory` and
+  // loaded by next run of the same module, see ObjectCache. empty
+  // `cacheDirectory` disables cache
+  static int run(const Cowstr &inputFile, int optLevel = 0, int jobs = 1,
+                 const Cowstr &cacheDirectory = "");
+
+  // read-eval-print loop on standard input, see Repl
+  static void repl();
 };
@@ -0,0 +1,309 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Constant.h"
+#include "Ast.h"
+#include "Token.h"
+#include "fmt/format.h"
+#include "infra/Log.h"
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+// integer arithmetic wraps around like the lowered instructions
+template <typename T> static Constant foldInteger(int op, T a, T b) {
+  typedef typename std::make_unsigned<T>::type U;
+  switch (op) {
+  case T_PLUS: // +
+    return Constant::fromInteger((T)((U)a + (U)b));
+  case T_MINUS: // -
+    return Constant::fromInteger((T)((U)a - (U)b));
+  case T_ASTERISK: // *
+    return Constant::fromInteger((T)((U)a * (U)b));
+  case T_SLASH:   // /
+  case T_PERCENT: // %
+    if (b == 0 || (std::is_signed<T>::value &&
+                   a == std::numeric_limits<T>::min() && b == (T)-1)) {
+      return Constant();
+    }
+    return Constant::fromInteger((T)(op == T_SLASH ? a / b : a % b));
+  case T_AMPERSAND: // &
+    return Constant::fromInteger((T)(a & b));
+  case T_BAR: // |
+    return Constant::fromInteger((T)(a | b));
+  case T_CARET: // ^
+    return Constant::fromInteger((T)(a ^ b));
+  case T_EQ: // ==
+    return Constant::fromBoolean(a == b);
+  case T_NEQ: // !=
+    return Constant::fromBoolean(a != b);
+  case T_LT: // <
+    return Constant::fromBoolean(a < b);
+  case T_LE: // <=
+    return Constant::fromBoolean(a <= b);
+  case T_GT: // >
+    return Constant::fromBoolean(a > b);
+  case T_GE: // >=
+    return Constant::fromBoolean(a >= b);
+  default:
+    return Constant();
+  }
+}
+
+template <typename T> static Constant foldFloat(int op, T a, T b) {
+  switch (op) {
+  case T_PLUS: // +
+    return Constant::fromFloat(a + b);
+  case T_MINUS: // -
+    return Constant::fromFloat(a - b);
+  case T_ASTERISK: // *
+    return Constant::fromFloat(a * b);
+  case T_SLASH: // /
+    return Constant::fromFloat(a / b);
+  case T_PERCENT: // %
+    return Constant::fromFloat((T)std::fmod(a, b));
+  case T_EQ: // ==
+    return Constant::fromBoolean(a == b);
+  case T_NEQ: // !=
+    return Constant::fromBoolean(a != b);
+  case T_LT: // <
+    return Constant::fromBoolean(a < b);
+  case T_LE: // <=
+    return Constant::fromBoolean(a <= b);
+  case T_GT: // >
+    return Constant::fromBoolean(a > b);
+  case T_GE: // >=
+    return Constant::fromBoolean(a >= b);
+  default:
+    return Constant();
+  }
+}
+
+static Constant foldBoolean(int op, bool a, bool b) {
+  switch (op) {
+  case T_AMPERSAND2:
+  case T_AND:
+  case T_AMPERSAND: // && and &
+    return Constant::fromBoolean(a && b);
+  case T_BAR2:
+  case T_OR:
+  case T_BAR: // || or |
+    return Constant::fromBoolean(a || b);
+  case T_CARET:
+  case T_NEQ: // ^ !=
+    return Constant::fromBoolean(a != b);
+  case T_EQ: // ==
+    return Constant::fromBoolean(a == b);
+  default:
+    return Constant();
+  }
+}
+
+Constant::Constant() : kind_(NONE), bit_(0), isSigned_(false) {
+  data_.u = 0;
+}
+
+Constant Constant::fromInteger(int32_t value) {
+  Constant c;
+  c.kind_ = INTEGER;
+  c.bit_ = 32;
+  c.isSigned_ = true;
+  c.data_.u = (uint64_t)(int64_t)value;
+  return c;
+}
+
+Constant Constant::fromInteger(uint32_t value) {
+  Constant c;
+  c.kind_ = INTEGER;
+  c.bit_ = 32;
+  c.isSigned_ = false;
+  c.data_.u = (uint64_t)value;
+  return c;
+}
+
+Constant Constant::fromInteger(int64_t value) {
+  Constant c;
+  c.kind_ = INTEGER;
+  c.bit_ = 64;
+  c.isSigned_ = true;
+  c.data_.u = (uint64_t)value;
+  return c;
+}
+
+Constant Constant::fromInteger(uint64_t value) {
+  Constant c;
+  c.kind_ = INTEGER;
+  c.bit_ = 64;
+  c.isSigned_ = false;
+  c.data_.u = value;
+  return c;
+}
+
+Constant Constant::fromFloat(float value) {
+  Constant c;
+  c.kind_ = FLOAT;
+  c.bit_ = 32;
+  c.data_.f = value;
+  return c;
+}
+
+Constant Constant::fromFloat(double value) {
+  Constant c;
+  c.kind_ = FLOAT;
+  c.bit_ = 64;
+  c.data_.d = value;
+  return c;
+}
+
+Constant Constant::fromBoolean(bool value) {
+  Constant c;
+  c.kind_ = BOOLEAN;
+  c.data_.b = value;
+  return c;
+}
+
+Constant Constant::fromAst(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::Integer: {
+    A_Integer *e = static_cast<A_Integer *>(ast);
+    if (e->bit() == 32) {
+      return e->isSigned() ? fromInteger(e->asInt32())
+                           : fromInteger(e->asUInt32());
+    }
+    return e->isSigned() ? fromInteger(e->asInt64())
+                         : fromInteger(e->asUInt64());
+  }
+  case AstKind::Float: {
+    A_Float *e = static_cast<A_Float *>(ast);
+    return e->bit() == 32 ? fromFloat(e->asFloat()) : fromFloat(e->asDouble());
+  }
+  case AstKind::Boolean:
+    return fromBoolean(static_cast<A_Boolean *>(ast)->asBoolean());
+  default:
+    return Constant();
+  }
+}
+
+Ast *Constant::toAst(const Location &location) const {
+  switch (kind_) {
+  case INTEGER:
+    return new A_Integer(str(), location);
+  case FLOAT:
+    return new A_Float(str(), location);
+  case BOOLEAN:
+    return new A_Boolean(str(), location);
+  default:
+    LOG_ASSERT(false, "invalid constant kind:{}", kind_);
+  }
+  return nullptr;
+}
+
+Constant Constant::binary(int op, const Constant &a, const Constant &b) {
+  if (a.kind_ != b.kind_ || a.bit_ != b.bit_ || a.isSigned_ != b.isSigned_) {
+    return Constant();
+  }
+  switch (a.kind_) {
+  case INTEGER:
+    if (a.bit_ == 32) {
+      return a.isSigned_ ? foldInteger<int32_t>(op, (int32_t)a.data_.u,
+                                                (int32_t)b.data_.u)
+                         : foldInteger<uint32_t>(op, (uint32_t)a.data_.u,
+                                                 (uint32_t)b.data_.u);
+    }
+    return a.isSigned_ ? foldInteger<int64_t>(op, (int64_t)a.data_.u,
+                                              (int64_t)b.data_.u)
+                       : foldInteger<uint64_t>(op, a.data_.u, b.data_.u);
+  case FLOAT:
+    return a.bit_ == 32 ? foldFloat<float>(op, a.data_.f, b.data_.f)
+                        : foldFloat<double>(op, a.data_.d, b.data_.d);
+  case BOOLEAN:
+    return foldBoolean(op, a.data_.b, b.data_.b);
+  default:
+    return Constant();
+  }
+}
+
+Constant Constant::unary(int op, const Constant &a) {
+  switch (a.kind_) {
+  case INTEGER: {
+    // +a = 0 + a, -a = 0 - a, ~a = -1 ^ a
+    if (op != T_PLUS && op != T_MINUS && op != T_TILDE) {
+      return Constant();
+    }
+    int binaryOp = op == T_TILDE ? T_CARET : op;
+    int64_t init = op == T_TILDE ? -1 : 0;
+    Constant c;
+    if (a.bit_ == 32) {
+      c = a.isSigned_ ? fromInteger((int32_t)init)
+                      : fromInteger((uint32_t)init);
+    } else {
+      c = a.isSigned_ ? fromInteger(init) : fromInteger((uint64_t)init);
+    }
+    return binary(binaryOp, c, a);
+  }
+  case FLOAT:
+    if (op == T_PLUS) {
+      return a;
+    } else if (op == T_MINUS) {
+      return a.bit_ == 32 ? fromFloat(-a.data_.f) : fromFloat(-a.data_.d);
+    }
+    return Constant();
+  case BOOLEAN:
+    if (op == T_EXCLAM || op == T_NOT) {
+      return fromBoolean(!a.data_.b);
+    }
+    return Constant();
+  default:
+    return Constant();
+  }
+}
+
+bool Constant::valid() const { return kind_ != NONE; }
+
+int Constant::kind() const { return kind_; }
+
+int Constant::bit() const { return bit_; }
+
+bool Constant::isSigned() const { return isSigned_; }
+
+uint64_t Constant::asUInt64() const {
+  LOG_ASSERT(kind_ == INTEGER, "kind {} != INTEGER", kind_);
+  return data_.u;
+}
+
+float Constant::asFloat() const {
+  LOG_ASSERT(kind_ == FLOAT && bit_ == 32, "kind {} bit {} is not float",
+             kind_, bit_);
+  return data_.f;
+}
+
+double Constant::asDouble() const {
+  LOG_ASSERT(kind_ == FLOAT && bit_ == 64, "kind {} bit {} is not double",
+             kind_, bit_);
+  return data_.d;
+}
+
+bool Constant::asBoolean() const {
+  LOG_ASSERT(kind_ == BOOLEAN, "kind {} != BOOLEAN", kind_);
+  return data_.b;
+}
+
+// same as literal in source code
+Cowstr Constant::str() const {
+  switch (kind_) {
+  case INTEGER:
+    if (bit_ == 32) {
+      return isSigned_ ? fmt::format("{}", (int32_t)data_.u)
+                       : fmt::format("{}u", (uint32_t)data_.u);
+    }
+    return isSigned_ ? fmt::format("{}l", (int64_t)data_.u)
+                     : fmt::format("{}ul", data_.u);
+  case FLOAT:
+    return bit_ == 32 ? fmt::format("{:.9g}f", data_.f)
+                      : fmt::format("{:.17g}d", data_.d);
+  case BOOLEAN:
+    return data_.b ? "true" : "false";
+  default:
+    return "none";
+  }
+}
@@ -0,0 +1,66 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "AstClasses.h"
+#include "Location.h"
+#include "infra/Cowstr.h"
+#include <cstdint>
+
+/**
+ * Constant is a compile-time value of integer, float or boolean, it's
+ * evaluated by ConstantFolder and Interpreter.
+ *
+ * Arithmetic follows the lowered semantics: integer wraps around, division by
+ * zero (and signed overflow of division) is not evaluated and returns an
+ * invalid constant.
+ */
+class Constant {
+public:
+  enum ConstantKind { NONE = 0, INTEGER, FLOAT, BOOLEAN };
+
+  // invalid constant
+  Constant();
+  virtual ~Constant() = default;
+
+  static Constant fromInteger(int32_t value);
+  static Constant fromInteger(uint32_t value);
+  static Constant fromInteger(int64_t value);
+  static Constant fromInteger(uint64_t value);
+  static Constant fromFloat(float value);
+  static Constant fromFloat(double value);
+  static Constant fromBoolean(bool value);
+  // invalid constant if ast is not integer, float or boolean literal
+  static Constant fromAst(Ast *ast);
+  // new literal ast
+  Ast *toAst(const Location &location) const;
+
+  // invalid constant if cannot evaluate
+  static Constant binary(int op, const Constant &a, const Constant &b);
+  static Constant unary(int op, const Constant &a);
+
+  bool valid() const;
+  int kind() const;
+  // 32, 64 for integer and float
+  int bit() const;
+  bool isSigned() const;
+
+  // integer is stored sign-extended for signed, zero-extended for unsigned
+  uint64_t asUInt64() const;
+  float asFloat() const;
+  double asDouble() const;
+  bool asBoolean() const;
+
+  Cowstr str() const;
+
+private:
+  int kind_;
+  int bit_;
+  bool isSigned_;
+  union {
+    uint64_t u;
+    float f;
+    double d;
+    bool b;
+  } data_;
+};
@@ -0,0 +1,221 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "ConstantFolder.h"
+#include "Ast.h"
+#include "AstWalker.h"
+#include "Constant.h"
+#include "Interpreter.h"
+#include "Symbol.h"
+#include "infra/Log.h"
+
+// copy of literal
+static Ast *copy(Ast *ast, const Location &location) {
+  Constant c = Constant::fromAst(ast);
+  LOG_ASSERT(c.valid(), "ast {}:{} is not constant", ast->name(),
+             ast->location());
+  return c.toAst(location);
+}
+
+// `s` of reduction `+ s` of foreach, which is assigned by the loop
+static bool isReduction(A_VarId *ast) {
+  Ast *prefix = ast->parent();
+  if (!prefix || prefix->kind() != +AstKind::Prefix) {
+    return false;
+  }
+  Ast *e = prefix->parent();
+  while (e && e->kind() == +AstKind::Exprs) {
+    e = e->parent();
+  }
+  return e && e->kind() == +AstKind::Loop;
+}
+
+// innermost scope enclosing ast, built by SymbolBuilder
+static Scope *enclosingScope(Ast *ast) {
+  for (Ast *e = ast->parent(); e; e = e->parent()) {
+    switch (e->kind()) {
+    case AstKind::Loop:
+      return static_cast<A_Loop *>(e)->scope();
+    case AstKind::Block:
+      return static_cast<A_Block *>(e)->scope();
+    case AstKind::FuncDef:
+      return static_cast<S_Func *>(
+          static_cast<A_VarId *>(static_cast<A_FuncDef *>(e)->getId())
+              ->symbol());
+    case AstKind::CompileUnit:
+      return static_cast<A_CompileUnit *>(e)->scope();
+    default:
+      break;
+    }
+  }
+  return nullptr;
+}
+
+ConstantFolder::ConstantFolder()
+    : FusiblePhase("ConstantFolder", PhaseOrder::PostOrder,
+                   {AstKind::VarId, AstKind::Prefix, AstKind::Infix,
+                    AstKind::Call, AstKind::Exprs, AstKind::If,
+                    AstKind::VarDef, AstKind::CompileUnit},
+                   true) {}
+
+ConstantFolder::~ConstantFolder() {
+  for (int i = 0; i < (int)garbage_.size(); i++) {
+    delete garbage_[i];
+  }
+}
+
+void ConstantFolder::leave(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::VarId:
+    leaveVarId(static_cast<A_VarId *>(ast));
+    break;
+  case AstKind::Prefix: {
+    Ast *result = fold(static_cast<A_Prefix *>(ast));
+    if (result) {
+      replace(ast, result);
+    }
+  } break;
+  case AstKind::Infix: {
+    Ast *result = fold(static_cast<A_Infix *>(ast));
+    if (result) {
+      replace(ast, result);
+    }
+  } break;
+  case AstKind::Call:
+    leaveCall(static_cast<A_Call *>(ast));
+    break;
+  case AstKind::Exprs:
+    leaveExprs(static_cast<A_Exprs *>(ast));
+    break;
+  case AstKind::If:
+    leaveIf(static_cast<A_If *>(ast));
+    break;
+  case AstKind::VarDef:
+    leaveVarDef(static_cast<A_VarDef *>(ast));
+    break;
+  case AstKind::CompileUnit:
+    for (int i = 0; i < (int)garbage_.size(); i++) {
+      delete garbage_[i];
+    }
+    garbage_.clear();
+    break;
+  default:
+    break;
+  }
+}
+
+Ast *ConstantFolder::fold(A_Infix *ast) {
+  Constant a = Constant::fromAst(ast->left);
+  Constant b = Constant::fromAst(ast->right);
+  if (!a.valid() || !b.valid()) {
+    return nullptr;
+  }
+  Constant c = Constant::binary(ast->infixOp, a, b);
+  return c.valid() ? c.toAst(ast->location()) : nullptr;
+}
+
+Ast *ConstantFolder::fold(A_Prefix *ast) {
+  Constant a = Constant::fromAst(ast->expr);
+  if (!a.valid()) {
+    return nullptr;
+  }
+  Constant c = Constant::unary(ast->prefixOp, a);
+  return c.valid() ? c.toAst(ast->location()) : nullptr;
+}
+
+bool ConstantFolder::isConstant(Ast *ast) {
+  return ast->kind() == +AstKind::Integer || ast->kind() == +AstKind::Float ||
+         ast->kind() == +AstKind::Boolean;
+}
+
+void ConstantFolder::leaveVarId(A_VarId *ast) {
+  Symbol *sym = ast->symbol();
+  if (!sym || sym->ast() == ast) {
+    return;
+  }
+  auto it = vals_.find(sym);
+  if (it == vals_.end()) {
+    return;
+  }
+  Ast *parent = ast->parent();
+  LOG_ASSERT(!(parent->kind() == +AstKind::Assign &&
+               static_cast<A_Assign *>(parent)->assignee == ast) &&
+                 parent->kind() != +AstKind::Postfix,
+             "val {}:{} cannot be assigned at {}", sym->name(),
+             sym->location(), ast->location());
+  // reduction is an assignee too, it's never replaced by literal
+  ASSERT(!isReduction(ast), "error: reduction {}:{} is a val\n", ast->name(),
+         ast->location());
+  if (it->second) {
+    replace(ast, copy(it->second, ast->location()));
+  }
+}
+
+void ConstantFolder::leaveVarDef(A_VarDef *ast) {
+  if (!ast->immutable) {
+    return;
+  }
+  Symbol *sym = static_cast<A_VarId *>(ast->id)->symbol();
+  vals_[sym] = isConstant(ast->expr) ? ast->expr : nullptr;
+}
+
+void ConstantFolder::leaveCall(A_Call *ast) {
+  A_FuncDef *funcDef = Interpreter::callee(ast);
+  if (!funcDef) {
+    return;
+  }
+  std::vector<Constant> args;
+  for (A_Exprs *e = ast->args; e; e = e->next) {
+    Constant c = Constant::fromAst(e->expr);
+    if (!c.valid()) {
+      return;
+    }
+    args.push_back(c);
+  }
+  // call is kept if it cannot be evaluated
+  Constant result = interpreter_.call(funcDef, args);
+  if (result.valid()) {
+    replace(ast, result.toAst(ast->location()));
+  }
+}
+
+void ConstantFolder::leaveExprs(A_Exprs *ast) {
+  // `(literal)` is replaced by literal, call arguments are kept
+  Ast *parent = ast->parent();
+  if (ast->next || !isConstant(ast->expr) ||
+      parent->kind() == +AstKind::Call ||
+      (parent->kind() == +AstKind::Exprs &&
+       static_cast<A_Exprs *>(parent)->next == ast)) {
+    return;
+  }
+  Ast *expr = ast->expr;
+  ast->expr = nullptr;
+  replace(ast, expr);
+}
+
+void ConstantFolder::leaveIf(A_If *ast) {
+  if (ast->condition->kind() != +AstKind::Boolean) {
+    return;
+  }
+  // detach the taken branch, the if node is replaced by it
+  Ast *branch = nullptr;
+  if (static_cast<A_Boolean *>(ast->condition)->asBoolean()) {
+    branch = ast->thenp;
+    ast->thenp = nullptr;
+  } else {
+    branch = ast->elsep;
+    ast->elsep = nullptr;
+  }
+  if (!branch) {
+    // empty block defines nothing, it shares the enclosing scope
+    A_Block *block = new A_Block(nullptr, ast->location());
+    block->scope() = enclosingScope(ast);
+    branch = block;
+  }
+  replace(ast, branch);
+}
+
+void ConstantFolder::replace(Ast *ast, Ast *replacement) {
+  AstWalker::replace(ast, replacement);
+  garbage_.push_back(ast);
+}
@@ -0,0 +1,55 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "AstClasses.h"
+#include "Interpreter.h"
+#include "SymbolClasses.h"
+#include "iface/Phase.h"
+#include <unordered_map>
+#include <vector>
+
+/**
+ * ConstantFolder rewrites the ast tree in place before IrBuilder:
+ *    fold infix/prefix expressions of integer, float and boolean literals.
+ *    propagate `val` variables which are initialized by literal.
+ *    unwrap parenthesized literal.
+ *    evaluate call of `const def` function with literal arguments, see
+ *    Interpreter.
+ *    prune `if` branch whose condition is literal.
+ *
+ * Folding follows the lowered semantics: integer arithmetic wraps around,
+ * division by zero (and signed overflow of division) is left to runtime.
+ *
+ * It walks in post-order, so children are folded before their parent. The
+ * replaced nodes are deleted after the compile unit is walked. It's a barrier,
+ * while a fusible phase added after it still shares its walk and sees the tree
+ * before folding.
+ */
+class ConstantFolder : public FusiblePhase {
+public:
+  ConstantFolder();
+  virtual ~ConstantFolder();
+
+  virtual void leave(Ast *ast);
+
+  // fold infix/prefix of literals, returns new literal or null if cannot fold
+  static Ast *fold(A_Infix *ast);
+  static Ast *fold(A_Prefix *ast);
+  // integer, float or boolean literal
+  static bool isConstant(Ast *ast);
+
+private:
+  void leaveVarId(A_VarId *ast);
+  void leaveVarDef(A_VarDef *ast);
+  void leaveCall(A_Call *ast);
+  void leaveExprs(A_Exprs *ast);
+  void leaveIf(A_If *ast);
+  void replace(Ast *ast, Ast *replacement);
+
+  // val variables, literal initializer or null if not constant
+  std::unordered_map<const Symbol *, Ast *> vals_;
+  // replaced nodes
+  std::vector<Ast *> garbage_;
+  Interpreter interpreter_;
+};
@@ -672,8 +672,13 @@ void Drawer::visitVarId(A_VarId *ast) {
 }
 
 void Drawer::visitPlainType(A_PlainType *ast) { VISIT_TOKEN(ast, g_, token); }
+void Drawer::visitArrayType(A_ArrayType *ast) {
+  VISIT_CHILD1(ast, g_, elementType);
+}
 
 void Drawer::visitThrow(A_Throw *ast) { VISIT_CHILD1(ast, g_, expr); }
+void Drawer::visitDelete(A_Delete *ast) { VISIT_CHILD1(ast, g_, expr); }
+void Drawer::visitAwait(A_Await *ast) { VISIT_CHILD1(ast, g_, expr); }
 void Drawer::visitReturn(A_Return *ast) { VISIT_CHILD1(ast, g_, expr); }
 void Drawer::visitYield(A_Yield *ast) { VISIT_CHILD1(ast, g_, expr); }
 void Drawer::visitBlock(A_Block *ast) {
@@ -708,6 +713,8 @@ void Drawer::visitPrefix(A_Prefix *ast) {
 
 void Drawer::visitCall(A_Call *ast) { VISIT_CHILD2(ast, g_, id, args); }
 void Drawer::visitExprs(A_Exprs *ast) { VISIT_CHILD2(ast, g_, expr, next); }
+void Drawer::visitIndex(A_Index *ast) { VISIT_CHILD2(ast, g_, expr, index); }
+void Drawer::visitNew(A_New *ast) { VISIT_CHILD2(ast, g_, type, count); }
 void Drawer::visitDoWhile(A_DoWhile *ast) {
   VISIT_CHILD2(ast, g_, body, condition);
 }
@@ -730,11 +737,15 @@ void Drawer::visitLoop(A_Loop *ast) {
   if (ast->condition) {
     ast->condition->accept(this);
   }
+  if (ast->reductions) {
+    ast->reductions->accept(this);
+  }
   if (ast->body) {
     ast->body->accept(this);
   }
 
   linkAstToAst(ast, ast->condition, BOOST_PP_STRINGIZE(condition), g_);
+  linkAstToAst(ast, ast->reductions, BOOST_PP_STRINGIZE(reductions), g_);
   linkAstToAst(ast, ast->body, BOOST_PP_STRINGIZE(body), g_);
 }
 
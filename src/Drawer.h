@@ -35,8 +35,11 @@ public:
   virtual void visitVarId(A_VarId *ast);
 
   virtual void visitPlainType(A_PlainType *ast);
+  virtual void visitArrayType(A_ArrayType *ast);
 
   virtual void visitThrow(A_Throw *ast);
+  virtual void visitDelete(A_Delete *ast);
+  virtual void visitAwait(A_Await *ast);
   virtual void visitReturn(A_Return *ast);
   virtual void visitYield(A_Yield *ast);
   virtual void visitBlock(A_Block *ast);
@@ -46,6 +49,8 @@ public:
 
   virtual void visitCall(A_Call *ast);
   virtual void visitExprs(A_Exprs *ast);
+  virtual void visitIndex(A_Index *ast);
+  virtual void visitNew(A_New *ast);
   virtual void visitDoWhile(A_DoWhile *ast);
   virtual void visitBlockStats(A_BlockStats *ast);
   virtual void visitFuncSign(A_FuncSign *ast);
@@ -7,9 +7,8 @@
 #include "boost/preprocessor/stringize.hpp"
 #include "fmt/format.h"
 
-Dumper::Dumper() : Phase("Dumper"), indent_(0) {}
-
-void Dumper::run(Ast *ast) { ast->accept(this); }
+Dumper::Dumper()
+    : FusiblePhase("Dumper", PhaseOrder::PrePostOrder), indent_(0) {}
 
 std::vector<Cowstr> &Dumper::dump() { return dump_; }
 
@@ -34,190 +33,162 @@ static Cowstr stringize(const Cowstr &hint, TypeSymbol *tsym) {
   return fmt::format("{}:{}@{}", hint, tsym->name(), tsym->identifier());
 }
 
-#define STRINGIZE0(a) dump_.push_back(stringize(a, indent_))
-
-#define STRINGIZE0_SYMBOL(a)                                                   \
-  do {                                                                         \
-    std::vector<Cowstr> joiner;                                                \
-    joiner.push_back(stringize(a, indent_));                                   \
-    if (a->symbol()) {                                                         \
-      joiner.push_back(stringize("symbol", a->symbol()));                      \
-    } else {                                                                   \
-      joiner.push_back("symbol:null");                                         \
-    }                                                                          \
-    if (a->typeSymbol()) {                                                     \
-      joiner.push_back(stringize("typeSymbol", a->typeSymbol()));              \
-    } else {                                                                   \
-      joiner.push_back("typeSymbol:null");                                     \
-    }                                                                          \
-    dump_.push_back(Cowstr::join(joiner.begin(), joiner.end(), " "));          \
-  } while (0)
-
-#define STRINGIZE1(a, b)                                                       \
+#define HINT(a, b)                                                             \
   do {                                                                         \
-    std::vector<Cowstr> joiner;                                                \
-    joiner.push_back(stringize(a, indent_));                                   \
     if (a->b) {                                                                \
       joiner.push_back(stringize(BOOST_PP_STRINGIZE(b), a->b));                \
     }                                                                          \
-    dump_.push_back(Cowstr::join(joiner.begin(), joiner.end(), " "));          \
-    indent_ += 1;                                                              \
-    if (a->b) {                                                                \
-      a->b->accept(this);                                                      \
-    }                                                                          \
-    indent_ -= 1;                                                              \
   } while (0)
 
-#define STRINGIZE1_NO_INDENT(a, b)                                             \
+#define HINT1(T, b)                                                            \
   do {                                                                         \
-    std::vector<Cowstr> joiner;                                                \
-    joiner.push_back(stringize(a, indent_));                                   \
-    if (a->b) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(b), a->b));                \
-    }                                                                          \
-    dump_.push_back(Cowstr::join(joiner.begin(), joiner.end(), " "));          \
-    if (a->b) {                                                                \
-      a->b->accept(this);                                                      \
-    }                                                                          \
-  } while (0)
-
-#define STRINGIZE2(a, b, c)                                                    \
-  do {                                                                         \
-    std::vector<Cowstr> joiner;                                                \
-    joiner.push_back(stringize(a, indent_));                                   \
-    if (a->b) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(b), a->b));                \
-    }                                                                          \
-    if (a->c) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(c), a->c));                \
-    }                                                                          \
-    dump_.push_back(Cowstr::join(joiner.begin(), joiner.end(), " "));          \
-    indent_ += 1;                                                              \
-    if (a->b) {                                                                \
-      a->b->accept(this);                                                      \
-    }                                                                          \
-    if (a->c) {                                                                \
-      a->c->accept(this);                                                      \
-    }                                                                          \
-    indent_ -= 1;                                                              \
-  } while (0)
-
-#define STRINGIZE2_NO_INDENT(a, b, c)                                          \
-  do {                                                                         \
-    std::vector<Cowstr> joiner;                                                \
-    joiner.push_back(stringize(a, indent_));                                   \
-    if (a->b) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(b), a->b));                \
-    }                                                                          \
-    if (a->c) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(c), a->c));                \
-    }                                                                          \
-    dump_.push_back(Cowstr::join(joiner.begin(), joiner.end(), " "));          \
-    if (a->b) {                                                                \
-      a->b->accept(this);                                                      \
-    }                                                                          \
-    if (a->c) {                                                                \
-      a->c->accept(this);                                                      \
-    }                                                                          \
+    T *e = static_cast<T *>(ast);                                              \
+    HINT(e, b);                                                                \
   } while (0)
 
-#define STRINGIZE3(a, b, c, d)                                                 \
+#define HINT2(T, b, c)                                                         \
   do {                                                                         \
-    std::vector<Cowstr> joiner;                                                \
-    joiner.push_back(stringize(a, indent_));                                   \
-    if (a->b) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(b), a->b));                \
-    }                                                                          \
-    if (a->c) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(c), a->c));                \
-    }                                                                          \
-    if (a->d) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(d), a->d));                \
-    }                                                                          \
-    dump_.push_back(Cowstr::join(joiner.begin(), joiner.end(), " "));          \
-    indent_ += 1;                                                              \
-    if (a->b) {                                                                \
-      a->b->accept(this);                                                      \
-    }                                                                          \
-    if (a->c) {                                                                \
-      a->c->accept(this);                                                      \
-    }                                                                          \
-    if (a->d) {                                                                \
-      a->d->accept(this);                                                      \
-    }                                                                          \
-    indent_ -= 1;                                                              \
+    T *e = static_cast<T *>(ast);                                              \
+    HINT(e, b);                                                                \
+    HINT(e, c);                                                                \
   } while (0)
 
-#define STRINGIZE3_NO_INDENT(a, b, c, d)                                       \
+#define HINT3(T, b, c, d)                                                      \
   do {                                                                         \
-    std::vector<Cowstr> joiner;                                                \
-    joiner.push_back(stringize(a, indent_));                                   \
-    if (a->b) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(b), a->b));                \
-    }                                                                          \
-    if (a->c) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(c), a->c));                \
-    }                                                                          \
-    if (a->d) {                                                                \
-      joiner.push_back(stringize(BOOST_PP_STRINGIZE(d), a->d));                \
-    }                                                                          \
-    dump_.push_back(Cowstr::join(joiner.begin(), joiner.end(), " "));          \
-    if (a->b) {                                                                \
-      a->b->accept(this);                                                      \
-    }                                                                          \
-    if (a->c) {                                                                \
-      a->c->accept(this);                                                      \
-    }                                                                          \
-    if (a->d) {                                                                \
-      a->d->accept(this);                                                      \
-    }                                                                          \
+    T *e = static_cast<T *>(ast);                                              \
+    HINT(e, b);                                                                \
+    HINT(e, c);                                                                \
+    HINT(e, d);                                                                \
   } while (0)
 
-void Dumper::visitInteger(A_Integer *ast) { STRINGIZE0(ast); }
-void Dumper::visitFloat(A_Float *ast) { STRINGIZE0(ast); }
-void Dumper::visitBoolean(A_Boolean *ast) { STRINGIZE0(ast); }
-void Dumper::visitCharacter(A_Character *ast) { STRINGIZE0(ast); }
-void Dumper::visitString(A_String *ast) { STRINGIZE0(ast); }
-void Dumper::visitNil(A_Nil *ast) { STRINGIZE0(ast); }
-void Dumper::visitVoid(A_Void *ast) { STRINGIZE0(ast); }
-void Dumper::visitVarId(A_VarId *ast) { STRINGIZE0_SYMBOL(ast); }
-void Dumper::visitBreak(A_Break *ast) { STRINGIZE0(ast); }
-void Dumper::visitContinue(A_Continue *ast) { STRINGIZE0(ast); }
-
-void Dumper::visitThrow(A_Throw *ast) { STRINGIZE1(ast, expr); }
-void Dumper::visitReturn(A_Return *ast) { STRINGIZE1(ast, expr); }
-void Dumper::visitAssign(A_Assign *ast) { STRINGIZE2(ast, assignee, assignor); }
-void Dumper::visitPostfix(A_Postfix *ast) { STRINGIZE1(ast, expr); }
-void Dumper::visitInfix(A_Infix *ast) { STRINGIZE2(ast, left, right); }
-void Dumper::visitPrefix(A_Prefix *ast) { STRINGIZE1(ast, expr); }
-void Dumper::visitCall(A_Call *ast) { STRINGIZE2(ast, id, args); }
-void Dumper::visitExprs(A_Exprs *ast) { STRINGIZE2_NO_INDENT(ast, expr, next); }
-void Dumper::visitIf(A_If *ast) { STRINGIZE3(ast, condition, thenp, elsep); }
-void Dumper::visitLoop(A_Loop *ast) { STRINGIZE2(ast, condition, body); }
-void Dumper::visitYield(A_Yield *ast) { STRINGIZE1(ast, expr); }
-void Dumper::visitLoopCondition(A_LoopCondition *ast) {
-  STRINGIZE3(ast, init, condition, update);
-}
-void Dumper::visitLoopEnumerator(A_LoopEnumerator *ast) {
-  STRINGIZE3(ast, id, type, expr);
-}
-void Dumper::visitDoWhile(A_DoWhile *ast) { STRINGIZE2(ast, body, condition); }
-void Dumper::visitTry(A_Try *ast) { STRINGIZE3(ast, tryp, catchp, finallyp); }
-void Dumper::visitBlock(A_Block *ast) { STRINGIZE1(ast, blockStats); }
-void Dumper::visitBlockStats(A_BlockStats *ast) {
-  STRINGIZE2_NO_INDENT(ast, blockStat, next);
+// list node doesn't indent its children
+static bool isList(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::Exprs:
+  case AstKind::BlockStats:
+  case AstKind::Params:
+  case AstKind::TopStats:
+    return true;
+  default:
+    return false;
+  }
 }
-void Dumper::visitPlainType(A_PlainType *ast) { STRINGIZE0(ast); }
-void Dumper::visitFuncDef(A_FuncDef *ast) {
-  STRINGIZE3(ast, funcSign, resultType, body);
-}
-void Dumper::visitFuncSign(A_FuncSign *ast) { STRINGIZE2(ast, id, params); }
-void Dumper::visitParams(A_Params *ast) {
-  STRINGIZE2_NO_INDENT(ast, param, next);
+
+void Dumper::enter(Ast *ast) {
+  std::vector<Cowstr> joiner;
+  joiner.push_back(stringize(ast, indent_));
+  switch (ast->kind()) {
+  case AstKind::VarId: {
+    A_VarId *e = static_cast<A_VarId *>(ast);
+    if (e->symbol()) {
+      joiner.push_back(stringize("symbol", e->symbol()));
+    } else {
+      joiner.push_back("symbol:null");
+    }
+    if (e->typeSymbol()) {
+      joiner.push_back(stringize("typeSymbol", e->typeSymbol()));
+    } else {
+      joiner.push_back("typeSymbol:null");
+    }
+  } break;
+  case AstKind::Throw:
+    HINT1(A_Throw, expr);
+    break;
+  case AstKind::Return:
+    HINT1(A_Return, expr);
+    break;
+  case AstKind::Assign:
+    HINT2(A_Assign, assignee, assignor);
+    break;
+  case AstKind::Postfix:
+    HINT1(A_Postfix, expr);
+    break;
+  case AstKind::Infix:
+    HINT2(A_Infix, left, right);
+    break;
+  case AstKind::Prefix:
+    HINT1(A_Prefix, expr);
+    break;
+  case AstKind::Call:
+    HINT2(A_Call, id, args);
+    break;
+  case AstKind::Exprs:
+    HINT2(A_Exprs, expr, next);
+    break;
+  case AstKind::Index:
+    HINT2(A_Index, expr, index);
+    break;
+  case AstKind::New:
+    HINT2(A_New, type, count);
+    break;
+  case AstKind::Delete:
+    HINT1(A_Delete, expr);
+    break;
+  case AstKind::Await:
+    HINT1(A_Await, expr);
+    break;
+  case AstKind::If:
+    HINT3(A_If, condition, thenp, elsep);
+    break;
+  case AstKind::Loop:
+    HINT3(A_Loop, condition, reductions, body);
+    break;
+  case AstKind::Yield:
+    HINT1(A_Yield, expr);
+    break;
+  case AstKind::LoopCondition:
+    HINT3(A_LoopCondition, init, condition, update);
+    break;
+  case AstKind::LoopEnumerator:
+    HINT3(A_LoopEnumerator, id, type, expr);
+    break;
+  case AstKind::DoWhile:
+    HINT2(A_DoWhile, body, condition);
+    break;
+  case AstKind::Try:
+    HINT3(A_Try, tryp, catchp, finallyp);
+    break;
+  case AstKind::Block:
+    HINT1(A_Block, blockStats);
+    break;
+  case AstKind::BlockStats:
+    HINT2(A_BlockStats, blockStat, next);
+    break;
+  case AstKind::ArrayType:
+    HINT1(A_ArrayType, elementType);
+    break;
+  case AstKind::FuncDef:
+    HINT3(A_FuncDef, funcSign, resultType, body);
+    break;
+  case AstKind::FuncSign:
+    HINT2(A_FuncSign, id, params);
+    break;
+  case AstKind::Params:
+    HINT2(A_Params, param, next);
+    break;
+  case AstKind::Param:
+    HINT2(A_Param, id, type);
+    break;
+  case AstKind::VarDef:
+    HINT3(A_VarDef, id, type, expr);
+    break;
+  case AstKind::TopStats:
+    HINT2(A_TopStats, topStat, next);
+    break;
+  case AstKind::CompileUnit:
+    HINT1(A_CompileUnit, topStats);
+    break;
+  default:
+    break;
+  }
+  dump_.push_back(Cowstr::join(joiner.begin(), joiner.end(), " "));
+  if (!isList(ast)) {
+    indent_ += 1;
+  }
 }
-void Dumper::visitParam(A_Param *ast) { STRINGIZE2(ast, id, type); }
-void Dumper::visitVarDef(A_VarDef *ast) { STRINGIZE3(ast, id, type, expr); }
-void Dumper::visitTopStats(A_TopStats *ast) {
-  STRINGIZE2_NO_INDENT(ast, topStat, next);
+
+void Dumper::leave(Ast *ast) {
+  if (!isList(ast)) {
+    indent_ -= 1;
+  }
 }
-void Dumper::visitCompileUnit(A_CompileUnit *ast) { STRINGIZE1(ast, topStats); }
@@ -0,0 +1,248 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "EscapeAnalysis.h"
+#include "Ast.h"
+#include "Symbol.h"
+#include "Token.h"
+#include "infra/Log.h"
+#include <cstdint>
+
+// bytes of plain type element, 0 if unknown
+static int elementBytes(Ast *type) {
+  if (type->kind() != +AstKind::PlainType) {
+    return 0;
+  }
+  switch (static_cast<A_PlainType *>(type)->token) {
+  case T_BYTE:
+  case T_UBYTE:
+  case T_CHAR:
+  case T_BOOLEAN:
+    return 1;
+  case T_SHORT:
+  case T_USHORT:
+    return 2;
+  case T_INT:
+  case T_UINT:
+  case T_FLOAT:
+    return 4;
+  case T_LONG:
+  case T_ULONG:
+  case T_DOUBLE:
+    return 8;
+  case T_BYTE16:
+  case T_SHORT8:
+  case T_INT4:
+  case T_LONG2:
+  case T_FLOAT4:
+  case T_DOUBLE2:
+    return 16;
+  case T_INT8:
+  case T_LONG4:
+  case T_FLOAT8:
+  case T_DOUBLE4:
+    return 32;
+  default:
+    return 0;
+  }
+}
+
+// `a[i]` accesses an element of array a, but slice `a[i..j]` is an alias of it
+static bool isElement(A_VarId *array) {
+  Ast *parent = array->parent();
+  if (parent->kind() != +AstKind::Index ||
+      static_cast<A_Index *>(parent)->expr != array) {
+    return false;
+  }
+  Ast *index = static_cast<A_Index *>(parent)->index;
+  return index->kind() != +AstKind::Infix ||
+         static_cast<A_Infix *>(index)->infixOp != T_DOT2;
+}
+
+// literal array length, -1 if not literal or negative
+static int64_t literalLength(Ast *count) {
+  if (count->kind() != +AstKind::Integer) {
+    return -1;
+  }
+  A_Integer *e = static_cast<A_Integer *>(count);
+  int64_t n = 0;
+  if (e->bit() == 32) {
+    n = e->isSigned() ? (int64_t)e->asInt32() : (int64_t)e->asUInt32();
+  } else if (e->isSigned()) {
+    n = e->asInt64();
+  } else {
+    n = e->asUInt64() > (uint64_t)INT64_MAX ? -1 : (int64_t)e->asUInt64();
+  }
+  return n < 0 ? -1 : n;
+}
+
+EscapeAnalysis::EscapeAnalysis(int maxStackBytes)
+    : FusiblePhase("EscapeAnalysis", PhaseOrder::PrePostOrder,
+                   {AstKind::VarId, AstKind::VarDef, AstKind::New,
+                    AstKind::Block, AstKind::FuncDef, AstKind::CompileUnit},
+                   true),
+      maxStackBytes_(maxStackBytes), eliminated_(0) {}
+
+void EscapeAnalysis::enter(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::VarId:
+    enterVarId(static_cast<A_VarId *>(ast));
+    break;
+  case AstKind::VarDef:
+    enterVarDef(static_cast<A_VarDef *>(ast));
+    break;
+  case AstKind::New:
+    enterNew(static_cast<A_New *>(ast));
+    break;
+  case AstKind::Block: {
+    A_Block *e = static_cast<A_Block *>(ast);
+    if (e->region) {
+      ASSERT(!functions_.empty(), "error: region {}:{} is not in function\n",
+             e->name(), e->location());
+      Region region;
+      region.block = e;
+      region.function = functions_.back();
+      regions_.push_back(region);
+    }
+  } break;
+  case AstKind::FuncDef:
+    functions_.push_back(static_cast<A_FuncDef *>(ast));
+    break;
+  default:
+    break;
+  }
+}
+
+void EscapeAnalysis::leave(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::Block:
+    if (static_cast<A_Block *>(ast)->region) {
+      regions_.pop_back();
+    }
+    break;
+  case AstKind::FuncDef:
+    functions_.pop_back();
+    break;
+  case AstKind::CompileUnit: {
+    int eliminated = 0;
+    for (auto it = candidates_.begin(); it != candidates_.end(); ++it) {
+      Candidate &c = it->second;
+      if (c.escaped) {
+        continue;
+      }
+      c.allocation->stack = true;
+      for (int i = 0; i < (int)c.deletes.size(); i++) {
+        c.deletes[i]->stack = true;
+      }
+      eliminated++;
+    }
+    candidates_.clear();
+    regionVars_.clear();
+    eliminated_ += eliminated;
+    LOG_INFO("{} heap allocations are moved to stack in {}", eliminated,
+             ast->name());
+  } break;
+  default:
+    break;
+  }
+}
+
+int EscapeAnalysis::eliminated() const { return eliminated_; }
+
+void EscapeAnalysis::enterVarDef(A_VarDef *ast) {
+  if (functions_.empty() || ast->expr->kind() != +AstKind::New) {
+    return;
+  }
+  A_New *allocation = static_cast<A_New *>(ast->expr);
+  int64_t length = literalLength(allocation->count);
+  int bytes = elementBytes(allocation->type);
+  if (length < 0 || bytes <= 0 || length > maxStackBytes_ / bytes) {
+    return;
+  }
+  Symbol *symbol = static_cast<A_VarId *>(ast->id)->symbol();
+  Candidate c;
+  c.allocation = allocation;
+  c.function = functions_.back();
+  c.escaped = false;
+  candidates_.insert(std::make_pair(symbol, c));
+}
+
+void EscapeAnalysis::enterVarId(A_VarId *ast) {
+  Symbol *symbol = ast->symbol();
+  if (!symbol || symbol->ast() == ast) {
+    return;
+  }
+  auto r = regionVars_.find(symbol);
+  if (r != regionVars_.end()) {
+    enterRegionVarId(ast, r->second);
+  }
+  auto it = candidates_.find(symbol);
+  if (it == candidates_.end()) {
+    return;
+  }
+  Candidate &c = it->second;
+  Ast *parent = ast->parent();
+  if (functions_.empty() || functions_.back() != c.function) {
+    c.escaped = true;
+  } else if (isElement(ast)) {
+    // element access, `a[i] = v` stores element only
+  } else if (parent->kind() == +AstKind::Delete) {
+    c.deletes.push_back(static_cast<A_Delete *>(parent));
+  } else {
+    // returned, assigned, passed to call, or copied
+    c.escaped = true;
+  }
+}
+
+void EscapeAnalysis::enterNew(A_New *ast) {
+  // `new` in nested function is not in region of outer function
+  if (regions_.empty() || functions_.empty() ||
+      regions_.back().function != functions_.back()) {
+    return;
+  }
+  const Region &region = regions_.back();
+  Ast *parent = ast->parent();
+  ASSERT(parent->kind() == +AstKind::VarDef &&
+             static_cast<A_VarDef *>(parent)->expr == ast,
+         "error: array {}:{} in region {}:{} must initialize a variable\n",
+         ast->name(), ast->location(), region.block->name(),
+         region.block->location());
+  Symbol *symbol =
+      static_cast<A_VarId *>(static_cast<A_VarDef *>(parent)->id)->symbol();
+  regionVars_.insert(std::make_pair(symbol, region));
+}
+
+void EscapeAnalysis::enterRegionVarId(A_VarId *ast, const Region &region) {
+  Ast *parent = ast->parent();
+  bool local = !functions_.empty() && functions_.back() == region.function;
+  if (local && isElement(ast)) {
+    return;
+  }
+  if (local && parent->kind() == +AstKind::Delete) {
+    // freed at region exit
+    static_cast<A_Delete *>(parent)->region = true;
+    return;
+  }
+  if (local && parent->kind() == +AstKind::Exprs) {
+    Ast *call = parent;
+    while (call->kind() == +AstKind::Exprs) {
+      call = call->parent();
+    }
+    // callee cannot keep array without returning it, since there's no global
+    // variable or field of array type
+    if (call->kind() == +AstKind::Call &&
+        static_cast<A_Call *>(call)->id->kind() == +AstKind::VarId) {
+      Symbol *callee =
+          static_cast<A_VarId *>(static_cast<A_Call *>(call)->id)->symbol();
+      TypeSymbol *type = callee ? callee->type() : nullptr;
+      if (type && type->kind() == +TypeSymbolKind::Func &&
+          static_cast<Ts_Func *>(type)->result->kind() !=
+              +TypeSymbolKind::Array) {
+        return;
+      }
+    }
+  }
+  ASSERT(false, "error: array {}:{} of region {}:{} escapes region\n",
+         ast->name(), ast->location(), region.block->name(),
+         region.block->location());
+}
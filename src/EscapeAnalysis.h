@@ -0,0 +1,78 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "AstClasses.h"
+#include "SymbolClasses.h"
+#include "iface/Phase.h"
+#include <unordered_map>
+#include <vector>
+
+/**
+ * EscapeAnalysis finds arrays created by `new` which never escape the function
+ * allocating them, and marks them to be allocated on stack by IrBuilder:
+ *
+ *    var a:int[] = new int[16];
+ *
+ * The array is moved to stack if:
+ *    it initializes a local variable, and its length is a literal (after
+ *    ConstantFolder) no more than `maxStackBytes`.
+ *    the variable is only used as `a[i]` or `delete a` in the same function,
+ *    so it's never returned, assigned, passed to a call, captured or sliced
+ *    by `a[i..j]`.
+ *
+ * A stack array is allocated in the entry block of function, its `delete` is
+ * dropped. Elements with constant index are promoted to SSA values by SROA.
+ *
+ * It also checks arrays of `region { ... }` block, they're released together
+ * at block exit, so none of them can outlive the region:
+ *
+ *    region {
+ *      var b:int[] = new int[n];
+ *      sum(b);
+ *    }
+ *
+ * `new` inside region must initialize a variable of the region, the variable
+ * is only used as `b[i]`, `delete b` (dropped) or argument of call whose result
+ * is not an array, in the same function. Otherwise it's a compile error.
+ *
+ * It runs after ConstantFolder, so it's a barrier.
+ */
+class EscapeAnalysis : public FusiblePhase {
+public:
+  EscapeAnalysis(int maxStackBytes = 4096);
+  virtual ~EscapeAnalysis() = default;
+
+  virtual void enter(Ast *ast);
+  virtual void leave(Ast *ast);
+
+  // heap allocations moved to stack
+  int eliminated() const;
+
+private:
+  struct Candidate {
+    A_New *allocation;
+    A_FuncDef *function;
+    std::vector<A_Delete *> deletes;
+    bool escaped;
+  };
+
+  struct Region {
+    A_Block *block;
+    A_FuncDef *function;
+  };
+
+  void enterVarDef(A_VarDef *ast);
+  void enterVarId(A_VarId *ast);
+  void enterNew(A_New *ast);
+  void enterRegionVarId(A_VarId *ast, const Region &region);
+
+  int maxStackBytes_;
+  int eliminated_;
+  std::vector<A_FuncDef *> functions_;
+  std::unordered_map<const Symbol *, Candidate> candidates_;
+  // enclosing regions
+  std::vector<Region> regions_;
+  // variables initialized by `new` inside region
+  std::unordered_map<const Symbol *, Region> regionVars_;
+};
@@ -0,0 +1,400 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Interpreter.h"
+#include "Ast.h"
+#include "Symbol.h"
+#include "Token.h"
+#include "infra/Log.h"
+
+// constant has same type as plain type symbol
+static bool typeOf(const Constant &c, const TypeSymbol *ts) {
+  switch (c.kind()) {
+  case Constant::INTEGER:
+    if (c.bit() == 32) {
+      return ts ==
+             (c.isSigned() ? TypeSymbol::ts_int() : TypeSymbol::ts_uint());
+    }
+    return ts ==
+           (c.isSigned() ? TypeSymbol::ts_long() : TypeSymbol::ts_ulong());
+  case Constant::FLOAT:
+    return ts == (c.bit() == 32 ? TypeSymbol::ts_float()
+                                : TypeSymbol::ts_double());
+  case Constant::BOOLEAN:
+    return ts == TypeSymbol::ts_boolean();
+  default:
+    return false;
+  }
+}
+
+Interpreter::Interpreter(int maxSteps, int maxDepth, int maxMemory)
+    : maxSteps_(maxSteps), maxDepth_(maxDepth), maxMemory_(maxMemory),
+      steps_(0), memory_(0), flow_(NORMAL) {}
+
+Constant Interpreter::call(A_FuncDef *funcDef,
+                           const std::vector<Constant> &args) {
+  steps_ = 0;
+  memory_ = 0;
+  flow_ = NORMAL;
+  values_.clear();
+  frames_.clear();
+  try {
+    return invoke(funcDef, args);
+  } catch (const Abandon &) {
+    return Constant();
+  }
+}
+
+A_FuncDef *Interpreter::callee(A_Call *ast) {
+  if (ast->id->kind() != +AstKind::VarId) {
+    return nullptr;
+  }
+  Symbol *sym = static_cast<A_VarId *>(ast->id)->symbol();
+  if (!sym || sym->kind() != +SymbolKind::Func || !sym->ast()) {
+    return nullptr;
+  }
+  // function id -> function signature -> function definition
+  Ast *funcSign = sym->ast()->parent();
+  Ast *funcDef = funcSign ? funcSign->parent() : nullptr;
+  if (!funcDef || funcDef->kind() != +AstKind::FuncDef ||
+      !static_cast<A_FuncDef *>(funcDef)->compileTime) {
+    return nullptr;
+  }
+  return static_cast<A_FuncDef *>(funcDef);
+}
+
+void Interpreter::visitInteger(A_Integer *ast) {
+  step();
+  values_.push_back(Constant::fromAst(ast));
+}
+
+void Interpreter::visitFloat(A_Float *ast) {
+  step();
+  values_.push_back(Constant::fromAst(ast));
+}
+
+void Interpreter::visitBoolean(A_Boolean *ast) {
+  step();
+  values_.push_back(Constant::fromAst(ast));
+}
+
+void Interpreter::visitCharacter(A_Character *ast) { abandon(); }
+
+void Interpreter::visitString(A_String *ast) { abandon(); }
+
+void Interpreter::visitNil(A_Nil *ast) { abandon(); }
+
+void Interpreter::visitVoid(A_Void *ast) { abandon(); }
+
+void Interpreter::visitVarId(A_VarId *ast) {
+  step();
+  values_.push_back(read(ast));
+}
+
+void Interpreter::visitBreak(A_Break *ast) {
+  step();
+  flow_ = BREAK;
+}
+
+void Interpreter::visitContinue(A_Continue *ast) {
+  step();
+  flow_ = CONTINUE;
+}
+
+void Interpreter::visitThrow(A_Throw *ast) { abandon(); }
+
+void Interpreter::visitReturn(A_Return *ast) {
+  step();
+  if (!ast->expr) {
+    abandon();
+  }
+  returned_ = evaluate(ast->expr);
+  flow_ = RETURN;
+}
+
+void Interpreter::visitAssign(A_Assign *ast) {
+  step();
+  if (ast->assignee->kind() != +AstKind::VarId) {
+    abandon();
+  }
+  A_VarId *varId = static_cast<A_VarId *>(ast->assignee);
+
+  int op = 0;
+  switch (ast->assignOp) {
+  case T_EQUAL: // =
+    break;
+  case T_PLUS_EQUAL: // +=
+    op = T_PLUS;
+    break;
+  case T_MINUS_EQUAL: // -=
+    op = T_MINUS;
+    break;
+  case T_ASTERISK_EQUAL: // *=
+    op = T_ASTERISK;
+    break;
+  case T_SLASH_EQUAL: // /=
+    op = T_SLASH;
+    break;
+  case T_PERCENT_EQUAL: // %=
+    op = T_PERCENT;
+    break;
+  case T_AMPERSAND_EQUAL: // &=
+    op = T_AMPERSAND;
+    break;
+  case T_BAR_EQUAL: // |=
+    op = T_BAR;
+    break;
+  case T_CARET_EQUAL: // ^=
+    op = T_CARET;
+    break;
+  default:
+    abandon();
+  }
+
+  // assignee must be local variable, it's read before assignor
+  Constant a = read(varId);
+  Constant v = evaluate(ast->assignor);
+  if (op) {
+    v = Constant::binary(op, a, v);
+  }
+  if (!typeOf(v, varId->symbol()->type())) {
+    abandon();
+  }
+  write(varId->symbol(), v);
+  values_.push_back(v);
+}
+
+void Interpreter::visitPostfix(A_Postfix *ast) { abandon(); }
+
+void Interpreter::visitInfix(A_Infix *ast) {
+  step();
+  Constant a = evaluate(ast->left);
+  Constant b = evaluate(ast->right);
+  Constant c = Constant::binary(ast->infixOp, a, b);
+  if (!c.valid()) {
+    abandon();
+  }
+  values_.push_back(c);
+}
+
+void Interpreter::visitPrefix(A_Prefix *ast) {
+  step();
+  Constant c = Constant::unary(ast->prefixOp, evaluate(ast->expr));
+  if (!c.valid()) {
+    abandon();
+  }
+  values_.push_back(c);
+}
+
+void Interpreter::visitCall(A_Call *ast) {
+  step();
+  A_FuncDef *funcDef = callee(ast);
+  if (!funcDef) {
+    abandon();
+  }
+  std::vector<Constant> args;
+  for (A_Exprs *e = ast->args; e; e = e->next) {
+    args.push_back(evaluate(e->expr));
+  }
+  values_.push_back(invoke(funcDef, args));
+}
+
+void Interpreter::visitExprs(A_Exprs *ast) {
+  step();
+  // value of parenthesized expressions is the last one
+  Constant last;
+  for (A_Exprs *e = ast; e; e = e->next) {
+    last = evaluate(e->expr);
+  }
+  values_.push_back(last);
+}
+
+void Interpreter::visitIndex(A_Index *ast) { abandon(); }
+
+void Interpreter::visitNew(A_New *ast) { abandon(); }
+
+void Interpreter::visitDelete(A_Delete *ast) { abandon(); }
+
+void Interpreter::visitAwait(A_Await *ast) { abandon(); }
+
+void Interpreter::visitIf(A_If *ast) {
+  step();
+  // value of the taken branch is kept, if any
+  if (condition(ast->condition)) {
+    ast->thenp->accept(this);
+  } else if (ast->elsep) {
+    ast->elsep->accept(this);
+  }
+}
+
+void Interpreter::visitLoop(A_Loop *ast) {
+  step();
+  if (ast->condition->kind() != +AstKind::LoopCondition) {
+    abandon();
+  }
+  A_LoopCondition *loopCondition =
+      static_cast<A_LoopCondition *>(ast->condition);
+  if (loopCondition->init) {
+    statement(loopCondition->init);
+  }
+  while (!loopCondition->condition || condition(loopCondition->condition)) {
+    statement(ast->body);
+    if (flow_ == BREAK) {
+      flow_ = NORMAL;
+      break;
+    } else if (flow_ == RETURN) {
+      break;
+    }
+    flow_ = NORMAL;
+    if (loopCondition->update) {
+      statement(loopCondition->update);
+    }
+  }
+}
+
+void Interpreter::visitYield(A_Yield *ast) { abandon(); }
+
+void Interpreter::visitLoopEnumerator(A_LoopEnumerator *ast) { abandon(); }
+
+void Interpreter::visitDoWhile(A_DoWhile *ast) {
+  step();
+  do {
+    statement(ast->body);
+    if (flow_ == BREAK) {
+      flow_ = NORMAL;
+      break;
+    } else if (flow_ == RETURN) {
+      break;
+    }
+    flow_ = NORMAL;
+  } while (condition(ast->condition));
+}
+
+void Interpreter::visitTry(A_Try *ast) { abandon(); }
+
+void Interpreter::visitBlock(A_Block *ast) {
+  step();
+  if (ast->blockStats) {
+    ast->blockStats->accept(this);
+  }
+}
+
+void Interpreter::visitBlockStats(A_BlockStats *ast) {
+  // iterate the list, long block doesn't recurse
+  for (A_BlockStats *e = ast; e && flow_ == NORMAL; e = e->next) {
+    statement(e->blockStat);
+  }
+}
+
+void Interpreter::visitFuncDef(A_FuncDef *ast) { abandon(); }
+
+void Interpreter::visitVarDef(A_VarDef *ast) {
+  step();
+  A_VarId *varId = static_cast<A_VarId *>(ast->id);
+  Constant v = evaluate(ast->expr);
+  if (!typeOf(v, varId->symbol()->type())) {
+    abandon();
+  }
+  write(varId->symbol(), v);
+}
+
+void Interpreter::abandon() { throw Abandon(); }
+
+void Interpreter::step() {
+  if (++steps_ > maxSteps_) {
+    abandon();
+  }
+}
+
+Constant Interpreter::invoke(A_FuncDef *funcDef,
+                             const std::vector<Constant> &args) {
+  if ((int)frames_.size() >= maxDepth_) {
+    abandon();
+  }
+  A_VarId *funcId = static_cast<A_VarId *>(funcDef->getId());
+  S_Func *func = static_cast<S_Func *>(funcId->symbol());
+  Ts_Func *funcType = static_cast<Ts_Func *>(func->type());
+  if (func->params.size() != args.size()) {
+    abandon();
+  }
+
+  frames_.push_back(std::unordered_map<const Symbol *, Constant>());
+  for (int i = 0; i < (int)args.size(); i++) {
+    if (!typeOf(args[i], func->params[i]->type())) {
+      abandon();
+    }
+    write(func->params[i], args[i]);
+  }
+
+  int values = (int)values_.size();
+  funcDef->body->accept(this);
+  Constant result;
+  if (flow_ == RETURN) {
+    result = returned_;
+  } else if (funcDef->body->kind() != +AstKind::Block &&
+             (int)values_.size() > values) {
+    // function body is an expression
+    result = values_.back();
+  }
+  if (!typeOf(result, funcType->result)) {
+    abandon();
+  }
+
+  flow_ = NORMAL;
+  values_.resize(values);
+  memory_ -= (int)frames_.back().size();
+  frames_.pop_back();
+  return result;
+}
+
+Constant Interpreter::evaluate(Ast *ast) {
+  int values = (int)values_.size();
+  ast->accept(this);
+  if ((int)values_.size() <= values || flow_ != NORMAL) {
+    // statement without value
+    abandon();
+  }
+  Constant result = values_.back();
+  values_.resize(values);
+  return result;
+}
+
+void Interpreter::statement(Ast *ast) {
+  int values = (int)values_.size();
+  ast->accept(this);
+  values_.resize(values);
+}
+
+bool Interpreter::condition(Ast *ast) {
+  step();
+  Constant c = evaluate(ast);
+  if (c.kind() != Constant::BOOLEAN) {
+    abandon();
+  }
+  return c.asBoolean();
+}
+
+Constant Interpreter::read(A_VarId *varId) {
+  const Symbol *sym = varId->symbol();
+  if (!sym || frames_.empty()) {
+    abandon();
+  }
+  // only local variables and parameters of current call
+  auto it = frames_.back().find(sym);
+  if (it == frames_.back().end()) {
+    abandon();
+  }
+  return it->second;
+}
+
+void Interpreter::write(const Symbol *symbol, const Constant &value) {
+  auto it = frames_.back().find(symbol);
+  if (it != frames_.back().end()) {
+    it->second = value;
+    return;
+  }
+  if (++memory_ > maxMemory_) {
+    abandon();
+  }
+  frames_.back().insert(std::make_pair(symbol, value));
+}
@@ -0,0 +1,97 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "AstClasses.h"
+#include "Constant.h"
+#include "SymbolClasses.h"
+#include "iface/Visitor.h"
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Interpreter evaluates a call of `const def` function with constant arguments
+ * on the ast tree, ConstantFolder substitutes the call with the result.
+ *
+ * It's sandboxed: only literals, local variables, operators, control flow and
+ * calls of other `const def` functions are evaluated. Evaluation is abandoned
+ * (returns an invalid constant) when anything else is met, or it runs out of:
+ *    steps: visited ast nodes.
+ *    depth: nested calls.
+ *    memory: live local variables of all calls.
+ */
+class Interpreter : public Visitor {
+public:
+  Interpreter(int maxSteps = 1000000, int maxDepth = 256,
+              int maxMemory = 65536);
+  virtual ~Interpreter() = default;
+
+  // returns invalid constant if cannot evaluate
+  Constant call(A_FuncDef *funcDef, const std::vector<Constant> &args);
+
+  // `const def` function called by ast, or null
+  static A_FuncDef *callee(A_Call *ast);
+
+  virtual void visitInteger(A_Integer *ast);
+  virtual void visitFloat(A_Float *ast);
+  virtual void visitBoolean(A_Boolean *ast);
+  virtual void visitCharacter(A_Character *ast);
+  virtual void visitString(A_String *ast);
+  virtual void visitNil(A_Nil *ast);
+  virtual void visitVoid(A_Void *ast);
+  virtual void visitVarId(A_VarId *ast);
+  virtual void visitBreak(A_Break *ast);
+  virtual void visitContinue(A_Continue *ast);
+
+  virtual void visitThrow(A_Throw *ast);
+  virtual void visitReturn(A_Return *ast);
+  virtual void visitAssign(A_Assign *ast);
+  virtual void visitPostfix(A_Postfix *ast);
+  virtual void visitInfix(A_Infix *ast);
+  virtual void visitPrefix(A_Prefix *ast);
+  virtual void visitCall(A_Call *ast);
+  virtual void visitExprs(A_Exprs *ast);
+  virtual void visitIndex(A_Index *ast);
+  virtual void visitNew(A_New *ast);
+  virtual void visitDelete(A_Delete *ast);
+  virtual void visitAwait(A_Await *ast);
+  virtual void visitIf(A_If *ast);
+  virtual void visitLoop(A_Loop *ast);
+  virtual void visitYield(A_Yield *ast);
+  virtual void visitLoopEnumerator(A_LoopEnumerator *ast);
+  virtual void visitDoWhile(A_DoWhile *ast);
+  virtual void visitTry(A_Try *ast);
+  virtual void visitBlock(A_Block *ast);
+  virtual void visitBlockStats(A_BlockStats *ast);
+  virtual void visitFuncDef(A_FuncDef *ast);
+  virtual void visitVarDef(A_VarDef *ast);
+
+private:
+  enum Flow { NORMAL = 0, BREAK, CONTINUE, RETURN };
+
+  // thrown when evaluation is abandoned
+  struct Abandon {};
+
+  void abandon();
+  void step();
+  Constant invoke(A_FuncDef *funcDef, const std::vector<Constant> &args);
+  Constant evaluate(Ast *ast);
+  // visit statement, its result is dropped
+  void statement(Ast *ast);
+  bool condition(Ast *ast);
+  Constant read(A_VarId *varId);
+  void write(const Symbol *symbol, const Constant &value);
+
+  int maxSteps_;
+  int maxDepth_;
+  int maxMemory_;
+
+  int steps_;
+  int memory_;
+  Flow flow_;
+  Constant returned_;
+  // visited expressions, each pushes one result
+  std::vector<Constant> values_;
+  // local variables of calls
+  std::vector<std::unordered_map<const Symbol *, Constant>> frames_;
+};
@@ -6,16 +6,80 @@
 #include "Symbol.h"
 #include "Token.h"
 #include "boost/preprocessor/stringize.hpp"
-#include "infra/LinkedHashMap.hpp"
 #include "infra/Log.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/Linker/Linker.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Coroutines.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
-#include "llvm/Transforms/Utils.h"
+#include "llvm/Transforms/Vectorize.h"
+#include <mutex>
 
 namespace detail {
 
+std::unique_ptr<llvm::Module> copyModule(const llvm::Module *module,
+                                         llvm::LLVMContext &context) {
+  LOG_ASSERT(module, "module must not null");
+  std::string bitcode;
+  llvm::raw_string_ostream os(bitcode);
+  llvm::WriteBitcodeToFile(*module, os);
+  os.flush();
+  llvm::Expected<std::unique_ptr<llvm::Module>> m = llvm::parseBitcodeFile(
+      llvm::MemoryBufferRef(bitcode, module->getModuleIdentifier()), context);
+  LOG_ASSERT(m, "cannot read module {}: {}", module->getModuleIdentifier(),
+             llvm::toString(m.takeError()));
+  return std::move(*m);
+}
+
+void lowerCoroutines(llvm::Module *module, bool optimize) {
+  bool coroutines = false;
+  for (llvm::Function &f : *module) {
+    if (f.isIntrinsic() && f.getName().startswith("llvm.coro.") &&
+        !f.use_empty()) {
+      coroutines = true;
+      break;
+    }
+  }
+  if (!coroutines) {
+    return;
+  }
+
+  // coroutine passes are added to extension points, CoroEarly runs in
+  // function pipeline, CoroSplit/CoroElide/CoroCleanup in module pipeline
+  llvm::PassManagerBuilder builder;
+  builder.OptLevel = optimize ? 2 : 0;
+  if (optimize) {
+    // ramp of generator is inlined into enumerating loop, so CoroElide can
+    // move its frame to stack
+    builder.Inliner = llvm::createFunctionInliningPass(builder.OptLevel, 0,
+                                                       false);
+  }
+  llvm::addCoroutinePassesToExtensionPoints(builder);
+
+  llvm::legacy::FunctionPassManager functionPassManager(module);
+  builder.populateFunctionPassManager(functionPassManager);
+  functionPassManager.doInitialization();
+  for (llvm::Function &f : *module) {
+    functionPassManager.run(f);
+  }
+  functionPassManager.doFinalization();
+
+  llvm::legacy::PassManager passManager;
+  builder.populateModulePassManager(passManager);
+  passManager.run(*module);
+}
+
 // SpaceData {
 
 SpaceData SpaceData::fromValue(llvm::Value *a_value) {
@@ -92,43 +156,36 @@ Cowstr SpaceData::str() const {
 
 Space::Space() {}
 
-void Space::setValue(const Cowstr &name, llvm::Value *value) {
-  LOG_ASSERT(!dataMap_.contains(name), "value {} already exist", name);
-  dataMap_.insert(name, SpaceData::fromValue(value));
+void Space::setValue(const Symbol *symbol, llvm::Value *value) {
+  LOG_ASSERT(dataMap_.find(symbol) == dataMap_.end(),
+             "value {} already exist", symbol->name());
+  dataMap_.insert(std::make_pair(symbol, SpaceData::fromValue(value)));
 }
 
-void Space::setType(const Cowstr &name, llvm::Type *type) {
-  LOG_ASSERT(!dataMap_.contains(name), "type {} already exist", name);
-  dataMap_.insert(name, SpaceData::fromType(type));
+void Space::setType(const TypeSymbol *typeSymbol, llvm::Type *type) {
+  LOG_ASSERT(dataMap_.find(typeSymbol) == dataMap_.end(),
+             "type {} already exist", typeSymbol->name());
+  dataMap_.insert(std::make_pair(typeSymbol, SpaceData::fromType(type)));
 }
 
-void Space::setConstant(const Cowstr &name, llvm::Constant *constant) {
-  LOG_ASSERT(!dataMap_.contains(name), "constant {} already exist", name);
-  dataMap_.insert(name, SpaceData::fromConstant(constant));
+void Space::setFunction(const Symbol *symbol, llvm::Function *function) {
+  LOG_ASSERT(dataMap_.find(symbol) == dataMap_.end(),
+             "function {} already exist", symbol->name());
+  dataMap_.insert(std::make_pair(symbol, SpaceData::fromFunction(function)));
 }
 
-void Space::setFunction(const Cowstr &name, llvm::Function *function) {
-  LOG_ASSERT(!dataMap_.contains(name), "function {} already exist", name);
-  dataMap_.insert(name, SpaceData::fromFunction(function));
-}
-
-llvm::Value *Space::getValue(const Cowstr &name) const {
-  auto it = dataMap_.find(name);
+llvm::Value *Space::getValue(const Symbol *symbol) const {
+  auto it = dataMap_.find(symbol);
   return it == dataMap_.end() ? nullptr : it->second.asValue();
 }
 
-llvm::Type *Space::getType(const Cowstr &name) const {
-  auto it = dataMap_.find(name);
+llvm::Type *Space::getType(const TypeSymbol *typeSymbol) const {
+  auto it = dataMap_.find(typeSymbol);
   return it == dataMap_.end() ? nullptr : it->second.asType();
 }
 
-llvm::Constant *Space::getConstant(const Cowstr &name) const {
-  auto it = dataMap_.find(name);
-  return it == dataMap_.end() ? nullptr : it->second.asConstant();
-}
-
-llvm::Function *Space::getFunction(const Cowstr &name) const {
-  auto it = dataMap_.find(name);
+llvm::Function *Space::getFunction(const Symbol *symbol) const {
+  auto it = dataMap_.find(symbol);
   return it == dataMap_.end() ? nullptr : it->second.asFunction();
 }
 
@@ -138,54 +195,156 @@ llvm::Function *Space::getFunction(const Cowstr &name) const {
 
 // IrBuilder {
 
+// alignment of coroutine promise, enough for every yielded or result type
+static const int PromiseAlign = 16;
+
+// alignment of array element, array memory is only aligned to 16 bytes while
+// 256-bit vector element has 32-byte ABI alignment
+static const int ElementAlign = 16;
+
 static Cowstr label(Ast *ast) {
   return fmt::format("{}.{}_{}_{}_{}", ast->name(), ast->location().begin.line,
                      ast->location().begin.column, ast->location().end.line,
                      ast->location().end.column);
 }
 
-static Cowstr label(Symbol *symbol) {
+static Cowstr label(const Symbol *symbol) {
   return fmt::format(
       "{}.{}_{}_{}_{}", symbol->name(), symbol->location().begin.line,
       symbol->location().begin.column, symbol->location().end.line,
       symbol->location().end.column);
 }
 
-static Cowstr label(TypeSymbol *typeSymbol) {
-  return fmt::format(
-      "{}.{}_{}_{}_{}", typeSymbol->name(), typeSymbol->location().begin.line,
-      typeSymbol->location().begin.column, typeSymbol->location().end.line,
-      typeSymbol->location().end.column);
+// integer type of range and reduction, its signedness is returned in
+// `isUnsigned`
+static bool integerType(const TypeSymbol *ts, bool *isUnsigned) {
+  *isUnsigned = ts == TypeSymbol::ts_ubyte() || ts == TypeSymbol::ts_ushort() ||
+                ts == TypeSymbol::ts_uint() || ts == TypeSymbol::ts_ulong();
+  return *isUnsigned || ts == TypeSymbol::ts_byte() ||
+         ts == TypeSymbol::ts_short() || ts == TypeSymbol::ts_int() ||
+         ts == TypeSymbol::ts_long();
+}
+
+// `a..b` of range loop or slice
+static bool isRange(Ast *ast) {
+  return ast->kind() == +AstKind::Infix &&
+         static_cast<A_Infix *>(ast)->infixOp == T_DOT2;
+}
+
+// type of variable or function call expr, or null if it's neither
+static const TypeSymbol *typeOf(Ast *expr) {
+  if (expr->kind() == +AstKind::VarId) {
+    Symbol *symbol = static_cast<A_VarId *>(expr)->symbol();
+    return symbol ? symbol->type() : nullptr;
+  }
+  if (expr->kind() != +AstKind::Call ||
+      static_cast<A_Call *>(expr)->id->kind() != +AstKind::VarId) {
+    return nullptr;
+  }
+  Symbol *symbol =
+      static_cast<A_VarId *>(static_cast<A_Call *>(expr)->id)->symbol();
+  return symbol && symbol->kind() == +SymbolKind::Func
+             ? static_cast<const Ts_Func *>(symbol->type())->result
+             : nullptr;
 }
 
-IrBuilder::IrBuilder(bool enableFunctionPass)
+// length of array known at compile time: `new T[N]`, or variable or call of
+// type `T[N]`, -1 otherwise
+static int64_t staticLength(Ast *expr) {
+  if (expr->kind() == +AstKind::New) {
+    Ast *count = static_cast<A_New *>(expr)->count;
+    if (count->kind() != +AstKind::Integer) {
+      return -1;
+    }
+    A_Integer *e = static_cast<A_Integer *>(count);
+    return e->bit() == 64 ? e->asInt64() : (int64_t)e->asInt32();
+  }
+  const TypeSymbol *ts = typeOf(expr);
+  return ts && ts->kind() == +TypeSymbolKind::Array
+             ? static_cast<const Ts_Array *>(ts)->length
+             : -1;
+}
+
+// vector type of variable or call expr, or null if it's not a vector
+static const Ts_Vector *vectorType(Ast *expr) {
+  const TypeSymbol *ts = typeOf(expr);
+  return ts && ts->kind() == +TypeSymbolKind::Vector
+             ? static_cast<const Ts_Vector *>(ts)
+             : nullptr;
+}
+
+// only an array of length N is stored to variable, parameter or result of
+// type `T[N]`, so its length is known when it's read
+static void checkLength(const TypeSymbol *ts, Ast *expr) {
+  if (!ts || ts->kind() != +TypeSymbolKind::Array) {
+    return;
+  }
+  int64_t length = static_cast<const Ts_Array *>(ts)->length;
+  ASSERT(length < 0 || staticLength(expr) == length,
+         "error: {}:{} is not an array of length {}\n", expr->name(),
+         expr->location(), length);
+}
+
+// target machine of host, or null if host is not supported
+static std::unique_ptr<llvm::TargetMachine> hostTargetMachine() {
+  // target registry is not thread safe, while shards are built concurrently
+  static std::once_flag initialized;
+  std::call_once(initialized, []() { llvm::InitializeNativeTarget(); });
+  llvm::Expected<llvm::orc::JITTargetMachineBuilder> builder =
+      llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!builder) {
+    llvm::consumeError(builder.takeError());
+    return nullptr;
+  }
+  llvm::Expected<std::unique_ptr<llvm::TargetMachine>> targetMachine =
+      builder->createTargetMachine();
+  if (!targetMachine) {
+    llvm::consumeError(targetMachine.takeError());
+    return nullptr;
+  }
+  return std::move(*targetMachine);
+}
+
+IrBuilder::IrBuilder(bool enableFunctionPass, int shard, int shards)
     : Phase("IrBuilder"), llvmContext_(), llvmIRBuilder_(llvmContext_),
       llvmModule_(nullptr), enableFunctionPass_(enableFunctionPass),
-      llvmFunctionPassManager_(nullptr), scope_(nullptr) {}
+      llvmFunctionPassManager_(nullptr), shard_(shard), shards_(shards),
+      funcDefs_(0), scope_(nullptr), ssa_(nullptr), coroutine_(nullptr),
+      parallel_(false) {
+  LOG_ASSERT(shards_ > 0 && shard_ >= 0 && shard_ < shards_,
+             "invalid shard {} of {}", shard_, shards_);
+}
 
 IrBuilder::~IrBuilder() {
   delete llvmModule_;
   delete llvmFunctionPassManager_;
 }
 
-void IrBuilder::run(Ast *ast) { ast->accept(this); }
+void IrBuilder::run(Ast *ast) { visit(ast); }
 
 llvm::Module *IrBuilder::llvmModule() const { return llvmModule_; }
 
+std::unique_ptr<llvm::Module>
+IrBuilder::copyModule(llvm::LLVMContext &context) const {
+  return detail::copyModule(llvmModule_, context);
+}
+
+Cowstr IrBuilder::linkName(const Symbol *symbol) { return label(symbol); }
+
 void IrBuilder::visitInteger(A_Integer *ast) {
   switch (ast->bit()) {
   case 32: {
     llvm::APInt ap = ast->isSigned() ? llvm::APInt(32, ast->asInt32(), true)
                                      : llvm::APInt(ast->asUInt32(), false);
     llvm::ConstantInt *ci = llvm::ConstantInt::get(llvmContext_, ap);
-    space_.setConstant(label(ast), llvm::dyn_cast<llvm::Constant>(ci));
+    results_.push_back(detail::SpaceData::fromConstant(ci));
     break;
   }
   case 64: {
     llvm::APInt ap = ast->isSigned() ? llvm::APInt(64, ast->asInt64(), true)
                                      : llvm::APInt(64, ast->asUInt64(), false);
     llvm::ConstantInt *ci = llvm::ConstantInt::get(llvmContext_, ap);
-    space_.setConstant(label(ast), llvm::dyn_cast<llvm::Constant>(ci));
+    results_.push_back(detail::SpaceData::fromConstant(ci));
     break;
   }
   default:
@@ -199,13 +358,13 @@ void IrBuilder::visitFloat(A_Float *ast) {
   case 32: {
     llvm::APFloat ap = llvm::APFloat(ast->asFloat());
     llvm::ConstantFP *cf = llvm::ConstantFP::get(llvmContext_, ap);
-    space_.setConstant(label(ast), llvm::dyn_cast<llvm::Constant>(cf));
+    results_.push_back(detail::SpaceData::fromConstant(cf));
     break;
   }
   case 64: {
     llvm::APFloat ap = llvm::APFloat(ast->asDouble());
     llvm::ConstantFP *cf = llvm::ConstantFP::get(llvmContext_, ap);
-    space_.setConstant(label(ast), llvm::dyn_cast<llvm::Constant>(cf));
+    results_.push_back(detail::SpaceData::fromConstant(cf));
     break;
   }
   default:
@@ -217,7 +376,7 @@ void IrBuilder::visitBoolean(A_Boolean *ast) {
   llvm::Constant *constant = ast->asBoolean()
                                  ? llvm::ConstantInt::getTrue(llvmContext_)
                                  : llvm::ConstantInt::getFalse(llvmContext_);
-  space_.setConstant(label(ast), constant);
+  results_.push_back(detail::SpaceData::fromConstant(constant));
 }
 
 void IrBuilder::visitCharacter(A_Character *ast) {
@@ -235,36 +394,186 @@ void IrBuilder::visitVoid(A_Void *ast) { LOG_ASSERT(false, "not implemented"); }
 
 void IrBuilder::visitVarId(A_VarId *ast) {
   if (ast->symbol()) {
-    llvm::Value *value = space_.getValue(label(ast->symbol()));
-    LOG_ASSERT(value, "ast {}:{} symbol {}:{} does not has llvm value",
-               ast->name(), ast->location(), ast->symbol()->name(),
-               ast->symbol()->location());
-    llvm::LoadInst *li = llvmIRBuilder_.CreateLoad(value);
-    space_.setValue(label(ast), llvm::dyn_cast<llvm::Value>(li));
+    results_.push_back(detail::SpaceData::fromValue(readVariable(ast)));
   } else if (ast->typeSymbol()) {
-    llvm::Type *type = space_.getType(label(ast->typeSymbol()));
+    llvm::Type *type = space_.getType(ast->typeSymbol());
     LOG_ASSERT(type, "ast {}:{} type symbol {}:{} does not has llvm type",
                ast->name(), ast->location(), ast->typeSymbol()->name(),
                ast->typeSymbol()->location());
-    space_.setType(label(ast), type);
+    results_.push_back(detail::SpaceData::fromType(type));
   }
 }
 
+void IrBuilder::visitThrow(A_Throw *ast) {
+  ast->expr->accept(this);
+  llvm::Value *value = pop().asValue();
+  ASSERT(value->getType()->isIntegerTy() && !value->getType()->isIntegerTy(1),
+         "error: throw {}:{} value must be integer\n", ast->name(),
+         ast->location());
+  llvm::Type *i64 = llvm::Type::getInt64Ty(llvmContext_);
+  call(runtime("dimrt_throw", llvm::Type::getVoidTy(llvmContext_), {i64}),
+       {llvmIRBuilder_.CreateIntCast(value, i64, true)});
+  llvmIRBuilder_.CreateUnreachable();
+  enterDeadBlock();
+}
+
 void IrBuilder::visitReturn(A_Return *ast) {
+  ASSERT(!parallel_, "error: return {}:{} cannot leave foreach\n", ast->name(),
+         ast->location());
   if (ast->expr) {
+    Ast *func = ast->parent();
+    while (func->kind() != +AstKind::FuncDef) {
+      func = func->parent();
+    }
+    A_VarId *funcId =
+        static_cast<A_VarId *>(static_cast<A_FuncDef *>(func)->getId());
+    checkLength(static_cast<const Ts_Func *>(funcId->symbol()->type())->result,
+                ast->expr);
+  }
+  if (coroutine_) {
+    // coroutine returns by final suspend, result of async function is in
+    // promise
+    ASSERT(coroutine_->async || !ast->expr,
+           "error: generator cannot return value at {}:{}\n", ast->name(),
+           ast->location());
+    if (ast->expr) {
+      ast->expr->accept(this);
+      llvm::AllocaInst *promise = coroutine_->promise;
+      llvmIRBuilder_.CreateStore(
+          pop().asValue(),
+          llvmIRBuilder_.CreateStructGEP(promise->getAllocatedType(), promise,
+                                         1, "result"));
+    }
+    cleanup(0);
+    llvmIRBuilder_.CreateBr(coroutine_->finalBlock);
+  } else if (ast->expr) {
     ast->expr->accept(this);
-    llvm::Value *retValue = space_.getValue(label(ast->expr));
+    llvm::Value *retValue = pop().asValue();
     LOG_ASSERT(retValue, "ast {}:{} ast->expr {}:{} retValue:{} must not null",
                ast->name(), ast->location(), ast->expr->name(),
                ast->expr->location(), Cowstr::from(retValue));
+    cleanup(0);
     llvmIRBuilder_.CreateRet(retValue);
   } else {
+    cleanup(0);
     llvmIRBuilder_.CreateRetVoid();
   }
+  enterDeadBlock();
+}
+
+void IrBuilder::visitBreak(A_Break *ast) {
+  LOG_ASSERT(!loops_.empty(), "ast {}:{} is not in loop", ast->name(),
+             ast->location());
+  ASSERT(!parallel_ || loops_.size() > 1,
+         "error: break {}:{} cannot leave foreach\n", ast->name(),
+         ast->location());
+  cleanup((int)loops_.size());
+  llvmIRBuilder_.CreateBr(loops_.back().second);
+  enterDeadBlock();
+}
+
+void IrBuilder::visitContinue(A_Continue *ast) {
+  LOG_ASSERT(!loops_.empty(), "ast {}:{} is not in loop", ast->name(),
+             ast->location());
+  cleanup((int)loops_.size());
+  llvmIRBuilder_.CreateBr(loops_.back().first);
+  enterDeadBlock();
 }
 
 void IrBuilder::visitAssign(A_Assign *ast) {
-  LOG_ASSERT(false, "not implemented");
+  LOG_ASSERT(ast->assignee->kind() == +AstKind::VarId ||
+                 ast->assignee->kind() == +AstKind::Index,
+             "ast {}:{} assignee must be VarId or Index", ast->name(),
+             ast->location());
+
+  int op = 0;
+  switch (ast->assignOp) {
+  case T_EQUAL: // =
+    break;
+  case T_PLUS_EQUAL: // +=
+    op = T_PLUS;
+    break;
+  case T_MINUS_EQUAL: // -=
+    op = T_MINUS;
+    break;
+  case T_ASTERISK_EQUAL: // *=
+    op = T_ASTERISK;
+    break;
+  case T_SLASH_EQUAL: // /=
+    op = T_SLASH;
+    break;
+  case T_PERCENT_EQUAL: // %=
+    op = T_PERCENT;
+    break;
+  case T_AMPERSAND_EQUAL: // &=
+    op = T_AMPERSAND;
+    break;
+  case T_BAR_EQUAL: // |=
+    op = T_BAR;
+    break;
+  case T_CARET_EQUAL: // ^=
+    op = T_CARET;
+    break;
+  // case T_LSHIFT_EQUAL:
+  // case T_RSHIFT_EQUAL:
+  // case T_ARSHIFT_EQUAL:
+  default:
+    LOG_ASSERT(false, "invalid assignOp {} in ast {}:{}",
+               tokenName(ast->assignOp), ast->name(), ast->location());
+  }
+
+  if (ast->assignee->kind() == +AstKind::Index &&
+      vectorType(static_cast<A_Index *>(ast->assignee)->expr)) {
+    // lane is inserted to vector, which is then written back to variable
+    A_Index *index = static_cast<A_Index *>(ast->assignee);
+    ASSERT(index->expr->kind() == +AstKind::VarId &&
+               index->index->kind() != +AstKind::Exprs,
+           "error: {}:{} cannot be assigned\n", index->name(),
+           index->location());
+    A_VarId *varId = static_cast<A_VarId *>(index->expr);
+    const Ts_Vector *tv = vectorType(varId);
+    uint64_t i = lane(index->index, tv);
+    llvm::Value *vector = readVariable(varId);
+    llvm::Value *a =
+        op ? llvmIRBuilder_.CreateExtractElement(vector, i, "lane") : nullptr;
+    ast->assignor->accept(this);
+    llvm::Value *v = pop().asValue();
+    if (op) {
+      v = binary(op, a, v, ast);
+    }
+    writeVariable(varId,
+                  llvmIRBuilder_.CreateInsertElement(vector, v, i, "lane"));
+    results_.push_back(detail::SpaceData::fromValue(v));
+    return;
+  }
+
+  if (ast->assignee->kind() == +AstKind::Index) {
+    // array and index are evaluated once, before assignor
+    llvm::Type *elementType = nullptr;
+    llvm::Value *ptr =
+        elementPointer(static_cast<A_Index *>(ast->assignee), &elementType);
+    llvm::Value *a = op ? loadElement(elementType, ptr) : nullptr;
+    ast->assignor->accept(this);
+    llvm::Value *v = pop().asValue();
+    if (op) {
+      v = binary(op, a, v, ast);
+    }
+    storeElement(v, ptr);
+    results_.push_back(detail::SpaceData::fromValue(v));
+    return;
+  }
+
+  // assignee is read before assignor in compound assignment
+  A_VarId *varId = static_cast<A_VarId *>(ast->assignee);
+  checkLength(varId->symbol()->type(), ast->assignor);
+  llvm::Value *a = op ? readVariable(varId) : nullptr;
+  ast->assignor->accept(this);
+  llvm::Value *v = pop().asValue();
+  if (op) {
+    v = binary(op, a, v, ast);
+  }
+  writeVariable(varId, v);
+  results_.push_back(detail::SpaceData::fromValue(v));
 }
 
 void IrBuilder::visitPostfix(A_Postfix *ast) {
@@ -272,135 +581,1688 @@ void IrBuilder::visitPostfix(A_Postfix *ast) {
 }
 
 void IrBuilder::visitInfix(A_Infix *ast) {
-  ast->left->accept(this);
-  llvm::Value *a = space_.getValue(label(ast->left));
-  ast->right->accept(this);
-  llvm::Value *b = space_.getValue(label(ast->right));
-  llvm::Value *v = nullptr;
+  postorderInfix(ast, this, [this](A_Infix *e) { infix(e); });
+}
 
-  switch (ast->infixOp) {
+void IrBuilder::infix(A_Infix *ast) {
+  // right operand is visited last
+  llvm::Value *b = pop().asValue();
+  llvm::Value *a = pop().asValue();
+  results_.push_back(
+      detail::SpaceData::fromValue(binary(ast->infixOp, a, b, ast)));
+}
+
+llvm::Value *IrBuilder::binary(int op, llvm::Value *a, llvm::Value *b,
+                               Ast *ast) {
+  // element operand of vector operation is broadcast to every lane
+  if (a->getType()->isVectorTy() != b->getType()->isVectorTy()) {
+    llvm::Value *&element = a->getType()->isVectorTy() ? b : a;
+    element = llvmIRBuilder_.CreateVectorSplat(
+        llvm::cast<llvm::FixedVectorType>(
+            (a->getType()->isVectorTy() ? a : b)->getType())
+            ->getNumElements(),
+        element, "splat");
+  }
+  ASSERT(a->getType() == b->getType(),
+         "error: operands of {}:{} are not of the same type\n", ast->name(),
+         ast->location());
+  bool fp = a->getType()->isFPOrFPVectorTy();
+  bool vector = a->getType()->isVectorTy();
+  llvm::Value *v = nullptr;
+  switch (op) {
   case T_PLUS: { // +
-    v = llvmIRBuilder_.CreateAdd(a, b, "add");
+    v = fp ? llvmIRBuilder_.CreateFAdd(a, b, "add")
+           : llvmIRBuilder_.CreateAdd(a, b, "add");
     break;
   }
   case T_MINUS: { // -
-    v = llvmIRBuilder_.CreateSub(a, b, "sub");
+    v = fp ? llvmIRBuilder_.CreateFSub(a, b, "sub")
+           : llvmIRBuilder_.CreateSub(a, b, "sub");
     break;
   }
   case T_ASTERISK: { // *
-    v = llvmIRBuilder_.CreateMul(a, b, "mul");
+    v = fp ? llvmIRBuilder_.CreateFMul(a, b, "mul")
+           : llvmIRBuilder_.CreateMul(a, b, "mul");
     break;
   }
   case T_SLASH: { // /
-    v = llvmIRBuilder_.CreateSDiv(a, b, "div");
+    v = fp ? llvmIRBuilder_.CreateFDiv(a, b, "div")
+           : llvmIRBuilder_.CreateSDiv(a, b, "div");
     break;
   }
   case T_PERCENT: { // %
-    v = llvmIRBuilder_.CreateSRem(a, b, "mod");
+    v = fp ? llvmIRBuilder_.CreateFRem(a, b, "mod")
+           : llvmIRBuilder_.CreateSRem(a, b, "mod");
     break;
   }
   case T_BAR2:
-  case T_OR: { // || or
-    v = llvmIRBuilder_.CreateOr(a, b, "or");
-    break;
-  }
+  case T_OR:
   case T_AMPERSAND2:
-  case T_AND: { // && and
-    v = llvmIRBuilder_.CreateAnd(a, b, "and");
+  case T_AND:
+  case T_BAR:
+  case T_AMPERSAND:
+  case T_CARET: {
+    ASSERT(!fp, "error: {}:{} is not an operation of floating point\n",
+           ast->name(), ast->location());
+    if (op == T_BAR2 || op == T_OR) { // || or
+      v = llvmIRBuilder_.CreateOr(a, b, "or");
+    } else if (op == T_AMPERSAND2 || op == T_AND) { // && and
+      v = llvmIRBuilder_.CreateAnd(a, b, "and");
+    } else if (op == T_BAR) { // |
+      v = llvmIRBuilder_.CreateOr(a, b, "bitor");
+    } else if (op == T_AMPERSAND) { // &
+      v = llvmIRBuilder_.CreateAnd(a, b, "bitand");
+    } else { // ^
+      v = llvmIRBuilder_.CreateXor(a, b, "xor");
+    }
     break;
   }
-  case T_BAR: { // |
-    v = llvmIRBuilder_.CreateOr(a, b, "bitor");
+  case T_EQ:
+  case T_NEQ:
+  case T_LT:
+  case T_LE:
+  case T_GT:
+  case T_GE: {
+    // a vector of booleans has no type
+    ASSERT(!vector, "error: comparison {}:{} of vectors is not supported\n",
+           ast->name(), ast->location());
+    if (op == T_EQ) { // ==
+      v = fp ? llvmIRBuilder_.CreateFCmpOEQ(a, b, "eq")
+             : llvmIRBuilder_.CreateICmpEQ(a, b, "eq");
+    } else if (op == T_NEQ) { // !=
+      v = fp ? llvmIRBuilder_.CreateFCmpUNE(a, b, "ne")
+             : llvmIRBuilder_.CreateICmpNE(a, b, "ne");
+    } else if (op == T_LT) { // <
+      v = fp ? llvmIRBuilder_.CreateFCmpOLT(a, b, "lt")
+             : llvmIRBuilder_.CreateICmpSLT(a, b, "lt");
+    } else if (op == T_LE) { // <=
+      v = fp ? llvmIRBuilder_.CreateFCmpOLE(a, b, "le")
+             : llvmIRBuilder_.CreateICmpSLE(a, b, "le");
+    } else if (op == T_GT) { // >
+      v = fp ? llvmIRBuilder_.CreateFCmpOGT(a, b, "gt")
+             : llvmIRBuilder_.CreateICmpSGT(a, b, "gt");
+    } else { // >=
+      v = fp ? llvmIRBuilder_.CreateFCmpOGE(a, b, "ge")
+             : llvmIRBuilder_.CreateICmpSGE(a, b, "ge");
+    }
     break;
   }
-  case T_AMPERSAND: { // &
-    v = llvmIRBuilder_.CreateAnd(a, b, "bitand");
+  case T_DOT2: { // ..
+    ASSERT(false, "error: range {}:{} can only be enumerated by for loop\n",
+           ast->name(), ast->location());
     break;
   }
-  case T_CARET: { // ^
-    v = llvmIRBuilder_.CreateXor(a, b, "xor");
-    break;
+  // case T_LSHIFT:
+  // case T_RSHIFT:
+  // case T_ARSHIFT:
+  default:
+    LOG_ASSERT(false, "invalid infixOp {} in ast {}:{}", tokenName(op),
+               ast->name(), ast->location());
   }
-  case T_EQ: { // ==
-    v = llvmIRBuilder_.CreateICmpEQ(a, b, "eq");
+  return v;
+}
+
+void IrBuilder::visitPrefix(A_Prefix *ast) {
+  LOG_ASSERT(ast->prefixOp == T_REDUCE, "not implemented");
+  reduce(ast);
+}
+
+void IrBuilder::reduce(A_Prefix *ast) {
+  // reduction of a constant is already folded to the constant
+  ASSERT(ast->expr->kind() == +AstKind::Prefix,
+         "error: {}:{} is not a vector\n", ast->expr->name(),
+         ast->expr->location());
+  A_Prefix *reduction = static_cast<A_Prefix *>(ast->expr);
+  reduction->expr->accept(this);
+  llvm::Value *v = pop().asValue();
+  ASSERT(v->getType()->isVectorTy(), "error: {}:{} is not a vector\n",
+         reduction->expr->name(), reduction->expr->location());
+  bool fp = v->getType()->isFPOrFPVectorTy();
+  llvm::Value *r = nullptr;
+  switch (reduction->prefixOp) {
+  case T_PLUS: { // +
+    if (fp) {
+      // lanes are added in any order like the loop vectorizer does, not
+      // sequentially
+      llvm::FastMathFlags flags;
+      flags.setAllowReassoc();
+      llvm::IRBuilderBase::FastMathFlagGuard guard(llvmIRBuilder_);
+      llvmIRBuilder_.setFastMathFlags(flags);
+      r = llvmIRBuilder_.CreateFAddReduce(
+          llvm::ConstantFP::getNegativeZero(
+              v->getType()->getScalarType()),
+          v);
+    } else {
+      r = llvmIRBuilder_.CreateAddReduce(v);
+    }
     break;
   }
-  case T_NEQ: { // !=
-    v = llvmIRBuilder_.CreateICmpNE(a, b, "ne");
+  case T_LT: { // min
+    r = fp ? llvmIRBuilder_.CreateFPMinReduce(v)
+           : llvmIRBuilder_.CreateIntMinReduce(v, true);
     break;
   }
-  case T_LT: { // <
-    v = llvmIRBuilder_.CreateICmpSLT(a, b, "lt");
+  case T_GT: { // max
+    r = fp ? llvmIRBuilder_.CreateFPMaxReduce(v)
+           : llvmIRBuilder_.CreateIntMaxReduce(v, true);
     break;
   }
-  case T_LE: { // <=
-    v = llvmIRBuilder_.CreateICmpSLE(a, b, "le");
-    break;
+  default:
+    LOG_ASSERT(false, "invalid reduction {} in ast {}:{}",
+               tokenName(reduction->prefixOp), ast->name(), ast->location());
   }
-  case T_GT: { // >
-    v = llvmIRBuilder_.CreateICmpSGT(a, b, "gt");
-    break;
+  results_.push_back(detail::SpaceData::fromValue(r));
+}
+
+void IrBuilder::visitCall(A_Call *ast) {
+  if (ast->id->kind() == +AstKind::PlainType) {
+    vector(ast);
+    return;
   }
-  case T_GE: { // >=
-    v = llvmIRBuilder_.CreateICmpSGE(a, b, "ge");
-    break;
+  LOG_ASSERT(ast->id->kind() == +AstKind::VarId,
+             "ast {}:{} callee must be VarId", ast->name(), ast->location());
+  A_VarId *funcId = static_cast<A_VarId *>(ast->id);
+  llvm::Function *func = space_.getFunction(funcId->symbol());
+  LOG_ASSERT(func, "ast {}:{} function {} must be defined before call",
+             ast->name(), ast->location(), funcId->name());
+  const Ts_Func *ts_func =
+      static_cast<const Ts_Func *>(funcId->symbol()->type());
+  ASSERT(!ts_func->generator ||
+             ast->parent()->kind() == +AstKind::LoopEnumerator,
+         "error: generator {}:{} can only be enumerated by for loop\n",
+         funcId->name(), ast->location());
+  if (ts_func->async) {
+    // task is spawned and completed by enclosing `await`
+    auto it = awaited_.find(ast);
+    ASSERT(it != awaited_.end(),
+           "error: async function {}:{} can only be called in await\n",
+           funcId->name(), ast->location());
+    results_.push_back(detail::SpaceData::fromValue(it->second));
+    return;
   }
-  // case T_LSHIFT:
-  // case T_RSHIFT:
-  // case T_ARSHIFT:
-  default:
-    LOG_ASSERT(false, "invalid infixOp {} in ast {}:{}",
-               tokenName(ast->infixOp), ast->name(), ast->location());
+  std::vector<llvm::Value *> args;
+  for (A_Exprs *e = ast->args; e; e = e->next) {
+    if (args.size() < ts_func->params.size()) {
+      checkLength(ts_func->params[args.size()], e->expr);
+    }
+    e->expr->accept(this);
+    args.push_back(pop().asValue());
   }
-  space_.setValue(label(ast), v);
+  llvm::Value *ci = call(func, args);
+  results_.push_back(detail::SpaceData::fromValue(ci));
 }
 
-void IrBuilder::visitPrefix(A_Prefix *ast) {
-  LOG_ASSERT(false, "not implemented");
+void IrBuilder::vector(A_Call *ast) {
+  const TypeSymbol *ts = scope_->ts_resolve(ast->id->name());
+  LOG_ASSERT(ts && ts->kind() == +TypeSymbolKind::Vector,
+             "ast {}:{} constructor must be of vector type", ast->name(),
+             ast->location());
+  const Ts_Vector *tv = static_cast<const Ts_Vector *>(ts);
+  llvm::Type *ty = type(tv);
+  std::vector<llvm::Value *> elements;
+  for (A_Exprs *e = ast->args; e; e = e->next) {
+    e->expr->accept(this);
+    elements.push_back(pop().asValue());
+    ASSERT(elements.back()->getType() == ty->getScalarType(),
+           "error: {}:{} is not an element of {}\n", e->expr->name(),
+           e->expr->location(), tv->name());
+  }
+  ASSERT(elements.size() == 1 || (int)elements.size() == tv->lanes,
+         "error: {}:{} needs 1 or {} elements\n", ast->name(),
+         ast->location(), tv->lanes);
+  llvm::Value *v = nullptr;
+  if (elements.size() == 1) {
+    v = llvmIRBuilder_.CreateVectorSplat(tv->lanes, elements[0], "splat");
+  } else {
+    v = llvm::UndefValue::get(ty);
+    for (int i = 0; i < tv->lanes; i++) {
+      v = llvmIRBuilder_.CreateInsertElement(v, elements[i], (uint64_t)i,
+                                             "vector");
+    }
+  }
+  results_.push_back(detail::SpaceData::fromValue(v));
 }
 
-void IrBuilder::visitCall(A_Call *ast) { LOG_ASSERT(false, "not implemented"); }
+void IrBuilder::visitIndex(A_Index *ast) {
+  if (isRange(ast->index)) {
+    slice(ast);
+    return;
+  }
+  const Ts_Vector *tv = vectorType(ast->expr);
+  ASSERT(tv || ast->index->kind() != +AstKind::Exprs,
+         "error: {}:{} is not a vector\n", ast->expr->name(),
+         ast->expr->location());
+  if (tv) {
+    ast->expr->accept(this);
+    llvm::Value *v = pop().asValue();
+    if (ast->index->kind() != +AstKind::Exprs) {
+      results_.push_back(detail::SpaceData::fromValue(
+          llvmIRBuilder_.CreateExtractElement(v, lane(ast->index, tv),
+                                              "lane")));
+      return;
+    }
+    std::vector<int> mask;
+    for (A_Exprs *e = static_cast<A_Exprs *>(ast->index); e; e = e->next) {
+      mask.push_back((int)lane(e->expr, tv));
+    }
+    results_.push_back(
+        detail::SpaceData::fromValue(llvmIRBuilder_.CreateShuffleVector(
+            v, llvm::UndefValue::get(v->getType()), mask, "shuffle")));
+    return;
+  }
+  llvm::Type *elementType = nullptr;
+  llvm::Value *ptr = elementPointer(ast, &elementType);
+  results_.push_back(
+      detail::SpaceData::fromValue(loadElement(elementType, ptr)));
+}
 
-void IrBuilder::visitBlock(A_Block *ast) {
-  if (ast->parent()->kind() == (+AstKind::FuncDef)) {
-    A_FuncDef *funcDef = static_cast<A_FuncDef *>(ast->parent());
-    A_FuncSign *funcSign = static_cast<A_FuncSign *>(funcDef->funcSign);
-    A_VarId *funcId = static_cast<A_VarId *>(funcSign->id);
-    llvm::Function *func = space_.getFunction(label(funcId->symbol()));
-    // entry block of function
-    llvm::BasicBlock *entryBlock =
-        llvm::BasicBlock::Create(llvmContext_, "entry", func);
-    llvmIRBuilder_.SetInsertPoint(entryBlock);
-    if (ast->blockStats) {
-      ast->blockStats->accept(this);
+uint64_t IrBuilder::lane(Ast *index, const Ts_Vector *tv) {
+  int64_t i = -1;
+  if (index->kind() == +AstKind::Integer) {
+    A_Integer *e = static_cast<A_Integer *>(index);
+    i = e->bit() == 64 ? e->asInt64() : (int64_t)e->asInt32();
+  }
+  ASSERT(i >= 0 && i < tv->lanes,
+         "error: lane {}:{} is not a constant in [0, {})\n", index->name(),
+         index->location(), tv->lanes);
+  return (uint64_t)i;
+}
+
+void IrBuilder::visitNew(A_New *ast) {
+  ast->type->accept(this);
+  llvm::Type *elementType = pop().asType();
+  ASSERT(!elementType->isVoidTy(), "error: array element {}:{} is void\n",
+         ast->type->name(), ast->type->location());
+  ast->count->accept(this);
+  llvm::Value *length = llvmIRBuilder_.CreateSExtOrTrunc(
+      pop().asValue(), llvm::Type::getInt64Ty(llvmContext_), "new.length");
+
+  // array memory is zero initialized
+  llvm::Value *bytes = arrayBytes(elementType, length);
+  llvm::Value *data = nullptr;
+  if (ast->stack) {
+    // static alloca in entry block, reused when `new` is in a loop
+    llvm::BasicBlock *entry =
+        &llvmIRBuilder_.GetInsertBlock()->getParent()->getEntryBlock();
+    llvm::IRBuilder<> entryBuilder(entry, entry->begin());
+    // `[N x T]` instead of array size operand, so SROA can split it
+    uint64_t n = llvm::cast<llvm::ConstantInt>(length)->getZExtValue();
+    llvm::AllocaInst *mem = entryBuilder.CreateAlloca(
+        llvm::ArrayType::get(elementType, n), nullptr, "new.stack");
+    mem->setAlignment(llvm::Align(16));
+    data = mem;
+  } else if (!regions_.empty()) {
+    // bump allocation in innermost region, freed at region exit
+    data = llvmIRBuilder_.CreateCall(
+        runtime("dimrt_region_alloc", llvm::Type::getInt8PtrTy(llvmContext_),
+                {llvm::Type::getInt8PtrTy(llvmContext_),
+                 llvm::Type::getInt64Ty(llvmContext_)}),
+        {regions_.back(), bytes}, "new.mem");
+  } else {
+    data = llvmIRBuilder_.CreateCall(
+        runtime("dimrt_alloc", llvm::Type::getInt8PtrTy(llvmContext_),
+                {llvm::Type::getInt64Ty(llvmContext_)}),
+        {bytes}, "new.mem");
+  }
+  llvmIRBuilder_.CreateMemSet(data, llvmIRBuilder_.getInt8(0), bytes,
+                              llvm::MaybeAlign(16));
+  data = llvmIRBuilder_.CreateBitCast(data, elementType->getPointerTo(),
+                                      "new.data");
+
+  llvm::Value *array = llvm::UndefValue::get(arrayType(elementType));
+  array = llvmIRBuilder_.CreateInsertValue(array, data, {0});
+  array = llvmIRBuilder_.CreateInsertValue(array, length, {1}, "new");
+  results_.push_back(detail::SpaceData::fromValue(array));
+}
+
+void IrBuilder::visitDelete(A_Delete *ast) {
+  if (ast->stack || ast->region) {
+    return;
+  }
+  ast->expr->accept(this);
+  llvm::Value *array = pop().asValue();
+  ASSERT(array->getType()->isStructTy(), "error: {}:{} is not an array\n",
+         ast->expr->name(), ast->expr->location());
+  llvm::Value *data =
+      llvmIRBuilder_.CreateExtractValue(array, {0}, "delete.data");
+  llvm::Value *length =
+      llvmIRBuilder_.CreateExtractValue(array, {1}, "delete.length");
+  llvm::Value *bytes =
+      arrayBytes(data->getType()->getPointerElementType(), length);
+  llvm::Value *mem = llvmIRBuilder_.CreateBitCast(
+      data, llvm::Type::getInt8PtrTy(llvmContext_), "delete.mem");
+  llvmIRBuilder_.CreateCall(
+      runtime("dimrt_free", llvm::Type::getVoidTy(llvmContext_),
+              {llvm::Type::getInt8PtrTy(llvmContext_),
+               llvm::Type::getInt64Ty(llvmContext_)}),
+      {mem, bytes});
+}
+
+void IrBuilder::visitIf(A_If *ast) {
+  ast->condition->accept(this);
+  llvm::Value *condition = pop().asValue();
+
+  llvm::BasicBlock *thenBlock = createBlock("if.then");
+  llvm::BasicBlock *elseBlock = ast->elsep ? createBlock("if.else") : nullptr;
+  llvm::BasicBlock *endBlock = createBlock("if.end");
+  llvmIRBuilder_.CreateCondBr(condition, thenBlock,
+                              elseBlock ? elseBlock : endBlock);
+
+  ssa_->sealBlock(thenBlock);
+  enterBlock(thenBlock);
+  llvm::Value *thenValue = branchValue(ast->thenp);
+  llvm::BasicBlock *thenEnd = llvmIRBuilder_.GetInsertBlock();
+  branch(endBlock);
+
+  llvm::Value *elseValue = nullptr;
+  llvm::BasicBlock *elseEnd = nullptr;
+  if (elseBlock) {
+    ssa_->sealBlock(elseBlock);
+    enterBlock(elseBlock);
+    elseValue = branchValue(ast->elsep);
+    elseEnd = llvmIRBuilder_.GetInsertBlock();
+    branch(endBlock);
+  }
+
+  ssa_->sealBlock(endBlock);
+  enterBlock(endBlock);
+
+  // if-else expression has a value when both branches have
+  if (thenValue && elseValue && thenValue->getType() == elseValue->getType()) {
+    llvm::PHINode *phi =
+        llvmIRBuilder_.CreatePHI(thenValue->getType(), 2, "if.value");
+    phi->addIncoming(thenValue, thenEnd);
+    phi->addIncoming(elseValue, elseEnd);
+    results_.push_back(detail::SpaceData::fromValue(phi));
+  }
+}
+
+llvm::Value *IrBuilder::branchValue(Ast *ast) {
+  int results = (int)results_.size();
+  ast->accept(this);
+  llvm::Value *value =
+      (int)results_.size() > results ? results_.back().asValue() : nullptr;
+  results_.resize(results);
+  return value;
+}
+
+void IrBuilder::visitLoop(A_Loop *ast) {
+  if (ast->parallel) {
+    parallelLoop(ast);
+    return;
+  }
+  if (ast->condition->kind() == +AstKind::LoopEnumerator) {
+    if (isRange(static_cast<A_LoopEnumerator *>(ast->condition)->expr)) {
+      llvm::Value *begin, *end;
+      range(ast, &begin, &end);
+      countedLoop(ast, begin, end);
+    } else {
+      enumerate(ast);
     }
-    // insert `return void` if there's no return instruction in function
-    bool hasReturn = false;
-    for (llvm::Function::const_iterator i = func->getBasicBlockList().begin();
-         i != func->getBasicBlockList().end() && !hasReturn; ++i) {
-      for (llvm::BasicBlock::const_iterator j = i->getInstList().begin();
-           j != i->getInstList().end() && !hasReturn; ++j) {
-        const llvm::Instruction *inst = &(*j);
-        // const llvm::Instruction *inst = j;
-        if (llvm::ReturnInst::classof(inst)) {
-          hasReturn = true;
-        }
+    return;
+  }
+  LOG_ASSERT(ast->condition->kind() == +AstKind::LoopCondition,
+             "not implemented");
+  A_LoopCondition *loopCondition =
+      static_cast<A_LoopCondition *>(ast->condition);
+  if (loopCondition->init) {
+    statement(loopCondition->init);
+  }
+
+  llvm::BasicBlock *condBlock = createBlock("loop.cond");
+  llvm::BasicBlock *bodyBlock = createBlock("loop.body");
+  llvm::BasicBlock *updateBlock =
+      loopCondition->update ? createBlock("loop.update") : nullptr;
+  llvm::BasicBlock *endBlock = createBlock("loop.end");
+  llvm::BasicBlock *continueBlock = updateBlock ? updateBlock : condBlock;
+
+  // condition block is sealed after back edge is created
+  branch(condBlock);
+  enterBlock(condBlock);
+  if (loopCondition->condition) {
+    loopCondition->condition->accept(this);
+    llvmIRBuilder_.CreateCondBr(pop().asValue(), bodyBlock, endBlock);
+  } else {
+    llvmIRBuilder_.CreateBr(bodyBlock);
+  }
+
+  ssa_->sealBlock(bodyBlock);
+  enterBlock(bodyBlock);
+  loops_.push_back(std::make_pair(continueBlock, endBlock));
+  statement(ast->body);
+  loops_.pop_back();
+  branch(continueBlock);
+
+  if (updateBlock) {
+    ssa_->sealBlock(updateBlock);
+    enterBlock(updateBlock);
+    statement(loopCondition->update);
+    branch(condBlock);
+  }
+
+  ssa_->sealBlock(condBlock);
+  ssa_->sealBlock(endBlock);
+  enterBlock(endBlock);
+}
+
+void IrBuilder::enumerate(A_Loop *ast) {
+  A_LoopEnumerator *enumerator =
+      static_cast<A_LoopEnumerator *>(ast->condition);
+  A_VarId *varId = static_cast<A_VarId *>(enumerator->id);
+  ASSERT(enumerator->expr->kind() == +AstKind::Call &&
+             static_cast<A_Call *>(enumerator->expr)->id->kind() ==
+                 +AstKind::VarId,
+         "error: {}:{} is not a generator call\n", enumerator->expr->name(),
+         enumerator->expr->location());
+  A_VarId *funcId =
+      static_cast<A_VarId *>(static_cast<A_Call *>(enumerator->expr)->id);
+  const Ts_Func *ts_func =
+      static_cast<const Ts_Func *>(funcId->symbol()->type());
+  ASSERT(ts_func->generator, "error: {}:{} is not a generator\n",
+         funcId->name(), funcId->location());
+  ASSERT(ts_func->result == varId->symbol()->type(),
+         "error: {}:{} type {} is not generator type {}\n", varId->name(),
+         varId->location(), varId->symbol()->type()->name(),
+         ts_func->result->name());
+
+  enumerator->expr->accept(this);
+  llvm::Value *handle = pop().asValue();
+  llvm::Type *elementType = type(ts_func->result);
+  Cleanup destroy;
+  destroy.function = intrinsic(llvm::Intrinsic::coro_destroy);
+  destroy.value = handle;
+  destroy.finallyp = nullptr;
+  destroy.depth = (int)loops_.size();
+  pushCleanup(destroy);
+
+  llvm::BasicBlock *condBlock = createBlock("for.cond");
+  llvm::BasicBlock *bodyBlock = createBlock("for.body");
+  llvm::BasicBlock *endBlock = createBlock("for.end");
+
+  // condition block is sealed after back edge is created
+  branch(condBlock);
+  enterBlock(condBlock);
+  // generator may throw
+  call(intrinsic(llvm::Intrinsic::coro_resume), {handle});
+  llvm::Value *done = llvmIRBuilder_.CreateCall(
+      intrinsic(llvm::Intrinsic::coro_done), {handle}, "for.done");
+  llvmIRBuilder_.CreateCondBr(done, endBlock, bodyBlock);
+
+  ssa_->sealBlock(bodyBlock);
+  enterBlock(bodyBlock);
+  llvm::Value *promise = llvmIRBuilder_.CreateCall(
+      intrinsic(llvm::Intrinsic::coro_promise),
+      {handle, llvmIRBuilder_.getInt32(PromiseAlign),
+       llvmIRBuilder_.getFalse()},
+      "for.promise");
+  promise = llvmIRBuilder_.CreateBitCast(promise, elementType->getPointerTo());
+  writeVariable(varId, llvmIRBuilder_.CreateLoad(elementType, promise,
+                                                 label(varId).str()));
+  loops_.push_back(std::make_pair(condBlock, endBlock));
+  statement(ast->body);
+  loops_.pop_back();
+  branch(condBlock);
+
+  ssa_->sealBlock(condBlock);
+  ssa_->sealBlock(endBlock);
+  enterBlock(endBlock);
+  popCleanup();
+  llvmIRBuilder_.CreateCall(destroy.function, {handle});
+}
+
+void IrBuilder::range(A_Loop *ast, llvm::Value **begin, llvm::Value **end) {
+  A_LoopEnumerator *enumerator =
+      static_cast<A_LoopEnumerator *>(ast->condition);
+  A_VarId *varId = static_cast<A_VarId *>(enumerator->id);
+  A_Infix *range = static_cast<A_Infix *>(enumerator->expr);
+  const TypeSymbol *ts = varId->symbol()->type();
+  bool isUnsigned;
+  ASSERT(integerType(ts, &isUnsigned),
+         "error: {}:{} type {} of range is not integer\n", varId->name(),
+         varId->location(), ts->name());
+  llvm::Type *indexType = type(ts);
+
+  // bounds are evaluated once before loop
+  range->left->accept(this);
+  *begin = pop().asValue();
+  range->right->accept(this);
+  *end = pop().asValue();
+  ASSERT((*begin)->getType() == indexType && (*end)->getType() == indexType,
+         "error: range {}:{} is not type {}\n", range->name(),
+         range->location(), ts->name());
+}
+
+namespace {
+
+// `a[i]` in body of range loop over i, except those of nested function or
+// foreach, whose body is outlined
+class RangeIndexes : public Visitor {
+public:
+  explicit RangeIndexes(const Symbol *index, bool outlined = false)
+      : index_(index), outlined_(outlined) {}
+
+  virtual void visitIndex(A_Index *ast) {
+    if (!outlined_ && ast->expr->kind() == +AstKind::VarId &&
+        ast->index->kind() == +AstKind::VarId &&
+        static_cast<A_VarId *>(ast->index)->symbol() == index_) {
+      Symbol *array = static_cast<A_VarId *>(ast->expr)->symbol();
+      if (array && array->type()->kind() == +TypeSymbolKind::Array) {
+        indexes.push_back(ast);
       }
     }
-    // llvm::BasicBlock *lastBlock = &(*func->getBasicBlockList().rbegin());
-    if (!hasReturn) {
-      llvmIRBuilder_.CreateRetVoid();
+    Visitor::visitIndex(ast);
+  }
+  virtual void visitAssign(A_Assign *ast) {
+    if (ast->assignee->kind() == +AstKind::VarId) {
+      assigned.insert(static_cast<A_VarId *>(ast->assignee)->symbol());
+    }
+    Visitor::visitAssign(ast);
+  }
+  virtual void visitLoop(A_Loop *ast) {
+    for (A_Exprs *e = ast->reductions; e; e = e->next) {
+      assigned.insert(
+          static_cast<A_VarId *>(static_cast<A_Prefix *>(e->expr)->expr)
+              ->symbol());
+    }
+    if (!ast->parallel || outlined_) {
+      Visitor::visitLoop(ast);
+      return;
+    }
+    // children are visited after this method returns, so body of foreach is
+    // visited by a nested visitor which only collects its assignments
+    RangeIndexes outlined(index_, true);
+    outlined.visit(ast->condition);
+    outlined.visit(ast->body);
+    assigned.insert(outlined.assigned.begin(), outlined.assigned.end());
+  }
+  virtual void visitFuncDef(A_FuncDef *ast) {}
+
+  std::vector<A_Index *> indexes;
+  std::unordered_set<const Symbol *> assigned;
+
+private:
+  const Symbol *index_;
+  bool outlined_;
+};
+
+} // namespace
+
+void IrBuilder::countedLoop(A_Loop *ast, llvm::Value *begin,
+                            llvm::Value *end) {
+  A_LoopEnumerator *enumerator =
+      static_cast<A_LoopEnumerator *>(ast->condition);
+  A_VarId *varId = static_cast<A_VarId *>(enumerator->id);
+  bool isUnsigned;
+  integerType(varId->symbol()->type(), &isUnsigned);
+  llvm::Type *indexType = begin->getType();
+
+  // bounds checks of `a[i]` are hoisted out of loop: if a is not assigned in
+  // body, and [begin, end) is in bounds of it, no check of them fails
+  RangeIndexes rangeIndexes(varId->symbol());
+  rangeIndexes.visit(ast->body);
+  if (!rangeIndexes.assigned.count(varId->symbol())) {
+    llvm::Type *i64 = llvm::Type::getInt64Ty(llvmContext_);
+    unsigned bits = indexType->getIntegerBitWidth();
+    llvm::Value *last = llvmIRBuilder_.CreateIntCast(end, i64, !isUnsigned);
+    llvm::Value *empty =
+        isUnsigned ? llvmIRBuilder_.CreateICmpUGE(begin, end)
+                   : llvmIRBuilder_.CreateICmpSGE(begin, end);
+    // index is sign extended to i64, so unsigned range must stay below sign
+    // bit of its type
+    llvm::Value *nonNegative =
+        !isUnsigned ? llvmIRBuilder_.CreateICmpSGE(
+                          llvmIRBuilder_.CreateSExt(begin, i64),
+                          llvm::ConstantInt::get(i64, 0))
+        : bits < 64 ? llvmIRBuilder_.CreateICmpULE(
+                          last, llvm::ConstantInt::get(i64, 1ULL << (bits - 1)))
+                    : llvmIRBuilder_.getTrue();
+    std::unordered_map<const Symbol *, llvm::Value *> hoisted;
+    for (A_Index *index : rangeIndexes.indexes) {
+      A_VarId *array = static_cast<A_VarId *>(index->expr);
+      if (rangeIndexes.assigned.count(array->symbol())) {
+        continue;
+      }
+      llvm::Value *&inBounds = hoisted[array->symbol()];
+      if (!inBounds) {
+        llvm::Value *length = arrayLength(array, readVariable(array));
+        inBounds = llvmIRBuilder_.CreateOr(
+            empty,
+            llvmIRBuilder_.CreateAnd(
+                nonNegative,
+                isUnsigned ? llvmIRBuilder_.CreateICmpULE(last, length)
+                           : llvmIRBuilder_.CreateICmpSLE(last, length)),
+            label(array).str() + ".inbounds");
+      }
+      inBounds_[index] = inBounds;
+    }
+  }
+
+  llvm::BasicBlock *preheader = llvmIRBuilder_.GetInsertBlock();
+  llvm::BasicBlock *condBlock = createBlock("range.cond");
+  llvm::BasicBlock *bodyBlock = createBlock("range.body");
+  llvm::BasicBlock *nextBlock = createBlock("range.next");
+  llvm::BasicBlock *endBlock = createBlock("range.end");
+
+  // condition block is sealed after back edge is created
+  llvmIRBuilder_.CreateBr(condBlock);
+  enterBlock(condBlock);
+  llvm::PHINode *index =
+      llvmIRBuilder_.CreatePHI(indexType, 2, label(varId).str());
+  index->addIncoming(begin, preheader);
+  llvm::Value *inRange =
+      isUnsigned ? llvmIRBuilder_.CreateICmpULT(index, end, "range.lt")
+                 : llvmIRBuilder_.CreateICmpSLT(index, end, "range.lt");
+  llvmIRBuilder_.CreateCondBr(inRange, bodyBlock, endBlock);
+
+  // assignment to loop variable in body doesn't change the induction variable
+  ssa_->sealBlock(bodyBlock);
+  enterBlock(bodyBlock);
+  writeVariable(varId, index);
+  loops_.push_back(std::make_pair(nextBlock, endBlock));
+  statement(ast->body);
+  loops_.pop_back();
+  branch(nextBlock);
+
+  // index < end before increment, so it never wraps
+  ssa_->sealBlock(nextBlock);
+  enterBlock(nextBlock);
+  llvm::Value *next = llvmIRBuilder_.CreateAdd(
+      index, llvm::ConstantInt::get(indexType, 1), "range.inc", isUnsigned,
+      !isUnsigned);
+  index->addIncoming(next, llvmIRBuilder_.GetInsertBlock());
+  llvmIRBuilder_.CreateBr(condBlock);
+
+  ssa_->sealBlock(condBlock);
+  ssa_->sealBlock(endBlock);
+  enterBlock(endBlock);
+  for (A_Index *index : rangeIndexes.indexes) {
+    inBounds_.erase(index);
+  }
+}
+
+namespace {
+
+// local variables of enclosing function used by body of parallel loop, except
+// those defined inside it
+class Captures : public Visitor {
+public:
+  virtual void visitVarId(A_VarId *ast) {
+    Symbol *symbol = ast->symbol();
+    if (!symbol || !ast->hasSlot()) {
+      return;
+    }
+    if (symbol->ast() == ast) {
+      defined.insert(symbol);
+    } else if (used.insert(symbol).second) {
+      uses.push_back(ast);
+    }
+  }
+  virtual void visitAssign(A_Assign *ast) {
+    if (ast->assignee->kind() == +AstKind::VarId) {
+      assigned.push_back(static_cast<A_VarId *>(ast->assignee));
+    }
+    // lane assignment `v[i] = x` writes vector variable v
+    if (ast->assignee->kind() == +AstKind::Index &&
+        vectorType(static_cast<A_Index *>(ast->assignee)->expr) &&
+        static_cast<A_Index *>(ast->assignee)->expr->kind() ==
+            +AstKind::VarId) {
+      assigned.push_back(static_cast<A_VarId *>(
+          static_cast<A_Index *>(ast->assignee)->expr));
+    }
+    Visitor::visitAssign(ast);
+  }
+  // reductions of nested parallel loop are assigned too
+  virtual void visitLoop(A_Loop *ast) {
+    for (A_Exprs *e = ast->reductions; e; e = e->next) {
+      assigned.push_back(
+          static_cast<A_VarId *>(static_cast<A_Prefix *>(e->expr)->expr));
+    }
+    Visitor::visitLoop(ast);
+  }
+  virtual void visitFuncDef(A_FuncDef *ast) {}
+
+  // first use of each variable, in source order
+  std::vector<A_VarId *> uses;
+  std::unordered_set<const Symbol *> used;
+  std::unordered_set<const Symbol *> defined;
+  std::vector<A_VarId *> assigned;
+};
+
+} // namespace
+
+void IrBuilder::parallelLoop(A_Loop *ast) {
+  A_LoopEnumerator *enumerator =
+      ast->condition->kind() == +AstKind::LoopEnumerator
+          ? static_cast<A_LoopEnumerator *>(ast->condition)
+          : nullptr;
+  ASSERT(enumerator && isRange(enumerator->expr),
+         "error: foreach {}:{} must enumerate a range\n", ast->name(),
+         ast->location());
+  A_VarId *varId = static_cast<A_VarId *>(enumerator->id);
+  bool isUnsigned;
+  llvm::Value *begin, *end;
+  range(ast, &begin, &end);
+  integerType(varId->symbol()->type(), &isUnsigned);
+  llvm::Type *indexType = begin->getType();
+  llvm::Type *i8p = llvm::Type::getInt8PtrTy(llvmContext_);
+  llvm::Type *i64 = llvm::Type::getInt64Ty(llvmContext_);
+  llvm::Type *voidType = llvm::Type::getVoidTy(llvmContext_);
+
+  // partial result of each chunk starts at identity of reduction, and is
+  // combined into an accumulator of enclosing function. Accumulator is i64,
+  // unsigned value of min/max is offset by 2^63 so it compares signed
+  struct Reduction {
+    A_VarId *varId;
+    int op;
+    bool isUnsigned;
+    llvm::Value *accumulator;
+  };
+  std::vector<Reduction> reductions;
+  std::unordered_set<const Symbol *> reduced;
+  for (A_Exprs *e = ast->reductions; e; e = e->next) {
+    A_Prefix *prefix = static_cast<A_Prefix *>(e->expr);
+    Reduction r;
+    r.varId = static_cast<A_VarId *>(prefix->expr);
+    r.op = prefix->prefixOp;
+    const TypeSymbol *ts = r.varId->symbol()->type();
+    ASSERT(r.varId->hasSlot(), "error: reduction {}:{} is not local variable\n",
+           r.varId->name(), r.varId->location());
+    ASSERT(integerType(ts, &r.isUnsigned),
+           "error: reduction {}:{} type {} is not integer\n", r.varId->name(),
+           r.varId->location(), ts->name());
+    ASSERT(reduced.insert(r.varId->symbol()).second,
+           "error: reduction {}:{} is duplicated\n", r.varId->name(),
+           r.varId->location());
+    reductions.push_back(r);
+  }
+  llvm::Value *signBit = llvm::ConstantInt::get(i64, 1ULL << 63);
+  auto encode = [&](const Reduction &r, llvm::Value *value) {
+    value = llvmIRBuilder_.CreateIntCast(value, i64, !r.isUnsigned);
+    return r.isUnsigned && r.op != T_PLUS
+               ? llvmIRBuilder_.CreateXor(value, signBit)
+               : value;
+  };
+  auto decode = [&](const Reduction &r, llvm::Value *value) {
+    if (r.isUnsigned && r.op != T_PLUS) {
+      value = llvmIRBuilder_.CreateXor(value, signBit);
+    }
+    return llvmIRBuilder_.CreateTrunc(value, type(r.varId->symbol()->type()),
+                                      label(r.varId).str());
+  };
+
+  // chunks run concurrently, so body only reads variables of enclosing
+  // function, except reductions
+  Captures captures;
+  captures.visit(ast->body);
+  for (A_VarId *assignee : captures.assigned) {
+    const Symbol *symbol = assignee->symbol();
+    ASSERT(!assignee->hasSlot() || captures.defined.count(symbol) ||
+               reduced.count(symbol) || symbol == varId->symbol(),
+           "error: {}:{} of enclosing function cannot be assigned in foreach "
+           "{}:{}\n",
+           assignee->name(), assignee->location(), ast->name(),
+           ast->location());
+  }
+  std::vector<A_VarId *> inputs;
+  for (A_VarId *use : captures.uses) {
+    const Symbol *symbol = use->symbol();
+    if (!captures.defined.count(symbol) && !reduced.count(symbol) &&
+        symbol != varId->symbol()) {
+      inputs.push_back(use);
+    }
+  }
+
+  // context of outlined body: captured values, begin of range, and pointers
+  // to accumulators
+  std::vector<llvm::Type *> fields;
+  std::vector<llvm::Value *> values;
+  for (A_VarId *input : inputs) {
+    values.push_back(readVariable(input));
+    fields.push_back(values.back()->getType());
+  }
+  values.push_back(begin);
+  fields.push_back(indexType);
+  llvm::BasicBlock *entry =
+      &llvmIRBuilder_.GetInsertBlock()->getParent()->getEntryBlock();
+  llvm::IRBuilder<> entryBuilder(entry, entry->begin());
+  for (Reduction &r : reductions) {
+    r.accumulator =
+        entryBuilder.CreateAlloca(i64, nullptr, label(r.varId).str() + ".acc");
+    llvmIRBuilder_.CreateStore(encode(r, readVariable(r.varId)),
+                               r.accumulator);
+    values.push_back(r.accumulator);
+    fields.push_back(i64->getPointerTo());
+  }
+  llvm::StructType *contextType = llvm::StructType::get(llvmContext_, fields);
+  llvm::AllocaInst *context =
+      entryBuilder.CreateAlloca(contextType, nullptr, "foreach.context");
+  for (int i = 0; i < (int)values.size(); i++) {
+    llvmIRBuilder_.CreateStore(
+        values[i], llvmIRBuilder_.CreateStructGEP(contextType, context, i));
+  }
+
+  // empty range has no iteration, otherwise end - begin is unsigned count
+  llvm::Value *nonEmpty =
+      isUnsigned ? llvmIRBuilder_.CreateICmpULT(begin, end)
+                 : llvmIRBuilder_.CreateICmpSLT(begin, end);
+  llvm::Value *n = llvmIRBuilder_.CreateSelect(
+      nonEmpty,
+      llvmIRBuilder_.CreateZExt(llvmIRBuilder_.CreateSub(end, begin), i64),
+      llvm::ConstantInt::get(i64, 0), "foreach.n");
+
+  // body is outlined as `void(i8* context, i64 begin, i64 end)` running a
+  // chunk of iterations, it has its own local variables like a function
+  llvm::FunctionType *bodyType =
+      llvm::FunctionType::get(voidType, {i8p, i64, i64}, false);
+  llvm::Function *outer = llvmIRBuilder_.GetInsertBlock()->getParent();
+  llvm::Function *body =
+      llvm::Function::Create(bodyType, llvm::Function::InternalLinkage,
+                             outer->getName() + ".foreach", llvmModule_);
+  SsaBuilder ssa;
+  SsaBuilder *outerSsa = ssa_;
+  ssa_ = &ssa;
+  std::vector<std::pair<llvm::BasicBlock *, llvm::BasicBlock *>> outerLoops;
+  outerLoops.swap(loops_);
+  std::vector<llvm::Value *> outerRegions;
+  outerRegions.swap(regions_);
+  std::vector<Cleanup> outerCleanups;
+  outerCleanups.swap(cleanups_);
+  std::vector<Unwind> outerUnwinds;
+  outerUnwinds.swap(unwinds_);
+  Coroutine *outerCoroutine = coroutine_;
+  coroutine_ = nullptr;
+  bool outerParallel = parallel_;
+  parallel_ = true;
+  llvm::IRBuilderBase::InsertPoint outerInsertPoint =
+      llvmIRBuilder_.saveIP();
+
+  llvm::BasicBlock *entryBlock =
+      llvm::BasicBlock::Create(llvmContext_, "entry", body);
+  ssa_->sealBlock(entryBlock);
+  llvmIRBuilder_.SetInsertPoint(entryBlock);
+  llvm::Function::arg_iterator args = body->arg_begin();
+  llvm::Value *bodyContext = llvmIRBuilder_.CreateBitCast(
+      &*args++, contextType->getPointerTo(), "context");
+  llvm::Value *chunkBegin = &*args++;
+  llvm::Value *chunkEnd = &*args++;
+  chunkBegin->setName("begin");
+  chunkEnd->setName("end");
+  std::vector<llvm::Value *> loaded;
+  for (int i = 0; i < (int)fields.size(); i++) {
+    loaded.push_back(llvmIRBuilder_.CreateLoad(
+        fields[i],
+        llvmIRBuilder_.CreateStructGEP(contextType, bodyContext, i)));
+  }
+  for (int i = 0; i < (int)inputs.size(); i++) {
+    loaded[i]->setName(label(inputs[i]).str());
+    writeVariable(inputs[i], loaded[i]);
+  }
+  for (const Reduction &r : reductions) {
+    unsigned bits = type(r.varId->symbol()->type())->getIntegerBitWidth();
+    llvm::APInt identity =
+        r.op == T_PLUS ? llvm::APInt(bits, 0)
+        : r.op == T_LT
+            ? (r.isUnsigned ? llvm::APInt::getMaxValue(bits)
+                            : llvm::APInt::getSignedMaxValue(bits))
+            : (r.isUnsigned ? llvm::APInt::getMinValue(bits)
+                            : llvm::APInt::getSignedMinValue(bits));
+    writeVariable(r.varId, llvm::ConstantInt::get(llvmContext_, identity));
+  }
+  // chunk [begin, end) of iterations is [first + begin, first + end) of range
+  llvm::Value *first = loaded[inputs.size()];
+  countedLoop(ast,
+              llvmIRBuilder_.CreateAdd(
+                  first, llvmIRBuilder_.CreateTrunc(chunkBegin, indexType)),
+              llvmIRBuilder_.CreateAdd(
+                  first, llvmIRBuilder_.CreateTrunc(chunkEnd, indexType)));
+  for (int i = 0; i < (int)reductions.size(); i++) {
+    const Reduction &r = reductions[i];
+    const char *combine = r.op == T_PLUS ? "dimrt_reduce_add"
+                          : r.op == T_LT ? "dimrt_reduce_min"
+                                         : "dimrt_reduce_max";
+    llvmIRBuilder_.CreateCall(
+        runtime(combine, voidType, {i64->getPointerTo(), i64}),
+        {loaded[inputs.size() + 1 + i], encode(r, readVariable(r.varId))});
+  }
+  llvmIRBuilder_.CreateRetVoid();
+
+  ssa_ = outerSsa;
+  loops_.swap(outerLoops);
+  regions_.swap(outerRegions);
+  cleanups_.swap(outerCleanups);
+  unwinds_.swap(outerUnwinds);
+  coroutine_ = outerCoroutine;
+  parallel_ = outerParallel;
+  llvmIRBuilder_.restoreIP(outerInsertPoint);
+  if (enableFunctionPass_) {
+    llvmFunctionPassManager_->run(*body);
+  }
+
+  // runtime returns after all chunks complete, no exception escapes it
+  llvmIRBuilder_.CreateCall(
+      runtime("dimrt_parallel_for", voidType,
+              {i64, bodyType->getPointerTo(), i8p}),
+      {n, body, llvmIRBuilder_.CreateBitCast(context, i8p)});
+  for (const Reduction &r : reductions) {
+    writeVariable(r.varId,
+                  decode(r, llvmIRBuilder_.CreateLoad(i64, r.accumulator)));
+  }
+}
+
+void IrBuilder::visitYield(A_Yield *ast) {
+  ASSERT(coroutine_ && !coroutine_->async,
+         "error: yield {}:{} is not in generator\n", ast->name(),
+         ast->location());
+  ast->expr->accept(this);
+  llvmIRBuilder_.CreateStore(pop().asValue(), coroutine_->promise);
+  suspend(llvm::ConstantTokenNone::get(llvmContext_), "yield");
+}
+
+namespace {
+
+// async calls of await expression, except those of nested await
+class AsyncCalls : public Visitor {
+public:
+  virtual void visitCall(A_Call *ast) {
+    if (ast->id->kind() == +AstKind::VarId) {
+      Symbol *symbol = static_cast<A_VarId *>(ast->id)->symbol();
+      if (symbol && symbol->kind() == +SymbolKind::Func &&
+          static_cast<const Ts_Func *>(symbol->type())->async) {
+        calls.push_back(ast);
+      }
+    }
+    Visitor::visitCall(ast);
+  }
+  virtual void visitAwait(A_Await *ast) {}
+  virtual void visitFuncDef(A_FuncDef *ast) {}
+
+  std::vector<A_Call *> calls;
+};
+
+} // namespace
+
+void IrBuilder::visitAwait(A_Await *ast) {
+  ASSERT(!coroutine_ || coroutine_->async,
+         "error: await {}:{} cannot be in generator\n", ast->name(),
+         ast->location());
+  AsyncCalls asyncCalls;
+  asyncCalls.visit(ast->expr);
+  ASSERT(!asyncCalls.calls.empty(), "error: await {}:{} has no async call\n",
+         ast->name(), ast->location());
+  llvm::Type *i8p = llvm::Type::getInt8PtrTy(llvmContext_);
+
+  // parent task is current async function, or a task of current thread
+  llvm::Value *parent = nullptr;
+  if (coroutine_) {
+    parent = llvmIRBuilder_.CreateBitCast(coroutine_->promise, i8p);
+  } else {
+    llvm::BasicBlock *entry =
+        &llvmIRBuilder_.GetInsertBlock()->getParent()->getEntryBlock();
+    llvm::IRBuilder<> entryBuilder(entry, entry->begin());
+    parent = llvmIRBuilder_.CreateBitCast(
+        entryBuilder.CreateAlloca(taskType(), nullptr, "await.task"), i8p);
+    llvm::Value *noHandle =
+        llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(i8p));
+    llvmIRBuilder_.CreateCall(runtime("dimrt_task_init",
+                                      llvm::Type::getVoidTy(llvmContext_),
+                                      {i8p, i8p}),
+                              {parent, noHandle});
+  }
+
+  // spawn all calls before waiting for any of them, arguments of async call
+  // cannot await
+  std::vector<std::pair<A_Call *, llvm::Value *>> children;
+  for (A_Call *call : asyncCalls.calls) {
+    A_VarId *funcId = static_cast<A_VarId *>(call->id);
+    std::vector<llvm::Value *> args;
+    for (A_Exprs *e = call->args; e; e = e->next) {
+      e->expr->accept(this);
+      args.push_back(pop().asValue());
     }
+    llvm::Value *handle = llvmIRBuilder_.CreateCall(
+        space_.getFunction(funcId->symbol()), args, "await.handle");
+    // task is at start of promise
+    llvm::Value *child = llvmIRBuilder_.CreateCall(
+        intrinsic(llvm::Intrinsic::coro_promise),
+        {handle, llvmIRBuilder_.getInt32(PromiseAlign),
+         llvmIRBuilder_.getFalse()},
+        "await.child");
+    llvmIRBuilder_.CreateCall(runtime("dimrt_task_spawn",
+                                      llvm::Type::getVoidTy(llvmContext_),
+                                      {i8p, i8p}),
+                              {parent, child});
+    children.push_back(std::make_pair(call, handle));
+  }
+
+  if (coroutine_) {
+    // state is saved before join, a child completing on another thread can
+    // resume current task before it returns from join
+    llvm::Value *save = llvmIRBuilder_.CreateCall(
+        intrinsic(llvm::Intrinsic::coro_save), {coroutine_->handle},
+        "await.save");
+    llvm::Value *pending = llvmIRBuilder_.CreateCall(
+        runtime("dimrt_task_join", llvm::Type::getInt32Ty(llvmContext_),
+                {i8p}),
+        {parent}, "await.pending");
+    llvm::BasicBlock *suspendBlock = createBlock("await.suspend");
+    llvm::BasicBlock *readyBlock = createBlock("await.ready");
+    llvmIRBuilder_.CreateCondBr(llvmIRBuilder_.CreateIsNotNull(pending),
+                                suspendBlock, readyBlock);
+    ssa_->sealBlock(suspendBlock);
+    enterBlock(suspendBlock);
+    suspend(save, "await");
+    branch(readyBlock);
+    ssa_->sealBlock(readyBlock);
+    enterBlock(readyBlock);
   } else {
-    LOG_ASSERT(false, "not implemented");
+    llvmIRBuilder_.CreateCall(runtime("dimrt_task_wait",
+                                      llvm::Type::getVoidTy(llvmContext_),
+                                      {i8p}),
+                              {parent});
+  }
+
+  // results are read from completed children, which are destroyed after expr
+  for (const std::pair<A_Call *, llvm::Value *> &c : children) {
+    const Ts_Func *ts_func = static_cast<const Ts_Func *>(
+        static_cast<A_VarId *>(c.first->id)->symbol()->type());
+    llvm::Type *resultType = type(ts_func->result);
+    llvm::Value *result = c.second;
+    if (!resultType->isVoidTy()) {
+      llvm::StructType *promise = promiseType(resultType);
+      llvm::Value *p = llvmIRBuilder_.CreateBitCast(
+          llvmIRBuilder_.CreateCall(intrinsic(llvm::Intrinsic::coro_promise),
+                                    {c.second,
+                                     llvmIRBuilder_.getInt32(PromiseAlign),
+                                     llvmIRBuilder_.getFalse()}),
+          promise->getPointerTo());
+      result = llvmIRBuilder_.CreateLoad(
+          resultType, llvmIRBuilder_.CreateStructGEP(promise, p, 1),
+          "await.result");
+    }
+    awaited_[c.first] = result;
+  }
+  ast->expr->accept(this);
+  for (const std::pair<A_Call *, llvm::Value *> &c : children) {
+    awaited_.erase(c.first);
+    llvmIRBuilder_.CreateCall(intrinsic(llvm::Intrinsic::coro_destroy),
+                              {c.second});
   }
 }
 
+void IrBuilder::visitDoWhile(A_DoWhile *ast) {
+  llvm::BasicBlock *bodyBlock = createBlock("do.body");
+  llvm::BasicBlock *condBlock = createBlock("do.cond");
+  llvm::BasicBlock *endBlock = createBlock("do.end");
+
+  // body block is sealed after back edge is created
+  branch(bodyBlock);
+  enterBlock(bodyBlock);
+  loops_.push_back(std::make_pair(condBlock, endBlock));
+  statement(ast->body);
+  loops_.pop_back();
+  branch(condBlock);
+
+  ssa_->sealBlock(condBlock);
+  enterBlock(condBlock);
+  ast->condition->accept(this);
+  llvmIRBuilder_.CreateCondBr(pop().asValue(), bodyBlock, endBlock);
+
+  ssa_->sealBlock(bodyBlock);
+  ssa_->sealBlock(endBlock);
+  enterBlock(endBlock);
+}
+
+void IrBuilder::visitTry(A_Try *ast) {
+  llvm::BasicBlock *endBlock = createBlock("try.end");
+  llvm::BasicBlock *finallyBlock =
+      ast->finallyp ? createBlock("try.finally") : endBlock;
+  // finally also runs when try or catch exits by return/break/continue or
+  // exception
+  if (ast->finallyp) {
+    Cleanup finally;
+    finally.value = nullptr;
+    finally.finallyp = ast->finallyp;
+    finally.depth = (int)loops_.size();
+    pushCleanup(finally);
+  }
+
+  Unwind unwind;
+  unwind.catches = true;
+  unwind.cleanup = Cleanup();
+  unwind.pad = nullptr;
+  unwind.handler = nullptr;
+  unwind.exception = nullptr;
+  unwinds_.push_back(unwind);
+  statement(ast->tryp);
+  unwind = unwinds_.back();
+  unwinds_.pop_back();
+  branch(finallyBlock);
+
+  // no landing pad if nothing in try can throw
+  if (enterUnwind(unwind)) {
+    llvmIRBuilder_.CreateCall(
+        runtime("dimrt_catch", llvm::Type::getInt64Ty(llvmContext_),
+                {llvm::Type::getInt8PtrTy(llvmContext_)}),
+        {llvmIRBuilder_.CreateExtractValue(unwind.exception, 0)});
+    statement(ast->catchp);
+    branch(finallyBlock);
+  }
+
+  if (ast->finallyp) {
+    popCleanup();
+    ssa_->sealBlock(finallyBlock);
+    enterBlock(finallyBlock);
+    statement(ast->finallyp);
+    branch(endBlock);
+  }
+  ssa_->sealBlock(endBlock);
+  enterBlock(endBlock);
+}
+
+void IrBuilder::visitBlock(A_Block *ast) {
+  if (!ast->region) {
+    if (ast->blockStats) {
+      ast->blockStats->accept(this);
+    }
+    return;
+  }
+  llvm::Value *region = llvmIRBuilder_.CreateCall(
+      runtime("dimrt_region_begin", llvm::Type::getInt8PtrTy(llvmContext_),
+              {}),
+      {}, "region");
+  Cleanup end;
+  end.function =
+      runtime("dimrt_region_end", llvm::Type::getVoidTy(llvmContext_),
+              {llvm::Type::getInt8PtrTy(llvmContext_)});
+  end.value = region;
+  end.finallyp = nullptr;
+  end.depth = (int)loops_.size();
+  regions_.push_back(region);
+  pushCleanup(end);
+  if (ast->blockStats) {
+    ast->blockStats->accept(this);
+  }
+  popCleanup();
+  regions_.pop_back();
+  // region is already released if block ends with return/break/continue,
+  // then current block is dead
+  llvmIRBuilder_.CreateCall(end.function, {region});
+}
+
 void IrBuilder::visitPlainType(A_PlainType *ast) {
   TypeSymbol *ts = scope_->ts_resolve(ast->name());
+  results_.push_back(detail::SpaceData::fromType(type(ts)));
+}
+
+void IrBuilder::visitArrayType(A_ArrayType *ast) {
+  ast->elementType->accept(this);
+  results_.push_back(detail::SpaceData::fromType(arrayType(pop().asType())));
+}
+
+llvm::Type *IrBuilder::type(const TypeSymbol *ts) {
+  if (ts->kind() == +TypeSymbolKind::Array) {
+    return arrayType(type(static_cast<const Ts_Array *>(ts)->element));
+  }
+  if (ts->kind() == +TypeSymbolKind::Vector) {
+    const Ts_Vector *tv = static_cast<const Ts_Vector *>(ts);
+    return llvm::FixedVectorType::get(type(tv->element), tv->lanes);
+  }
+  return plainType(ts);
+}
+
+llvm::StructType *IrBuilder::arrayType(llvm::Type *elementType) {
+  return llvm::StructType::get(llvmContext_,
+                               {elementType->getPointerTo(),
+                                llvm::Type::getInt64Ty(llvmContext_)});
+}
+
+llvm::Value *IrBuilder::elementPointer(A_Index *ast,
+                                       llvm::Type **elementType) {
+  ASSERT(!isRange(ast->index), "error: slice {}:{} cannot be assigned\n",
+         ast->name(), ast->location());
+  ast->expr->accept(this);
+  llvm::Value *array = pop().asValue();
+  ASSERT(array->getType()->isStructTy(), "error: {}:{} is not an array\n",
+         ast->expr->name(), ast->expr->location());
+  ast->index->accept(this);
+  llvm::Value *index = llvmIRBuilder_.CreateSExtOrTrunc(
+      pop().asValue(), llvm::Type::getInt64Ty(llvmContext_), "index.i");
+  llvm::Value *length = arrayLength(ast->expr, array);
+
+  // negative index is out of bounds as unsigned
+  auto hoisted = inBounds_.find(ast);
+  llvm::Value *inBounds =
+      hoisted == inBounds_.end() ? nullptr : hoisted->second;
+  if (!inBounds || !llvm::isa<llvm::ConstantInt>(inBounds) ||
+      !llvm::cast<llvm::ConstantInt>(inBounds)->isOne()) {
+    llvm::Value *inRange =
+        llvmIRBuilder_.CreateICmpULT(index, length, "index.inbounds");
+    if (inBounds && !llvm::isa<llvm::Constant>(inBounds)) {
+      inRange = llvmIRBuilder_.CreateOr(inBounds, inRange, "index.inbounds");
+    }
+    boundsCheck(ast, inRange, index, length);
+  }
+
+  llvm::Value *data =
+      llvmIRBuilder_.CreateExtractValue(array, {0}, "index.data");
+  *elementType = data->getType()->getPointerElementType();
+  return llvmIRBuilder_.CreateGEP(*elementType, data, index, "index.ptr");
+}
+
+llvm::Value *IrBuilder::loadElement(llvm::Type *elementType,
+                                    llvm::Value *ptr) {
+  llvm::Align align = std::min(
+      llvmModule_->getDataLayout().getABITypeAlign(elementType),
+      llvm::Align(ElementAlign));
+  return llvmIRBuilder_.CreateAlignedLoad(elementType, ptr, align,
+                                          "index.load");
+}
+
+void IrBuilder::storeElement(llvm::Value *v, llvm::Value *ptr) {
+  llvm::Align align = std::min(
+      llvmModule_->getDataLayout().getABITypeAlign(v->getType()),
+      llvm::Align(ElementAlign));
+  llvmIRBuilder_.CreateAlignedStore(v, ptr, align);
+}
+
+void IrBuilder::slice(A_Index *ast) {
+  A_Infix *range = static_cast<A_Infix *>(ast->index);
+  llvm::Type *i64 = llvm::Type::getInt64Ty(llvmContext_);
+  ast->expr->accept(this);
+  llvm::Value *array = pop().asValue();
+  ASSERT(array->getType()->isStructTy(), "error: {}:{} is not an array\n",
+         ast->expr->name(), ast->expr->location());
+  range->left->accept(this);
+  llvm::Value *begin =
+      llvmIRBuilder_.CreateSExtOrTrunc(pop().asValue(), i64, "slice.begin");
+  range->right->accept(this);
+  llvm::Value *end =
+      llvmIRBuilder_.CreateSExtOrTrunc(pop().asValue(), i64, "slice.end");
+  llvm::Value *length = arrayLength(ast->expr, array);
+
+  // 0 <= begin <= end <= length, the first bound violated is reported
+  llvm::Value *endInBounds =
+      llvmIRBuilder_.CreateICmpULE(end, length, "slice.inbounds");
+  llvm::Value *inBounds = llvmIRBuilder_.CreateAnd(
+      endInBounds, llvmIRBuilder_.CreateICmpULE(begin, end), "slice.inbounds");
+  boundsCheck(ast, inBounds,
+              llvmIRBuilder_.CreateSelect(endInBounds, begin, end),
+              llvmIRBuilder_.CreateSelect(endInBounds, end, length));
+
+  llvm::Value *data =
+      llvmIRBuilder_.CreateExtractValue(array, {0}, "slice.data");
+  llvm::Value *result = llvm::UndefValue::get(array->getType());
+  result = llvmIRBuilder_.CreateInsertValue(
+      result,
+      llvmIRBuilder_.CreateGEP(data->getType()->getPointerElementType(), data,
+                               begin),
+      {0});
+  result = llvmIRBuilder_.CreateInsertValue(
+      result, llvmIRBuilder_.CreateSub(end, begin), {1}, "slice");
+  results_.push_back(detail::SpaceData::fromValue(result));
+}
+
+llvm::Value *IrBuilder::arrayLength(Ast *expr, llvm::Value *array) {
+  int64_t length = staticLength(expr);
+  return length >= 0
+             ? llvm::ConstantInt::get(llvm::Type::getInt64Ty(llvmContext_),
+                                      length)
+             : llvmIRBuilder_.CreateExtractValue(array, {1}, "length");
+}
+
+void IrBuilder::boundsCheck(Ast *ast, llvm::Value *inBounds,
+                            llvm::Value *index, llvm::Value *length) {
+  if (llvm::ConstantInt *c = llvm::dyn_cast<llvm::ConstantInt>(inBounds)) {
+    ASSERT(c->isOne(), "error: {}:{} is out of bounds\n", ast->name(),
+           ast->location());
+    return;
+  }
+  llvm::BasicBlock *failBlock = createBlock("bounds.fail");
+  llvm::BasicBlock *okBlock = createBlock("bounds.ok");
+  llvmIRBuilder_.CreateCondBr(inBounds, okBlock, failBlock);
+
+  // failure is cold and never returns, so it doesn't block optimization of
+  // the path in bounds
+  ssa_->sealBlock(failBlock);
+  enterBlock(failBlock);
+  llvm::Type *i64 = llvm::Type::getInt64Ty(llvmContext_);
+  llvm::FunctionCallee fail =
+      runtime("dimrt_bounds", llvm::Type::getVoidTy(llvmContext_), {i64, i64});
+  llvm::Function *f = llvm::cast<llvm::Function>(fail.getCallee());
+  f->setDoesNotReturn();
+  f->setDoesNotThrow();
+  f->addFnAttr(llvm::Attribute::Cold);
+  llvmIRBuilder_.CreateCall(fail, {index, length});
+  llvmIRBuilder_.CreateUnreachable();
+
+  ssa_->sealBlock(okBlock);
+  enterBlock(okBlock);
+}
+
+llvm::Value *IrBuilder::arrayBytes(llvm::Type *elementType,
+                                   llvm::Value *length) {
+  llvm::Constant *size = llvm::ConstantExpr::getSizeOf(elementType);
+  return llvmIRBuilder_.CreateMul(length, size, "bytes");
+}
+
+llvm::FunctionCallee
+IrBuilder::runtime(const char *name, llvm::Type *result,
+                   const std::vector<llvm::Type *> &params) {
+  return llvmModule_->getOrInsertFunction(
+      name, llvm::FunctionType::get(result, params, false));
+}
+
+void IrBuilder::cleanup(int depth) {
+  for (int i = (int)cleanups_.size() - 1;
+       i >= 0 && cleanups_[i].depth >= depth; i--) {
+    runCleanup(cleanups_[i]);
+  }
+}
+
+llvm::Value *IrBuilder::call(llvm::FunctionCallee callee,
+                             llvm::ArrayRef<llvm::Value *> args,
+                             const llvm::Twine &name) {
+  llvm::BasicBlock *pad = unwindPad();
+  if (!pad) {
+    return llvmIRBuilder_.CreateCall(callee, args, name);
+  }
+  llvm::BasicBlock *next = createBlock("invoke.cont");
+  llvm::Value *value =
+      llvmIRBuilder_.CreateInvoke(callee, next, pad, args, name);
+  ssa_->sealBlock(next);
+  enterBlock(next);
+  return value;
+}
+
+llvm::BasicBlock *IrBuilder::unwindPad() {
+  if (unwinds_.empty()) {
+    return nullptr;
+  }
+  Unwind &unwind = unwinds_.back();
+  if (!unwind.pad) {
+    unwind.pad = createBlock("unwind.pad");
+    unwindHandler(&unwind);
+  }
+  return unwind.pad;
+}
+
+void IrBuilder::rethrow(llvm::Value *exception) {
+  if (unwinds_.empty()) {
+    if (coroutine_) {
+      // exception escapes coroutine
+      llvmIRBuilder_.CreateCall(intrinsic(llvm::Intrinsic::coro_end),
+                                {coroutine_->handle, llvmIRBuilder_.getTrue()});
+    }
+    llvmIRBuilder_.CreateResume(exception);
+    return;
+  }
+  Unwind &outer = unwinds_.back();
+  llvm::BasicBlock *handler = unwindHandler(&outer);
+  outer.exception->addIncoming(exception, llvmIRBuilder_.GetInsertBlock());
+  llvmIRBuilder_.CreateBr(handler);
+}
+
+llvm::StructType *IrBuilder::exceptionType() {
+  return llvm::StructType::get(llvmContext_,
+                               {llvm::Type::getInt8PtrTy(llvmContext_),
+                                llvm::Type::getInt32Ty(llvmContext_)});
+}
+
+void IrBuilder::pushCleanup(Cleanup cleanup) {
+  cleanup.unwinds = (int)unwinds_.size();
+  cleanups_.push_back(cleanup);
+  Unwind unwind;
+  unwind.catches = false;
+  unwind.cleanup = cleanup;
+  unwind.pad = nullptr;
+  unwind.handler = nullptr;
+  unwind.exception = nullptr;
+  unwinds_.push_back(unwind);
+}
+
+void IrBuilder::popCleanup() {
+  cleanups_.pop_back();
+  Unwind unwind = unwinds_.back();
+  unwinds_.pop_back();
+  llvm::IRBuilderBase::InsertPoint insertPoint = llvmIRBuilder_.saveIP();
+  if (enterUnwind(unwind)) {
+    runCleanup(unwind.cleanup);
+    rethrow(unwind.exception);
+  }
+  llvmIRBuilder_.restoreIP(insertPoint);
+}
+
+void IrBuilder::runCleanup(const Cleanup &cleanup) {
+  if (!cleanup.finallyp) {
+    llvmIRBuilder_.CreateCall(cleanup.function, {cleanup.value});
+    return;
+  }
+  // finally runs in scopes enclosing its try, so it doesn't run itself again
+  // by return or exception inside it
+  std::vector<Cleanup> innerCleanups;
+  std::vector<Unwind> innerUnwinds;
+  for (int i = 0; i < (int)cleanups_.size(); i++) {
+    if (cleanups_[i].unwinds >= cleanup.unwinds) {
+      innerCleanups.assign(cleanups_.begin() + i, cleanups_.end());
+      cleanups_.resize(i);
+      break;
+    }
+  }
+  innerUnwinds.assign(unwinds_.begin() + cleanup.unwinds, unwinds_.end());
+  unwinds_.resize(cleanup.unwinds);
+  statement(cleanup.finallyp);
+  cleanups_.insert(cleanups_.end(), innerCleanups.begin(), innerCleanups.end());
+  unwinds_.insert(unwinds_.end(), innerUnwinds.begin(), innerUnwinds.end());
+}
+
+llvm::BasicBlock *IrBuilder::unwindHandler(Unwind *unwind) {
+  if (!unwind->handler) {
+    unwind->handler =
+        createBlock(unwind->catches ? "try.catch" : "unwind.cleanup");
+    unwind->exception = llvm::PHINode::Create(exceptionType(), 2, "exception",
+                                              unwind->handler);
+  }
+  return unwind->handler;
+}
+
+bool IrBuilder::enterUnwind(const Unwind &unwind) {
+  if (!unwind.handler) {
+    return false;
+  }
+  if (unwind.pad) {
+    llvm::Type *i8p = llvm::Type::getInt8PtrTy(llvmContext_);
+    llvm::Type *i32 = llvm::Type::getInt32Ty(llvmContext_);
+    llvmIRBuilder_.GetInsertBlock()->getParent()->setPersonalityFn(
+        llvm::cast<llvm::Function>(
+            runtime("dimrt_personality", i32,
+                    {i32, i32, llvm::Type::getInt64Ty(llvmContext_), i8p, i8p})
+                .getCallee()));
+    ssa_->sealBlock(unwind.pad);
+    enterBlock(unwind.pad);
+    // cleanup pad also catches if an enclosing try catches, then exception is
+    // caught in this function after cleanup
+    bool catches = unwind.catches;
+    for (const Unwind &outer : unwinds_) {
+      catches = catches || outer.catches;
+    }
+    llvm::LandingPadInst *landingPad =
+        llvmIRBuilder_.CreateLandingPad(exceptionType(), 1, "landing.pad");
+    landingPad->setCleanup(!unwind.catches);
+    if (catches) {
+      landingPad->addClause(
+          llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(i8p)));
+    }
+    unwind.exception->addIncoming(landingPad, unwind.pad);
+    llvmIRBuilder_.CreateBr(unwind.handler);
+  }
+  ssa_->sealBlock(unwind.handler);
+  enterBlock(unwind.handler);
+  return true;
+}
+
+llvm::Function *IrBuilder::intrinsic(llvm::Intrinsic::ID id) {
+  if (id == llvm::Intrinsic::coro_size) {
+    return llvm::Intrinsic::getDeclaration(
+        llvmModule_, id, {llvm::Type::getInt64Ty(llvmContext_)});
+  }
+  return llvm::Intrinsic::getDeclaration(llvmModule_, id);
+}
+
+void IrBuilder::beginCoroutine(llvm::Type *promiseType) {
+  llvm::Type *i8p = llvm::Type::getInt8PtrTy(llvmContext_);
+  coroutine_->promise =
+      llvmIRBuilder_.CreateAlloca(promiseType, nullptr, "promise");
+  coroutine_->promise->setAlignment(llvm::Align(PromiseAlign));
+  coroutine_->id = llvmIRBuilder_.CreateCall(
+      intrinsic(llvm::Intrinsic::coro_id),
+      {llvmIRBuilder_.getInt32(0),
+       llvmIRBuilder_.CreateBitCast(coroutine_->promise, i8p),
+       llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(i8p)),
+       llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(i8p))},
+      "coro.id");
+  coroutine_->finalBlock = createBlock("coro.final");
+  coroutine_->cleanupBlock = createBlock("coro.cleanup");
+  coroutine_->suspendBlock = createBlock("coro.suspend");
+
+  // frame is allocated by runtime, unless CoroElide moves it to stack
+  llvm::BasicBlock *entryBlock = llvmIRBuilder_.GetInsertBlock();
+  llvm::BasicBlock *allocBlock = createBlock("coro.alloc");
+  llvm::BasicBlock *beginBlock = createBlock("coro.begin");
+  llvm::Value *needAlloc = llvmIRBuilder_.CreateCall(
+      intrinsic(llvm::Intrinsic::coro_alloc), {coroutine_->id});
+  llvmIRBuilder_.CreateCondBr(needAlloc, allocBlock, beginBlock);
+  ssa_->sealBlock(allocBlock);
+  enterBlock(allocBlock);
+  llvm::Value *mem = llvmIRBuilder_.CreateCall(
+      runtime("dimrt_alloc", i8p, {llvm::Type::getInt64Ty(llvmContext_)}),
+      {llvmIRBuilder_.CreateCall(intrinsic(llvm::Intrinsic::coro_size))},
+      "coro.mem");
+  llvmIRBuilder_.CreateBr(beginBlock);
+  ssa_->sealBlock(beginBlock);
+  enterBlock(beginBlock);
+  llvm::PHINode *frame = llvmIRBuilder_.CreatePHI(i8p, 2, "coro.frame");
+  frame->addIncoming(
+      llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(i8p)),
+      entryBlock);
+  frame->addIncoming(mem, allocBlock);
+  coroutine_->handle = llvmIRBuilder_.CreateCall(
+      intrinsic(llvm::Intrinsic::coro_begin), {coroutine_->id, frame},
+      "coro.handle");
+  if (coroutine_->async) {
+    // task is at start of promise
+    llvmIRBuilder_.CreateCall(
+        runtime("dimrt_task_init", llvm::Type::getVoidTy(llvmContext_),
+                {i8p, i8p}),
+        {llvmIRBuilder_.CreateBitCast(coroutine_->promise, i8p),
+         coroutine_->handle});
+  }
+
+  // initial suspend, ramp returns handle before body runs
+  llvm::Value *suspend = llvmIRBuilder_.CreateCall(
+      intrinsic(llvm::Intrinsic::coro_suspend),
+      {llvm::ConstantTokenNone::get(llvmContext_), llvmIRBuilder_.getFalse()},
+      "coro.start");
+  llvm::BasicBlock *bodyBlock = createBlock("coro.body");
+  llvm::SwitchInst *switchInst =
+      llvmIRBuilder_.CreateSwitch(suspend, coroutine_->suspendBlock, 2);
+  switchInst->addCase(llvmIRBuilder_.getInt8(0), bodyBlock);
+  switchInst->addCase(llvmIRBuilder_.getInt8(1), coroutine_->cleanupBlock);
+  ssa_->sealBlock(bodyBlock);
+  enterBlock(bodyBlock);
+}
+
+void IrBuilder::endCoroutine() {
+  llvm::Type *i8p = llvm::Type::getInt8PtrTy(llvmContext_);
+  branch(coroutine_->finalBlock);
+
+  // final suspend, handle is done and can only be destroyed. async function
+  // is saved before it completes its task, the awaiting parent may destroy it
+  // before it returns from complete
+  ssa_->sealBlock(coroutine_->finalBlock);
+  enterBlock(coroutine_->finalBlock);
+  llvm::Value *save = llvm::ConstantTokenNone::get(llvmContext_);
+  if (coroutine_->async) {
+    save = llvmIRBuilder_.CreateCall(intrinsic(llvm::Intrinsic::coro_save),
+                                     {coroutine_->handle}, "coro.save");
+    llvmIRBuilder_.CreateCall(
+        runtime("dimrt_task_complete", llvm::Type::getVoidTy(llvmContext_),
+                {i8p}),
+        {llvmIRBuilder_.CreateBitCast(coroutine_->promise, i8p)});
+  }
+  llvm::Value *suspend =
+      llvmIRBuilder_.CreateCall(intrinsic(llvm::Intrinsic::coro_suspend),
+                                {save, llvmIRBuilder_.getTrue()}, "coro.done");
+  llvm::BasicBlock *resumeBlock = createBlock("coro.resume");
+  llvm::SwitchInst *switchInst =
+      llvmIRBuilder_.CreateSwitch(suspend, coroutine_->suspendBlock, 2);
+  switchInst->addCase(llvmIRBuilder_.getInt8(0), resumeBlock);
+  switchInst->addCase(llvmIRBuilder_.getInt8(1), coroutine_->cleanupBlock);
+  ssa_->sealBlock(resumeBlock);
+  enterBlock(resumeBlock);
+  llvmIRBuilder_.CreateUnreachable();
+
+  // free frame if it's allocated by runtime
+  ssa_->sealBlock(coroutine_->cleanupBlock);
+  enterBlock(coroutine_->cleanupBlock);
+  llvm::Value *mem = llvmIRBuilder_.CreateCall(
+      intrinsic(llvm::Intrinsic::coro_free),
+      {coroutine_->id, coroutine_->handle}, "coro.free");
+  llvm::BasicBlock *freeBlock = createBlock("coro.dealloc");
+  llvmIRBuilder_.CreateCondBr(llvmIRBuilder_.CreateIsNull(mem),
+                              coroutine_->suspendBlock, freeBlock);
+  ssa_->sealBlock(freeBlock);
+  enterBlock(freeBlock);
+  llvmIRBuilder_.CreateCall(
+      runtime("dimrt_free", llvm::Type::getVoidTy(llvmContext_),
+              {i8p, llvm::Type::getInt64Ty(llvmContext_)}),
+      {mem, llvmIRBuilder_.CreateCall(intrinsic(llvm::Intrinsic::coro_size))});
+  llvmIRBuilder_.CreateBr(coroutine_->suspendBlock);
+
+  ssa_->sealBlock(coroutine_->suspendBlock);
+  enterBlock(coroutine_->suspendBlock);
+  llvmIRBuilder_.CreateCall(intrinsic(llvm::Intrinsic::coro_end),
+                            {coroutine_->handle, llvmIRBuilder_.getFalse()});
+  llvmIRBuilder_.CreateRet(coroutine_->handle);
+}
+
+void IrBuilder::suspend(llvm::Value *save, const char *name) {
+  llvm::Value *suspend = llvmIRBuilder_.CreateCall(
+      intrinsic(llvm::Intrinsic::coro_suspend),
+      {save, llvmIRBuilder_.getFalse()}, name);
+  llvm::BasicBlock *resumeBlock = createBlock(std::string(name) + ".resume");
+  llvm::BasicBlock *destroyBlock = createBlock(std::string(name) + ".destroy");
+  llvm::SwitchInst *switchInst =
+      llvmIRBuilder_.CreateSwitch(suspend, coroutine_->suspendBlock, 2);
+  switchInst->addCase(llvmIRBuilder_.getInt8(0), resumeBlock);
+  switchInst->addCase(llvmIRBuilder_.getInt8(1), destroyBlock);
+
+  // destroyed while suspended, enclosing regions and generators are left
+  ssa_->sealBlock(destroyBlock);
+  enterBlock(destroyBlock);
+  cleanup(0);
+  llvmIRBuilder_.CreateBr(coroutine_->cleanupBlock);
+
+  ssa_->sealBlock(resumeBlock);
+  enterBlock(resumeBlock);
+}
+
+llvm::StructType *IrBuilder::taskType() {
+  llvm::Type *i8p = llvm::Type::getInt8PtrTy(llvmContext_);
+  llvm::Type *i32 = llvm::Type::getInt32Ty(llvmContext_);
+  return llvm::StructType::get(llvmContext_, {i8p, i8p, i32});
+}
+
+llvm::StructType *IrBuilder::promiseType(llvm::Type *resultType) {
+  if (resultType->isVoidTy()) {
+    return llvm::StructType::get(llvmContext_, {taskType()});
+  }
+  return llvm::StructType::get(llvmContext_, {taskType(), resultType});
+}
+
+llvm::Type *IrBuilder::plainType(const TypeSymbol *ts) {
   LOG_ASSERT(ts->kind() == +TypeSymbolKind::Plain,
              "ts kind {} != TypeSymbolKind::Plain", ts->kind()._to_string());
-  Ts_Plain *tp = static_cast<Ts_Plain *>(ts);
+  const Ts_Plain *tp = static_cast<const Ts_Plain *>(ts);
   llvm::Type *ty = nullptr;
   if (tp == TypeSymbol::ts_byte() || tp == TypeSymbol::ts_ubyte()) {
     ty = llvm::Type::getInt8Ty(llvmContext_);
@@ -423,7 +2285,38 @@ void IrBuilder::visitPlainType(A_PlainType *ast) {
   } else {
     LOG_ASSERT(false, "invalid plain type{}:{}", tp->name(), tp->location());
   }
-  space_.setType(label(ast), ty);
+  return ty;
+}
+
+void IrBuilder::declare(const Symbol *symbol) {
+  switch (symbol->kind()) {
+  case SymbolKind::Var: {
+    llvm::GlobalVariable *gv = new llvm::GlobalVariable(
+        *llvmModule_, type(symbol->type()), false,
+        llvm::GlobalValue::ExternalLinkage, nullptr, label(symbol).str(),
+        nullptr, llvm::GlobalValue::NotThreadLocal, 0, false);
+    space_.setValue(symbol, llvm::dyn_cast<llvm::Value>(gv));
+  } break;
+  case SymbolKind::Func: {
+    const Ts_Func *ts_func = static_cast<const Ts_Func *>(symbol->type());
+    std::vector<llvm::Type *> funcArgTypes;
+    for (int i = 0; i < (int)ts_func->params.size(); i++) {
+      funcArgTypes.push_back(type(ts_func->params[i]));
+    }
+    // ramp of generator or async function returns coroutine handle
+    llvm::FunctionType *funcType = llvm::FunctionType::get(
+        ts_func->generator || ts_func->async
+            ? llvm::Type::getInt8PtrTy(llvmContext_)
+            : type(ts_func->result),
+        funcArgTypes, false);
+    llvm::Function *func =
+        llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
+                               label(symbol).str(), llvmModule_);
+    space_.setFunction(symbol, func);
+  } break;
+  default:
+    break;
+  }
 }
 
 void IrBuilder::visitFuncDef(A_FuncDef *ast) {
@@ -432,30 +2325,129 @@ void IrBuilder::visitFuncDef(A_FuncDef *ast) {
 
   std::vector<llvm::Type *> funcArgTypes;
   for (int i = 0; i < (int)funcArgs.size(); ++i) {
-    funcArgTypes.push_back(space_.getType(label(funcArgs[i].second)));
+    funcArgs[i].second->accept(this);
+    funcArgTypes.push_back(pop().asType());
   }
 
   ast->resultType->accept(this);
-  llvm::Type *funcResultType = space_.getType(label(ast->resultType));
-
-  llvm::FunctionType *funcType =
-      llvm::FunctionType::get(funcResultType, funcArgTypes, false);
-  llvm::Function *func =
-      llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
-                             label(funcId->symbol()).str(), llvmModule_);
-  space_.setFunction(label(funcId->symbol()), func);
+  llvm::Type *funcResultType = pop().asType();
+  const Ts_Func *ts_func =
+      static_cast<const Ts_Func *>(funcId->symbol()->type());
+  bool generator = ts_func->generator;
+  bool async = ts_func->async;
+  ASSERT(!generator || !funcResultType->isVoidTy(),
+         "error: generator {}:{} cannot yield void\n", funcId->name(),
+         funcId->location());
+  ASSERT(!generator || !async, "error: async function {}:{} cannot yield\n",
+         funcId->name(), funcId->location());
+
+  llvm::FunctionType *funcType = llvm::FunctionType::get(
+      generator || async ? llvm::Type::getInt8PtrTy(llvmContext_)
+                         : funcResultType,
+      funcArgTypes, false);
+  // top-level function is already declared by visitCompileUnit
+  llvm::Function *func = space_.getFunction(funcId->symbol());
+  if (!func) {
+    func = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
+                                  label(funcId->symbol()).str(), llvmModule_);
+  }
+  LOG_ASSERT(func->getFunctionType() == funcType,
+             "function {}:{} type must be its declared type", funcId->name(),
+             funcId->location());
+  if (generator || async) {
+    // CoroSplit only splits functions marked as presplit coroutine
+    func->addFnAttr("coroutine.presplit", "0");
+  }
+  space_.setFunction(funcId->symbol(), func);
   // space_.setFunction(label(funcId), func);
 
+  // function of other shard is only declared
+  if (ast->parent()->kind() == (+AstKind::TopStats) &&
+      (funcDefs_++) % shards_ != shard_) {
+    return;
+  }
+
+  // each function has its own local variables, loops and regions, nested
+  // function returns to insert point of outer function
+  SsaBuilder ssa;
+  SsaBuilder *outerSsa = ssa_;
+  ssa_ = &ssa;
+  std::vector<std::pair<llvm::BasicBlock *, llvm::BasicBlock *>> outerLoops;
+  outerLoops.swap(loops_);
+  std::vector<llvm::Value *> outerRegions;
+  outerRegions.swap(regions_);
+  std::vector<Cleanup> outerCleanups;
+  outerCleanups.swap(cleanups_);
+  std::vector<Unwind> outerUnwinds;
+  outerUnwinds.swap(unwinds_);
+  Coroutine coroutine;
+  coroutine.async = async;
+  Coroutine *outerCoroutine = coroutine_;
+  coroutine_ = generator || async ? &coroutine : nullptr;
+  bool outerParallel = parallel_;
+  parallel_ = false;
+  llvm::IRBuilderBase::InsertPoint outerInsertPoint =
+      llvmIRBuilder_.saveIP();
+
+  // entry block of function, it has no predecessor
+  llvm::BasicBlock *entryBlock =
+      llvm::BasicBlock::Create(llvmContext_, "entry", func);
+  ssa_->sealBlock(entryBlock);
+  llvmIRBuilder_.SetInsertPoint(entryBlock);
+
   int i = 0;
   for (llvm::Function::arg_iterator it = func->args().begin();
        it != func->args().end(); ++it, ++i) {
     llvm::Argument *arg = it;
     arg->setName(label(funcArgs[i].first).str());
-    space_.setValue(label(static_cast<A_VarId *>(funcArgs[i].first)), arg);
-    // space_.setValue(label(funcArgs[i].first), arg);
+    writeVariable(static_cast<A_VarId *>(funcArgs[i].first), arg);
+  }
+
+  // results of expression statements are not used
+  int results = (int)results_.size();
+  if (generator) {
+    beginCoroutine(funcResultType);
+    statement(ast->body);
+    endCoroutine();
+  } else if (async) {
+    beginCoroutine(promiseType(funcResultType));
+    ast->body->accept(this);
+    if (!llvmIRBuilder_.GetInsertBlock()->getTerminator() &&
+        !funcResultType->isVoidTy() &&
+        ast->body->kind() != +AstKind::Block &&
+        (int)results_.size() > results) {
+      // function body is an expression
+      llvmIRBuilder_.CreateStore(
+          pop().asValue(), llvmIRBuilder_.CreateStructGEP(
+                               coroutine.promise->getAllocatedType(),
+                               coroutine.promise, 1, "result"));
+    }
+    results_.resize(results);
+    endCoroutine();
+  } else {
+    ast->body->accept(this);
+  }
+  if (!llvmIRBuilder_.GetInsertBlock()->getTerminator()) {
+    if (funcResultType->isVoidTy()) {
+      llvmIRBuilder_.CreateRetVoid();
+    } else if (ast->body->kind() != +AstKind::Block &&
+               (int)results_.size() > results) {
+      // function body is an expression
+      llvmIRBuilder_.CreateRet(pop().asValue());
+    } else {
+      llvmIRBuilder_.CreateUnreachable();
+    }
   }
+  results_.resize(results);
 
-  ast->body->accept(this);
+  ssa_ = outerSsa;
+  loops_.swap(outerLoops);
+  regions_.swap(outerRegions);
+  cleanups_.swap(outerCleanups);
+  unwinds_.swap(outerUnwinds);
+  coroutine_ = outerCoroutine;
+  parallel_ = outerParallel;
+  llvmIRBuilder_.restoreIP(outerInsertPoint);
 
   if (enableFunctionPass_) {
     llvmFunctionPassManager_->run(*func);
@@ -466,56 +2458,229 @@ void IrBuilder::visitVarDef(A_VarDef *ast) {
   A_VarId *varId = static_cast<A_VarId *>(ast->id);
 
   ast->type->accept(this);
-  llvm::Type *ty_var = space_.getType(label(ast->type));
+  llvm::Type *ty_var = pop().asType();
 
   // global variable
   if (ast->parent()->kind() == (+AstKind::TopStats) ||
       ast->parent()->kind() == (+AstKind::CompileUnit)) {
-    IrBuilder::ConstantBuilder cb(this);
-    ast->expr->accept(&cb);
-    llvm::Constant *gc = space_.getConstant(label(ast->expr));
+    ASSERT(!ty_var->isStructTy(),
+           "error: global variable {}:{} cannot be array\n", varId->name(),
+           varId->location());
+    ASSERT(!ty_var->isVectorTy(),
+           "error: global variable {}:{} cannot be vector\n", varId->name(),
+           varId->location());
+    // global variable of other shard is only declared
+    llvm::Constant *gc = nullptr;
+    if (shard_ == 0) {
+      IrBuilder::ConstantBuilder cb(this);
+      ast->expr->accept(&cb);
+      gc = cb.constants.back();
+    }
     llvm::GlobalVariable *gv = new llvm::GlobalVariable(
         *llvmModule_, ty_var, false, llvm::GlobalValue::ExternalLinkage, gc,
         label(varId->symbol()).str(), nullptr,
         llvm::GlobalValue::NotThreadLocal, 0, false);
-    space_.setValue(label(varId->symbol()), llvm::dyn_cast<llvm::Value>(gv));
-  } else if (ast->parent()->kind() == (+AstKind::BlockStats)) {
+    space_.setValue(varId->symbol(), llvm::dyn_cast<llvm::Value>(gv));
+  } else {
     // local variable
+    checkLength(varId->symbol()->type(), ast->expr);
     ast->expr->accept(this);
-    llvm::Value *ae = space_.getValue(label(ast->expr));
-    llvm::AllocaInst *ai = llvmIRBuilder_.CreateAlloca(
-        ty_var, nullptr, label(varId->symbol()).str());
-    llvm::StoreInst *si = llvmIRBuilder_.CreateStore(ae, ai, false);
-    (void)si;
-    space_.setValue(label(varId->symbol()), llvm::dyn_cast<llvm::Value>(ai));
-    // space_.setValue(label(varId), llvm::dyn_cast<llvm::Value>(si));
+    writeVariable(varId, pop().asValue());
   }
 }
 
 void IrBuilder::visitCompileUnit(A_CompileUnit *ast) {
   llvmModule_ = new llvm::Module(ast->name().str(), llvmContext_);
   if (enableFunctionPass_) {
+    targetMachine_ = hostTargetMachine();
+    if (targetMachine_) {
+      llvmModule_->setDataLayout(targetMachine_->createDataLayout());
+      llvmModule_->setTargetTriple(targetMachine_->getTargetTriple().str());
+    }
     llvmFunctionPassManager_ =
         new llvm::legacy::FunctionPassManager(llvmModule_);
+    if (targetMachine_) {
+      // vector width and instruction costs of host for loop vectorizer
+      llvmFunctionPassManager_->add(llvm::createTargetTransformInfoWrapperPass(
+          targetMachine_->getTargetIRAnalysis()));
+    }
+    // promote stack arrays of EscapeAnalysis to SSA values
+    llvmFunctionPassManager_->add(llvm::createSROAPass());
     llvmFunctionPassManager_->add(llvm::createInstructionCombiningPass());
     llvmFunctionPassManager_->add(llvm::createReassociatePass());
     llvmFunctionPassManager_->add(llvm::createGVNPass());
     llvmFunctionPassManager_->add(llvm::createCFGSimplificationPass());
-    llvmFunctionPassManager_->add(llvm::createPromoteMemoryToRegisterPass());
+    // canonical counted loops are vectorized, then unrolled
+    llvmFunctionPassManager_->add(llvm::createLoopRotatePass());
+    llvmFunctionPassManager_->add(llvm::createLICMPass());
+    // loop with hoisted bounds checks is versioned on them, the version in
+    // bounds has no check and is vectorized
+    llvmFunctionPassManager_->add(llvm::createLoopUnswitchPass());
+    llvmFunctionPassManager_->add(llvm::createIndVarSimplifyPass());
+    llvmFunctionPassManager_->add(llvm::createLoopVectorizePass());
+    llvmFunctionPassManager_->add(llvm::createLoopUnrollPass());
+    llvmFunctionPassManager_->add(llvm::createInstructionCombiningPass());
+    llvmFunctionPassManager_->add(llvm::createCFGSimplificationPass());
     llvmFunctionPassManager_->doInitialization();
   }
 
   scope_ = ast->scope();
+  for (Scope *scope = scope_->owner(); scope; scope = scope->owner()) {
+    for (Scope::s_const_iterator it = scope->s_cbegin();
+         it != scope->s_cend(); ++it) {
+      declare(it->second);
+    }
+  }
+  // functions of this compile unit are declared before any body is lowered,
+  // so a function can call another one defined after it
+  for (A_TopStats *e = ast->topStats; e; e = e->next) {
+    if (e->topStat->kind() == +AstKind::FuncDef) {
+      declare(static_cast<A_VarId *>(
+                  static_cast<A_FuncDef *>(e->topStat)->getId())
+                  ->symbol());
+    }
+  }
 
   if (ast->topStats) {
     ast->topStats->accept(this);
   }
 
   scope_ = scope_->owner();
+  // shards are lowered after linked, see ParallelIrBuilder
+  if (shards_ == 1) {
+    detail::lowerCoroutines(llvmModule_, enableFunctionPass_);
+  }
+}
+
+detail::SpaceData IrBuilder::pop() {
+  LOG_ASSERT(!results_.empty(), "results_ must not empty");
+  detail::SpaceData result = results_.back();
+  results_.pop_back();
+  return result;
+}
+
+llvm::Value *IrBuilder::readVariable(A_VarId *varId) {
+  Symbol *symbol = varId->symbol();
+  if (varId->hasSlot()) {
+    return ssa_->readVariable(symbol, type(symbol->type()),
+                              llvmIRBuilder_.GetInsertBlock());
+  }
+  llvm::Value *value = space_.getValue(symbol);
+  LOG_ASSERT(value, "ast {}:{} symbol {}:{} does not has llvm value",
+             varId->name(), varId->location(), symbol->name(),
+             symbol->location());
+  return llvmIRBuilder_.CreateLoad(value);
+}
+
+void IrBuilder::writeVariable(A_VarId *varId, llvm::Value *value) {
+  Symbol *symbol = varId->symbol();
+  if (varId->hasSlot()) {
+    ssa_->writeVariable(symbol, llvmIRBuilder_.GetInsertBlock(), value);
+    return;
+  }
+  llvm::Value *address = space_.getValue(symbol);
+  LOG_ASSERT(address, "ast {}:{} symbol {}:{} does not has llvm value",
+             varId->name(), varId->location(), symbol->name(),
+             symbol->location());
+  llvmIRBuilder_.CreateStore(value, address);
+}
+
+void IrBuilder::statement(Ast *ast) {
+  int results = (int)results_.size();
+  ast->accept(this);
+  results_.resize(results);
+}
+
+llvm::BasicBlock *IrBuilder::createBlock(const Cowstr &name) {
+  // block is appended to function when entered, so blocks are in source order
+  return llvm::BasicBlock::Create(llvmContext_, name.str());
+}
+
+void IrBuilder::enterBlock(llvm::BasicBlock *block) {
+  llvm::Function *func = llvmIRBuilder_.GetInsertBlock()->getParent();
+  func->getBasicBlockList().push_back(block);
+  llvmIRBuilder_.SetInsertPoint(block);
+}
+
+void IrBuilder::branch(llvm::BasicBlock *dest) {
+  if (!llvmIRBuilder_.GetInsertBlock()->getTerminator()) {
+    llvmIRBuilder_.CreateBr(dest);
+  }
+}
+
+void IrBuilder::enterDeadBlock() {
+  llvm::BasicBlock *block = createBlock("dead");
+  ssa_->sealBlock(block);
+  enterBlock(block);
 }
 
 // IrBuilder }
 
+// ParallelIrBuilder {
+
+ParallelIrBuilder::ParallelIrBuilder(bool enableFunctionPass, int threads)
+    : Phase("ParallelIrBuilder"), enableFunctionPass_(enableFunctionPass),
+      threads_(threads), llvmContext_(), llvmModule_(nullptr) {}
+
+ParallelIrBuilder::~ParallelIrBuilder() { delete llvmModule_; }
+
+void ParallelIrBuilder::run(Ast *ast) {
+  LOG_ASSERT(ast->kind() == +AstKind::CompileUnit,
+             "ast {}:{} kind {} != AstKind::CompileUnit", ast->name(),
+             ast->location(), ast->kind()._to_string());
+
+  // lower each shard in its own context, and write module as bitcode
+  int shards = threads_;
+  std::vector<std::string> bitcodes(shards);
+  {
+    ThreadPool pool(threads_);
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < shards; i++) {
+      bool enableFunctionPass = enableFunctionPass_;
+      std::string *bitcode = &bitcodes[i];
+      futures.push_back(
+          pool.submit([ast, i, shards, enableFunctionPass, bitcode]() {
+            IrBuilder irBuilder(enableFunctionPass, i, shards);
+            irBuilder.run(ast);
+            llvm::raw_string_ostream os(*bitcode);
+            llvm::WriteBitcodeToFile(*irBuilder.llvmModule(), os);
+            os.flush();
+          }));
+    }
+    for (int i = 0; i < (int)futures.size(); i++) {
+      futures[i].wait();
+    }
+    for (int i = 0; i < (int)futures.size(); i++) {
+      futures[i].get();
+    }
+  }
+
+  // read shards into this context and link them
+  for (int i = 0; i < shards; i++) {
+    llvm::Expected<std::unique_ptr<llvm::Module>> m = llvm::parseBitcodeFile(
+        llvm::MemoryBufferRef(bitcodes[i], ast->name().str()), llvmContext_);
+    LOG_ASSERT(m, "cannot read shard {} of {}: {}", i, ast->name(),
+               llvm::toString(m.takeError()));
+    if (!llvmModule_) {
+      llvmModule_ = m->release();
+      continue;
+    }
+    bool linkError = llvm::Linker::linkModules(*llvmModule_, std::move(*m));
+    LOG_ASSERT(!linkError, "cannot link shard {} of {}", i, ast->name());
+  }
+  // generators are inlined into loops of other shards
+  detail::lowerCoroutines(llvmModule_, enableFunctionPass_);
+}
+
+llvm::Module *ParallelIrBuilder::llvmModule() const { return llvmModule_; }
+
+std::unique_ptr<llvm::Module>
+ParallelIrBuilder::copyModule(llvm::LLVMContext &context) const {
+  return detail::copyModule(llvmModule_, context);
+}
+
+// ParallelIrBuilder }
+
 // ConstantBuilder {
 
 IrBuilder::ConstantBuilder::ConstantBuilder(IrBuilder *a_irBuilder)
@@ -527,16 +2692,14 @@ void IrBuilder::ConstantBuilder::visitInteger(A_Integer *ast) {
     llvm::APInt ap = ast->isSigned() ? llvm::APInt(32, ast->asInt32(), true)
                                      : llvm::APInt(ast->asUInt32(), false);
     llvm::ConstantInt *ci = llvm::ConstantInt::get(irBuilder->llvmContext_, ap);
-    irBuilder->space_.setConstant(label(ast),
-                                  llvm::dyn_cast<llvm::Constant>(ci));
+    constants.push_back(ci);
     break;
   }
   case 64: {
     llvm::APInt ap = ast->isSigned() ? llvm::APInt(64, ast->asInt64(), true)
                                      : llvm::APInt(64, ast->asUInt64(), false);
     llvm::ConstantInt *ci = llvm::ConstantInt::get(irBuilder->llvmContext_, ap);
-    irBuilder->space_.setConstant(label(ast),
-                                  llvm::dyn_cast<llvm::Constant>(ci));
+    constants.push_back(ci);
     break;
   }
   default:
@@ -550,15 +2713,13 @@ void IrBuilder::ConstantBuilder::visitFloat(A_Float *ast) {
   case 32: {
     llvm::APFloat ap = llvm::APFloat(ast->asFloat());
     llvm::ConstantFP *cf = llvm::ConstantFP::get(irBuilder->llvmContext_, ap);
-    irBuilder->space_.setConstant(label(ast),
-                                  llvm::dyn_cast<llvm::Constant>(cf));
+    constants.push_back(cf);
     break;
   }
   case 64: {
     llvm::APFloat ap = llvm::APFloat(ast->asDouble());
     llvm::ConstantFP *cf = llvm::ConstantFP::get(irBuilder->llvmContext_, ap);
-    irBuilder->space_.setConstant(label(ast),
-                                  llvm::dyn_cast<llvm::Constant>(cf));
+    constants.push_back(cf);
     break;
   }
   default:
@@ -570,7 +2731,7 @@ void IrBuilder::ConstantBuilder::visitBoolean(A_Boolean *ast) {
   llvm::Constant *cb =
       ast->asBoolean() ? llvm::ConstantInt::getTrue(irBuilder->llvmContext_)
                        : llvm::ConstantInt::getFalse(irBuilder->llvmContext_);
-  irBuilder->space_.setConstant(label(ast), cb);
+  constants.push_back(cb);
 }
 
 void IrBuilder::ConstantBuilder::visitCharacter(A_Character *ast) {
@@ -602,19 +2763,23 @@ void IrBuilder::ConstantBuilder::visitPostfix(A_Postfix *ast) {
 }
 
 void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
-  ast->left->accept(this);
-  llvm::Constant *a = irBuilder->space_.getConstant(label(ast->left));
-  ast->right->accept(this);
-  llvm::Constant *b = irBuilder->space_.getConstant(label(ast->right));
+  postorderInfix(ast, this, [this](A_Infix *e) { infix(e); });
+}
+
+void IrBuilder::ConstantBuilder::infix(A_Infix *ast) {
+  // right operand is visited last
+  LOG_ASSERT(constants.size() >= 2, "constants size {} < 2", constants.size());
+  llvm::Constant *b = constants.back();
+  constants.pop_back();
+  llvm::Constant *a = constants.back();
+  constants.pop_back();
   switch (ast->infixOp) {
   case T_PLUS: { // +
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getAdd(a, b));
+      constants.push_back(llvm::ConstantExpr::getAdd(a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getFAdd(a, b));
+      constants.push_back(llvm::ConstantExpr::getFAdd(a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
                  ast->location());
@@ -623,12 +2788,10 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
   }
   case T_MINUS: { // -
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getSub(a, b));
+      constants.push_back(llvm::ConstantExpr::getSub(a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getFSub(a, b));
+      constants.push_back(llvm::ConstantExpr::getFSub(a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
                  ast->location());
@@ -637,12 +2800,10 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
   }
   case T_ASTERISK: { // *
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getMul(a, b));
+      constants.push_back(llvm::ConstantExpr::getMul(a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getFMul(a, b));
+      constants.push_back(llvm::ConstantExpr::getFMul(a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
                  ast->location());
@@ -651,12 +2812,10 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
   }
   case T_SLASH: { // /
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getSDiv(a, b));
+      constants.push_back(llvm::ConstantExpr::getSDiv(a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getFDiv(a, b));
+      constants.push_back(llvm::ConstantExpr::getFDiv(a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
                  ast->location());
@@ -665,12 +2824,10 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
   }
   case T_PERCENT: { // %
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getSRem(a, b));
+      constants.push_back(llvm::ConstantExpr::getSRem(a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(label(ast),
-                                    llvm::ConstantExpr::getFRem(a, b));
+      constants.push_back(llvm::ConstantExpr::getFRem(a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
                  ast->location());
@@ -688,7 +2845,7 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
                Cowstr::from(b));
     LOG_ASSERT(llvm::dyn_cast<llvm::ConstantInt>(b)->getBitWidth() == 1,
                "b bitWidth != 1:{}", Cowstr::from(b));
-    irBuilder->space_.setConstant(label(ast), llvm::ConstantExpr::getOr(a, b));
+    constants.push_back(llvm::ConstantExpr::getOr(a, b));
     break;
   }
   case T_AMPERSAND2:
@@ -702,30 +2859,28 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
                Cowstr::from(b));
     LOG_ASSERT(llvm::dyn_cast<llvm::ConstantInt>(b)->getBitWidth() == 1,
                "b bitWidth != 1:{}", Cowstr::from(b));
-    irBuilder->space_.setConstant(label(ast), llvm::ConstantExpr::getAnd(a, b));
+    constants.push_back(llvm::ConstantExpr::getAnd(a, b));
     break;
   }
   case T_BAR: { // |
-    irBuilder->space_.setConstant(label(ast), llvm::ConstantExpr::getOr(a, b));
+    constants.push_back(llvm::ConstantExpr::getOr(a, b));
     break;
   }
   case T_AMPERSAND: { // &
-    irBuilder->space_.setConstant(label(ast), llvm::ConstantExpr::getAnd(a, b));
+    constants.push_back(llvm::ConstantExpr::getAnd(a, b));
     break;
   }
   case T_CARET: { // ^
-    irBuilder->space_.setConstant(label(ast), llvm::ConstantExpr::getXor(a, b));
+    constants.push_back(llvm::ConstantExpr::getXor(a, b));
     break;
   }
   case T_EQ: { // ==
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::ICMP_EQ, a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::FCMP_OEQ, a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
@@ -735,13 +2890,11 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
   }
   case T_NEQ: { // !=
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::ICMP_NE, a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::FCMP_ONE, a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
@@ -751,13 +2904,11 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
   }
   case T_LT: { // <
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::ICMP_SLT, a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::FCMP_OLT, a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
@@ -767,13 +2918,11 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
   }
   case T_LE: { // <=
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::ICMP_SLE, a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::FCMP_OLE, a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
@@ -783,13 +2932,11 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
   }
   case T_GT: { // >
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::ICMP_SGT, a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::FCMP_OGT, a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
@@ -799,13 +2946,11 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
   }
   case T_GE: { // >=
     if (llvm::isa<llvm::ConstantInt>(a) && llvm::isa<llvm::ConstantInt>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::ICMP_SGE, a, b));
     } else if (llvm::isa<llvm::ConstantFP>(a) &&
                llvm::isa<llvm::ConstantFP>(b)) {
-      irBuilder->space_.setConstant(
-          label(ast),
+      constants.push_back(
           llvm::ConstantExpr::getCompare(llvm::CmpInst::FCMP_OGE, a, b));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
@@ -813,6 +2958,11 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
     }
     break;
   }
+  case T_DOT2: { // ..
+    ASSERT(false, "error: range {}:{} can only be enumerated by for loop\n",
+           ast->name(), ast->location());
+    break;
+  }
   // case T_LSHIFT:
   // case T_RSHIFT:
   // case T_ARSHIFT:
@@ -824,17 +2974,18 @@ void IrBuilder::ConstantBuilder::visitInfix(A_Infix *ast) {
 
 void IrBuilder::ConstantBuilder::visitPrefix(A_Prefix *ast) {
   ast->expr->accept(this);
-  llvm::Constant *a = irBuilder->space_.getConstant(label(ast->expr));
+  llvm::Constant *a = constants.back();
+  constants.pop_back();
   switch (ast->prefixOp) {
   case T_PLUS: { // +
-    // do nothing
+    constants.push_back(a);
     break;
   }
   case T_MINUS: { // -
     if (llvm::isa<llvm::ConstantInt>(a)) {
-      irBuilder->space_.setConstant(label(ast), llvm::ConstantExpr::getNeg(a));
+      constants.push_back(llvm::ConstantExpr::getNeg(a));
     } else if (llvm::isa<llvm::ConstantFP>(a)) {
-      irBuilder->space_.setConstant(label(ast), llvm::ConstantExpr::getFNeg(a));
+      constants.push_back(llvm::ConstantExpr::getFNeg(a));
     } else {
       LOG_ASSERT(false, "invalid operation for {}:{}", ast->name(),
                  ast->location());
@@ -842,12 +2993,12 @@ void IrBuilder::ConstantBuilder::visitPrefix(A_Prefix *ast) {
     break;
   }
   case T_TILDE: { // ~
-    irBuilder->space_.setConstant(label(ast), llvm::ConstantExpr::getNeg(a));
+    constants.push_back(llvm::ConstantExpr::getNeg(a));
     break;
   }
   case T_EXCLAM:
   case T_NOT: { // ! not
-    irBuilder->space_.setConstant(label(ast), llvm::ConstantExpr::getNeg(a));
+    constants.push_back(llvm::ConstantExpr::getNeg(a));
     break;
   }
   default:
@@ -6,23 +6,38 @@
 #include "SymbolClasses.h"
 #include "enum.h"
 #include "iface/Phase.h"
+#include "SsaBuilder.h"
 #include "iface/Visitor.h"
 #include "infra/Cowstr.h"
-#include "infra/LinkedHashMap.h"
+#include "infra/ThreadPool.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Value.h"
+#include "llvm/Target/TargetMachine.h"
+#include <memory>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace detail {
 
+// copy module into another context through bitcode
+std::unique_ptr<llvm::Module> copyModule(const llvm::Module *module,
+                                         llvm::LLVMContext &context);
+
+// split generators and async functions into resume/destroy functions and
+// lower coroutine intrinsics, it does nothing if module has no coroutine. With
+// `optimize`, generators enumerated in the module are inlined and their frames
+// are allocated on stack
+void lowerCoroutines(llvm::Module *module, bool optimize);
+
 struct SpaceData {
   enum SpaceDataKind { VALUE = 0, TYPE, CONSTANT, FUNCTION };
 
@@ -49,32 +64,97 @@ struct SpaceData {
   Cowstr str() const;
 };
 
+/**
+ * Space keeps llvm values of global variables and functions, and llvm types of
+ * type symbols, keyed by symbol identity.
+ *
+ * Local variables are SSA values built by SsaBuilder, and expression results
+ * are passed through the result stack in IrBuilder, neither goes here.
+ */
 class Space {
 public:
   Space();
   virtual ~Space() = default;
 
-  void setValue(const Cowstr &name, llvm::Value *value);
-  void setType(const Cowstr &name, llvm::Type *type);
-  void setConstant(const Cowstr &name, llvm::Constant *constant);
-  void setFunction(const Cowstr &name, llvm::Function *function);
-  llvm::Value *getValue(const Cowstr &name) const;
-  llvm::Type *getType(const Cowstr &name) const;
-  llvm::Constant *getConstant(const Cowstr &name) const;
-  llvm::Function *getFunction(const Cowstr &name) const;
+  void setValue(const Symbol *symbol, llvm::Value *value);
+  void setType(const TypeSymbol *typeSymbol, llvm::Type *type);
+  void setFunction(const Symbol *symbol, llvm::Function *function);
+  llvm::Value *getValue(const Symbol *symbol) const;
+  llvm::Type *getType(const TypeSymbol *typeSymbol) const;
+  llvm::Function *getFunction(const Symbol *symbol) const;
 
 private:
-  LinkedHashMap<Cowstr, SpaceData> dataMap_;
+  std::unordered_map<const void *, SpaceData> dataMap_;
 };
 
 } // namespace detail
 
+/**
+ * IrBuilder lowers the compile unit into a LLVM module.
+ *
+ * With `shards` > 1, only top-level functions whose index % shards == shard
+ * are defined, other functions are declared as external prototypes. Global
+ * variables are defined in shard 0 and declared in other shards. The shard
+ * modules are linked into one module by ParallelIrBuilder.
+ *
+ * Local variables and parameters never have their address taken, so they are
+ * lowered to SSA values directly instead of alloca/load/store, see SsaBuilder.
+ *
+ * Global variables and functions of enclosing scopes of the compile unit are
+ * defined by previous compile units, they are declared as external, see Repl.
+ *
+ * A function with `yield` is a generator, it's lowered to a switched-resume
+ * LLVM coroutine whose ramp returns the coroutine handle, yielded value is
+ * passed through the promise. `for (x:T <- gen(...))` resumes the handle until
+ * it's done, and destroys it when loop exits.
+ *
+ * `for (i:T <- a..b)` over integer range is a counted loop whose induction
+ * variable starts at a and stops before b, with both bounds evaluated once. Its
+ * trip count is known to LLVM, so function passes can vectorize and unroll it.
+ *
+ * `a[i]` checks i is in bounds of array a, and a slice `a[i..j]` checks
+ * 0 <= i <= j <= length, out of bounds aborts by dimrt_bounds. A check is
+ * dropped if both index and length are constants, e.g. of a `T[N]` array. In a
+ * range loop over i, checks of `a[i]` are hoisted before loop as whether the
+ * range is in bounds of a, LoopUnswitch then versions the loop on it, so the
+ * version in bounds has no check and can be vectorized.
+ *
+ * A vector type like `float8` is an LLVM fixed vector, its arithmetic is
+ * elementwise and a scalar operand is broadcast to every lane. `float8(x)`
+ * splats x and `float8(x0, ..., x7)` builds lanes, `v[i]` reads or assigns a
+ * lane, `v[i, j, ...]` is a shufflevector, lanes are constants checked at
+ * compile time. `reduce(+ v)`, `reduce(min v)` and `reduce(max v)` are
+ * horizontal reductions, `+` of float lanes is reassociated.
+ *
+ * `foreach (i:T <- a..b; + s, min t, max u)` runs iterations of range in
+ * parallel, see rt/Parallel.h. Its body is outlined into a function running a
+ * chunk of iterations, local variables it uses are copied into a context and
+ * are read-only. Each reduction variable starts at its identity in a chunk,
+ * and the chunk combines it into the variable of enclosing function once.
+ *
+ * An `async def` function is lowered to coroutine too, its promise starts with
+ * a task of runtime scheduler (see rt/Scheduler.h) followed by the result.
+ * `await expr` spawns every async call of expr as a child task, then suspends
+ * current task until all of them complete, or blocks current thread outside
+ * async function.
+ *
+ * `throw` raises an exception by Itanium C++ ABI unwinder, see rt/Exception.h.
+ * Calls inside try block, or inside scope of a region, generator or finally,
+ * are lowered to `invoke`, whose landing pad runs cleanups and catch. Code
+ * without throw doesn't check anything, it only costs unwind tables.
+ */
 class IrBuilder : public Phase, public Visitor {
 public:
-  IrBuilder(bool enableFunctionPass = true);
+  IrBuilder(bool enableFunctionPass = true, int shard = 0, int shards = 1);
   virtual ~IrBuilder();
   virtual void run(Ast *ast);
   virtual llvm::Module *llvmModule() const;
+  // copy lowered module into another context through bitcode, so it can be
+  // owned by JIT
+  std::unique_ptr<llvm::Module> copyModule(llvm::LLVMContext &context) const;
+
+  // name of lowered global variable or function in llvm module
+  static Cowstr linkName(const Symbol *symbol);
 
   virtual void visitInteger(A_Integer *ast);
   virtual void visitFloat(A_Float *ast);
@@ -84,10 +164,10 @@ public:
   virtual void visitNil(A_Nil *ast);
   virtual void visitVoid(A_Void *ast);
   virtual void visitVarId(A_VarId *ast);
-  // virtual void visitBreak(A_Break *ast);
-  // virtual void visitContinue(A_Continue *ast);
+  virtual void visitBreak(A_Break *ast);
+  virtual void visitContinue(A_Continue *ast);
 
-  // virtual void visitThrow(A_Throw *ast);
+  virtual void visitThrow(A_Throw *ast);
   virtual void visitReturn(A_Return *ast);
   virtual void visitAssign(A_Assign *ast);
   virtual void visitPostfix(A_Postfix *ast);
@@ -95,16 +175,21 @@ public:
   virtual void visitPrefix(A_Prefix *ast);
   virtual void visitCall(A_Call *ast);
   // virtual void visitExprs(A_Exprs *ast);
-  // virtual void visitIf(A_If *ast);
-  // virtual void visitLoop(A_Loop *ast);
-  // virtual void visitYield(A_Yield *ast);
+  virtual void visitIndex(A_Index *ast);
+  virtual void visitNew(A_New *ast);
+  virtual void visitDelete(A_Delete *ast);
+  virtual void visitAwait(A_Await *ast);
+  virtual void visitIf(A_If *ast);
+  virtual void visitLoop(A_Loop *ast);
+  virtual void visitYield(A_Yield *ast);
   // virtual void visitLoopCondition(A_LoopCondition *ast);
   // virtual void visitLoopEnumerator(A_LoopEnumerator *ast);
-  // virtual void visitDoWhile(A_DoWhile *ast);
-  // virtual void visitTry(A_Try *ast);
+  virtual void visitDoWhile(A_DoWhile *ast);
+  virtual void visitTry(A_Try *ast);
   virtual void visitBlock(A_Block *ast);
   // virtual void visitBlockStats(A_BlockStats *ast);
   virtual void visitPlainType(A_PlainType *ast);
+  virtual void visitArrayType(A_ArrayType *ast);
   virtual void visitFuncDef(A_FuncDef *ast);
   // virtual void visitFuncSign(A_FuncSign *ast);
   // virtual void visitParams(A_Params *ast);
@@ -132,16 +217,213 @@ public:
     virtual void visitInfix(A_Infix *ast);
     virtual void visitPrefix(A_Prefix *ast);
     // virtual void visitExprs(A_Exprs *ast);
+
+    // combine infix node from its visited operands
+    void infix(A_Infix *ast);
+
+    // visited constant expressions, each expression pushes one
+    std::vector<llvm::Constant *> constants;
   };
 
 private:
+  // combine infix node from its visited operands
+  void infix(A_Infix *ast);
+  llvm::Value *binary(int op, llvm::Value *a, llvm::Value *b, Ast *ast);
+  // `reduce(+ v)`, `reduce(min v)` or `reduce(max v)` of vector v
+  void reduce(A_Prefix *ast);
+  // `float8(x)` or `float8(x0, ..., x7)`
+  void vector(A_Call *ast);
+  // constant lane of vector in [0, lanes)
+  uint64_t lane(Ast *index, const Ts_Vector *tv);
+
+  // pop result of last visited expression or type
+  detail::SpaceData pop();
+
+  llvm::Type *plainType(const TypeSymbol *typeSymbol);
+  // plain type, vector type, or array type `{T*, i64}` of data pointer and
+  // length
+  llvm::Type *type(const TypeSymbol *typeSymbol);
+  llvm::StructType *arrayType(llvm::Type *elementType);
+  // address of element `a[i]` after its bounds check, element type is
+  // returned in `elementType`
+  llvm::Value *elementPointer(A_Index *ast, llvm::Type **elementType);
+  // load or store array element, at most 16-byte aligned like array memory
+  llvm::Value *loadElement(llvm::Type *elementType, llvm::Value *ptr);
+  void storeElement(llvm::Value *v, llvm::Value *ptr);
+  // `a[i..j]`, a slice sharing elements of a
+  void slice(A_Index *ast);
+  // length of array value of expr, a constant if it's known at compile time
+  llvm::Value *arrayLength(Ast *expr, llvm::Value *array);
+  // call dimrt_bounds with index and length unless inBounds is true, a
+  // constant false is a compile error
+  void boundsCheck(Ast *ast, llvm::Value *inBounds, llvm::Value *index,
+                   llvm::Value *length);
+  // bytes of array with `length` elements
+  llvm::Value *arrayBytes(llvm::Type *elementType, llvm::Value *length);
+  // function of runtime library, see rt/Runtime.h
+  llvm::FunctionCallee runtime(const char *name, llvm::Type *result,
+                               const std::vector<llvm::Type *> &params);
+  // emit cleanups entered at loop depth no less than `depth`, before
+  // return/break/continue jumps out of them
+  void cleanup(int depth);
+
+  // call function, it's an invoke if the exception it throws unwinds to a
+  // landing pad of current function
+  llvm::Value *call(llvm::FunctionCallee callee,
+                    llvm::ArrayRef<llvm::Value *> args,
+                    const llvm::Twine &name = "");
+  // landing pad of innermost unwind scope, or null if exception unwinds to
+  // caller
+  llvm::BasicBlock *unwindPad();
+  // continue unwinding `{i8*, i32}` exception to enclosing unwind scope, or to
+  // caller
+  void rethrow(llvm::Value *exception);
+  // `{i8*, i32}` of landing pad
+  llvm::StructType *exceptionType();
+
+  // coroutine intrinsic
+  llvm::Function *intrinsic(llvm::Intrinsic::ID id);
+  // ramp of coroutine: allocate frame and suspend before body
+  void beginCoroutine(llvm::Type *promiseType);
+  // final suspend, frame deallocation and return of handle
+  void endCoroutine();
+  // suspend coroutine at `save`, resumed at current block. `name` prefixes
+  // resume/destroy blocks
+  void suspend(llvm::Value *save, const char *name);
+  // `{handle, parent, pending}` of dimrt::Task
+  llvm::StructType *taskType();
+  // task followed by result, or task only if result is void
+  llvm::StructType *promiseType(llvm::Type *resultType);
+  // `for (x:T <- gen(...))`
+  void enumerate(A_Loop *ast);
+  // bounds of `for (i:T <- a..b)`, evaluated once
+  void range(A_Loop *ast, llvm::Value **begin, llvm::Value **end);
+  // `for (i:T <- a..b)`, a counted loop over [begin, end) without any iterator
+  void countedLoop(A_Loop *ast, llvm::Value *begin, llvm::Value *end);
+  // `foreach (i:T <- a..b; reductions)`, body is outlined and run in chunks
+  // by runtime
+  void parallelLoop(A_Loop *ast);
+  // external declaration of global variable or function
+  void declare(const Symbol *symbol);
+
+  // read/write local or global variable
+  llvm::Value *readVariable(A_VarId *varId);
+  void writeVariable(A_VarId *varId, llvm::Value *value);
+
+  // visit statement, its result is dropped
+  void statement(Ast *ast);
+  // visit branch of if, returns its value or null
+  llvm::Value *branchValue(Ast *ast);
+
+  // create block in current function, enter block which is created before
+  llvm::BasicBlock *createBlock(const Cowstr &name);
+  void enterBlock(llvm::BasicBlock *block);
+  // branch to dest if current block is not terminated
+  void branch(llvm::BasicBlock *dest);
+  // code after return/break/continue goes to an unreachable block
+  void enterDeadBlock();
+
   llvm::LLVMContext llvmContext_;
   llvm::IRBuilder<> llvmIRBuilder_;
   llvm::Module *llvmModule_;
 
   bool enableFunctionPass_;
   llvm::legacy::FunctionPassManager *llvmFunctionPassManager_;
+  // host target of function passes, or null if it's not supported
+  std::unique_ptr<llvm::TargetMachine> targetMachine_;
+
+  int shard_;
+  int shards_;
+  // top-level functions visited
+  int funcDefs_;
 
   detail::Space space_;
+  // visited expressions and types, each pushes one result
+  std::vector<detail::SpaceData> results_;
   Scope *scope_;
+  // local variables of current function
+  SsaBuilder *ssa_;
+  // continue/break targets of enclosing loops in current function
+  std::vector<std::pair<llvm::BasicBlock *, llvm::BasicBlock *>> loops_;
+  // handles of enclosing regions in current function
+  std::vector<llvm::Value *> regions_;
+
+  // runtime call releasing a region or destroying a generator, or `finally`
+  // of try, when control leaves it, with loop depth where it's entered
+  struct Cleanup {
+    llvm::FunctionCallee function;
+    llvm::Value *value;
+    Ast *finallyp;
+    int depth;
+    // unwind scopes enclosing it
+    int unwinds;
+  };
+  std::vector<Cleanup> cleanups_;
+
+  // calls inside try block or cleanup scope unwind to its landing pad, which
+  // is created by first call of them
+  struct Unwind {
+    // try catches exception, otherwise it runs cleanup and rethrows
+    bool catches;
+    Cleanup cleanup;
+    llvm::BasicBlock *pad;
+    // receives exception from landing pad or inner unwind scopes
+    llvm::BasicBlock *handler;
+    llvm::PHINode *exception;
+  };
+  std::vector<Unwind> unwinds_;
+
+  void pushCleanup(Cleanup cleanup);
+  // cleanup is done by caller on normal exit, exception handler is emitted
+  void popCleanup();
+  void runCleanup(const Cleanup &cleanup);
+  llvm::BasicBlock *unwindHandler(Unwind *unwind);
+  // enter handler of popped unwind scope, returns false if nothing unwinds to
+  // it
+  bool enterUnwind(const Unwind &unwind);
+
+  struct Coroutine {
+    // defined by `async def`, otherwise a generator
+    bool async;
+    // yielded value of generator, or task and result of async function
+    llvm::AllocaInst *promise;
+    llvm::Value *id;
+    llvm::Value *handle;
+    llvm::BasicBlock *finalBlock;
+    llvm::BasicBlock *cleanupBlock;
+    llvm::BasicBlock *suspendBlock;
+  };
+  // current function is a coroutine, or null
+  Coroutine *coroutine_;
+  // current function is outlined body of `foreach`, which cannot return or
+  // break out of it
+  bool parallel_;
+  // results of async calls of enclosing `await`
+  std::unordered_map<A_Call *, llvm::Value *> awaited_;
+  // `a[i]` in range loops over i, whose bounds are checked once before loop
+  std::unordered_map<A_Index *, llvm::Value *> inBounds_;
+};
+
+/**
+ * ParallelIrBuilder lowers and function-optimizes shards of functions on a
+ * thread pool, each shard is an IrBuilder with its own LLVMContext.
+ *
+ * Shard modules are round-tripped through bitcode into the context of
+ * ParallelIrBuilder, then linked into one module.
+ */
+class ParallelIrBuilder : public Phase {
+public:
+  ParallelIrBuilder(bool enableFunctionPass = true,
+                    int threads = ThreadPool::defaultThreads());
+  virtual ~ParallelIrBuilder();
+  virtual void run(Ast *ast);
+  virtual llvm::Module *llvmModule() const;
+  // see IrBuilder::copyModule
+  std::unique_ptr<llvm::Module> copyModule(llvm::LLVMContext &context) const;
+
+private:
+  bool enableFunctionPass_;
+  int threads_;
+  llvm::LLVMContext llvmContext_;
+  llvm::Module *llvmModule_;
 };
@@ -0,0 +1,151 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "ObjectCache.h"
+#include "boost/filesystem.hpp"
+#include "fmt/format.h"
+#include "infra/Log.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdlib>
+#include <string>
+
+namespace fs = boost::filesystem;
+
+Cowstr ObjectCache::Stats::str() const {
+  int total = hits + misses;
+  return fmt::format("object cache: {} hits, {} misses, hit rate {:.1f}%, "
+                     "compile {:.3f}ms, saved {:.3f}ms",
+                     hits, misses, total ? hits * 100.0 / total : 0.0,
+                     compileTime / 1e6, savedTime / 1e6);
+}
+
+ObjectCache::ObjectCache(const Cowstr &directory, const Cowstr &target)
+    : directory_(directory), target_(target), stats_() {
+  boost::system::error_code error;
+  fs::create_directories(fs::path(directory_.str()), error);
+  ASSERT(!error, "error: cannot create cache directory {}: {}\n", directory_,
+         error.message());
+}
+
+void ObjectCache::notifyObjectCompiled(const llvm::Module *module,
+                                       llvm::MemoryBufferRef object) {
+  Cowstr name;
+  uint64_t elapsed = 0;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = misses_.find(module);
+    if (it == misses_.end()) {
+      return;
+    }
+    name = it->second.first;
+    elapsed =
+        (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - it->second.second)
+            .count();
+    misses_.erase(it);
+    stats_.compileTime += elapsed;
+  }
+  // time is written first, so an entry with object always has time
+  write(name + ".time", std::to_string(elapsed));
+  write(name + ".o", object.getBuffer());
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+ObjectCache::getObject(const llvm::Module *module) {
+  Cowstr name = key(module);
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> object =
+      llvm::MemoryBuffer::getFile((name + ".o").str());
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> time =
+      llvm::MemoryBuffer::getFile((name + ".time").str());
+
+  std::lock_guard<std::mutex> guard(lock_);
+  if (!object) {
+    stats_.misses++;
+    misses_[module] = std::make_pair(name, std::chrono::steady_clock::now());
+    return nullptr;
+  }
+  stats_.hits++;
+  if (time) {
+    stats_.savedTime += std::strtoull((*time)->getBufferStart(), nullptr, 10);
+  }
+  LOG_INFO("load {} from object cache {}", module->getModuleIdentifier(),
+           name);
+  return std::move(*object);
+}
+
+llvm::orc::LLJITBuilderState::CompileFunctionCreator
+ObjectCache::compileFunction() {
+  return [this](llvm::orc::JITTargetMachineBuilder builder)
+             -> llvm::Expected<
+                 std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+    llvm::Expected<std::unique_ptr<llvm::TargetMachine>> targetMachine =
+        builder.createTargetMachine();
+    if (!targetMachine) {
+      return targetMachine.takeError();
+    }
+    return std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>(
+        new llvm::orc::TMOwningSimpleCompiler(std::move(*targetMachine),
+                                              this));
+  };
+}
+
+const Cowstr &ObjectCache::directory() const { return directory_; }
+
+ObjectCache::Stats ObjectCache::stats() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  return stats_;
+}
+
+Cowstr ObjectCache::defaultDirectory() {
+  const char *dir = std::getenv("DIM_CACHE_DIR");
+  if (dir && *dir) {
+    return dir;
+  }
+  dir = std::getenv("XDG_CACHE_HOME");
+  if (dir && *dir) {
+    return (fs::path(dir) / "dim").string();
+  }
+  dir = std::getenv("HOME");
+  if (dir && *dir) {
+    return (fs::path(dir) / ".cache" / "dim").string();
+  }
+  return (fs::temp_directory_path() / "dim-cache").string();
+}
+
+Cowstr ObjectCache::key(const llvm::Module *module) const {
+  std::string bitcode;
+  llvm::raw_string_ostream os(bitcode);
+  llvm::WriteBitcodeToFile(*module, os);
+  os << target_.str();
+  os.flush();
+  llvm::SHA1 sha1;
+  sha1.update(bitcode);
+  return (fs::path(directory_.str()) / llvm::toHex(sha1.final(), true))
+      .string();
+}
+
+void ObjectCache::write(const Cowstr &fileName, llvm::StringRef data) {
+  fs::path temporary =
+      fs::unique_path(fs::path(fileName.str() + ".%%%%-%%%%-%%%%.tmp"));
+  {
+    std::error_code error;
+    llvm::raw_fd_ostream os(temporary.string(), error, llvm::sys::fs::OF_None);
+    if (error) {
+      LOG_WARN("cannot write object cache {}: {}", temporary.string(),
+               error.message());
+      return;
+    }
+    os << data;
+  }
+  boost::system::error_code error;
+  fs::rename(temporary, fs::path(fileName.str()), error);
+  if (error) {
+    LOG_WARN("cannot write object cache {}: {}", fileName, error.message());
+    fs::remove(temporary, error);
+  }
+}
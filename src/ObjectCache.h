@@ -0,0 +1,68 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "infra/Cowstr.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * ObjectCache keeps object files compiled by JIT in a local directory, so an
+ * unchanged module is loaded instead of compiled again, see `dimc --run`.
+ *
+ * The key of a module is the SHA1 of its bitcode and the target description
+ * (triple, cpu, features and optimization level). An entry is `<key>.o` and
+ * `<key>.time` which holds the compile time in nanoseconds, it's saved when
+ * the entry is loaded later. Files are written to a temporary name and then
+ * renamed, so concurrent runs never read a partial entry.
+ */
+class ObjectCache : public llvm::ObjectCache {
+public:
+  struct Stats {
+    int hits;
+    int misses;
+    // compile time of misses, and compile time saved by hits, in nanoseconds
+    uint64_t compileTime;
+    uint64_t savedTime;
+
+    Cowstr str() const;
+  };
+
+  ObjectCache(const Cowstr &directory, const Cowstr &target);
+  virtual ~ObjectCache() = default;
+
+  virtual void notifyObjectCompiled(const llvm::Module *module,
+                                    llvm::MemoryBufferRef object);
+  virtual std::unique_ptr<llvm::MemoryBuffer>
+  getObject(const llvm::Module *module);
+
+  // compile function for LLJITBuilder, compiled objects go through the cache
+  llvm::orc::LLJITBuilderState::CompileFunctionCreator compileFunction();
+
+  const Cowstr &directory() const;
+  Stats stats() const;
+
+  // $DIM_CACHE_DIR, $XDG_CACHE_HOME/dim or $HOME/.cache/dim
+  static Cowstr defaultDirectory();
+
+private:
+  Cowstr key(const llvm::Module *module) const;
+  void write(const Cowstr &fileName, llvm::StringRef data);
+
+  Cowstr directory_;
+  Cowstr target_;
+
+  mutable std::mutex lock_;
+  // key and compile start time of missed modules
+  std::unordered_map<const llvm::Module *,
+                     std::pair<Cowstr, std::chrono::steady_clock::time_point>>
+      misses_;
+  Stats stats_;
+};
@@ -46,10 +46,45 @@ Option::Option(int argc, char **argv)
       // --debug, -g
       ("debug,g", "add debugging information in object file")
 
+      // --jobs, -j
+      ("jobs,j", po::value<int>()->default_value(1)->value_name("n"),
+       "resolve symbols and generate LLVM IR with `n` threads, by default n "
+       "is 1")
+
       // --dump, -d
       ("dump,d", po::value<std::string>()->value_name("type"),
        "dump compile information type\n"
-       "ast: dump abstract syntax file");
+       "ast: dump abstract syntax file")
+
+      // --interpret
+      ("interpret",
+       "compile input file into bytecode and run its main function without "
+       "LLVM")
+
+      // --tier
+      ("tier", po::value<int>()->default_value(0)->value_name("n"),
+       "with --interpret, compile functions hot after `n` invocations and "
+       "backedges by LLVM JIT in background")
+
+      // --run
+      ("run", "compile input file with LLVM JIT and run its main function, "
+              "with --optimize and --jobs")
+
+      // --cache-dir
+      ("cache-dir", po::value<std::string>()->value_name("dir"),
+       "with --run, cache machine code in `dir`, by default $DIM_CACHE_DIR, "
+       "$XDG_CACHE_HOME/dim or $HOME/.cache/dim")
+
+      // --no-cache
+      ("no-cache", "with --run, always compile without cache")
+
+      // --perf
+      ("perf", "with --run, --tier or --repl, write functions compiled by JIT "
+               "to /tmp/perf-<pid>.map and jitdump files for linux perf")
+
+      // --repl
+      ("repl", "read, compile and evaluate definitions and expressions from "
+               "standard input with LLVM JIT");
 
   pos_desc_.add("input-files", -1);
 
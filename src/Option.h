@@ -37,9 +37,35 @@
  *
  *  --debug, -g               add debugging information in object file
  *
+ *  --jobs, -j [n]            resolve symbols and generate LLVM IR with `n`
+ *                            threads, by default n is 1
+ *
  *  --dump, -d [type]         dump compile information `type`
  *                            ast: dump abstract syntax file
  *
+ *  --interpret               compile input file into bytecode and run its
+ *                            main function without LLVM
+ *
+ *  --tier [n]                with --interpret, compile functions hot after
+ *                            `n` invocations and backedges by LLVM JIT in
+ *                            background
+ *
+ *  --run                     compile input file with LLVM JIT and run its
+ *                            main function, with --optimize and --jobs
+ *
+ *  --cache-dir [dir]         with --run, cache machine code in `dir`, by
+ *                            default $DIM_CACHE_DIR, $XDG_CACHE_HOME/dim or
+ *                            $HOME/.cache/dim
+ *
+ *  --no-cache                with --run, always compile without cache
+ *
+ *  --perf                    with --run, --tier or --repl, write functions
+ *                            compiled by JIT to /tmp/perf-<pid>.map and
+ *                            jitdump files for linux perf
+ *
+ *  --repl                    read, compile and evaluate definitions and
+ *                            expressions from standard input with LLVM JIT
+ *
  *  --input-files [input files]   input multiple files only when
  *                                --codegen=lib/bin
  */
@@ -0,0 +1,178 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "PerfMap.h"
+#include "fmt/format.h"
+#include "infra/Log.h"
+#include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Process.h"
+#include <cctype>
+#include <string>
+#include <utility>
+
+namespace {
+
+// compiler of ORC names object buffer after its module
+const std::string ObjectBufferSuffix = "-jitted-objectbuffer";
+// lazy JIT extracts functions into sub modules
+const std::string SubModuleSuffix = ".submodule";
+
+bool endsWith(const std::string &s, const std::string &suffix) {
+  return s.length() >= suffix.length() &&
+         s.compare(s.length() - suffix.length(), suffix.length(), suffix) == 0;
+}
+
+// source file name of object compiled by JIT, or empty if unknown, e.g. the
+// object is loaded from ObjectCache
+std::string sourceName(llvm::StringRef objectName) {
+  std::string name = objectName.str();
+  if (!endsWith(name, ObjectBufferSuffix)) {
+    return "";
+  }
+  name.erase(name.length() - ObjectBufferSuffix.length());
+  while (endsWith(name, SubModuleSuffix)) {
+    name.erase(name.length() - SubModuleSuffix.length());
+  }
+  return name;
+}
+
+} // namespace
+
+std::atomic<bool> PerfMap::enabled_(false);
+
+PerfMap::PerfMap()
+    : fileName_(fmt::format("/tmp/perf-{}.map",
+                            llvm::sys::Process::getProcessId())),
+      fp_(nullptr), functions_(0) {
+  fp_ = std::fopen(fileName_.rawstr(), "a");
+  if (!fp_) {
+    LOG_WARN("cannot open perf map {}", fileName_);
+  }
+}
+
+PerfMap::~PerfMap() {
+  if (fp_) {
+    std::fclose(fp_);
+    fp_ = nullptr;
+  }
+}
+
+void PerfMap::notifyObjectLoaded(
+    ObjectKey key, const llvm::object::ObjectFile &object,
+    const llvm::RuntimeDyld::LoadedObjectInfo &info) {
+  if (!fp_) {
+    return;
+  }
+  // symbol addresses of debug object are relocated to load addresses
+  llvm::object::OwningBinary<llvm::object::ObjectFile> debugObject =
+      info.getObjectForDebug(object);
+  if (!debugObject.getBinary()) {
+    return;
+  }
+  std::string source = sourceName(object.getFileName());
+
+  std::lock_guard<std::mutex> guard(lock_);
+  for (const std::pair<llvm::object::SymbolRef, uint64_t> &p :
+       llvm::object::computeSymbolSizes(*debugObject.getBinary())) {
+    llvm::Expected<llvm::object::SymbolRef::Type> type = p.first.getType();
+    if (!type) {
+      llvm::consumeError(type.takeError());
+      continue;
+    }
+    if (*type != llvm::object::SymbolRef::ST_Function) {
+      continue;
+    }
+    llvm::Expected<llvm::StringRef> name = p.first.getName();
+    if (!name) {
+      llvm::consumeError(name.takeError());
+      continue;
+    }
+    llvm::Expected<uint64_t> address = p.first.getAddress();
+    if (!address) {
+      llvm::consumeError(address.takeError());
+      continue;
+    }
+    if (p.second == 0) {
+      continue;
+    }
+    fmt::print(fp_, "{:x} {:x} {}\n", *address, p.second,
+               demangle(name->str(), source));
+    functions_++;
+  }
+  std::fflush(fp_);
+}
+
+const Cowstr &PerfMap::fileName() const { return fileName_; }
+
+int PerfMap::functions() const { return functions_; }
+
+PerfMap &PerfMap::instance() {
+  static PerfMap perfMap;
+  return perfMap;
+}
+
+void PerfMap::enable(bool enabled) { enabled_ = enabled; }
+
+bool PerfMap::enabled() { return enabled_; }
+
+void PerfMap::setup(llvm::orc::LLJITBuilderState &builder) {
+  if (!enabled_) {
+    return;
+  }
+  builder.CreateObjectLinkingLayer = [](llvm::orc::ExecutionSession &session,
+                                        const llvm::Triple &) {
+    std::unique_ptr<llvm::orc::RTDyldObjectLinkingLayer> layer(
+        new llvm::orc::RTDyldObjectLinkingLayer(session, []() {
+          return std::unique_ptr<llvm::RuntimeDyld::MemoryManager>(
+              new llvm::SectionMemoryManager());
+        }));
+    // null if LLVM is built without LLVM_USE_PERF
+    static llvm::JITEventListener *jitdump =
+        llvm::JITEventListener::createPerfJITEventListener();
+    if (jitdump) {
+      layer->registerJITEventListener(*jitdump);
+    }
+    layer->registerJITEventListener(instance());
+    return llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>>(
+        std::move(layer));
+  };
+}
+
+Cowstr PerfMap::demangle(const Cowstr &linkName, const Cowstr &fileName) {
+  std::string s = linkName.str();
+  size_t dot = s.rfind('.');
+  if (dot == std::string::npos || dot == 0) {
+    return linkName;
+  }
+  // 4 numbers separated by '_' after last '.'
+  int numbers = 0;
+  size_t i = dot + 1;
+  while (i < s.length()) {
+    size_t j = i;
+    while (j < s.length() && std::isdigit((unsigned char)s[j])) {
+      j++;
+    }
+    if (j == i) {
+      return linkName;
+    }
+    numbers++;
+    if (j == s.length()) {
+      break;
+    }
+    if (s[j] != '_') {
+      return linkName;
+    }
+    i = j + 1;
+  }
+  if (numbers != 4 || i >= s.length()) {
+    return linkName;
+  }
+  std::string line = s.substr(dot + 1, s.find('_', dot) - dot - 1);
+  if (fileName.empty()) {
+    return fmt::format("{} (line {})", s.substr(0, dot), line);
+  }
+  return fmt::format("{} ({}:{})", s.substr(0, dot), fileName, line);
+}
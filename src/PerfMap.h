@@ -0,0 +1,60 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "infra/Cowstr.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+/**
+ * PerfMap makes functions compiled by JIT visible to linux perf.
+ *
+ * It writes `/tmp/perf-<pid>.map`, one line `<address> <size> <name>` for each
+ * loaded function, which is read by `perf report` and `perf top`. Link names
+ * of functions are demangled to source names and lines, e.g. `fib.6_1_15_1`
+ * in `vm.dim` is written as `fib (vm.dim:6)`.
+ *
+ * LLVM's perf JIT event listener is registered too when LLVM is built with
+ * LLVM_USE_PERF, it writes jitdump files for `perf inject --jit`.
+ *
+ * It's enabled by `dimc --perf`, then every LLJIT created by dimc (`--run`,
+ * `--tier` and `--repl`) is set up by `PerfMap::setup`.
+ */
+class PerfMap : public llvm::JITEventListener {
+public:
+  virtual ~PerfMap();
+
+  virtual void
+  notifyObjectLoaded(ObjectKey key, const llvm::object::ObjectFile &object,
+                     const llvm::RuntimeDyld::LoadedObjectInfo &info);
+
+  // path of perf map file
+  const Cowstr &fileName() const;
+  // functions written to perf map file
+  int functions() const;
+
+  // perf map of this process
+  static PerfMap &instance();
+  static void enable(bool enabled);
+  static bool enabled();
+  // when enabled, link JIT objects in a layer with perf map and jitdump
+  // listeners
+  static void setup(llvm::orc::LLJITBuilderState &builder);
+
+  // `name.line_column_line_column` => `name (file:line)`, other names are not
+  // changed
+  static Cowstr demangle(const Cowstr &linkName, const Cowstr &fileName = "");
+
+private:
+  PerfMap();
+
+  Cowstr fileName_;
+  std::FILE *fp_;
+  std::mutex lock_;
+  std::atomic<int> functions_;
+  static std::atomic<bool> enabled_;
+};
@@ -0,0 +1,355 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Repl.h"
+#include "Ast.h"
+#include "ConstantFolder.h"
+#include "EscapeAnalysis.h"
+#include "IrBuilder.h"
+#include "PerfMap.h"
+#include "RuntimeSymbols.h"
+#include "Symbol.h"
+#include "SymbolBuilder.h"
+#include "SymbolResolver.h"
+#include "Token.h"
+#include "fmt/format.h"
+#include "iface/Phase.h"
+#include "infra/Log.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+
+namespace {
+
+// type of expression in the subset lowered by IrBuilder, or null if unknown
+const TypeSymbol *resultType(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::Integer: {
+    A_Integer *e = static_cast<A_Integer *>(ast);
+    if (e->bit() == 32) {
+      return e->isSigned() ? TypeSymbol::ts_int() : TypeSymbol::ts_uint();
+    }
+    return e->isSigned() ? TypeSymbol::ts_long() : TypeSymbol::ts_ulong();
+  }
+  case AstKind::Float:
+    return static_cast<A_Float *>(ast)->bit() == 32 ? TypeSymbol::ts_float()
+                                                     : TypeSymbol::ts_double();
+  case AstKind::Boolean:
+    return TypeSymbol::ts_boolean();
+  case AstKind::VarId: {
+    A_VarId *e = static_cast<A_VarId *>(ast);
+    return e->symbol() && e->symbol()->kind() != +SymbolKind::Func
+               ? e->symbol()->type()
+               : nullptr;
+  }
+  case AstKind::Assign:
+    return resultType(static_cast<A_Assign *>(ast)->assignee);
+  case AstKind::Index: {
+    A_Index *e = static_cast<A_Index *>(ast);
+    const TypeSymbol *array = resultType(e->expr);
+    if (array && array->kind() == +TypeSymbolKind::Vector) {
+      // lane `v[i]` is an element, shuffle `v[i, j, ...]` is a vector
+      TypeSymbol *element = static_cast<const Ts_Vector *>(array)->element;
+      if (e->index->kind() != +AstKind::Exprs) {
+        return element;
+      }
+      int lanes = 0;
+      for (A_Exprs *i = static_cast<A_Exprs *>(e->index); i; i = i->next) {
+        lanes++;
+      }
+      return TypeSymbol::ts_vector(element, lanes);
+    }
+    if (!array || array->kind() != +TypeSymbolKind::Array) {
+      return nullptr;
+    }
+    TypeSymbol *element = static_cast<const Ts_Array *>(array)->element;
+    // slice `a[i..j]` is an array
+    return e->index->kind() == +AstKind::Infix &&
+                   static_cast<A_Infix *>(e->index)->infixOp == T_DOT2
+               ? TypeSymbol::ts_array(element)
+               : element;
+  }
+  case AstKind::Postfix:
+    return resultType(static_cast<A_Postfix *>(ast)->expr);
+  case AstKind::Infix:
+    switch (static_cast<A_Infix *>(ast)->infixOp) {
+    case T_EQ:
+    case T_NEQ:
+    case T_GT:
+    case T_LT:
+    case T_GE:
+    case T_LE:
+    case T_BAR2:
+    case T_OR:
+    case T_AMPERSAND2:
+    case T_AND:
+      return TypeSymbol::ts_boolean();
+    default: {
+      // element operand is broadcast to vector operand
+      const TypeSymbol *right = resultType(static_cast<A_Infix *>(ast)->right);
+      return right && right->kind() == +TypeSymbolKind::Vector
+                 ? right
+                 : resultType(static_cast<A_Infix *>(ast)->left);
+    }
+    }
+  case AstKind::Prefix:
+    switch (static_cast<A_Prefix *>(ast)->prefixOp) {
+    case T_EXCLAM:
+    case T_NOT:
+      return TypeSymbol::ts_boolean();
+    case T_REDUCE: {
+      // `reduce(+ v)` is an element of vector v
+      Ast *reduction = static_cast<A_Prefix *>(ast)->expr;
+      if (reduction->kind() != +AstKind::Prefix) {
+        return nullptr;
+      }
+      const TypeSymbol *vector =
+          resultType(static_cast<A_Prefix *>(reduction)->expr);
+      return vector && vector->kind() == +TypeSymbolKind::Vector
+                 ? static_cast<const Ts_Vector *>(vector)->element
+                 : nullptr;
+    }
+    default:
+      return resultType(static_cast<A_Prefix *>(ast)->expr);
+    }
+  case AstKind::Call: {
+    Ast *id = static_cast<A_Call *>(ast)->id;
+    if (id->kind() != +AstKind::VarId) {
+      return nullptr;
+    }
+    Symbol *symbol = static_cast<A_VarId *>(id)->symbol();
+    if (!symbol || symbol->kind() != +SymbolKind::Func) {
+      return nullptr;
+    }
+    return static_cast<const Ts_Func *>(symbol->type())->result;
+  }
+  case AstKind::If: {
+    A_If *e = static_cast<A_If *>(ast);
+    return e->elsep ? resultType(e->thenp) : nullptr;
+  }
+  default:
+    return nullptr;
+  }
+}
+
+// call compiled expression and format its value
+template <typename T> Cowstr invoke(uint64_t address) {
+  return fmt::format("{}", reinterpret_cast<T (*)()>(address)());
+}
+
+Cowstr invoke(uint64_t address, const TypeSymbol *type) {
+  if (type == TypeSymbol::ts_byte() || type == TypeSymbol::ts_char()) {
+    return fmt::format("{}", (int)reinterpret_cast<int8_t (*)()>(address)());
+  } else if (type == TypeSymbol::ts_ubyte()) {
+    return fmt::format("{}", (int)reinterpret_cast<uint8_t (*)()>(address)());
+  } else if (type == TypeSymbol::ts_short()) {
+    return invoke<int16_t>(address);
+  } else if (type == TypeSymbol::ts_ushort()) {
+    return invoke<uint16_t>(address);
+  } else if (type == TypeSymbol::ts_int()) {
+    return invoke<int32_t>(address);
+  } else if (type == TypeSymbol::ts_uint()) {
+    return invoke<uint32_t>(address);
+  } else if (type == TypeSymbol::ts_long()) {
+    return invoke<int64_t>(address);
+  } else if (type == TypeSymbol::ts_ulong()) {
+    return invoke<uint64_t>(address);
+  } else if (type == TypeSymbol::ts_float()) {
+    return invoke<float>(address);
+  } else if (type == TypeSymbol::ts_double()) {
+    return invoke<double>(address);
+  } else if (type == TypeSymbol::ts_boolean()) {
+    return invoke<bool>(address);
+  }
+  reinterpret_cast<void (*)()>(address)();
+  return "";
+}
+
+// name defined by top-level definition
+const Cowstr &definedName(Ast *ast) {
+  if (ast->kind() == +AstKind::FuncDef) {
+    return static_cast<A_FuncDef *>(ast)->getId()->name();
+  }
+  LOG_ASSERT(ast->kind() == +AstKind::VarDef,
+             "ast {}:{} kind {} != AstKind::VarDef", ast->name(),
+             ast->location(), ast->kind()._to_string());
+  return static_cast<A_VarDef *>(ast)->id->name();
+}
+
+bool isDefinition(const Cowstr &input) {
+  std::string s = input.str();
+  size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    return false;
+  }
+  size_t end = s.find_first_of(" \t\r\n(", begin);
+  std::string word = s.substr(begin, end == std::string::npos
+                                         ? std::string::npos
+                                         : end - begin);
+  return word == "def" || word == "const" || word == "var" || word == "val";
+}
+
+} // namespace
+
+Repl::Repl() : jit_(nullptr), scope_(nullptr), inputs_(0), compiled_(0) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+  llvm::orc::LLLazyJITBuilder jitBuilder;
+  PerfMap::setup(jitBuilder);
+  llvm::Expected<std::unique_ptr<llvm::orc::LLLazyJIT>> jit =
+      jitBuilder.create();
+  LOG_ASSERT(jit, "cannot create JIT: {}", llvm::toString(jit.takeError()));
+  jit_ = std::move(*jit);
+  RuntimeSymbols::define(*jit_);
+
+  // each module reaching transform layer is a partition of lazy module,
+  // compiled at the first call of its function
+  jit_->getIRTransformLayer().setTransform(
+      [this](llvm::orc::ThreadSafeModule module, auto &) {
+        module.withModuleDo([this](llvm::Module &m) {
+          for (llvm::Function &f : m) {
+            if (!f.isDeclaration()) {
+              compiled_++;
+            }
+          }
+        });
+        return llvm::Expected<llvm::orc::ThreadSafeModule>(std::move(module));
+      });
+}
+
+Repl::~Repl() {
+  // compiled code is released before ast and symbols
+  jit_.reset();
+}
+
+Cowstr Repl::eval(const Cowstr &input) {
+  if (isDefinition(input)) {
+    define(input);
+    return "";
+  }
+  Cowstr name = nextName();
+  const TypeSymbol *type = typeOf(name, input);
+  if (!type) {
+    type = TypeSymbol::ts_void();
+  }
+  define(fmt::format("def {}():{} = {}", name, type->name(), input));
+
+  Symbol *symbol = scope_->s_resolve(name);
+  LOG_ASSERT(symbol, "function {} must be defined", name);
+  llvm::Expected<llvm::JITEvaluatedSymbol> function =
+      jit_->lookup(IrBuilder::linkName(symbol).str());
+  LOG_ASSERT(function, "cannot find function {}: {}", name,
+             llvm::toString(function.takeError()));
+  return invoke(function->getAddress(), type);
+}
+
+void Repl::run(std::istream &in, std::ostream &out) {
+  std::string input;
+  int braces = 0;
+  std::string line;
+  out << "dim> " << std::flush;
+  while (std::getline(in, line)) {
+    input = input.empty() ? line : input + "\n" + line;
+    braces += (int)std::count(line.begin(), line.end(), '{') -
+              (int)std::count(line.begin(), line.end(), '}');
+    if (braces > 0) {
+      out << "...> " << std::flush;
+      continue;
+    }
+    if (input.find_first_not_of(" \t\r\n") != std::string::npos) {
+      try {
+        Cowstr value = eval(input);
+        if (!value.empty()) {
+          out << value.str() << std::endl;
+        }
+      } catch (const Exception &e) {
+        out << e.message().str() << std::endl;
+      }
+    }
+    input.clear();
+    braces = 0;
+    out << "dim> " << std::flush;
+  }
+}
+
+int Repl::compiled() const { return compiled_; }
+
+void Repl::define(const Cowstr &source) {
+  std::unique_ptr<Scanner> scanner(
+      new Scanner(fmt::format("repl-{}", ++inputs_), source));
+  ASSERT(scanner->parse() == 0, "error: syntax error in {}\n", source);
+  A_CompileUnit *compileUnit =
+      static_cast<A_CompileUnit *>(scanner->compileUnit());
+  for (A_TopStats *e = compileUnit->topStats; e; e = e->next) {
+    const Cowstr &name = definedName(e->topStat);
+    ASSERT(!scope_ || !scope_->s_resolve(name),
+           "error: {} is already defined\n", name);
+  }
+
+  SymbolBuilder symbolBuilder(scope_);
+  SymbolResolver symbolResolver;
+  ConstantFolder constantFolder;
+  EscapeAnalysis escapeAnalysis;
+  IrBuilder irBuilder(false);
+  PhaseManager pm({&symbolBuilder, &symbolResolver, &constantFolder,
+                   &escapeAnalysis, &irBuilder});
+  pm.run(compileUnit);
+
+  std::unique_ptr<llvm::LLVMContext> context(new llvm::LLVMContext());
+  std::unique_ptr<llvm::Module> module = irBuilder.copyModule(*context);
+
+  // nested functions are local to this input, so their names never clash
+  // with other inputs
+  std::unordered_set<std::string> globals;
+  for (Scope::s_const_iterator it = compileUnit->scope()->s_cbegin();
+       it != compileUnit->scope()->s_cend(); ++it) {
+    globals.insert(IrBuilder::linkName(it->second).str());
+  }
+  for (llvm::Function &f : *module) {
+    if (!f.isDeclaration() && !globals.count(f.getName().str())) {
+      f.setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
+  }
+  std::string verifyError;
+  llvm::raw_string_ostream verifyOs(verifyError);
+  ASSERT(!llvm::verifyModule(*module, &verifyOs), "error: invalid input {}\n",
+         verifyOs.str());
+
+  module->setDataLayout(jit_->getDataLayout());
+  llvm::Error error = jit_->addLazyIRModule(
+      llvm::orc::ThreadSafeModule(std::move(module), std::move(context)));
+  if (error) {
+    LOG_ASSERT(false, "cannot add {} to JIT: {}", compileUnit->name(),
+               llvm::toString(std::move(error)));
+  }
+  scope_ = compileUnit->scope();
+  scanners_.push_back(std::move(scanner));
+}
+
+const TypeSymbol *Repl::typeOf(const Cowstr &name, const Cowstr &expr) {
+  Scanner scanner(fmt::format("repl-{}", inputs_ + 1),
+                  fmt::format("def {}():void = {}", name, expr));
+  ASSERT(scanner.parse() == 0, "error: syntax error in {}\n", expr);
+  SymbolBuilder symbolBuilder(scope_);
+  SymbolResolver symbolResolver;
+  PhaseManager pm({&symbolBuilder, &symbolResolver});
+  pm.run(scanner.compileUnit());
+  A_CompileUnit *compileUnit =
+      static_cast<A_CompileUnit *>(scanner.compileUnit());
+  return resultType(
+      static_cast<A_FuncDef *>(compileUnit->topStats->topStat)->body);
+}
+
+Cowstr Repl::nextName() {
+  for (int i = inputs_ + 1;; i++) {
+    Cowstr name = fmt::format("_repl{}", i);
+    if (!scope_ || !scope_->s_resolve(name)) {
+      return name;
+    }
+  }
+}
@@ -0,0 +1,60 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "Scanner.h"
+#include "SymbolClasses.h"
+#include "infra/Cowstr.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include <atomic>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/**
+ * Repl evaluates inputs one by one with a lazy ORC JIT, it's `dimc --repl`.
+ *
+ * Each input is a compile unit, its global scope is enclosed by the global
+ * scope of previous input, so it resolves global variables and functions
+ * defined before, see SymbolBuilder. It's lowered by IrBuilder, and added to
+ * JIT as a lazy module: function bodies are compiled at the first call through
+ * lazy reexports, so a long session only compiles the functions it runs.
+ *
+ * An input starting with `def`, `const`, `var` or `val` defines global
+ * variables and functions, names cannot be defined twice. Other input is an
+ * expression, it's wrapped into a function and called, its value is printed.
+ *
+ * An input which fails to compile is dropped, its definitions are not visible
+ * to later inputs.
+ */
+class Repl {
+public:
+  Repl();
+  virtual ~Repl();
+
+  // evaluate one input, returns value of expression, or empty for definitions
+  // and void expression, throws Exception if input fails to compile
+  Cowstr eval(const Cowstr &input);
+  // read and evaluate inputs until end of `in`, an input with open braces
+  // continues on next lines
+  void run(std::istream &in, std::ostream &out);
+
+  // functions compiled by JIT
+  int compiled() const;
+
+private:
+  // compile definitions and add them to JIT
+  void define(const Cowstr &source);
+  // result type of expression, resolved in a void function
+  const TypeSymbol *typeOf(const Cowstr &name, const Cowstr &expr);
+  Cowstr nextName();
+
+  std::unique_ptr<llvm::orc::LLLazyJIT> jit_;
+  // ast and symbols of inputs are alive during the session
+  std::vector<std::unique_ptr<Scanner>> scanners_;
+  // global scope of last input
+  Scope *scope_;
+  int inputs_;
+  std::atomic<int> compiled_;
+};
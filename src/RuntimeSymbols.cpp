@@ -0,0 +1,44 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "RuntimeSymbols.h"
+#include "infra/Log.h"
+#include "llvm/ExecutionEngine/JITSymbol.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/Mangling.h"
+#include "llvm/Support/Error.h"
+#include "rt/Runtime.h"
+
+#define RUNTIME_SYMBOL(f)                                                      \
+  symbols[mangle(#f)] = llvm::JITEvaluatedSymbol(                              \
+      llvm::pointerToJITTargetAddress(&f), llvm::JITSymbolFlags::Exported)
+
+void RuntimeSymbols::define(llvm::orc::LLJIT &jit) {
+  llvm::orc::MangleAndInterner mangle(jit.getExecutionSession(),
+                                      jit.getDataLayout());
+  llvm::orc::SymbolMap symbols;
+  RUNTIME_SYMBOL(dimrt_alloc);
+  RUNTIME_SYMBOL(dimrt_free);
+  RUNTIME_SYMBOL(dimrt_bounds);
+  RUNTIME_SYMBOL(dimrt_region_begin);
+  RUNTIME_SYMBOL(dimrt_region_alloc);
+  RUNTIME_SYMBOL(dimrt_region_end);
+  RUNTIME_SYMBOL(dimrt_task_init);
+  RUNTIME_SYMBOL(dimrt_task_spawn);
+  RUNTIME_SYMBOL(dimrt_task_join);
+  RUNTIME_SYMBOL(dimrt_task_wait);
+  RUNTIME_SYMBOL(dimrt_task_complete);
+  RUNTIME_SYMBOL(dimrt_parallel_for);
+  RUNTIME_SYMBOL(dimrt_reduce_add);
+  RUNTIME_SYMBOL(dimrt_reduce_min);
+  RUNTIME_SYMBOL(dimrt_reduce_max);
+  RUNTIME_SYMBOL(dimrt_throw);
+  RUNTIME_SYMBOL(dimrt_catch);
+  RUNTIME_SYMBOL(dimrt_personality);
+  llvm::Error error = jit.getMainJITDylib().define(
+      llvm::orc::absoluteSymbols(std::move(symbols)));
+  if (error) {
+    LOG_ASSERT(false, "cannot define runtime symbols: {}",
+               llvm::toString(std::move(error)));
+  }
+}
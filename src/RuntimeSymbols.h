@@ -0,0 +1,15 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+/**
+ * RuntimeSymbols defines functions of runtime library (see rt/Runtime.h) in
+ * the main dylib of JIT, so code lowered by IrBuilder can call them without
+ * searching symbols of host process.
+ */
+class RuntimeSymbols {
+public:
+  static void define(llvm::orc::LLJIT &jit);
+};
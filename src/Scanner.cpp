@@ -25,6 +25,21 @@ Scanner::Scanner(const Cowstr &fileName)
   yyset_lineno(1, yyscanner_);
 }
 
+Scanner::Scanner(const Cowstr &fileName, const Cowstr &source)
+    : fileName_(fileName), yyBufferState_(nullptr), fp_(nullptr),
+      yyscanner_(nullptr), compileUnit_(nullptr) {
+  // init scanner
+  int r = yylex_init_extra(this, &yyscanner_);
+  LOG_ASSERT(r == 0, "lexer initialize fail with code {}", r);
+  LOG_ASSERT(yyscanner_, "yyscanner_ must not null");
+
+  // init buffer, source is copied
+  yyBufferState_ = yy_scan_bytes(source.rawstr(), source.length(), yyscanner_);
+  LOG_ASSERT(yyBufferState_, "lexer buffer state creation fail with source {}",
+             fileName_);
+  yyset_lineno(1, yyscanner_);
+}
+
 Scanner::~Scanner() {
   if (yyBufferState_) {
     yy_delete_buffer(yyBufferState_, yyscanner_);
@@ -17,6 +17,8 @@ class Ast;
 class Scanner {
 public:
   Scanner(const Cowstr &fileName);
+  // scan source text in memory, `fileName` names it in locations and errors
+  Scanner(const Cowstr &fileName, const Cowstr &source);
   virtual ~Scanner();
 
   // attributes
@@ -0,0 +1,120 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "SsaBuilder.h"
+#include "infra/Log.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+
+SsaBuilder::SsaBuilder() {}
+
+void SsaBuilder::writeVariable(const Symbol *variable, llvm::BasicBlock *block,
+                               llvm::Value *value) {
+  currentDef_[block][variable] = value;
+}
+
+llvm::Value *SsaBuilder::readVariable(const Symbol *variable, llvm::Type *type,
+                                      llvm::BasicBlock *block) {
+  auto defs = currentDef_.find(block);
+  if (defs != currentDef_.end()) {
+    auto it = defs->second.find(variable);
+    if (it != defs->second.end() && it->second) {
+      return it->second;
+    }
+  }
+  return readVariableRecursive(variable, type, block);
+}
+
+void SsaBuilder::sealBlock(llvm::BasicBlock *block) {
+  LOG_ASSERT(!sealed(block), "block {} already sealed",
+             block->getName().str());
+  auto it = incompletePhis_.find(block);
+  if (it != incompletePhis_.end()) {
+    std::vector<std::pair<const Symbol *, llvm::PHINode *>> phis;
+    phis.swap(it->second);
+    incompletePhis_.erase(it);
+    for (int i = 0; i < (int)phis.size(); i++) {
+      addPhiOperands(phis[i].first, phis[i].second);
+    }
+  }
+  sealed_.insert(block);
+}
+
+bool SsaBuilder::sealed(llvm::BasicBlock *block) const {
+  return sealed_.find(block) != sealed_.end();
+}
+
+llvm::Value *SsaBuilder::readVariableRecursive(const Symbol *variable,
+                                               llvm::Type *type,
+                                               llvm::BasicBlock *block) {
+  llvm::Value *value = nullptr;
+  if (!sealed(block)) {
+    // incomplete phi, operands are added when block is sealed
+    llvm::PHINode *phi = newPhi(type, block);
+    incompletePhis_[block].push_back(std::make_pair(variable, phi));
+    value = phi;
+  } else if (llvm::pred_empty(block)) {
+    // unreachable block
+    value = llvm::UndefValue::get(type);
+  } else if (block->getSinglePredecessor()) {
+    // no phi needed
+    value = readVariable(variable, type, block->getSinglePredecessor());
+  } else {
+    // break potential cycles with operandless phi
+    llvm::PHINode *phi = newPhi(type, block);
+    writeVariable(variable, block, phi);
+    value = addPhiOperands(variable, phi);
+  }
+  writeVariable(variable, block, value);
+  return value;
+}
+
+llvm::Value *SsaBuilder::addPhiOperands(const Symbol *variable,
+                                        llvm::PHINode *phi) {
+  llvm::BasicBlock *block = phi->getParent();
+  for (llvm::BasicBlock *pred : llvm::predecessors(block)) {
+    phi->addIncoming(readVariable(variable, phi->getType(), pred), pred);
+  }
+  return tryRemoveTrivialPhi(phi);
+}
+
+llvm::Value *SsaBuilder::tryRemoveTrivialPhi(llvm::PHINode *phi) {
+  llvm::Value *same = nullptr;
+  for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+    llvm::Value *op = phi->getIncomingValue(i);
+    if (op == same || op == phi) {
+      continue;
+    }
+    if (same) {
+      // merges at least two values
+      return phi;
+    }
+    same = op;
+  }
+  if (!same) {
+    // unreachable or in start block
+    same = llvm::UndefValue::get(phi->getType());
+  }
+
+  // other phi users may become trivial after replacement
+  std::vector<llvm::WeakVH> users;
+  for (llvm::User *user : phi->users()) {
+    if (user != phi && llvm::isa<llvm::PHINode>(user)) {
+      users.push_back(llvm::WeakVH(user));
+    }
+  }
+  phi->replaceAllUsesWith(same);
+  phi->eraseFromParent();
+  for (int i = 0; i < (int)users.size(); i++) {
+    if (users[i]) {
+      tryRemoveTrivialPhi(llvm::cast<llvm::PHINode>(users[i]));
+    }
+  }
+  return same;
+}
+
+llvm::PHINode *SsaBuilder::newPhi(llvm::Type *type, llvm::BasicBlock *block) {
+  // phi nodes are at beginning of block
+  return block->empty() ? llvm::PHINode::Create(type, 0, "", block)
+                        : llvm::PHINode::Create(type, 0, "", &block->front());
+}
@@ -0,0 +1,60 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "SymbolClasses.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Type.h"
+#include "llvm/IR/Value.h"
+#include "llvm/IR/ValueHandle.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * SsaBuilder constructs SSA form of local variables while IrBuilder lowers
+ * them, phi nodes are placed on the fly (Braun et al. 2013, Simple and
+ * Efficient Construction of Static Single Assignment Form).
+ *
+ * A variable is defined in a basic block by `writeVariable`, and read by
+ * `readVariable`. When a block doesn't define the variable, its value is
+ * looked up in predecessors, and a phi node is inserted if predecessors
+ * disagree.
+ *
+ * A block is sealed when all its predecessors are known. Reading from an
+ * unsealed block (for example a loop header before its back edge is created)
+ * inserts an incomplete phi, which is completed when the block is sealed.
+ * Trivial phi (all operands are same value or itself) is removed.
+ */
+class SsaBuilder {
+public:
+  SsaBuilder();
+  virtual ~SsaBuilder() = default;
+
+  void writeVariable(const Symbol *variable, llvm::BasicBlock *block,
+                     llvm::Value *value);
+  llvm::Value *readVariable(const Symbol *variable, llvm::Type *type,
+                            llvm::BasicBlock *block);
+
+  // all predecessors of block are known
+  void sealBlock(llvm::BasicBlock *block);
+  bool sealed(llvm::BasicBlock *block) const;
+
+private:
+  llvm::Value *readVariableRecursive(const Symbol *variable, llvm::Type *type,
+                                     llvm::BasicBlock *block);
+  llvm::Value *addPhiOperands(const Symbol *variable, llvm::PHINode *phi);
+  llvm::Value *tryRemoveTrivialPhi(llvm::PHINode *phi);
+  llvm::PHINode *newPhi(llvm::Type *type, llvm::BasicBlock *block);
+
+  // value follows phi replacement
+  std::unordered_map<llvm::BasicBlock *,
+                     std::unordered_map<const Symbol *, llvm::WeakTrackingVH>>
+      currentDef_;
+  std::unordered_map<llvm::BasicBlock *,
+                     std::vector<std::pair<const Symbol *, llvm::PHINode *>>>
+      incompletePhis_;
+  std::unordered_set<llvm::BasicBlock *> sealed_;
+};
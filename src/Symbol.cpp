@@ -5,9 +5,13 @@
 #include "Ast.h"
 #include "iface/Locationable.h"
 #include "iface/Nameable.h"
-#include "infra/LinkedHashMap.hpp"
+#include "infra/FlatMap.hpp"
+#include "infra/Interner.h"
 #include "infra/Log.h"
 #include <algorithm>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 
 #define SYMBOL_CONSTRUCTOR                                                     \
   Nameable(name), Locationable(location), detail::Ownable(owner), Symbol(type)
@@ -68,21 +72,29 @@ ScopeImpl::~ScopeImpl() {
 
 void ScopeImpl::s_define(Symbol *symbol) {
   LOG_ASSERT(symbol, "symbol must not null");
-  LOG_ASSERT(s_data_.find(symbol->name()) == s_data_.end(),
-             "symbol {} already exist", symbol->name());
-  s_data_.insert(symbol->name(), symbol);
+  int id = Interner::intern(symbol->name());
+  LOG_ASSERT(!s_index_.contains(id), "symbol {} already exist",
+             symbol->name());
+  s_data_.push_back(std::make_pair(symbol->name(), symbol));
+  s_index_.insert(id, symbol);
 }
 
 Symbol *ScopeImpl::s_resolve(const Cowstr &name) const {
-  s_const_iterator it = s_data_.find(name);
-  if (it != s_data_.end()) {
-    return it->second;
+  int id = Interner::find(name);
+  return id < 0 ? nullptr : s_resolve(id);
+}
+
+Symbol *ScopeImpl::s_resolve(int nameId) const {
+  Symbol *sym = s_index_.find(nameId);
+  if (sym) {
+    return sym;
   }
-  return owner() ? owner()->s_resolve(name) : nullptr;
+  return owner() ? owner()->s_resolve(nameId) : nullptr;
 }
 
 bool ScopeImpl::s_contains(const Cowstr &name) const {
-  return s_data_.find(name) != s_data_.end();
+  int id = Interner::find(name);
+  return id >= 0 && s_index_.contains(id);
 }
 
 bool ScopeImpl::s_empty() const { return s_data_.empty(); }
@@ -107,21 +119,29 @@ Scope::s_const_iterator ScopeImpl::s_cend() const { return s_data_.end(); }
 
 void ScopeImpl::ts_define(TypeSymbol *symbol) {
   LOG_ASSERT(symbol, "symbol must not null");
-  LOG_ASSERT(ts_data_.find(symbol->name()) == ts_data_.end(),
-             "symbol {} already exist", symbol->name());
-  ts_data_.insert(symbol->name(), symbol);
+  int id = Interner::intern(symbol->name());
+  LOG_ASSERT(!ts_index_.contains(id), "symbol {} already exist",
+             symbol->name());
+  ts_data_.push_back(std::make_pair(symbol->name(), symbol));
+  ts_index_.insert(id, symbol);
 }
 
 TypeSymbol *ScopeImpl::ts_resolve(const Cowstr &name) const {
-  ts_const_iterator it = ts_data_.find(name);
-  if (it != ts_data_.end()) {
-    return it->second;
+  int id = Interner::find(name);
+  return id < 0 ? nullptr : ts_resolve(id);
+}
+
+TypeSymbol *ScopeImpl::ts_resolve(int nameId) const {
+  TypeSymbol *sym = ts_index_.find(nameId);
+  if (sym) {
+    return sym;
   }
-  return owner() ? owner()->ts_resolve(name) : nullptr;
+  return owner() ? owner()->ts_resolve(nameId) : nullptr;
 }
 
 bool ScopeImpl::ts_contains(const Cowstr &name) const {
-  return ts_data_.find(name) != ts_data_.end();
+  int id = Interner::find(name);
+  return id >= 0 && ts_index_.contains(id);
 }
 
 bool ScopeImpl::ts_empty() const { return ts_data_.empty(); }
@@ -150,18 +170,21 @@ Scope::ts_const_iterator ScopeImpl::ts_cend() const { return ts_data_.cend(); }
 
 void ScopeImpl::sc_define(Scope *scope) {
   LOG_ASSERT(scope, "scope must not null");
-  LOG_ASSERT(!sc_data_.contains(scope->name()), "scope already exist: {}",
+  int id = Interner::intern(scope->name());
+  LOG_ASSERT(!sc_index_.contains(id), "scope already exist: {}",
              scope->name());
-  sc_data_.insert(scope->name(), scope);
+  sc_data_.push_back(std::make_pair(scope->name(), scope));
+  sc_index_.insert(id, scope);
 }
 
 Scope *ScopeImpl::sc_resolve(const Cowstr &name) const {
-  auto it = sc_data_.find(name);
-  return it == sc_data_.end() ? nullptr : it->second;
+  int id = Interner::find(name);
+  return id < 0 ? nullptr : sc_index_.find(id);
 }
 
 bool ScopeImpl::sc_contains(const Cowstr &name) const {
-  return sc_data_.find(name) != sc_data_.end();
+  int id = Interner::find(name);
+  return id >= 0 && sc_index_.contains(id);
 }
 
 bool ScopeImpl::sc_empty() const { return sc_data_.empty(); }
@@ -271,6 +294,32 @@ TypeSymbol *TypeSymbol::ts_void() {
   return ts;
 }
 
+TypeSymbol *TypeSymbol::ts_array(TypeSymbol *element, int64_t length) {
+  LOG_ASSERT(element, "element must not null");
+  static std::mutex lock;
+  static std::map<std::pair<TypeSymbol *, int64_t>, TypeSymbol *> arrays;
+  length = std::max<int64_t>(length, -1);
+  std::lock_guard<std::mutex> guard(lock);
+  TypeSymbol *&ts = arrays[std::make_pair(element, length)];
+  if (!ts) {
+    ts = new Ts_Array(element, length);
+  }
+  return ts;
+}
+
+TypeSymbol *TypeSymbol::ts_vector(TypeSymbol *element, int lanes) {
+  LOG_ASSERT(element, "element must not null");
+  LOG_ASSERT(lanes > 0, "lanes {} > 0", lanes);
+  static std::mutex lock;
+  static std::map<std::pair<TypeSymbol *, int>, TypeSymbol *> vectors;
+  std::lock_guard<std::mutex> guard(lock);
+  TypeSymbol *&ts = vectors[std::make_pair(element, lanes)];
+  if (!ts) {
+    ts = new Ts_Vector(element, lanes);
+  }
+  return ts;
+}
+
 // TypeSymbol {
 
 // scope {
@@ -345,10 +394,24 @@ Ts_Func::Ts_Func(const std::vector<TypeSymbol *> &a_params,
                  TypeSymbol *a_result, const Location &location, Scope *owner)
     : Nameable(createFunctionName(a_params, a_result)),
       Locationable(location), detail::Ownable(owner), params(a_params),
-      result(a_result) {}
+      result(a_result), generator(false), async(false) {}
 
 TypeSymbolKind Ts_Func::kind() const { return TypeSymbolKind::Func; }
 
+Ts_Array::Ts_Array(TypeSymbol *a_element, int64_t a_length)
+    : Nameable(a_element->name() + "[" +
+               (a_length < 0 ? Cowstr() : Cowstr::from(a_length)) + "]"),
+      Locationable(), detail::Ownable(nullptr), element(a_element),
+      length(std::max<int64_t>(a_length, -1)) {}
+
+TypeSymbolKind Ts_Array::kind() const { return TypeSymbolKind::Array; }
+
+Ts_Vector::Ts_Vector(TypeSymbol *a_element, int a_lanes)
+    : Nameable(a_element->name() + Cowstr::from(a_lanes)), Locationable(),
+      detail::Ownable(nullptr), element(a_element), lanes(a_lanes) {}
+
+TypeSymbolKind Ts_Vector::kind() const { return TypeSymbolKind::Vector; }
+
 // type symbol }
 
 // scope {
@@ -9,11 +9,14 @@
 #include "iface/Identifiable.h"
 #include "iface/Locationable.h"
 #include "iface/Nameable.h"
-#include "infra/LinkedHashMap.h"
+#include "iface/Slotable.h"
+#include "infra/FlatMap.h"
 #include "infra/Log.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Value.h"
 #include <functional>
+#include <utility>
+#include <vector>
 
 BETTER_ENUM(SymbolKind, int,
             // symbol
@@ -31,7 +34,11 @@ BETTER_ENUM(TypeSymbolKind, int,
             // function
             Func,
             // class
-            Class)
+            Class,
+            // array
+            Array,
+            // simd vector
+            Vector)
 
 BETTER_ENUM(ScopeKind, int, Symbol = 4000, TypeSymbol, LocalScope, GlobalScope)
 
@@ -89,6 +96,7 @@ class Symbol : public virtual Nameable,
                public virtual detail::Ownable,
                public virtual detail::Astable,
                public detail::Typeable,
+               public Slotable,
                private boost::noncopyable {
 public:
   Symbol(TypeSymbol *type = nullptr);
@@ -122,6 +130,12 @@ public:
   static TypeSymbol *ts_char();
   static TypeSymbol *ts_boolean();
   static TypeSymbol *ts_void();
+  // `T[]`, or `T[N]` if length is not negative, the same element and length
+  // get the same array type
+  static TypeSymbol *ts_array(TypeSymbol *element, int64_t length = -1);
+  // vector of lanes plain elements, e.g. `float4`, the same element and lanes
+  // get the same vector type
+  static TypeSymbol *ts_vector(TypeSymbol *element, int lanes);
 };
 
 class Scope : public virtual Nameable,
@@ -131,15 +145,16 @@ class Scope : public virtual Nameable,
               public virtual detail::Astable,
               private boost::noncopyable {
 public:
-  using s_map = LinkedHashMap<Cowstr, Symbol *>;
-  using s_iterator = s_map::iterator;
-  using s_const_iterator = s_map::const_iterator;
-  using ts_map = LinkedHashMap<Cowstr, TypeSymbol *>;
-  using ts_iterator = ts_map::iterator;
-  using ts_const_iterator = ts_map::const_iterator;
-  using scope_map = LinkedHashMap<Cowstr, Scope *>;
-  using sc_iterator = scope_map::iterator;
-  using sc_const_iterator = scope_map::const_iterator;
+  // symbols in defined order, lookup goes through interned name id
+  using s_list = std::vector<std::pair<Cowstr, Symbol *>>;
+  using s_iterator = s_list::iterator;
+  using s_const_iterator = s_list::const_iterator;
+  using ts_list = std::vector<std::pair<Cowstr, TypeSymbol *>>;
+  using ts_iterator = ts_list::iterator;
+  using ts_const_iterator = ts_list::const_iterator;
+  using scope_list = std::vector<std::pair<Cowstr, Scope *>>;
+  using sc_iterator = scope_list::iterator;
+  using sc_const_iterator = scope_list::const_iterator;
 
   virtual ~Scope() = default;
   virtual ScopeKind sc_kind() const = 0;
@@ -149,6 +164,8 @@ public:
    */
   virtual void s_define(Symbol *symbol) = 0;
   virtual Symbol *s_resolve(const Cowstr &name) const = 0;
+  // resolve with interned name id, see Interner
+  virtual Symbol *s_resolve(int nameId) const = 0;
   virtual bool s_contains(const Cowstr &name) const = 0;
   virtual bool s_empty() const = 0;
   virtual int s_size() const = 0;
@@ -164,6 +181,8 @@ public:
    */
   virtual void ts_define(TypeSymbol *symbol) = 0;
   virtual TypeSymbol *ts_resolve(const Cowstr &name) const = 0;
+  // resolve with interned name id, see Interner
+  virtual TypeSymbol *ts_resolve(int nameId) const = 0;
   virtual bool ts_contains(const Cowstr &name) const = 0;
   virtual bool ts_empty() const = 0;
   virtual int ts_size() const = 0;
@@ -202,6 +221,7 @@ public:
    */
   virtual void s_define(Symbol *symbol);
   virtual Symbol *s_resolve(const Cowstr &name) const;
+  virtual Symbol *s_resolve(int nameId) const;
   virtual bool s_contains(const Cowstr &name) const;
   virtual bool s_empty() const;
   virtual int s_size() const;
@@ -217,6 +237,7 @@ public:
    */
   virtual void ts_define(TypeSymbol *symbol);
   virtual TypeSymbol *ts_resolve(const Cowstr &name) const;
+  virtual TypeSymbol *ts_resolve(int nameId) const;
   virtual bool ts_contains(const Cowstr &name) const;
   virtual bool ts_empty() const;
   virtual int ts_size() const;
@@ -243,9 +264,13 @@ public:
   virtual sc_const_iterator sc_cend() const;
 
 protected:
-  s_map s_data_;
-  ts_map ts_data_;
-  scope_map sc_data_;
+  s_list s_data_;
+  ts_list ts_data_;
+  scope_list sc_data_;
+  // interned name id => symbol/type symbol/scope
+  FlatMap<Symbol *> s_index_;
+  FlatMap<TypeSymbol *> ts_index_;
+  FlatMap<Scope *> sc_index_;
 };
 
 } // namespace detail
@@ -337,6 +362,46 @@ public:
 
   std::vector<TypeSymbol *> params;
   TypeSymbol *result;
+  // function body has `yield`, its call is a generator of `result`
+  bool generator;
+  // defined by `async def`, its call is a task awaited by `await`
+  bool async;
+};
+
+/**
+ * array type `T[]`, a heap allocated array of `T` created by `new T[n]`, or a
+ * slice `a[i..j]` of another array.
+ *
+ * `T[N]` is an array whose length N is known at compile time, it has the same
+ * representation as `T[]`, so it's passed as `T[]` freely, but only an array
+ * of length N can be stored to it.
+ */
+class Ts_Array : public TypeSymbol {
+public:
+  Ts_Array(TypeSymbol *a_element, int64_t a_length = -1);
+  virtual ~Ts_Array() = default;
+  virtual TypeSymbolKind kind() const;
+
+  TypeSymbol *element;
+  // -1 for `T[]`
+  int64_t length;
+};
+
+/**
+ * simd vector type, named by element and number of lanes:
+ *  byte16, short8, int4, int8, long2, long4, float4, float8, double2, double4
+ *
+ * it's a value like plain type, arithmetic of two vectors, or of a vector and
+ * an element, is elementwise.
+ */
+class Ts_Vector : public TypeSymbol {
+public:
+  Ts_Vector(TypeSymbol *a_element, int a_lanes);
+  virtual ~Ts_Vector() = default;
+  virtual TypeSymbolKind kind() const;
+
+  TypeSymbol *element;
+  int lanes;
 };
 
 // type symbol }
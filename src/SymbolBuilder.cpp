@@ -9,12 +9,64 @@
 
 static NameGenerator SymbolNG(".");
 
-SymbolBuilder::SymbolBuilder()
-    : Phase("SymbolBuilder"), currentScope_(nullptr) {}
+SymbolBuilder::SymbolBuilder(Scope *scope)
+    : FusiblePhase("SymbolBuilder", PhaseOrder::PrePostOrder,
+                   {AstKind::Loop, AstKind::LoopEnumerator, AstKind::Block,
+                    AstKind::Param, AstKind::FuncDef, AstKind::VarDef,
+                    AstKind::Yield, AstKind::CompileUnit}),
+      enclosingScope_(scope), currentScope_(nullptr) {}
+
+void SymbolBuilder::enter(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::Loop:
+    enterLoop(static_cast<A_Loop *>(ast));
+    break;
+  case AstKind::LoopEnumerator:
+    enterLoopEnumerator(static_cast<A_LoopEnumerator *>(ast));
+    break;
+  case AstKind::Block:
+    enterBlock(static_cast<A_Block *>(ast));
+    break;
+  case AstKind::Param:
+    enterParam(static_cast<A_Param *>(ast));
+    break;
+  case AstKind::FuncDef:
+    enterFuncDef(static_cast<A_FuncDef *>(ast));
+    break;
+  case AstKind::VarDef:
+    enterVarDef(static_cast<A_VarDef *>(ast));
+    break;
+  case AstKind::Yield:
+    enterYield(static_cast<A_Yield *>(ast));
+    break;
+  case AstKind::CompileUnit:
+    enterCompileUnit(static_cast<A_CompileUnit *>(ast));
+    break;
+  default:
+    break;
+  }
+}
 
-void SymbolBuilder::run(Ast *ast) { ast->accept(this); }
+void SymbolBuilder::leave(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::Loop:
+  case AstKind::Block:
+  case AstKind::FuncDef:
+    // update scope
+    currentScope_ = currentScope_->owner();
+    break;
+  case AstKind::CompileUnit:
+    currentScope_ = currentScope_->owner();
+    LOG_ASSERT(currentScope_ == enclosingScope_,
+               "currentScope_ must be enclosing scope of {}:{}", ast->name(),
+               ast->location());
+    break;
+  default:
+    break;
+  }
+}
 
-void SymbolBuilder::visitLoop(A_Loop *ast) {
+void SymbolBuilder::enterLoop(A_Loop *ast) {
   // scope
   Sc_Local *sc_loop =
       new Sc_Local(SymbolNG.generate("loop", ast->location().str()),
@@ -25,22 +77,15 @@ void SymbolBuilder::visitLoop(A_Loop *ast) {
 
   // update scope
   currentScope_ = sc_loop;
-
-  ast->condition->accept(this);
-  ast->body->accept(this);
-
-  // update scope
-  currentScope_ = currentScope_->owner();
 }
 
-void SymbolBuilder::visitLoopEnumerator(A_LoopEnumerator *ast) {
+void SymbolBuilder::enterLoopEnumerator(A_LoopEnumerator *ast) {
   A_VarId *varId = static_cast<A_VarId *>(ast->id);
-  A_PlainType *varType = static_cast<A_PlainType *>(ast->type);
 
   // type symbol
-  TypeSymbol *ts_var = currentScope_->ts_resolve(varType->name());
+  TypeSymbol *ts_var = resolveType(ast->type);
   LOG_ASSERT(ts_var, "variable type symbol {}:{} must not null",
-             varType->name(), varType->location());
+             ast->type->name(), ast->type->location());
 
   // symbol
   S_Var *s_var =
@@ -50,10 +95,11 @@ void SymbolBuilder::visitLoopEnumerator(A_LoopEnumerator *ast) {
   currentScope_->s_define(s_var);
 }
 
-void SymbolBuilder::visitBlock(A_Block *ast) {
+void SymbolBuilder::enterBlock(A_Block *ast) {
   // scope
   Sc_Local *sc_block =
-      new Sc_Local(SymbolNG.generate("block", ast->location().str()),
+      new Sc_Local(SymbolNG.generate(ast->region ? "region" : "block",
+                                     ast->location().str()),
                    ast->location(), currentScope_);
   sc_block->ast() = ast;
   ast->scope() = sc_block;
@@ -61,23 +107,15 @@ void SymbolBuilder::visitBlock(A_Block *ast) {
 
   // update scope
   currentScope_ = sc_block;
-
-  if (ast->blockStats) {
-    ast->blockStats->accept(this);
-  }
-
-  // update scope
-  currentScope_ = currentScope_->owner();
 }
 
-void SymbolBuilder::visitVarDef(A_VarDef *ast) {
+void SymbolBuilder::enterVarDef(A_VarDef *ast) {
   A_VarId *varId = static_cast<A_VarId *>(ast->id);
-  A_PlainType *varType = static_cast<A_PlainType *>(ast->type);
 
   // type symbol
-  TypeSymbol *ts_var = currentScope_->ts_resolve(varType->name());
+  TypeSymbol *ts_var = resolveType(ast->type);
   LOG_ASSERT(ts_var, "variable type symbol {}:{} must not null",
-             varType->name(), varType->location());
+             ast->type->name(), ast->type->location());
 
   // symbol
   S_Var *s_var =
@@ -87,13 +125,11 @@ void SymbolBuilder::visitVarDef(A_VarDef *ast) {
   currentScope_->s_define(s_var);
 }
 
-void SymbolBuilder::visitParam(A_Param *ast) {
+void SymbolBuilder::enterParam(A_Param *ast) {
   A_VarId *paramId = static_cast<A_VarId *>(ast->id);
-  A_PlainType *paramType = static_cast<A_PlainType *>(ast->type);
-
-  TypeSymbol *ts_param = currentScope_->ts_resolve(paramType->name());
-  LOG_ASSERT(ts_param, "paramType {}:{} must not null", paramType->name(),
-             paramType->location());
+  TypeSymbol *ts_param = resolveType(ast->type);
+  LOG_ASSERT(ts_param, "paramType {}:{} must not null", ast->type->name(),
+             ast->type->location());
 
   S_Param *s_param = new S_Param(paramId->name(), paramId->location(),
                                  currentScope_, ts_param);
@@ -109,25 +145,24 @@ void SymbolBuilder::visitParam(A_Param *ast) {
   s_func->params.push_back(s_param);
 }
 
-void SymbolBuilder::visitFuncDef(A_FuncDef *ast) {
+void SymbolBuilder::enterFuncDef(A_FuncDef *ast) {
   A_VarId *funcId = static_cast<A_VarId *>(ast->getId());
   std::vector<std::pair<Ast *, Ast *>> funcArgs = ast->getArguments();
-  A_PlainType *funcResultType = static_cast<A_PlainType *>(ast->resultType);
 
   // parameter types
   std::vector<TypeSymbol *> ts_params;
   for (int i = 0; i < (int)funcArgs.size(); i++) {
-    A_PlainType *argType = static_cast<A_PlainType *>(funcArgs[i].second);
-    TypeSymbol *ts_param = currentScope_->ts_resolve(argType->name());
+    TypeSymbol *ts_param = resolveType(funcArgs[i].second);
     ts_params.push_back(ts_param);
   }
 
   // result type
-  TypeSymbol *ts_result = currentScope_->ts_resolve(funcResultType->name());
+  TypeSymbol *ts_result = resolveType(ast->resultType);
 
   // symbol
   Ts_Func *ts_func =
       new Ts_Func(ts_params, ts_result, funcId->location(), currentScope_);
+  ts_func->async = ast->async;
   S_Func *s_func =
       new S_Func(funcId->name(), funcId->location(), currentScope_, ts_func);
   s_func->ast() = funcId;
@@ -136,15 +171,20 @@ void SymbolBuilder::visitFuncDef(A_FuncDef *ast) {
 
   // update scope
   currentScope_ = s_func;
+}
 
-  ast->funcSign->accept(this);
-  ast->body->accept(this);
-
-  // update scope
-  currentScope_ = currentScope_->owner();
+void SymbolBuilder::enterYield(A_Yield *ast) {
+  // enclosing function is a generator
+  for (Scope *scope = currentScope_; scope; scope = scope->owner()) {
+    Symbol *sym = dynamic_cast<Symbol *>(scope);
+    if (sym && sym->kind() == +SymbolKind::Func) {
+      static_cast<Ts_Func *>(sym->type())->generator = true;
+      return;
+    }
+  }
 }
 
-void SymbolBuilder::visitCompileUnit(A_CompileUnit *ast) {
+void SymbolBuilder::enterCompileUnit(A_CompileUnit *ast) {
   // scope
   Sc_Global *sc_global = new Sc_Global("global", ast->location());
   sc_global->ts_define(TypeSymbol::ts_byte());
@@ -160,18 +200,30 @@ void SymbolBuilder::visitCompileUnit(A_CompileUnit *ast) {
   sc_global->ts_define(TypeSymbol::ts_char());
   sc_global->ts_define(TypeSymbol::ts_boolean());
   sc_global->ts_define(TypeSymbol::ts_void());
+  // simd vectors of 128 and 256 bits, named like `float4`
+  const std::pair<TypeSymbol *, int> vectors[] = {
+      {TypeSymbol::ts_byte(), 16},  {TypeSymbol::ts_short(), 8},
+      {TypeSymbol::ts_int(), 4},    {TypeSymbol::ts_int(), 8},
+      {TypeSymbol::ts_long(), 2},   {TypeSymbol::ts_long(), 4},
+      {TypeSymbol::ts_float(), 4},  {TypeSymbol::ts_float(), 8},
+      {TypeSymbol::ts_double(), 2}, {TypeSymbol::ts_double(), 4}};
+  for (const std::pair<TypeSymbol *, int> &v : vectors) {
+    sc_global->ts_define(TypeSymbol::ts_vector(v.first, v.second));
+  }
 
+  sc_global->owner() = enclosingScope_;
   sc_global->ast() = ast;
   ast->scope() = sc_global;
 
   // new scope
   currentScope_ = sc_global;
+}
 
-  if (ast->topStats) {
-    ast->topStats->accept(this);
+TypeSymbol *SymbolBuilder::resolveType(Ast *type) {
+  if (type->kind() == +AstKind::ArrayType) {
+    A_ArrayType *e = static_cast<A_ArrayType *>(type);
+    TypeSymbol *element = resolveType(e->elementType);
+    return element ? TypeSymbol::ts_array(element, e->length) : nullptr;
   }
-
-  currentScope_ = currentScope_->owner();
-  LOG_ASSERT(!currentScope_, "currentScope_ must be null: {}:{}",
-             currentScope_->name(), currentScope_->location());
+  return currentScope_->ts_resolve(type->name());
 }
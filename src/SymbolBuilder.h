@@ -2,24 +2,33 @@
 // Apache License Version 2.0
 
 #pragma once
+#include "AstClasses.h"
 #include "SymbolClasses.h"
 #include "iface/Phase.h"
-#include "iface/Visitor.h"
 
-class SymbolBuilder : public Phase, public Visitor {
+class SymbolBuilder : public FusiblePhase {
 public:
-  SymbolBuilder();
+  // scope encloses the global scope of compile unit, symbols defined by
+  // previous compile units are resolved through it, see Repl
+  SymbolBuilder(Scope *scope = nullptr);
   virtual ~SymbolBuilder() = default;
-  virtual void run(Ast *ast);
 
-  virtual void visitLoop(A_Loop *ast);
-  virtual void visitLoopEnumerator(A_LoopEnumerator *ast);
-  virtual void visitBlock(A_Block *ast);
-  virtual void visitParam(A_Param *ast);
-  virtual void visitFuncDef(A_FuncDef *ast);
-  virtual void visitVarDef(A_VarDef *ast);
-  virtual void visitCompileUnit(A_CompileUnit *ast);
+  virtual void enter(Ast *ast);
+  virtual void leave(Ast *ast);
 
 private:
+  void enterLoop(A_Loop *ast);
+  void enterLoopEnumerator(A_LoopEnumerator *ast);
+  void enterBlock(A_Block *ast);
+  void enterParam(A_Param *ast);
+  void enterFuncDef(A_FuncDef *ast);
+  void enterVarDef(A_VarDef *ast);
+  void enterYield(A_Yield *ast);
+  void enterCompileUnit(A_CompileUnit *ast);
+
+  // resolve plain type `T` or array type `T[]`
+  TypeSymbol *resolveType(Ast *type);
+
+  Scope *enclosingScope_;
   Scope *currentScope_;
 };
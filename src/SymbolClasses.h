@@ -16,6 +16,8 @@ class S_Method;
 class Ts_Plain;
 class Ts_Class;
 class Ts_Func;
+class Ts_Array;
+class Ts_Vector;
 
 class Sc_Local;
 class Sc_Global;
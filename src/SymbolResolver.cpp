@@ -6,53 +6,69 @@
 #include "Symbol.h"
 #include "infra/Log.h"
 
-SymbolResolver::SymbolResolver()
-    : Phase("SymbolResolver"), currentScope_(nullptr) {}
+// SymbolResolver needs all symbols defined by previous phases
+SymbolResolver::SymbolResolver(Scope *scope)
+    : FusiblePhase("SymbolResolver", PhaseOrder::PrePostOrder,
+                   {AstKind::Loop, AstKind::Block, AstKind::FuncDef,
+                    AstKind::CompileUnit, AstKind::VarId},
+                   true),
+      currentScope_(scope) {}
 
-void SymbolResolver::run(Ast *ast) { ast->accept(this); }
-
-void SymbolResolver::visitLoop(A_Loop *ast) {
-  currentScope_ = ast->scope();
-
-  ast->condition->accept(this);
-  ast->body->accept(this);
-
-  currentScope_ = currentScope_->owner();
-}
-
-void SymbolResolver::visitBlock(A_Block *ast) {
-  currentScope_ = ast->scope();
-  if (ast->blockStats) {
-    ast->blockStats->accept(this);
+void SymbolResolver::enter(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::Loop:
+    currentScope_ = static_cast<A_Loop *>(ast)->scope();
+    if (!slots_.empty()) {
+      slots_.back().push_back(0);
+    }
+    break;
+  case AstKind::Block:
+    currentScope_ = static_cast<A_Block *>(ast)->scope();
+    if (!slots_.empty()) {
+      slots_.back().push_back(0);
+    }
+    break;
+  case AstKind::FuncDef: {
+    A_VarId *funcId =
+        static_cast<A_VarId *>(static_cast<A_FuncDef *>(ast)->getId());
+    currentScope_ = dynamic_cast<Scope *>(funcId->symbol());
+    slots_.push_back(std::vector<int>(1, 0));
+  } break;
+  case AstKind::CompileUnit:
+    currentScope_ = static_cast<A_CompileUnit *>(ast)->scope();
+    break;
+  case AstKind::VarId:
+    enterVarId(static_cast<A_VarId *>(ast));
+    break;
+  default:
+    break;
   }
-  currentScope_ = currentScope_->owner();
 }
 
-void SymbolResolver::visitFuncDef(A_FuncDef *ast) {
-  A_VarId *funcId = static_cast<A_VarId *>(ast->getId());
-
-  currentScope_ = dynamic_cast<Scope *>(funcId->symbol());
-
-  ast->resultType->accept(this);
-  ast->funcSign->accept(this);
-  ast->body->accept(this);
-
-  currentScope_ = currentScope_->owner();
-}
-
-void SymbolResolver::visitCompileUnit(A_CompileUnit *ast) {
-  currentScope_ = ast->scope();
-
-  if (ast->topStats) {
-    ast->topStats->accept(this);
+void SymbolResolver::leave(Ast *ast) {
+  switch (ast->kind()) {
+  case AstKind::Loop:
+  case AstKind::Block:
+    currentScope_ = currentScope_->owner();
+    if (!slots_.empty()) {
+      slots_.back().pop_back();
+    }
+    break;
+  case AstKind::FuncDef:
+    currentScope_ = currentScope_->owner();
+    slots_.pop_back();
+    break;
+  case AstKind::CompileUnit:
+    currentScope_ = currentScope_->owner();
+    break;
+  default:
+    break;
   }
-
-  currentScope_ = currentScope_->owner();
 }
 
-void SymbolResolver::visitVarId(A_VarId *ast) {
-  Symbol *sym = currentScope_->s_resolve(ast->name());
-  TypeSymbol *tsym = currentScope_->ts_resolve(ast->name());
+void SymbolResolver::enterVarId(A_VarId *ast) {
+  Symbol *sym = currentScope_->s_resolve(ast->nameId());
+  TypeSymbol *tsym = currentScope_->ts_resolve(ast->nameId());
   if (ast->symbol()) {
     LOG_ASSERT(sym, "symbol {}:{} cannot resolve in scope {}:{}", ast->name(),
                ast->location(), currentScope_->name(),
@@ -61,6 +77,7 @@ void SymbolResolver::visitVarId(A_VarId *ast) {
                "symbol {}:{} must defined in scope {}:{}", sym->name(),
                sym->location(), currentScope_->name(),
                currentScope_->location());
+    assignSlot(sym);
   } else if (ast->typeSymbol()) {
     LOG_ASSERT(tsym, "type symbol {}:{} cannot resolve in scope {}:{}",
                ast->name(), ast->location(), currentScope_->name(),
@@ -86,4 +103,65 @@ void SymbolResolver::visitVarId(A_VarId *ast) {
                  currentScope_->location());
     }
   }
+
+  // copy slot, later phases address local variable without name
+  if (ast->symbol()) {
+    ast->slotDepth() = ast->symbol()->slotDepth();
+    ast->slotIndex() = ast->symbol()->slotIndex();
+  }
+}
+
+void SymbolResolver::assignSlot(Symbol *sym) {
+  if (slots_.empty() || (sym->kind() != +SymbolKind::Var &&
+                         sym->kind() != +SymbolKind::Param)) {
+    return;
+  }
+  std::vector<int> &frame = slots_.back();
+  sym->slotDepth() = (int)frame.size() - 1;
+  sym->slotIndex() = frame.back()++;
+}
+
+ParallelSymbolResolver::ParallelSymbolResolver(int threads)
+    : Phase("ParallelSymbolResolver"), threads_(threads) {}
+
+void ParallelSymbolResolver::run(Ast *ast) {
+  LOG_ASSERT(ast->kind() == +AstKind::CompileUnit,
+             "ast {}:{} kind {} != AstKind::CompileUnit", ast->name(),
+             ast->location(), ast->kind()._to_string());
+  A_CompileUnit *compileUnit = static_cast<A_CompileUnit *>(ast);
+  Scope *global = compileUnit->scope();
+  LOG_ASSERT(global, "compile unit {}:{} scope must not null",
+             compileUnit->name(), compileUnit->location());
+
+  // global variables are resolved first, functions can read them
+  std::vector<Ast *> funcDefs;
+  SymbolResolver globalResolver(global);
+  for (A_TopStats *e = compileUnit->topStats; e; e = e->next) {
+    if (!e->topStat) {
+      continue;
+    }
+    if (e->topStat->kind() == +AstKind::FuncDef) {
+      funcDefs.push_back(e->topStat);
+    } else {
+      globalResolver.run(e->topStat);
+    }
+  }
+
+  // each function is resolved by its own resolver, the first exception
+  // thrown by any function is rethrown here after all tasks are finished
+  ThreadPool pool(threads_);
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < (int)funcDefs.size(); i++) {
+    Ast *funcDef = funcDefs[i];
+    futures.push_back(pool.submit([global, funcDef]() {
+      SymbolResolver resolver(global);
+      resolver.run(funcDef);
+    }));
+  }
+  for (int i = 0; i < (int)futures.size(); i++) {
+    futures[i].wait();
+  }
+  for (int i = 0; i < (int)futures.size(); i++) {
+    futures[i].get();
+  }
 }
@@ -2,22 +2,47 @@
 // Apache License Version 2.0
 
 #pragma once
+#include "AstClasses.h"
 #include "SymbolClasses.h"
 #include "iface/Phase.h"
-#include "iface/Visitor.h"
+#include "infra/ThreadPool.h"
+#include <vector>
 
-class SymbolResolver : public Phase, public Visitor {
+/**
+ * SymbolResolver resolves each varId to its symbol or type symbol, and assigns
+ * (scope depth, slot index) to local variables and parameters, see Slotable.
+ */
+class SymbolResolver : public FusiblePhase {
 public:
-  SymbolResolver();
+  // scope is the enclosing scope when walk starts from a non-compile-unit ast
+  SymbolResolver(Scope *scope = nullptr);
   virtual ~SymbolResolver() = default;
-  virtual void run(Ast *ast);
 
-  virtual void visitLoop(A_Loop *ast);
-  virtual void visitBlock(A_Block *ast);
-  virtual void visitFuncDef(A_FuncDef *ast);
-  virtual void visitCompileUnit(A_CompileUnit *ast);
-  virtual void visitVarId(A_VarId *ast);
+  virtual void enter(Ast *ast);
+  virtual void leave(Ast *ast);
 
 private:
+  void enterVarId(A_VarId *ast);
+  void assignSlot(Symbol *sym);
+
   Scope *currentScope_;
+  // slot counters of nested scopes, one frame for each function
+  std::vector<std::vector<int>> slots_;
+};
+
+/**
+ * ParallelSymbolResolver resolves global variables first, then resolves
+ * function bodies on a thread pool, each function is resolved by its own
+ * SymbolResolver.
+ *
+ * When function bodies are resolved, the global scope is read-only.
+ */
+class ParallelSymbolResolver : public Phase {
+public:
+  ParallelSymbolResolver(int threads = ThreadPool::defaultThreads());
+  virtual ~ParallelSymbolResolver() = default;
+  virtual void run(Ast *ast);
+
+private:
+  int threads_;
 };
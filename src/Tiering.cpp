@@ -0,0 +1,320 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Tiering.h"
+#include "IrBuilder.h"
+#include "PerfMap.h"
+#include "Symbol.h"
+#include "fmt/format.h"
+#include "infra/Log.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <exception>
+
+namespace {
+
+// types passed between registers and native code
+bool integral(const TypeSymbol *ts) {
+  return ts == TypeSymbol::ts_int() || ts == TypeSymbol::ts_long() ||
+         ts == TypeSymbol::ts_boolean();
+}
+
+// IrBuilder lowers integers with signed operations only, and has no prefix
+// operators and global variables in functions
+bool signedOnly(const bytecode::Function *function) {
+  for (int i = 0; i < (int)function->code.size(); i++) {
+    switch (function->code[i].op) {
+    case bytecode::UDIV:
+    case bytecode::UREM:
+    case bytecode::ULT:
+    case bytecode::ULE:
+    case bytecode::NEG:
+    case bytecode::BNOT:
+    case bytecode::LNOT:
+    case bytecode::ZEXT32:
+    case bytecode::FADD:
+    case bytecode::FSUB:
+    case bytecode::FMUL:
+    case bytecode::FDIV:
+    case bytecode::FREM:
+    case bytecode::FEQ:
+    case bytecode::FNE:
+    case bytecode::FLT:
+    case bytecode::FLE:
+    case bytecode::FNEG:
+    case bytecode::FROUND32:
+    case bytecode::GETG:
+    case bytecode::SETG:
+      return false;
+    default:
+      break;
+    }
+  }
+  return true;
+}
+
+Cowstr wrapperName(const Symbol *symbol) {
+  return IrBuilder::linkName(symbol) + ".tier";
+}
+
+// void <name>.tier(i64 *registers) loads arguments from registers, calls the
+// function and stores the result into the first register
+void wrap(llvm::Module *module, llvm::Function *function,
+          const Cowstr &name) {
+  llvm::LLVMContext &context = module->getContext();
+  llvm::Type *i64 = llvm::Type::getInt64Ty(context);
+  llvm::FunctionType *wrapperType =
+      llvm::FunctionType::get(llvm::Type::getVoidTy(context),
+                              {llvm::PointerType::get(i64, 0)}, false);
+  llvm::Function *wrapper = llvm::Function::Create(
+      wrapperType, llvm::Function::ExternalLinkage, name.str(), module);
+  llvm::IRBuilder<> builder(
+      llvm::BasicBlock::Create(context, "entry", wrapper));
+  llvm::Value *registers = wrapper->arg_begin();
+
+  std::vector<llvm::Value *> args;
+  for (int i = 0; i < (int)function->arg_size(); i++) {
+    llvm::Value *value = builder.CreateLoad(
+        i64, builder.CreateConstGEP1_64(i64, registers, i));
+    llvm::Type *type = function->getFunctionType()->getParamType(i);
+    args.push_back(type == i64 ? value : builder.CreateTrunc(value, type));
+  }
+  llvm::Value *result = builder.CreateCall(function, args);
+  llvm::Type *resultType = function->getReturnType();
+  if (!resultType->isVoidTy()) {
+    // boolean is 0 or 1 in register, int is sign extended
+    if (resultType->isIntegerTy(1)) {
+      result = builder.CreateZExt(result, i64);
+    } else if (resultType != i64) {
+      result = builder.CreateSExt(result, i64);
+    }
+    builder.CreateStore(result, registers);
+  }
+  builder.CreateRetVoid();
+}
+
+uint64_t since(const std::chrono::steady_clock::time_point &start) {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+} // namespace
+
+Cowstr Tiering::Stats::str() const {
+  Cowstr s = fmt::format(
+      "tiering: {} hot, {} compiled, {} rejected, interpreter {:.3f}ms, "
+      "native {:.3f}ms, compile {:.3f}ms",
+      hot, compiled, rejected, interpreterTime / 1e6, nativeTime / 1e6,
+      compileTime / 1e6);
+  for (int i = 0; i < (int)decisions.size(); i++) {
+    s = s + "\n  " + decisions[i];
+  }
+  return s;
+}
+
+Tiering::Tiering(Vm *vm, Ast *compileUnit,
+                 const BytecodeBuilder *bytecodeBuilder, int threshold)
+    : vm_(vm), compileUnit_(compileUnit), bytecodeBuilder_(bytecodeBuilder),
+      jit_(nullptr), prepared_(false), stats_(), pool_(1) {
+  LOG_ASSERT(vm_, "vm_ must not null");
+  LOG_ASSERT(compileUnit_, "compileUnit_ must not null");
+  LOG_ASSERT(bytecodeBuilder_ && bytecodeBuilder_->module(),
+             "bytecodeBuilder_ must be run");
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  // function is eligible when its signature and instructions are, and all
+  // its callees are, repeat until no more changes
+  const bytecode::Module *module = bytecodeBuilder_->module();
+  int n = (int)module->functions.size();
+  eligible_.resize(n, false);
+  for (int i = 1; i < n; i++) {
+    const Symbol *symbol = bytecodeBuilder_->symbol(i);
+    if (!symbol || !symbol->type() ||
+        symbol->type()->kind() != +TypeSymbolKind::Func) {
+      continue;
+    }
+    const Ts_Func *type = static_cast<const Ts_Func *>(symbol->type());
+    bool eligible = integral(type->result) ||
+                    type->result == TypeSymbol::ts_void();
+    for (int j = 0; j < (int)type->params.size(); j++) {
+      eligible = eligible && integral(type->params[j]);
+    }
+    eligible_[i] = eligible && signedOnly(module->functions[i]);
+  }
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (int i = 1; i < n; i++) {
+      const std::vector<bytecode::Instruction> &code =
+          module->functions[i]->code;
+      for (int j = 0; eligible_[i] && j < (int)code.size(); j++) {
+        if (code[j].op == bytecode::CALL && !eligible_[code[j].b]) {
+          eligible_[i] = false;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  vm_->profile(threshold, [this](int function) { hot(function); });
+}
+
+Tiering::~Tiering() {
+  // error of a compilation is logged, destructor doesn't throw
+  for (int i = 0; i < (int)futures_.size(); i++) {
+    try {
+      futures_[i].get();
+    } catch (const std::exception &e) {
+      LOG_ERROR("tier-up compilation failed: {}", e.what());
+    }
+  }
+}
+
+void Tiering::wait() {
+  // every compilation completes before the first error is rethrown
+  std::exception_ptr error;
+  for (int i = 0; i < (int)futures_.size(); i++) {
+    try {
+      futures_[i].get();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  futures_.clear();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+Tiering::Stats Tiering::stats() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  Stats s = stats_;
+  s.interpreterTime = vm_->interpreterTime();
+  s.nativeTime = vm_->nativeTime();
+  return s;
+}
+
+bool Tiering::eligible(int function) const {
+  LOG_ASSERT(function >= 0 && function < (int)eligible_.size(),
+             "function {} out of range [0, {})", function, eligible_.size());
+  return eligible_[function];
+}
+
+void Tiering::hot(int function) {
+  const Vm::Profile &profile = vm_->profile(function);
+  const Cowstr &name = bytecodeBuilder_->module()->functions[function]->name;
+  std::lock_guard<std::mutex> guard(lock_);
+  stats_.hot++;
+  if (!eligible_[function]) {
+    stats_.rejected++;
+    decide(fmt::format("{}: hot after {} invocations and {} backedges, "
+                       "stays in interpreter",
+                       name, profile.invocations, profile.backedges));
+    return;
+  }
+  decide(fmt::format("{}: hot after {} invocations and {} backedges, "
+                     "compiling",
+                     name, profile.invocations, profile.backedges));
+  futures_.push_back(pool_.submit([this, function]() { compile(function); }));
+}
+
+void Tiering::compile(int function) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  const Cowstr &name = bytecodeBuilder_->module()->functions[function]->name;
+  Cowstr failure;
+  Vm::Native native = nullptr;
+
+  // lower compile unit at the first time, then it's compiled lazily
+  if (!prepared_) {
+    prepared_ = true;
+    try {
+      prepare();
+    } catch (const Exception &e) {
+      failure_ = e.message();
+      jit_.reset();
+    }
+  }
+  if (jit_) {
+    llvm::Expected<llvm::JITEvaluatedSymbol> symbol =
+        jit_->lookup(wrapperName(bytecodeBuilder_->symbol(function)).str());
+    if (symbol) {
+      native = reinterpret_cast<Vm::Native>(
+          static_cast<uintptr_t>(symbol->getAddress()));
+    } else {
+      failure = llvm::toString(symbol.takeError());
+    }
+  } else {
+    failure = failure_;
+  }
+
+  uint64_t elapsed = since(start);
+  std::lock_guard<std::mutex> guard(lock_);
+  stats_.compileTime += elapsed;
+  if (native) {
+    stats_.compiled++;
+    vm_->install(function, native);
+    decide(fmt::format("{}: compiled in {:.3f}ms", name, elapsed / 1e6));
+  } else {
+    stats_.rejected++;
+    decide(fmt::format("{}: cannot compile, {}", name, failure));
+  }
+}
+
+void Tiering::prepare() {
+  // lower compile unit in a new context owned by JIT
+  std::unique_ptr<llvm::LLVMContext> context(new llvm::LLVMContext());
+  std::unique_ptr<llvm::Module> module;
+  {
+    IrBuilder irBuilder(true);
+    irBuilder.run(compileUnit_);
+    module = irBuilder.copyModule(*context);
+  }
+
+  // ineligible functions are never called by native code, their bodies are
+  // dropped, eligible functions are called by wrappers
+  const bytecode::Module *bytecodeModule = bytecodeBuilder_->module();
+  for (int i = 1; i < (int)bytecodeModule->functions.size(); i++) {
+    const Symbol *symbol = bytecodeBuilder_->symbol(i);
+    llvm::Function *function =
+        module->getFunction(IrBuilder::linkName(symbol).str());
+    LOG_ASSERT(function, "function {} not found in {}",
+               bytecodeModule->functions[i]->name, compileUnit_->name());
+    if (eligible_[i]) {
+      wrap(module.get(), function, wrapperName(symbol));
+    } else {
+      function->deleteBody();
+    }
+  }
+  std::string verifyError;
+  llvm::raw_string_ostream verifyOs(verifyError);
+  LOG_ASSERT(!llvm::verifyModule(*module, &verifyOs), "invalid module {}: {}",
+             compileUnit_->name(), verifyOs.str());
+
+  llvm::orc::LLLazyJITBuilder jitBuilder;
+  PerfMap::setup(jitBuilder);
+  llvm::Expected<std::unique_ptr<llvm::orc::LLLazyJIT>> jit =
+      jitBuilder.create();
+  LOG_ASSERT(jit, "cannot create JIT: {}", llvm::toString(jit.takeError()));
+  jit_ = std::move(*jit);
+  module->setDataLayout(jit_->getDataLayout());
+  llvm::Error error = jit_->addLazyIRModule(
+      llvm::orc::ThreadSafeModule(std::move(module), std::move(context)));
+  if (error) {
+    LOG_ASSERT(false, "cannot add {} to JIT: {}", compileUnit_->name(),
+               llvm::toString(std::move(error)));
+  }
+}
+
+void Tiering::decide(const Cowstr &decision) {
+  LOG_INFO("{}", decision);
+  stats_.decisions.push_back(decision);
+}
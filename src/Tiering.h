@@ -0,0 +1,82 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "AstClasses.h"
+#include "BytecodeBuilder.h"
+#include "Vm.h"
+#include "infra/Cowstr.h"
+#include "infra/ThreadPool.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Tiering runs a compile unit in Vm first, and compiles hot functions with
+ * LLVM on a background thread.
+ *
+ * When a function is hot (see Vm::profile), it's queued to the background
+ * thread, which lowers the compile unit with IrBuilder into a lazy ORC JIT
+ * once, then compiles the function (and its callees on demand) and installs
+ * the native code in the function table of Vm. The interpreter keeps running
+ * until the native code is installed.
+ *
+ * Only functions which IrBuilder lowers with the same semantics are compiled:
+ * signed integer and boolean values, no global variables, and callees are
+ * compiled too. Other hot functions stay in the interpreter. Native code
+ * behaves like compiled code, for example integer division by zero traps.
+ */
+class Tiering {
+public:
+  struct Stats {
+    // hot functions
+    int hot;
+    // hot functions compiled and installed
+    int compiled;
+    // hot functions stay in interpreter
+    int rejected;
+    // time in nanoseconds
+    uint64_t interpreterTime;
+    uint64_t nativeTime;
+    uint64_t compileTime;
+    // tier-up decisions in order
+    std::vector<Cowstr> decisions;
+
+    Cowstr str() const;
+  };
+
+  Tiering(Vm *vm, Ast *compileUnit, const BytecodeBuilder *bytecodeBuilder,
+          int threshold = 1000);
+  virtual ~Tiering();
+
+  // wait for queued compilations, then rethrow the first error of them
+  void wait();
+  Stats stats() const;
+  // function is lowered with same semantics
+  bool eligible(int function) const;
+
+private:
+  void hot(int function);
+  void compile(int function);
+  void prepare();
+  void decide(const Cowstr &decision);
+
+  Vm *vm_;
+  Ast *compileUnit_;
+  const BytecodeBuilder *bytecodeBuilder_;
+  std::vector<bool> eligible_;
+
+  // accessed only by background thread
+  std::unique_ptr<llvm::orc::LLLazyJIT> jit_;
+  bool prepared_;
+  // why compile unit cannot be lowered
+  Cowstr failure_;
+
+  mutable std::mutex lock_;
+  Stats stats_;
+  std::vector<std::future<void>> futures_;
+  ThreadPool pool_;
+};
@@ -25,6 +25,7 @@ const static std::unordered_map<int, Cowstr> TokenNameMap = {
     NAME_VALUE(T_NIL, "nil"),
     NAME_VALUE(T_NEW, "new"),
     NAME_VALUE(T_DELETE, "delete"),
+    NAME_VALUE(T_REGION, "region"),
     NAME_VALUE(T_DEF, "def"),
     NAME_VALUE(T_IF, "if"),
     NAME_VALUE(T_THEN, "then"),
@@ -57,6 +58,7 @@ const static std::unordered_map<int, Cowstr> TokenNameMap = {
     NAME_VALUE(T_INF, "inf"),
     NAME_VALUE(T_ASYNC, "async"),
     NAME_VALUE(T_AWAIT, "await"),
+    NAME_VALUE(T_REDUCE, "reduce"),
     NAME_VALUE(T_STATIC, "static"),
     NAME_VALUE(T_PUBLIC, "public"),
     NAME_VALUE(T_PROTECT, "protect"),
@@ -64,6 +66,7 @@ const static std::unordered_map<int, Cowstr> TokenNameMap = {
     NAME_VALUE(T_PREFIX, "prefix"),
     NAME_VALUE(T_POSTFIX, "postfix"),
     NAME_VALUE(T_PACKAGE, "package"),
+    NAME_VALUE(T_CONST, "const"),
     NAME_VALUE(T_BYTE, "byte"),
     NAME_VALUE(T_UBYTE, "ubyte"),
     NAME_VALUE(T_SHORT, "short"),
@@ -78,6 +81,16 @@ const static std::unordered_map<int, Cowstr> TokenNameMap = {
     NAME_VALUE(T_DOUBLE, "double"),
     NAME_VALUE(T_BOOLEAN, "boolean"),
     NAME_VALUE(T_CHAR, "char"),
+    NAME_VALUE(T_BYTE16, "byte16"),
+    NAME_VALUE(T_SHORT8, "short8"),
+    NAME_VALUE(T_INT4, "int4"),
+    NAME_VALUE(T_INT8, "int8"),
+    NAME_VALUE(T_LONG2, "long2"),
+    NAME_VALUE(T_LONG4, "long4"),
+    NAME_VALUE(T_FLOAT4, "float4"),
+    NAME_VALUE(T_FLOAT8, "float8"),
+    NAME_VALUE(T_DOUBLE2, "double2"),
+    NAME_VALUE(T_DOUBLE4, "double4"),
     NAME_VALUE(T_AND, "and"),
     NAME_VALUE(T_OR, "or"),
     NAME_VALUE(T_NOT, "not"),
@@ -0,0 +1,334 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Vm.h"
+#include "infra/Log.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+using namespace bytecode;
+
+namespace {
+
+// caller of current function
+struct Frame {
+  int index;
+  const Function *function;
+  const Instruction *pc;
+  Value *base;
+  // result register of call in caller
+  int result;
+};
+
+static uint64_t elapsed(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+} // namespace
+
+Vm::Vm(const Module *module, int maxStack)
+    : module_(module), stack_(maxStack), globals_(module->globals),
+      initialized_(false), threshold_(0),
+      profiles_(module->functions.size(), Profile{0, 0, false}),
+      natives_(new std::atomic<Native>[module->functions.size()]),
+      totalTime_(0), nativeTime_(0) {
+  LOG_ASSERT(!module_->functions.empty(),
+             "module must have initializer function");
+  for (int i = 0; i < (int)module_->functions.size(); i++) {
+    natives_[i].store(nullptr);
+  }
+}
+
+void Vm::initialize() {
+  if (initialized_) {
+    return;
+  }
+  initialized_ = true;
+  execute(0);
+}
+
+Value Vm::call(int function, const std::vector<Value> &args) {
+  LOG_ASSERT(function > 0 && function < (int)module_->functions.size(),
+             "invalid function index {}", function);
+  const Function *callee = module_->functions[function];
+  LOG_ASSERT((int)args.size() == callee->params,
+             "function {} arguments {} != {}", callee->name, args.size(),
+             callee->params);
+  initialize();
+  for (int i = 0; i < (int)args.size(); i++) {
+    stack_[i] = args[i];
+  }
+  if (!threshold_) {
+    Native native = natives_[function].load(std::memory_order_acquire);
+    if (native) {
+      native(stack_.data());
+      return stack_[0];
+    }
+    return execute(function);
+  }
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  count(function, false);
+  Value result;
+  Native native = natives_[function].load(std::memory_order_acquire);
+  if (native) {
+    native(stack_.data());
+    result = stack_[0];
+    nativeTime_ += elapsed(start);
+  } else {
+    result = execute(function);
+  }
+  totalTime_ += elapsed(start);
+  return result;
+}
+
+Value Vm::global(int index) const {
+  LOG_ASSERT(index >= 0 && index < (int)globals_.size(),
+             "invalid global index {}", index);
+  return globals_[index];
+}
+
+void Vm::profile(int threshold, const std::function<void(int)> &hot) {
+  LOG_ASSERT(threshold > 0, "threshold {} > 0", threshold);
+  threshold_ = threshold;
+  hot_ = hot;
+}
+
+const Vm::Profile &Vm::profile(int function) const {
+  LOG_ASSERT(function >= 0 && function < (int)profiles_.size(),
+             "invalid function index {}", function);
+  return profiles_[function];
+}
+
+void Vm::install(int function, Native native) {
+  LOG_ASSERT(function > 0 && function < (int)profiles_.size(),
+             "invalid function index {}", function);
+  natives_[function].store(native, std::memory_order_release);
+}
+
+Vm::Native Vm::native(int function) const {
+  LOG_ASSERT(function >= 0 && function < (int)profiles_.size(),
+             "invalid function index {}", function);
+  return natives_[function].load(std::memory_order_acquire);
+}
+
+uint64_t Vm::interpreterTime() const { return totalTime_ - nativeTime_; }
+
+uint64_t Vm::nativeTime() const { return nativeTime_; }
+
+void Vm::count(int function, bool backedge) {
+  Profile &p = profiles_[function];
+  if (backedge) {
+    p.backedges++;
+  } else {
+    p.invocations++;
+  }
+  if (!p.hot && p.invocations + p.backedges >= (uint64_t)threshold_) {
+    p.hot = true;
+    if (hot_) {
+      hot_(function);
+    }
+  }
+}
+
+Value Vm::execute(int function) {
+  std::vector<Frame> frames;
+  int current = function;
+  const Function *fn = module_->functions[function];
+  const Instruction *pc = fn->code.data();
+  const Value *k = fn->constants.data();
+  Value *r = stack_.data();
+  Value *g = globals_.data();
+  Value *limit = stack_.data() + stack_.size();
+  const Instruction *i = nullptr;
+  Value result;
+  result.u = 0;
+  LOG_ASSERT(r + fn->registers <= limit, "stack overflow in function {}",
+             fn->name);
+
+#ifdef DIM_VM_COMPUTED_GOTO
+#define BYTECODE_LABEL(op) &&L_##op,
+  static const void *labels[] = {BYTECODE_OPS(BYTECODE_LABEL)};
+#undef BYTECODE_LABEL
+#define VM_CASE(op) L_##op:
+#define VM_NEXT()                                                              \
+  do {                                                                         \
+    i = pc++;                                                                  \
+    goto *labels[i->op];                                                       \
+  } while (0)
+  VM_NEXT();
+#else
+#define VM_CASE(op) case op:
+#define VM_NEXT() continue
+  for (;;) {
+    i = pc++;
+    switch (i->op) {
+#endif
+
+  // clang-format off
+  VM_CASE(NOP) { VM_NEXT(); }
+  VM_CASE(MOV) { r[i->a] = r[i->b]; VM_NEXT(); }
+  VM_CASE(LOADK) { r[i->a] = k[i->b]; VM_NEXT(); }
+  VM_CASE(GETG) { r[i->a] = g[i->b]; VM_NEXT(); }
+  VM_CASE(SETG) { g[i->b] = r[i->a]; VM_NEXT(); }
+  VM_CASE(ADD) { r[i->a].u = r[i->b].u + r[i->c].u; VM_NEXT(); }
+  VM_CASE(SUB) { r[i->a].u = r[i->b].u - r[i->c].u; VM_NEXT(); }
+  VM_CASE(MUL) { r[i->a].u = r[i->b].u * r[i->c].u; VM_NEXT(); }
+  VM_CASE(SDIV) {
+    LOG_ASSERT(r[i->c].i != 0 &&
+                   !(r[i->b].i == std::numeric_limits<int64_t>::min() &&
+                     r[i->c].i == -1),
+               "integer division overflow in function {}", fn->name);
+    r[i->a].i = r[i->b].i / r[i->c].i;
+    VM_NEXT();
+  }
+  VM_CASE(UDIV) {
+    LOG_ASSERT(r[i->c].u != 0, "integer division by zero in function {}",
+               fn->name);
+    r[i->a].u = r[i->b].u / r[i->c].u;
+    VM_NEXT();
+  }
+  VM_CASE(SREM) {
+    LOG_ASSERT(r[i->c].i != 0 &&
+                   !(r[i->b].i == std::numeric_limits<int64_t>::min() &&
+                     r[i->c].i == -1),
+               "integer division overflow in function {}", fn->name);
+    r[i->a].i = r[i->b].i % r[i->c].i;
+    VM_NEXT();
+  }
+  VM_CASE(UREM) {
+    LOG_ASSERT(r[i->c].u != 0, "integer division by zero in function {}",
+               fn->name);
+    r[i->a].u = r[i->b].u % r[i->c].u;
+    VM_NEXT();
+  }
+  VM_CASE(AND) { r[i->a].u = r[i->b].u & r[i->c].u; VM_NEXT(); }
+  VM_CASE(OR) { r[i->a].u = r[i->b].u | r[i->c].u; VM_NEXT(); }
+  VM_CASE(XOR) { r[i->a].u = r[i->b].u ^ r[i->c].u; VM_NEXT(); }
+  VM_CASE(EQ) { r[i->a].u = r[i->b].u == r[i->c].u; VM_NEXT(); }
+  VM_CASE(NE) { r[i->a].u = r[i->b].u != r[i->c].u; VM_NEXT(); }
+  VM_CASE(SLT) { r[i->a].u = r[i->b].i < r[i->c].i; VM_NEXT(); }
+  VM_CASE(SLE) { r[i->a].u = r[i->b].i <= r[i->c].i; VM_NEXT(); }
+  VM_CASE(ULT) { r[i->a].u = r[i->b].u < r[i->c].u; VM_NEXT(); }
+  VM_CASE(ULE) { r[i->a].u = r[i->b].u <= r[i->c].u; VM_NEXT(); }
+  VM_CASE(NEG) { r[i->a].u = 0 - r[i->b].u; VM_NEXT(); }
+  VM_CASE(BNOT) { r[i->a].u = ~r[i->b].u; VM_NEXT(); }
+  VM_CASE(LNOT) { r[i->a].u = !r[i->b].u; VM_NEXT(); }
+  VM_CASE(SEXT32) { r[i->a].i = (int32_t)r[i->a].u; VM_NEXT(); }
+  VM_CASE(ZEXT32) { r[i->a].u = (uint32_t)r[i->a].u; VM_NEXT(); }
+  VM_CASE(FADD) { r[i->a].d = r[i->b].d + r[i->c].d; VM_NEXT(); }
+  VM_CASE(FSUB) { r[i->a].d = r[i->b].d - r[i->c].d; VM_NEXT(); }
+  VM_CASE(FMUL) { r[i->a].d = r[i->b].d * r[i->c].d; VM_NEXT(); }
+  VM_CASE(FDIV) { r[i->a].d = r[i->b].d / r[i->c].d; VM_NEXT(); }
+  VM_CASE(FREM) { r[i->a].d = std::fmod(r[i->b].d, r[i->c].d); VM_NEXT(); }
+  VM_CASE(FEQ) { r[i->a].u = r[i->b].d == r[i->c].d; VM_NEXT(); }
+  VM_CASE(FNE) { r[i->a].u = r[i->b].d != r[i->c].d; VM_NEXT(); }
+  VM_CASE(FLT) { r[i->a].u = r[i->b].d < r[i->c].d; VM_NEXT(); }
+  VM_CASE(FLE) { r[i->a].u = r[i->b].d <= r[i->c].d; VM_NEXT(); }
+  VM_CASE(FNEG) { r[i->a].d = -r[i->b].d; VM_NEXT(); }
+  VM_CASE(FROUND32) { r[i->a].d = (float)r[i->a].d; VM_NEXT(); }
+  VM_CASE(JMP) {
+    const Instruction *target = fn->code.data() + i->b;
+    if (threshold_ && target < pc) {
+      count(current, true);
+    }
+    pc = target;
+    VM_NEXT();
+  }
+  VM_CASE(JT) {
+    if (r[i->a].u) {
+      const Instruction *target = fn->code.data() + i->b;
+      if (threshold_ && target < pc) {
+        count(current, true);
+      }
+      pc = target;
+    }
+    VM_NEXT();
+  }
+  VM_CASE(JF) {
+    if (!r[i->a].u) {
+      pc = fn->code.data() + i->b;
+    }
+    VM_NEXT();
+  }
+  // clang-format on
+  VM_CASE(CALL) {
+    const Function *callee = module_->functions[i->b];
+    Value *base = r + i->c;
+    LOG_ASSERT(base + callee->registers <= limit,
+               "stack overflow in function {}", callee->name);
+    if (threshold_) {
+      count(i->b, false);
+    }
+    Native native = natives_[i->b].load(std::memory_order_acquire);
+    if (native) {
+      if (threshold_) {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        native(base);
+        nativeTime_ += elapsed(start);
+      } else {
+        native(base);
+      }
+      r[i->a] = base[0];
+      VM_NEXT();
+    }
+    frames.push_back(Frame{current, fn, pc, r, i->a});
+    current = i->b;
+    fn = callee;
+    pc = fn->code.data();
+    k = fn->constants.data();
+    r = base;
+    VM_NEXT();
+  }
+  VM_CASE(RET) {
+    result = r[i->a];
+    if (frames.empty()) {
+      goto done;
+    }
+    const Frame &caller = frames.back();
+    current = caller.index;
+    fn = caller.function;
+    pc = caller.pc;
+    k = fn->constants.data();
+    r = caller.base;
+    r[caller.result] = result;
+    frames.pop_back();
+    VM_NEXT();
+  }
+  VM_CASE(RETV) {
+    if (frames.empty()) {
+      goto done;
+    }
+    const Frame &caller = frames.back();
+    current = caller.index;
+    fn = caller.function;
+    pc = caller.pc;
+    k = fn->constants.data();
+    r = caller.base;
+    frames.pop_back();
+    VM_NEXT();
+  }
+  VM_CASE(TRAP) {
+    LOG_ASSERT(false, "function {} reaches end without return", fn->name);
+    VM_NEXT();
+  }
+
+#ifndef DIM_VM_COMPUTED_GOTO
+    default:
+      LOG_ASSERT(false, "invalid opcode {} in function {}", i->op, fn->name);
+    }
+  }
+#endif
+
+#undef VM_CASE
+#undef VM_NEXT
+
+done:
+  return result;
+}
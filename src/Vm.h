@@ -0,0 +1,84 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "Bytecode.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// dispatch with computed goto (labels as values) when compiler supports,
+// define DIM_VM_SWITCH_DISPATCH to use the portable switch loop
+#if (defined(__GNUC__) || defined(__clang__)) &&                               \
+    !defined(DIM_VM_SWITCH_DISPATCH)
+#define DIM_VM_COMPUTED_GOTO 1
+#endif
+
+/**
+ * Vm executes a bytecode module built by BytecodeBuilder.
+ *
+ * Registers of all calls live in one fixed stack. A call doesn't copy its
+ * arguments: the frame of callee starts at the argument registers of caller.
+ * Calls are dispatched in the same loop, so deep recursion doesn't recurse
+ * natively and is only limited by the stack size.
+ *
+ * Runtime errors (integer division by zero, stack overflow, reaching the end
+ * of function without return) throw Exception.
+ *
+ * With profiling enabled, each function counts its invocations and backedges
+ * (backward jumps), it's hot when the sum reaches the threshold, see Tiering.
+ * A function with installed native code is called natively instead, its
+ * arguments are passed in registers and the result is written back to the
+ * first one.
+ */
+class Vm {
+public:
+  typedef void (*Native)(bytecode::Value *registers);
+
+  struct Profile {
+    uint64_t invocations;
+    uint64_t backedges;
+    bool hot;
+  };
+
+  // stack size is in registers
+  Vm(const bytecode::Module *module, int maxStack = 1 << 20);
+  virtual ~Vm() = default;
+
+  // initialize global variables, it runs once before the first call
+  void initialize();
+
+  bytecode::Value call(int function, const std::vector<bytecode::Value> &args);
+  bytecode::Value global(int index) const;
+
+  // enable profiling, `hot` is called once for each hot function in the
+  // interpreter thread
+  void profile(int threshold, const std::function<void(int)> &hot);
+  const Profile &profile(int function) const;
+  // thread-safe, it can be called while running
+  void install(int function, Native native);
+  Native native(int function) const;
+
+  // time of calls in interpreter and native code, in nanoseconds, only
+  // measured with profiling enabled
+  uint64_t interpreterTime() const;
+  uint64_t nativeTime() const;
+
+private:
+  bytecode::Value execute(int function);
+  void count(int function, bool backedge);
+
+  const bytecode::Module *module_;
+  std::vector<bytecode::Value> stack_;
+  std::vector<bytecode::Value> globals_;
+  bool initialized_;
+
+  int threshold_;
+  std::function<void(int)> hot_;
+  std::vector<Profile> profiles_;
+  std::unique_ptr<std::atomic<Native>[]> natives_;
+  uint64_t totalTime_;
+  uint64_t nativeTime_;
+};
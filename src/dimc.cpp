@@ -2,11 +2,14 @@
 // Apache License Version 2.0
 
 #include "Compiler.h"
+#include "ObjectCache.h"
 #include "Option.h"
+#include "PerfMap.h"
 #include "boost/filesystem.hpp"
 #include "boost/program_options/parsers.hpp"
 #include "fmt/format.h"
 #include "infra/Log.h"
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -42,6 +45,40 @@ int main(int argc, char **argv) {
              "error: input one file at a time\n");
       Compiler::dumpAst(opt.get<std::vector<std::string>>("input-files")[0]);
     }
+    if (opt.has("perf")) {
+      PerfMap::enable(true);
+    }
+    if (opt.has("repl")) {
+      Compiler::repl();
+      return 0;
+    }
+    if (opt.has("run")) {
+      ASSERT(opt.has("input-files"), "error: missing input file name\n");
+      ASSERT(opt.get<std::vector<std::string>>("input-files").size() == 1,
+             "error: input one file at a time\n");
+      int optLevel = opt.get<int>("optimize");
+      if (optLevel < 0 || optLevel > 3) {
+        PRINT("warn: invalid optLevel {}, using optLevel=0\n", optLevel);
+        optLevel = 0;
+      }
+      int jobs = std::max(1, opt.get<int>("jobs"));
+      std::string cacheDirectory =
+          opt.has("no-cache")
+              ? ""
+              : (opt.has("cache-dir") ? opt.get<std::string>("cache-dir")
+                                      : ObjectCache::defaultDirectory().str());
+      return Compiler::run(opt.get<std::vector<std::string>>("input-files")[0],
+                           optLevel, jobs, cacheDirectory);
+    }
+    if (opt.has("interpret")) {
+      ASSERT(opt.has("input-files"), "error: missing input file name\n");
+      ASSERT(opt.get<std::vector<std::string>>("input-files").size() == 1,
+             "error: input one file at a time\n");
+      int jobs = std::max(1, opt.get<int>("jobs"));
+      return Compiler::interpret(
+          opt.get<std::vector<std::string>>("input-files")[0], jobs,
+          std::max(0, opt.get<int>("tier")));
+    }
     if (opt.has("codegen")) {
       std::string codegenOpt = opt.get<std::string>("codegen");
       ASSERT(codegenOpt == "asm" || codegenOpt == "llvm-ll" ||
@@ -63,6 +100,7 @@ int main(int argc, char **argv) {
         }
         bool debugInfo = opt.has("debug");
         (void)debugInfo;
+        int jobs = std::max(1, opt.get<int>("jobs"));
 
         std::vector<std::string> inputFileList =
             opt.get<std::vector<std::string>>("input-files");
@@ -74,13 +112,15 @@ int main(int argc, char **argv) {
               "warn: output file {} cannot work for more than 2 input files\n",
               opt.get<std::string>("output"));
           for (int i = 0; i < (int)inputFileList.size(); ++i) {
-            Compiler::createObjectFile(inputFileList[i], "", optLevel);
+            Compiler::createObjectFile(inputFileList[i], "", optLevel, false,
+                                       "generic", "", jobs);
           }
         } else if (inputFileList.size() == 1) {
           // single input file
           Cowstr outputFile =
               opt.has("output") ? opt.get<std::string>("output") : "";
-          Compiler::createObjectFile(inputFileList[0], outputFile, optLevel);
+          Compiler::createObjectFile(inputFileList[0], outputFile, optLevel,
+                                     false, "generic", "", jobs);
         }
       } // obj
 
@@ -93,6 +133,7 @@ int main(int argc, char **argv) {
         }
         bool debugInfo = opt.has("debug");
         (void)debugInfo;
+        int jobs = std::max(1, opt.get<int>("jobs"));
 
         std::vector<std::string> inputFileList =
             opt.get<std::vector<std::string>>("input-files");
@@ -104,14 +145,15 @@ int main(int argc, char **argv) {
               "warn: output file {} cannot work for more than 2 input files\n",
               opt.get<std::string>("output"));
           for (int i = 0; i < (int)inputFileList.size(); ++i) {
-            Compiler::create_llvm_ll_file(inputFileList[i], "", optLevel > 0);
+            Compiler::create_llvm_ll_file(inputFileList[i], "", optLevel > 0,
+                                          jobs);
           }
         } else if (inputFileList.size() == 1) {
           // single input file
           Cowstr outputFile =
               opt.has("output") ? opt.get<std::string>("output") : "";
           Compiler::create_llvm_ll_file(inputFileList[0], outputFile,
-                                        optLevel > 0);
+                                        optLevel > 0, jobs);
         }
       } // llvm-ll
     }
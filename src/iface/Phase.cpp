@@ -2,10 +2,37 @@
 // Apache License Version 2.0
 
 #include "iface/Phase.h"
+#include "AstWalker.h"
 #include "infra/Log.h"
 
 Phase::Phase(const Cowstr &name) : Nameable(name) {}
 
+FusiblePhase::FusiblePhase(const Cowstr &name, PhaseOrder order,
+                           const std::vector<AstKind> &kinds, bool barrier)
+    : Phase(name), order_(order), kinds_(AstKind::_size(), kinds.empty()),
+      barrier_(barrier) {
+  for (int i = 0; i < (int)kinds.size(); i++) {
+    kinds_[AstWalker::index(kinds[i])] = true;
+  }
+}
+
+void FusiblePhase::run(Ast *ast) {
+  AstWalker walker({this});
+  walker.walk(ast);
+}
+
+void FusiblePhase::enter(Ast *ast) {}
+
+void FusiblePhase::leave(Ast *ast) {}
+
+PhaseOrder FusiblePhase::order() const { return order_; }
+
+bool FusiblePhase::interest(AstKind kind) const {
+  return kinds_[AstWalker::index(kind)];
+}
+
+bool FusiblePhase::barrier() const { return barrier_; }
+
 PhaseManager::PhaseManager(const std::vector<Phase *> phases)
     : phases_(phases) {}
 
@@ -15,9 +42,28 @@ void PhaseManager::add(Phase *phase) {
 }
 
 void PhaseManager::run(Ast *ast) {
+  std::vector<FusiblePhase *> fused;
   for (int i = 0; i < (int)phases_.size(); i++) {
     LOG_ASSERT(phases_[i], "phases_[{}] must not null", i);
-    phases_[i]->run(ast);
+    FusiblePhase *fp = dynamic_cast<FusiblePhase *>(phases_[i]);
+    if (fp && (fused.empty() || !fp->barrier())) {
+      fused.push_back(fp);
+      continue;
+    }
+    if (!fused.empty()) {
+      AstWalker walker(fused);
+      walker.walk(ast);
+      fused.clear();
+    }
+    if (fp) {
+      fused.push_back(fp);
+    } else {
+      phases_[i]->run(ast);
+    }
+  }
+  if (!fused.empty()) {
+    AstWalker walker(fused);
+    walker.walk(ast);
   }
 }
 
@@ -2,10 +2,14 @@
 // Apache License Version 2.0
 
 #pragma once
+#include "Ast.h"
 #include "AstClasses.h"
+#include "enum.h"
 #include "iface/Nameable.h"
 #include <vector>
 
+BETTER_ENUM(PhaseOrder, int, PreOrder = 5000, PostOrder, PrePostOrder)
+
 class Phase : public Nameable {
 public:
   Phase(const Cowstr &name);
@@ -13,12 +17,51 @@ public:
   virtual void run(Ast *ast) = 0;
 };
 
+/**
+ * FusiblePhase doesn't walk the ast tree by itself, it receives node events
+ * from a tree walk instead:
+ *    enter: before the children of node are visited (pre-order).
+ *    leave: after the children of node are visited (post-order).
+ *
+ * It declares the ast kinds and the events it needs, so PhaseManager fuses
+ * consecutive fusible phases into one tree walk, and dispatches each node only
+ * to the phases need it.
+ *
+ * A phase depends on previous phases finished the whole tree (for example
+ * SymbolResolver needs all symbols defined by SymbolBuilder) is a barrier, it
+ * starts a new tree walk.
+ */
+class FusiblePhase : public Phase {
+public:
+  // empty kinds means all ast kinds
+  FusiblePhase(const Cowstr &name, PhaseOrder order,
+               const std::vector<AstKind> &kinds = {}, bool barrier = false);
+  virtual ~FusiblePhase() = default;
+
+  // walk the ast tree alone
+  virtual void run(Ast *ast);
+
+  virtual void enter(Ast *ast);
+  virtual void leave(Ast *ast);
+
+  virtual PhaseOrder order() const;
+  virtual bool interest(AstKind kind) const;
+  virtual bool barrier() const;
+
+private:
+  PhaseOrder order_;
+  std::vector<bool> kinds_;
+  bool barrier_;
+};
+
 class PhaseManager {
 public:
   PhaseManager(const std::vector<Phase *> phases = {});
   virtual ~PhaseManager() = default;
 
   virtual void add(Phase *phase);
+
+  // fusible phases next to each other share one tree walk
   virtual void run(Ast *ast);
 
   virtual Phase *phase(int pos) const;
@@ -0,0 +1,22 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "iface/Slotable.h"
+
+Slotable::Slotable(int depth, int index)
+    : slotDepth_(depth), slotIndex_(index) {}
+
+int &Slotable::slotDepth() { return slotDepth_; }
+
+int Slotable::slotDepth() const { return slotDepth_; }
+
+int &Slotable::slotIndex() { return slotIndex_; }
+
+int Slotable::slotIndex() const { return slotIndex_; }
+
+bool Slotable::hasSlot() const { return slotDepth_ >= 0 && slotIndex_ >= 0; }
+
+void Slotable::resetSlot() {
+  slotDepth_ = -1;
+  slotIndex_ = -1;
+}
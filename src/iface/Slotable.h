@@ -0,0 +1,29 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+
+/**
+ * Slotable is the precomputed address of a local variable or parameter inside
+ * its function, assigned by SymbolResolver:
+ *    depth: scope depth, function scope (parameters) is 0, each nested
+ *           block/loop scope adds 1.
+ *    index: slot index in the scope, in defined order.
+ *
+ * Global variables and functions don't have slot, depth and index are -1.
+ */
+class Slotable {
+public:
+  Slotable(int depth = -1, int index = -1);
+  virtual ~Slotable() = default;
+  virtual int &slotDepth();
+  virtual int slotDepth() const;
+  virtual int &slotIndex();
+  virtual int slotIndex() const;
+  virtual bool hasSlot() const;
+  virtual void resetSlot();
+
+protected:
+  int slotDepth_;
+  int slotIndex_;
+};
@@ -4,12 +4,53 @@
 #include "iface/Visitor.h"
 #include "Ast.h"
 
-#define ACCEPT(x)                                                              \
-  do {                                                                         \
-    if (ast->x) {                                                              \
-      ast->x->accept(this);                                                    \
-    }                                                                          \
-  } while (0)
+#define ACCEPT1(a) accept(ast, {ast->a})
+#define ACCEPT2(a, b) accept(ast, {ast->a, ast->b})
+#define ACCEPT3(a, b, c) accept(ast, {ast->a, ast->b, ast->c})
+
+Visitor::Visitor() : work_(nullptr), current_(nullptr) {}
+
+void Visitor::visit(Ast *ast) {
+  if (!ast) {
+    return;
+  }
+  std::vector<Ast *> work;
+  std::vector<Ast *> *savedWork = work_;
+  Ast *savedCurrent = current_;
+  work_ = &work;
+  work.push_back(ast);
+  try {
+    while (!work.empty()) {
+      current_ = work.back();
+      work.pop_back();
+      current_->accept(this);
+    }
+  } catch (...) {
+    work_ = savedWork;
+    current_ = savedCurrent;
+    throw;
+  }
+  work_ = savedWork;
+  current_ = savedCurrent;
+}
+
+void Visitor::accept(Ast *ast, std::initializer_list<Ast *> children) {
+  if (work_ && ast == current_) {
+    // push in reverse order, so children are popped in order
+    for (const Ast *const *it = children.end(); it != children.begin();) {
+      --it;
+      if (*it) {
+        work_->push_back(const_cast<Ast *>(*it));
+      }
+    }
+  } else {
+    for (const Ast *const *it = children.begin(); it != children.end(); ++it) {
+      if (*it) {
+        visit(const_cast<Ast *>(*it));
+      }
+    }
+  }
+}
 
 void Visitor::visitInteger(A_Integer *ast) {}
 void Visitor::visitFloat(A_Float *ast) {}
@@ -20,91 +61,47 @@ void Visitor::visitNil(A_Nil *ast) {}
 void Visitor::visitVoid(A_Void *ast) {}
 void Visitor::visitVarId(A_VarId *ast) {}
 
-void Visitor::visitThrow(A_Throw *ast) { ACCEPT(expr); }
-void Visitor::visitReturn(A_Return *ast) { ACCEPT(expr); }
+void Visitor::visitThrow(A_Throw *ast) { ACCEPT1(expr); }
+void Visitor::visitReturn(A_Return *ast) { ACCEPT1(expr); }
 
 void Visitor::visitBreak(A_Break *ast) {}
 void Visitor::visitContinue(A_Continue *ast) {}
 
-void Visitor::visitAssign(A_Assign *ast) {
-  ACCEPT(assignor);
-  ACCEPT(assignee);
-}
-void Visitor::visitPostfix(A_Postfix *ast) { ACCEPT(expr); }
-void Visitor::visitInfix(A_Infix *ast) {
-  ACCEPT(left);
-  ACCEPT(right);
-}
-void Visitor::visitPrefix(A_Prefix *ast) { ACCEPT(expr); }
-void Visitor::visitCall(A_Call *ast) {
-  ACCEPT(args);
-  ACCEPT(id);
-}
-void Visitor::visitExprs(A_Exprs *ast) {
-  ACCEPT(expr);
-  ACCEPT(next);
-}
-void Visitor::visitIf(A_If *ast) {
-  ACCEPT(condition);
-  ACCEPT(thenp);
-  ACCEPT(elsep);
-}
+void Visitor::visitAssign(A_Assign *ast) { ACCEPT2(assignor, assignee); }
+void Visitor::visitPostfix(A_Postfix *ast) { ACCEPT1(expr); }
+void Visitor::visitInfix(A_Infix *ast) { ACCEPT2(left, right); }
+void Visitor::visitPrefix(A_Prefix *ast) { ACCEPT1(expr); }
+void Visitor::visitCall(A_Call *ast) { ACCEPT2(args, id); }
+void Visitor::visitExprs(A_Exprs *ast) { ACCEPT2(expr, next); }
+void Visitor::visitIndex(A_Index *ast) { ACCEPT2(expr, index); }
+void Visitor::visitNew(A_New *ast) { ACCEPT2(type, count); }
+void Visitor::visitDelete(A_Delete *ast) { ACCEPT1(expr); }
+void Visitor::visitAwait(A_Await *ast) { ACCEPT1(expr); }
+void Visitor::visitIf(A_If *ast) { ACCEPT3(condition, thenp, elsep); }
 void Visitor::visitLoop(A_Loop *ast) {
-  ACCEPT(condition);
-  ACCEPT(body);
+  ACCEPT3(condition, reductions, body);
 }
-void Visitor::visitYield(A_Yield *ast) { ACCEPT(expr); }
+void Visitor::visitYield(A_Yield *ast) { ACCEPT1(expr); }
 void Visitor::visitLoopCondition(A_LoopCondition *ast) {
-  ACCEPT(init);
-  ACCEPT(condition);
-  ACCEPT(update);
+  ACCEPT3(init, condition, update);
 }
 void Visitor::visitLoopEnumerator(A_LoopEnumerator *ast) {
-  ACCEPT(expr);
-  ACCEPT(type);
-  ACCEPT(id);
-}
-void Visitor::visitDoWhile(A_DoWhile *ast) {
-  ACCEPT(body);
-  ACCEPT(condition);
-}
-void Visitor::visitTry(A_Try *ast) {
-  ACCEPT(tryp);
-  ACCEPT(catchp);
-  ACCEPT(finallyp);
-}
-void Visitor::visitBlock(A_Block *ast) { ACCEPT(blockStats); }
-void Visitor::visitBlockStats(A_BlockStats *ast) {
-  ACCEPT(blockStat);
-  ACCEPT(next);
+  ACCEPT3(expr, type, id);
 }
+void Visitor::visitDoWhile(A_DoWhile *ast) { ACCEPT2(body, condition); }
+void Visitor::visitTry(A_Try *ast) { ACCEPT3(tryp, catchp, finallyp); }
+void Visitor::visitBlock(A_Block *ast) { ACCEPT1(blockStats); }
+void Visitor::visitBlockStats(A_BlockStats *ast) { ACCEPT2(blockStat, next); }
 
 void Visitor::visitPlainType(A_PlainType *ast) {}
+void Visitor::visitArrayType(A_ArrayType *ast) { ACCEPT1(elementType); }
 
 void Visitor::visitFuncDef(A_FuncDef *ast) {
-  ACCEPT(resultType);
-  ACCEPT(funcSign);
-  ACCEPT(body);
-}
-void Visitor::visitFuncSign(A_FuncSign *ast) {
-  ACCEPT(params);
-  ACCEPT(id);
-}
-void Visitor::visitParams(A_Params *ast) {
-  ACCEPT(param);
-  ACCEPT(next);
-}
-void Visitor::visitParam(A_Param *ast) {
-  ACCEPT(type);
-  ACCEPT(id);
-}
-void Visitor::visitVarDef(A_VarDef *ast) {
-  ACCEPT(expr);
-  ACCEPT(type);
-  ACCEPT(id);
-}
-void Visitor::visitTopStats(A_TopStats *ast) {
-  ACCEPT(topStat);
-  ACCEPT(next);
-}
-void Visitor::visitCompileUnit(A_CompileUnit *ast) { ACCEPT(topStats); }
+  ACCEPT3(resultType, funcSign, body);
+}
+void Visitor::visitFuncSign(A_FuncSign *ast) { ACCEPT2(params, id); }
+void Visitor::visitParams(A_Params *ast) { ACCEPT2(param, next); }
+void Visitor::visitParam(A_Param *ast) { ACCEPT2(type, id); }
+void Visitor::visitVarDef(A_VarDef *ast) { ACCEPT3(expr, type, id); }
+void Visitor::visitTopStats(A_TopStats *ast) { ACCEPT2(topStat, next); }
+void Visitor::visitCompileUnit(A_CompileUnit *ast) { ACCEPT1(topStats); }
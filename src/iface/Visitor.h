@@ -2,12 +2,29 @@
 // Apache License Version 2.0
 
 #pragma once
+#include "Ast.h"
 #include "AstClasses.h"
+#include <initializer_list>
+#include <utility>
+#include <vector>
 
 class Visitor {
 public:
+  Visitor();
   virtual ~Visitor() = default;
 
+  // visit ast tree with a heap allocated work stack instead of recursion.
+  //
+  // default visit methods dispatched from the work stack push children on it,
+  // so deep ast tree doesn't overflow native stack. default visit methods
+  // called in other ways (for example `ast->body->accept(this)` in an
+  // overridden visit method) still visit all children before return.
+  //
+  // note: overridden visit method calls its default visit method (e.g.
+  // `Visitor::visitIf(ast)`) should not depend on children are visited after
+  // it returns.
+  virtual void visit(Ast *ast);
+
   // by default do nothing
   virtual void visitInteger(A_Integer *ast);
   virtual void visitFloat(A_Float *ast);
@@ -29,6 +46,10 @@ public:
   virtual void visitPrefix(A_Prefix *ast);
   virtual void visitCall(A_Call *ast);
   virtual void visitExprs(A_Exprs *ast);
+  virtual void visitIndex(A_Index *ast);
+  virtual void visitNew(A_New *ast);
+  virtual void visitDelete(A_Delete *ast);
+  virtual void visitAwait(A_Await *ast);
   virtual void visitIf(A_If *ast);
   virtual void visitLoop(A_Loop *ast);
   virtual void visitYield(A_Yield *ast);
@@ -39,6 +60,7 @@ public:
   virtual void visitBlock(A_Block *ast);
   virtual void visitBlockStats(A_BlockStats *ast);
   virtual void visitPlainType(A_PlainType *ast);
+  virtual void visitArrayType(A_ArrayType *ast);
   virtual void visitFuncDef(A_FuncDef *ast);
   virtual void visitFuncSign(A_FuncSign *ast);
   virtual void visitParams(A_Params *ast);
@@ -46,4 +68,44 @@ public:
   virtual void visitVarDef(A_VarDef *ast);
   virtual void visitTopStats(A_TopStats *ast);
   virtual void visitCompileUnit(A_CompileUnit *ast);
+
+private:
+  void accept(Ast *ast, std::initializer_list<Ast *> children);
+
+  std::vector<Ast *> *work_;
+  Ast *current_;
 };
+
+/**
+ * visit infix expression tree in post-order with a heap allocated stack, so
+ * deeply nested infix expressions don't recurse.
+ *
+ * non-infix operands are visited by visitor in evaluation order, then infix
+ * node is combined from its operands by `f`.
+ */
+template <typename F>
+void postorderInfix(A_Infix *ast, Visitor *visitor, F f) {
+  // the bool is true when left operand is visited
+  std::vector<std::pair<A_Infix *, bool>> stack;
+  stack.push_back(std::make_pair(ast, false));
+  while (!stack.empty()) {
+    A_Infix *e = stack.back().first;
+    if (stack.back().second) {
+      stack.pop_back();
+      if (e->right->kind() != (+AstKind::Infix)) {
+        e->right->accept(visitor);
+      }
+      f(e);
+      continue;
+    }
+    stack.back().second = true;
+    if (e->right->kind() == (+AstKind::Infix)) {
+      stack.push_back(std::make_pair(static_cast<A_Infix *>(e->right), false));
+    }
+    if (e->left->kind() == (+AstKind::Infix)) {
+      stack.push_back(std::make_pair(static_cast<A_Infix *>(e->left), false));
+    } else {
+      e->left->accept(visitor);
+    }
+  }
+}
@@ -5,6 +5,10 @@
 
 Counter::Counter(unsigned long long value) : value_(value) {}
 
-unsigned long long Counter::count() { return value_++; }
+unsigned long long Counter::count() {
+  return value_.fetch_add(1ULL, std::memory_order_relaxed);
+}
 
-unsigned long long Counter::total() const { return value_; }
+unsigned long long Counter::total() const {
+  return value_.load(std::memory_order_relaxed);
+}
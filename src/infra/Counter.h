@@ -3,7 +3,9 @@
 
 #pragma once
 #include "infra/Cowstr.h"
+#include <atomic>
 
+// thread-safe counter
 class Counter {
 public:
   Counter(unsigned long long value = 1ULL);
@@ -12,5 +14,5 @@ public:
   unsigned long long total() const;
 
 private:
-  unsigned long long value_;
+  std::atomic<unsigned long long> value_;
 };
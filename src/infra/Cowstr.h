@@ -265,8 +265,11 @@ std::ostream &operator<<(std::ostream &os, const Cowstr &s);
 
 namespace fmt {
 
+// taken by reference, copying a Cowstr changes its reference count, which is
+// not atomic while names of shared symbols are formatted concurrently
 template <> struct formatter<Cowstr> : formatter<std::string> {
-  template <typename FormatContext> auto format(Cowstr s, FormatContext &ctx) {
+  template <typename FormatContext>
+  auto format(const Cowstr &s, FormatContext &ctx) {
     return formatter<std::string>::format(s.str(), ctx);
   }
 };
@@ -0,0 +1,42 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include <utility>
+#include <vector>
+
+/**
+ * FlatMap is an open-addressing hash map from a non-negative integer key (for
+ * example interned name id, see Interner) to value.
+ *
+ * All entries are stored in one flat array with linear probing, a lookup is an
+ * integer hash and a few adjacent memory reads, there's no node allocation and
+ * pointer chasing.
+ *
+ * V must be default constructible and copyable, `find` returns V() when key not
+ * found, so it's usually a pointer type.
+ */
+template <typename V> class FlatMap {
+public:
+  FlatMap();
+  virtual ~FlatMap() = default;
+
+  // insert or update
+  void insert(int key, const V &value);
+  V find(int key) const;
+  bool contains(int key) const;
+  bool empty() const;
+  int size() const;
+  int capacity() const;
+  void clear();
+
+private:
+  // first slot of key
+  int slot(int key) const;
+  void rehash(int capacity);
+
+  // key -1 means empty slot
+  std::vector<std::pair<int, V>> data_;
+  int size_;
+  int bits_;
+};
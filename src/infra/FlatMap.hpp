@@ -0,0 +1,102 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "infra/FlatMap.h"
+#include "infra/Log.h"
+#include <cstdint>
+
+#define FM_EMPTY -1
+// rehash when load factor > 1/2
+#define FM_LOAD(size, capacity) ((size)*2 > (capacity))
+#define FM_MIN_BITS 3
+
+template <typename V> FlatMap<V>::FlatMap() : size_(0), bits_(0) {}
+
+template <typename V> void FlatMap<V>::insert(int key, const V &value) {
+  LOG_ASSERT(key >= 0, "key {} must be non-negative", key);
+  if (data_.empty() || FM_LOAD(size_ + 1, (int)data_.size())) {
+    rehash(data_.empty() ? (1 << FM_MIN_BITS) : (int)data_.size() * 2);
+  }
+  int mask = (int)data_.size() - 1;
+  for (int i = slot(key);; i = (i + 1) & mask) {
+    if (data_[i].first == key) {
+      data_[i].second = value;
+      return;
+    }
+    if (data_[i].first == FM_EMPTY) {
+      data_[i] = std::make_pair(key, value);
+      size_++;
+      return;
+    }
+  }
+}
+
+template <typename V> V FlatMap<V>::find(int key) const {
+  if (data_.empty()) {
+    return V();
+  }
+  int mask = (int)data_.size() - 1;
+  for (int i = slot(key);; i = (i + 1) & mask) {
+    if (data_[i].first == key) {
+      return data_[i].second;
+    }
+    if (data_[i].first == FM_EMPTY) {
+      return V();
+    }
+  }
+}
+
+template <typename V> bool FlatMap<V>::contains(int key) const {
+  if (data_.empty()) {
+    return false;
+  }
+  int mask = (int)data_.size() - 1;
+  for (int i = slot(key);; i = (i + 1) & mask) {
+    if (data_[i].first == key) {
+      return true;
+    }
+    if (data_[i].first == FM_EMPTY) {
+      return false;
+    }
+  }
+}
+
+template <typename V> bool FlatMap<V>::empty() const { return size_ == 0; }
+
+template <typename V> int FlatMap<V>::size() const { return size_; }
+
+template <typename V> int FlatMap<V>::capacity() const {
+  return (int)data_.size();
+}
+
+template <typename V> void FlatMap<V>::clear() {
+  data_.clear();
+  size_ = 0;
+  bits_ = 0;
+}
+
+template <typename V> int FlatMap<V>::slot(int key) const {
+  // fibonacci hashing, take the high bits of the product
+  return (int)(((uint32_t)key * 2654435769U) >> (32 - bits_));
+}
+
+template <typename V> void FlatMap<V>::rehash(int capacity) {
+  std::vector<std::pair<int, V>> old;
+  old.swap(data_);
+  data_.resize(capacity, std::make_pair(FM_EMPTY, V()));
+  bits_ = 0;
+  while ((1 << bits_) < capacity) {
+    bits_++;
+  }
+  size_ = 0;
+  for (int i = 0; i < (int)old.size(); i++) {
+    if (old[i].first != FM_EMPTY) {
+      insert(old[i].first, old[i].second);
+    }
+  }
+}
+
+#undef FM_EMPTY
+#undef FM_LOAD
+#undef FM_MIN_BITS
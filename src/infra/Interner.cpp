@@ -0,0 +1,113 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "infra/Interner.h"
+#include "infra/Log.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace detail {
+
+// name is hashed once, both to select its shard and to find it in the shard
+struct InternKey {
+  llvm::StringRef name;
+  size_t hash;
+
+  explicit InternKey(llvm::StringRef s)
+      : name(s), hash((size_t)llvm::hash_value(s)) {}
+  bool operator==(const InternKey &other) const { return name == other.name; }
+};
+
+struct InternKeyHash {
+  size_t operator()(const InternKey &key) const { return key.hash; }
+};
+
+// names are stored as std::string, Cowstr shares its buffer with a
+// non-atomic reference count, so it cannot be shared across threads.
+//
+// lookup of a name only takes a read lock of its shard, and refers to the
+// caller's buffer without copy. keys refer to strings in `names` of the
+// shard, std::deque doesn't move them when it grows.
+struct InternShard {
+  std::shared_timed_mutex lock;
+  std::unordered_map<InternKey, int, InternKeyHash> ids;
+  std::deque<std::string> names;
+};
+
+struct InternTable {
+  static const int Shards = 16;
+
+  InternShard shards[Shards];
+  // names by id, only locked to create an id or read a name of id
+  std::shared_timed_mutex lock;
+  std::vector<const std::string *> names;
+
+  InternShard &shard(const InternKey &key) {
+    return shards[(key.hash >> 8) % Shards];
+  }
+};
+
+static InternTable &internTable() {
+  static InternTable table;
+  return table;
+}
+
+} // namespace detail
+
+int Interner::intern(const Cowstr &name) {
+  detail::InternTable &t = detail::internTable();
+  detail::InternKey key(llvm::StringRef(name.str()));
+  detail::InternShard &shard = t.shard(key);
+  {
+    std::shared_lock<std::shared_timed_mutex> guard(shard.lock);
+    auto it = shard.ids.find(key);
+    if (it != shard.ids.end()) {
+      return it->second;
+    }
+  }
+  std::lock_guard<std::shared_timed_mutex> guard(shard.lock);
+  auto it = shard.ids.find(key);
+  if (it != shard.ids.end()) {
+    return it->second;
+  }
+  shard.names.push_back(name.str());
+  const std::string &stored = shard.names.back();
+  int id;
+  {
+    std::lock_guard<std::shared_timed_mutex> namesGuard(t.lock);
+    id = (int)t.names.size();
+    t.names.push_back(&stored);
+  }
+  shard.ids.insert(
+      std::make_pair(detail::InternKey(llvm::StringRef(stored)), id));
+  return id;
+}
+
+int Interner::find(const Cowstr &name) {
+  detail::InternTable &t = detail::internTable();
+  detail::InternKey key(llvm::StringRef(name.str()));
+  detail::InternShard &shard = t.shard(key);
+  std::shared_lock<std::shared_timed_mutex> guard(shard.lock);
+  auto it = shard.ids.find(key);
+  return it == shard.ids.end() ? -1 : it->second;
+}
+
+Cowstr Interner::name(int id) {
+  detail::InternTable &t = detail::internTable();
+  std::shared_lock<std::shared_timed_mutex> guard(t.lock);
+  LOG_ASSERT(id >= 0 && id < (int)t.names.size(), "invalid id {}", id);
+  return Cowstr(*t.names[id]);
+}
+
+int Interner::size() {
+  detail::InternTable &t = detail::internTable();
+  std::shared_lock<std::shared_timed_mutex> guard(t.lock);
+  return (int)t.names.size();
+}
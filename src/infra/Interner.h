@@ -0,0 +1,30 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "infra/Cowstr.h"
+
+/**
+ * Interner maps each distinct name to a dense integer id, starts from 0.
+ *
+ * A name is hashed only once when it's interned (for example when an
+ * identifier is parsed), after that symbol tables compare integer ids instead
+ * of hashing and comparing strings.
+ *
+ * It's thread-safe. Names are sharded by hash, lookup of an interned name
+ * only takes a read lock of its shard, and doesn't copy the name.
+ */
+class Interner {
+public:
+  // intern name and returns its id
+  static int intern(const Cowstr &name);
+
+  // returns id of name, or -1 if name is not interned
+  static int find(const Cowstr &name);
+
+  // returns name of id
+  static Cowstr name(int id);
+
+  // count of interned names
+  static int size();
+};
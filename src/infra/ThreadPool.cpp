@@ -0,0 +1,59 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "infra/ThreadPool.h"
+#include "infra/Log.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads) : stop_(false) {
+  LOG_ASSERT(threads > 0, "threads {} must be positive", threads);
+  for (int i = 0; i < threads; i++) {
+    workers_.push_back(std::thread([this]() { work(); }));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  for (int i = 0; i < (int)workers_.size(); i++) {
+    workers_[i].join();
+  }
+}
+
+std::future<void> ThreadPool::submit(const std::function<void()> &task) {
+  std::packaged_task<void()> pt(task);
+  std::future<void> f = pt.get_future();
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    LOG_ASSERT(!stop_, "thread pool already stopped");
+    tasks_.push_back(std::move(pt));
+  }
+  cond_.notify_one();
+  return f;
+}
+
+int ThreadPool::threads() const { return (int)workers_.size(); }
+
+int ThreadPool::defaultThreads() {
+  return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::packaged_task<void()> task;
+    {
+      std::unique_lock<std::mutex> guard(lock_);
+      cond_.wait(guard, [this]() { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    // exception is stored in the future
+    task();
+  }
+}
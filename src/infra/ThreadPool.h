@@ -0,0 +1,40 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * ThreadPool runs submitted tasks on a fixed number of worker threads.
+ *
+ * `submit` returns a future of the task, an exception thrown by the task is
+ * rethrown by `future::get` in caller thread.
+ *
+ * The destructor finishes all submitted tasks, then joins the workers.
+ */
+class ThreadPool {
+public:
+  ThreadPool(int threads = defaultThreads());
+  virtual ~ThreadPool();
+
+  std::future<void> submit(const std::function<void()> &task);
+  int threads() const;
+
+  // hardware concurrency, at least 1
+  static int defaultThreads();
+
+private:
+  void work();
+
+  std::vector<std::thread> workers_;
+  std::deque<std::packaged_task<void()>> tasks_;
+  std::mutex lock_;
+  std::condition_variable cond_;
+  bool stop_;
+};
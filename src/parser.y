@@ -12,6 +12,7 @@
 #include "Scanner.h"
 #include "tokenizer.yy.hh"
 #include <cstdlib>
+#include <cstring>
 
 #define Y_SCANNER       (static_cast<Scanner*>(yyget_extra(yyscanner)))
 
@@ -63,6 +64,7 @@ class Ast;
 %token<token> T_NIL "nil"
 %token<token> T_NEW "new"
 %token<token> T_DELETE "delete"
+%token<token> T_REGION "region"
 %token<token> T_DEF "def"
 %token<token> T_IF "if"
 %token<token> T_THEN "then"
@@ -95,6 +97,7 @@ class Ast;
 %token<token> T_INF "inf"
 %token<token> T_ASYNC "async"
 %token<token> T_AWAIT "await"
+%token<token> T_REDUCE "reduce"
 %token<token> T_STATIC "static"
 %token<token> T_PUBLIC "public"
 %token<token> T_PROTECT "protect"
@@ -102,6 +105,7 @@ class Ast;
 %token<token> T_PREFIX "prefix"
 %token<token> T_POSTFIX "postfix"
 %token<token> T_PACKAGE "package"
+%token<token> T_CONST "const"
 
  /* primitive type */
 %token<token> T_BYTE "byte"
@@ -117,6 +121,18 @@ class Ast;
 %token<token> T_BOOLEAN "boolean"
 %token<token> T_CHAR "char"
 
+ /* simd vector type */
+%token<token> T_BYTE16 "byte16"
+%token<token> T_SHORT8 "short8"
+%token<token> T_INT4 "int4"
+%token<token> T_INT8 "int8"
+%token<token> T_LONG2 "long2"
+%token<token> T_LONG4 "long4"
+%token<token> T_FLOAT4 "float4"
+%token<token> T_FLOAT8 "float8"
+%token<token> T_DOUBLE2 "double2"
+%token<token> T_DOUBLE4 "double4"
+
  /* operator */
 %token<token> T_AND "and"
 %token<token> T_OR "or"
@@ -197,10 +213,11 @@ class Ast;
  /* id */
 %type<ast> id varId
  /* expr */
-%type<ast> expr exprs enumerators assignExpr prefixExpr postfixExpr infixExpr primaryExpr callExpr block blockStat blockStats
+%type<ast> expr exprs enumerators assignExpr assignee prefixExpr postfixExpr infixExpr primaryExpr callExpr indexExpr block blockStat blockStats
 %type<ast> optionalExprs optionalBlockStats optionalVarDef optionalExpr
+%type<ast> optionalReductions reductions reduction vectorReduction
  /* type */
-%type<ast> type plainType
+%type<ast> type plainType arrayType vectorType
  /* def */
 %type<ast> def funcDef varDef funcSign resultType param params
 %type<ast> /* optionalResultType */ optionalParams
@@ -246,11 +263,11 @@ class Ast;
 %left "&"
 %left "==" "!="
 %left "<" "<=" ">" ">="
+%nonassoc ".."
 %left "<<" ">>" ">>>"
 %left "+" "-"
 %left "*" "/" "%"
 %left "++" "--"
-%left ".."
 /* %right "::" */
 
  /* unary op */
@@ -333,6 +350,8 @@ varId : T_VAR_ID { $$ = new A_VarId($1, @$); std::free($1); }
   *     add `optionalNewlines` after `do expr` to enable newlines here
   * 3. for
   *     add `optionalNewlines` after `for (enumerators)` to enable newlines here
+  *     `for (enumerators) yield expr` is a for loop whose body is `yield expr`
+  *     `foreach (i:T <- a..b; + s, min t, max u) expr` is a parallel loop with optional reductions
   * 4. try-catch-finally
   *     use `%prec "try_catch"` and `%prec "try_catch_finally"` and `%right "catch" "finally"` to fix dangling finally shift/reduce
   *     use magic `try-ws` token to eat all whitespaces after real keyword `try`, `ws-catch-ws` `ws-finally-ws` token to eat all whitespaces around real keyword `catch` `finally`
@@ -342,11 +361,15 @@ expr : "if" "(" expr ")" optionalNewlines expr %prec "then" { $$ = new A_If($3,
      | "if" "(" expr ")" optionalNewlines expr "else" expr %prec "else" { $$ = new A_If($3, $6, $8, @$); }
      | "while" "(" expr ")" optionalNewlines expr %prec "while" { Ast* loopCondition = new A_LoopCondition(nullptr, $3, nullptr, @3); $$ = new A_Loop(loopCondition, $6, @$); }
      | "do" expr optionalNewlines "while" "(" expr ")" %prec "do_while" { $$ = new A_DoWhile($2, $6, @$); }
-     | "for" "(" enumerators ")" optionalNewlines "yield" expr { Ast* loopYield = new A_Yield($7, @7); $$ = new A_Loop($3, loopYield, @$); }
      | "for" "(" enumerators ")" optionalNewlines expr { $$ = new A_Loop($3, $6, @$); }
+     | "foreach" "(" enumerators optionalReductions ")" optionalNewlines expr { $$ = new A_Loop($3, static_cast<A_Exprs*>($4), $7, @$); }
      | "try" expr "catch" expr %prec "try_catch" { $$ = new A_Try($2, $4, nullptr, @$); }
      | "try" expr "catch" expr "finally" expr %prec "try_catch_finally" { $$ = new A_Try($2, $4, $6, @$); }
      | "throw" expr { $$ = new A_Throw($2, @$); }
+     | "yield" expr { $$ = new A_Yield($2, @$); }
+     | "delete" expr { $$ = new A_Delete($2, @$); }
+     | "await" expr { $$ = new A_Await($2, @$); }
+     | "region" block { static_cast<A_Block*>($2)->region = true; $$ = $2; }
      | "return" %prec "return" { $$ = new A_Return(nullptr, @$); }
      | "return" expr %prec "return_expr" { $$ = new A_Return($2, @$); }
      | "continue" { $$ = new A_Continue(@$); }
@@ -359,6 +382,28 @@ enumerators : id ":" type "<-" expr { $$ = new A_LoopEnumerator($1, $3, $5, @$);
             | optionalVarDef ";" optionalExpr ";" optionalExpr { $$ = new A_LoopCondition($1, $3, $5, @$); }
             ;
 
+optionalReductions : ";" reductions { $$ = reverse(static_cast<A_Exprs*>($2)); }
+                   | %empty { $$ = nullptr; }
+                   ;
+
+reductions : reduction { $$ = new A_Exprs($1, nullptr, @$); }
+           | reductions "," reduction { $$ = new A_Exprs($3, static_cast<A_Exprs*>($1), @$); }
+           ;
+
+/* `min s` and `max s` are stored as `< s` and `> s` */
+reduction : "+" id { $$ = new A_Prefix($1, $2, @$); }
+          | T_VAR_ID id {
+                int op = std::strcmp($1, "min") == 0 ? T_LT : (std::strcmp($1, "max") == 0 ? T_GT : 0);
+                std::free($1);
+                if (!op) {
+                    delete $2;
+                    yyerror(&@1, yyscanner, "reduction must be +, min or max");
+                    YYERROR;
+                }
+                $$ = new A_Prefix(op, $2, @$);
+            }
+          ;
+
 optionalVarDef : varDef { $$ = $1; }
                | %empty { $$ = nullptr; }
                ;
@@ -372,20 +417,24 @@ optionalExpr : expr { $$ = $1; }
  * "=" "+=" "-=" "*=" "/=" "%=" "&=" "|=" "^=" "<<=" ">>=" ">>>="
  */
 
-assignExpr : id "=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id "+=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id "-=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id "*=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id "/=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id "%=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id "&=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id "|=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id "^=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id "<<=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id ">>=" expr { $$ = new A_Assign($1, $2, $3, @$); }
-           | id ">>>=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+assignExpr : assignee "=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee "+=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee "-=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee "*=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee "/=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee "%=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee "&=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee "|=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee "^=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee "<<=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee ">>=" expr { $$ = new A_Assign($1, $2, $3, @$); }
+           | assignee ">>>=" expr { $$ = new A_Assign($1, $2, $3, @$); }
            ;
 
+assignee : id { $$ = $1; }
+         | indexExpr { $$ = $1; }
+         ;
+
 /**
  * postfix operator
  * "++" "--"
@@ -423,6 +472,7 @@ infixExpr : prefixExpr { $$ = $1; }
           | infixExpr "*" optionalNewline infixExpr { $$ = new A_Infix($1, $2, $4, @$); }
           | infixExpr "/" optionalNewline infixExpr { $$ = new A_Infix($1, $2, $4, @$); }
           | infixExpr "%" optionalNewline infixExpr { $$ = new A_Infix($1, $2, $4, @$); }
+          | infixExpr ".." optionalNewline infixExpr { $$ = new A_Infix($1, $2, $4, @$); }
           ;
 
 /**
@@ -444,9 +494,27 @@ primaryExpr : literal { $$ = $1; }
             | id { $$ = $1; }
             | "(" optionalExprs ")" { $$ = $2; }
             | callExpr { $$ = $1; }
+            | indexExpr { $$ = $1; }
+            | "new" plainType "[" expr "]" { $$ = new A_New($2, $4, @$); }
+            | vectorType "(" optionalExprs ")" { $$ = new A_Call($1, static_cast<A_Exprs*>($3), @$); }
+            | "reduce" "(" vectorReduction ")" { $$ = new A_Prefix($1, $3, @$); }
             | block { $$ = $1; }
             ;
 
+/* `reduce(+ v)` is a horizontal reduction of vector, stored as prefix `reduce` of reduction `+ v` like foreach */
+vectorReduction : "+" expr { $$ = new A_Prefix($1, $2, @$); }
+                | T_VAR_ID expr {
+                      int op = std::strcmp($1, "min") == 0 ? T_LT : (std::strcmp($1, "max") == 0 ? T_GT : 0);
+                      std::free($1);
+                      if (!op) {
+                          delete $2;
+                          yyerror(&@1, yyscanner, "reduction must be +, min or max");
+                          YYERROR;
+                      }
+                      $$ = new A_Prefix(op, $2, @$);
+                  }
+                ;
+
 optionalExprs : exprs { $$ = reverse(static_cast<A_Exprs*>($1)); }
               | %empty { $$ = nullptr; }
               ;
@@ -458,6 +526,12 @@ exprs : expr { $$ = new A_Exprs($1, nullptr, @$); }
 callExpr : id "(" optionalExprs ")" { $$ = new A_Call($1, static_cast<A_Exprs*>($3), @$); }
          ;
 
+/* `v[i, j, ...]` shuffles lanes of vector v, its index is the list of lanes */
+indexExpr : id "[" expr "]" { $$ = new A_Index($1, $3, @$); }
+          | callExpr "[" expr "]" { $$ = new A_Index($1, $3, @$); }
+          | id "[" expr "," exprs "]" { $$ = new A_Index($1, new A_Exprs($3, reverse(static_cast<A_Exprs*>($5)), @3), @$); }
+          ;
+
 block : "{" blockStat optionalBlockStats "}" {
             A_BlockStats* blockStats = reverse(static_cast<A_BlockStats*>($3));
             blockStats = ($2)
@@ -486,6 +560,7 @@ blockStats : seminl blockStat { $$ = ($2) ? (new A_BlockStats($2, nullptr, @$))
  /* type { */
 
 type : plainType { $$ = $1; }
+     | arrayType { $$ = $1; }
      /* | FuncArgtypes RARROW type */
      /* | idType */
      ;
@@ -514,6 +589,34 @@ plainType : "byte" { $$ = new A_PlainType($1, @$); }
           | "boolean" { $$ = new A_PlainType($1, @$); }
           | "char" { $$ = new A_PlainType($1, @$); }
           | "void" { $$ = new A_PlainType($1, @$); }
+          | vectorType { $$ = $1; }
+          ;
+
+vectorType : "byte16" { $$ = new A_PlainType($1, @$); }
+           | "short8" { $$ = new A_PlainType($1, @$); }
+           | "int4" { $$ = new A_PlainType($1, @$); }
+           | "int8" { $$ = new A_PlainType($1, @$); }
+           | "long2" { $$ = new A_PlainType($1, @$); }
+           | "long4" { $$ = new A_PlainType($1, @$); }
+           | "float4" { $$ = new A_PlainType($1, @$); }
+           | "float8" { $$ = new A_PlainType($1, @$); }
+           | "double2" { $$ = new A_PlainType($1, @$); }
+           | "double4" { $$ = new A_PlainType($1, @$); }
+           ;
+
+/* `T[N]` is a fixed-size array of literal length, `T[]` is a slice */
+arrayType : plainType "[" "]" { $$ = new A_ArrayType($1, @$); }
+          | plainType "[" T_INTEGER_LITERAL "]" {
+                A_Integer length($3, @3);
+                std::free($3);
+                int64_t n = length.bit() == 64 ? length.asInt64() : (int64_t)length.asInt32();
+                if (n <= 0) {
+                    delete $1;
+                    yyerror(&@3, yyscanner, "array length must be positive");
+                    YYERROR;
+                }
+                $$ = new A_ArrayType($1, n, @$);
+            }
           ;
 
 /* idType : id */
@@ -531,6 +634,10 @@ def : funcDef { $$ = $1; }
 
 funcDef : "def" funcSign resultType "=" expr { $$ = new A_FuncDef($2, $3, $5, @$); }
         | "def" funcSign resultType optionalNewlines block { $$ = new A_FuncDef($2, $3, $5, @$); }
+        | "const" "def" funcSign resultType "=" expr { $$ = new A_FuncDef($3, $4, $6, @$, true); }
+        | "const" "def" funcSign resultType optionalNewlines block { $$ = new A_FuncDef($3, $4, $6, @$, true); }
+        | "async" "def" funcSign resultType "=" expr { A_FuncDef *funcDef = new A_FuncDef($3, $4, $6, @$); funcDef->async = true; $$ = funcDef; }
+        | "async" "def" funcSign resultType optionalNewlines block { A_FuncDef *funcDef = new A_FuncDef($3, $4, $6, @$); funcDef->async = true; $$ = funcDef; }
         ;
 
 /* optionalResultType : resultType { $$ = nullptr; } */
@@ -556,6 +663,7 @@ param : id ":" type { $$ = new A_Param($1, $3, @$); }
       ;
 
 varDef : "var" id ":" type "=" expr { $$ = new A_VarDef($2, $4, $6, @$); }
+       | "val" id ":" type "=" expr { $$ = new A_VarDef($2, $4, $6, @$, true); }
        ;
 
 /* Decl : "var" varDecl */
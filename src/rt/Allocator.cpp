@@ -0,0 +1,311 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Allocator.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace dimrt {
+
+namespace {
+
+const int SmallStep = 16;
+const int SmallClasses = 16;
+const int SplitClasses = 8;
+
+int log2Floor(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(x);
+#else
+  int n = -1;
+  while (x) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+void *mapOs(uint64_t bytes) {
+#ifdef _WIN32
+  void *p = VirtualAlloc(nullptr, (SIZE_T)bytes, MEM_RESERVE | MEM_COMMIT,
+                         PAGE_READWRITE);
+#else
+  void *p = mmap(nullptr, (size_t)bytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    p = nullptr;
+  }
+#endif
+  if (!p) {
+    std::fprintf(stderr, "dimrt: out of memory, cannot map %llu bytes\n",
+                 (unsigned long long)bytes);
+    std::abort();
+  }
+  return p;
+}
+
+void unmapOs(void *p, uint64_t bytes) {
+#ifdef _WIN32
+  VirtualFree(p, 0, MEM_RELEASE);
+#else
+  munmap(p, (size_t)bytes);
+#endif
+}
+
+// map a chunk aligned to its size, so it can be backed by huge pages
+char *mapChunk() {
+#ifdef _WIN32
+  return static_cast<char *>(mapOs(PageHeap::ChunkSize));
+#else
+  uint64_t bytes = PageHeap::ChunkSize * 2;
+  char *p = static_cast<char *>(mapOs(bytes));
+  uintptr_t begin = reinterpret_cast<uintptr_t>(p);
+  uintptr_t aligned = (begin + PageHeap::ChunkSize - 1) &
+                      ~(uintptr_t)(PageHeap::ChunkSize - 1);
+  char *chunk = reinterpret_cast<char *>(aligned);
+  if (chunk > p) {
+    unmapOs(p, (uint64_t)(chunk - p));
+  }
+  char *end = chunk + PageHeap::ChunkSize;
+  if (end < p + bytes) {
+    unmapOs(end, (uint64_t)(p + bytes - end));
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(chunk, PageHeap::ChunkSize, MADV_HUGEPAGE);
+#endif
+  return chunk;
+#endif
+}
+
+uint64_t roundUp(uint64_t x, uint64_t align) {
+  return (x + align - 1) / align * align;
+}
+
+// free objects are linked through their first word
+void *&next(void *p) { return *static_cast<void **>(p); }
+
+PageHeap &pageHeap() {
+  // never destroyed, threads exiting after main still release to it
+  static PageHeap *heap = new PageHeap();
+  return *heap;
+}
+
+CentralList *centralLists() {
+  static CentralList *lists = new CentralList[SizeClass::Count];
+  return lists;
+}
+
+struct FreeList {
+  void *head;
+  int length;
+};
+
+class ThreadCache {
+public:
+  ThreadCache() {
+    for (int i = 0; i < SizeClass::Count; i++) {
+      lists_[i].head = nullptr;
+      lists_[i].length = 0;
+    }
+  }
+
+  ~ThreadCache() {
+    for (int i = 0; i < SizeClass::Count; i++) {
+      if (lists_[i].length > 0) {
+        releaseToCentral(i, lists_[i].length);
+      }
+    }
+  }
+
+  void *allocate(int cls) {
+    FreeList &list = lists_[cls];
+    if (!list.head) {
+      list.length = centralLists()[cls].fetch(
+          cls, &pageHeap(), SizeClass::batch(cls), &list.head);
+    }
+    void *p = list.head;
+    list.head = next(p);
+    list.length--;
+    return p;
+  }
+
+  void deallocate(void *p, int cls) {
+    FreeList &list = lists_[cls];
+    next(p) = list.head;
+    list.head = p;
+    list.length++;
+    if (list.length > 2 * SizeClass::batch(cls)) {
+      releaseToCentral(cls, SizeClass::batch(cls));
+    }
+  }
+
+private:
+  void releaseToCentral(int cls, int n) {
+    FreeList &list = lists_[cls];
+    void *head = list.head;
+    void *tail = head;
+    for (int i = 1; i < n; i++) {
+      tail = next(tail);
+    }
+    list.head = next(tail);
+    list.length -= n;
+    next(tail) = nullptr;
+    centralLists()[cls].release(head, tail, n);
+  }
+
+  FreeList lists_[SizeClass::Count];
+};
+
+ThreadCache &threadCache() {
+  static thread_local ThreadCache cache;
+  return cache;
+}
+
+} // namespace
+
+// SizeClass {
+
+const int SizeClass::Count;
+const uint64_t SizeClass::MaxSmall;
+
+int SizeClass::index(uint64_t size) {
+  if (size <= (uint64_t)SmallStep * SmallClasses) {
+    return size <= SmallStep ? 0
+                             : (int)((size + SmallStep - 1) / SmallStep) - 1;
+  }
+  uint64_t s = size - 1;
+  int b = log2Floor(s);
+  int offset = (int)((s - ((uint64_t)1 << b)) >> (b - 3));
+  return SmallClasses + (b - 8) * SplitClasses + offset;
+}
+
+uint64_t SizeClass::size(int cls) {
+  if (cls < SmallClasses) {
+    return (uint64_t)(cls + 1) * SmallStep;
+  }
+  int b = (cls - SmallClasses) / SplitClasses + 8;
+  int offset = (cls - SmallClasses) % SplitClasses;
+  return ((uint64_t)1 << b) + (uint64_t)(offset + 1) * ((uint64_t)1 << (b - 3));
+}
+
+int SizeClass::batch(int cls) {
+  uint64_t n = 64 * 1024 / size(cls);
+  return (int)std::max<uint64_t>(2, std::min<uint64_t>(64, n));
+}
+
+uint64_t SizeClass::slabBytes(int cls) {
+  uint64_t bytes = std::max<uint64_t>(
+      64 * 1024, roundUp(size(cls) * 8, PageHeap::PageSize));
+  return std::min<uint64_t>(bytes, PageHeap::ChunkSize);
+}
+
+// SizeClass }
+
+// PageHeap {
+
+const uint64_t PageHeap::PageSize;
+const uint64_t PageHeap::ChunkSize;
+
+PageHeap::PageHeap() : chunk_(nullptr), chunkUsed_(ChunkSize), mapped_(0) {}
+
+void *PageHeap::slab(uint64_t bytes) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (chunkUsed_ + bytes > ChunkSize) {
+    // rest of current chunk is left unused
+    chunk_ = mapChunk();
+    chunkUsed_ = 0;
+    mapped_ += ChunkSize;
+  }
+  void *p = chunk_ + chunkUsed_;
+  chunkUsed_ += bytes;
+  return p;
+}
+
+void *PageHeap::mapLarge(uint64_t bytes) {
+  bytes = roundUp(bytes, PageSize);
+  mapped_ += bytes;
+  return mapOs(bytes);
+}
+
+void PageHeap::unmapLarge(void *p, uint64_t bytes) {
+  bytes = roundUp(bytes, PageSize);
+  mapped_ -= bytes;
+  unmapOs(p, bytes);
+}
+
+uint64_t PageHeap::mappedBytes() const { return mapped_; }
+
+// PageHeap }
+
+// CentralList {
+
+CentralList::CentralList() : head_(nullptr), length_(0) {}
+
+int CentralList::fetch(int cls, PageHeap *pageHeap, int n, void **head) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (!head_) {
+    // carve a new slab into objects, linked in address order
+    uint64_t size = SizeClass::size(cls);
+    uint64_t bytes = SizeClass::slabBytes(cls);
+    char *slab = static_cast<char *>(pageHeap->slab(bytes));
+    int count = (int)(bytes / size);
+    for (int i = 0; i < count - 1; i++) {
+      next(slab + i * size) = slab + (i + 1) * size;
+    }
+    next(slab + (uint64_t)(count - 1) * size) = nullptr;
+    head_ = slab;
+    length_ = count;
+  }
+  int m = std::min(n, length_);
+  void *tail = head_;
+  for (int i = 1; i < m; i++) {
+    tail = next(tail);
+  }
+  *head = head_;
+  head_ = next(tail);
+  next(tail) = nullptr;
+  length_ -= m;
+  return m;
+}
+
+void CentralList::release(void *head, void *tail, int n) {
+  std::lock_guard<std::mutex> guard(lock_);
+  next(tail) = head_;
+  head_ = head;
+  length_ += n;
+}
+
+// CentralList }
+
+// Allocator {
+
+void *Allocator::allocate(uint64_t size) {
+  if (size > SizeClass::MaxSmall) {
+    return pageHeap().mapLarge(size);
+  }
+  return threadCache().allocate(SizeClass::index(size));
+}
+
+void Allocator::deallocate(void *p, uint64_t size) {
+  if (!p) {
+    return;
+  }
+  if (size > SizeClass::MaxSmall) {
+    pageHeap().unmapLarge(p, size);
+    return;
+  }
+  threadCache().deallocate(p, SizeClass::index(size));
+}
+
+uint64_t Allocator::mappedBytes() { return pageHeap().mappedBytes(); }
+
+// Allocator }
+
+} // namespace dimrt
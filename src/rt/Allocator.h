@@ -0,0 +1,103 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace dimrt {
+
+/**
+ * Size classes of small objects, each allocation is rounded up to its class.
+ *
+ * Sizes are 16-byte spaced up to 256 bytes, then each power of 2 is split
+ * into 8 classes, so rounding wastes at most 12.5% of a small object.
+ * Objects larger than `MaxSmall` are mapped from OS directly.
+ */
+class SizeClass {
+public:
+  static const int Count = 96;
+  static const uint64_t MaxSmall = 256 * 1024;
+
+  // class of size in [1, MaxSmall]
+  static int index(uint64_t size);
+  // object size of class
+  static uint64_t size(int cls);
+  // objects moved between thread cache and central list at once
+  static int batch(int cls);
+  // bytes of a slab carved into objects of class
+  static uint64_t slabBytes(int cls);
+};
+
+/**
+ * PageHeap maps memory from OS in 2MB chunks, backed by transparent huge pages
+ * where available, and carves slabs from them.
+ *
+ * Slabs are never returned, memory of a freed object is reused by objects of
+ * the same size class.
+ */
+class PageHeap {
+public:
+  static const uint64_t PageSize = 8 * 1024;
+  static const uint64_t ChunkSize = 2 * 1024 * 1024;
+
+  PageHeap();
+  // allocate slab of `bytes`, a multiple of PageSize no more than ChunkSize
+  void *slab(uint64_t bytes);
+
+  // map and unmap large object
+  void *mapLarge(uint64_t bytes);
+  void unmapLarge(void *p, uint64_t bytes);
+
+  // bytes mapped from OS and not unmapped
+  uint64_t mappedBytes() const;
+
+private:
+  std::mutex lock_;
+  char *chunk_;
+  uint64_t chunkUsed_;
+  std::atomic<uint64_t> mapped_;
+};
+
+/**
+ * CentralList keeps free objects of one size class shared by all threads,
+ * it's refilled with a new slab when empty.
+ */
+class CentralList {
+public:
+  CentralList();
+  // pop at most n objects as a linked list, returns the count
+  int fetch(int cls, PageHeap *pageHeap, int n, void **head);
+  // push linked list of n objects
+  void release(void *head, void *tail, int n);
+
+private:
+  std::mutex lock_;
+  void *head_;
+  int length_;
+};
+
+/**
+ * Allocator is a thread-caching, size-class segregated allocator:
+ *
+ * 1. Each thread keeps a free list per size class, allocation and
+ *    deallocation of small object touch only the free list of current thread,
+ *    without lock.
+ * 2. An empty thread free list fetches a batch of objects from the central
+ *    list of its class, a long one returns a batch to it.
+ * 3. Central lists are refilled by slabs carved from huge page chunks.
+ *
+ * Deallocation is sized: caller passes the size of allocation, so no header
+ * or page map lookup is needed to find the size class of an object.
+ */
+class Allocator {
+public:
+  static void *allocate(uint64_t size);
+  static void deallocate(void *p, uint64_t size);
+
+  // bytes mapped from OS by all threads
+  static uint64_t mappedBytes();
+};
+
+} // namespace dimrt
@@ -0,0 +1,136 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace dimrt {
+
+/**
+ * Deque is the Chase-Lev work-stealing deque of pointers, with the memory
+ * orders of "Correct and Efficient Work-Stealing for Weak Memory Models"
+ * (Lê et al. 2013).
+ *
+ * Its owner thread pushes and pops at bottom without lock, other threads steal
+ * at top with a CAS. The circular array grows when full, replaced arrays are
+ * kept until the deque is destroyed since a thief may still read them.
+ */
+template <typename T> class Deque {
+public:
+  // capacity is power of 2
+  explicit Deque(int64_t capacity = 256)
+      : top_(0), bottom_(0), array_(new Array(capacity)) {}
+
+  ~Deque() {
+    delete array_.load(std::memory_order_relaxed);
+    for (Array *a : garbage_) {
+      delete a;
+    }
+  }
+
+  Deque(const Deque &) = delete;
+  Deque &operator=(const Deque &) = delete;
+
+  // owner only
+  void push(T x) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    Array *a = array_.load(std::memory_order_relaxed);
+    if (b - t > a->capacity - 1) {
+      a = grow(a, t, b);
+    }
+    a->put(b, x);
+    // publish element to thieves loading bottom
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  // owner only, returns false if empty
+  bool pop(T *x) {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Array *a = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+    *x = a->get(b);
+    if (t == b) {
+      // last element, race with thieves
+      bool won = top_.compare_exchange_strong(
+          t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  // any thread, returns false if empty or lost race
+  bool steal(T *x) {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return false;
+    }
+    Array *a = array_.load(std::memory_order_acquire);
+    T v = a->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return false;
+    }
+    *x = v;
+    return true;
+  }
+
+  // approximate, exact only when called by owner without thieves
+  int64_t size() const {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? b - t : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+private:
+  struct Array {
+    explicit Array(int64_t a_capacity)
+        : capacity(a_capacity), mask(a_capacity - 1),
+          buffer(new std::atomic<T>[a_capacity]) {}
+    ~Array() { delete[] buffer; }
+
+    T get(int64_t i) const {
+      return buffer[i & mask].load(std::memory_order_relaxed);
+    }
+    void put(int64_t i, T x) {
+      buffer[i & mask].store(x, std::memory_order_relaxed);
+    }
+
+    // capacity is power of 2
+    int64_t capacity;
+    int64_t mask;
+    std::atomic<T> *buffer;
+  };
+
+  Array *grow(Array *a, int64_t t, int64_t b) {
+    Array *bigger = new Array(a->capacity * 2);
+    for (int64_t i = t; i < b; i++) {
+      bigger->put(i, a->get(i));
+    }
+    garbage_.push_back(a);
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  // top and bottom are on separate cache lines, thieves only touch top
+  std::atomic<int64_t> top_;
+  char padding_[64];
+  std::atomic<int64_t> bottom_;
+  std::atomic<Array *> array_;
+  std::vector<Array *> garbage_;
+};
+
+} // namespace dimrt
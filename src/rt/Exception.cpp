@@ -0,0 +1,236 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Exception.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace dimrt {
+
+namespace {
+
+// pointer encodings of DWARF exception header
+const uint8_t PeAbsptr = 0x00;
+const uint8_t PeUleb128 = 0x01;
+const uint8_t PeUdata2 = 0x02;
+const uint8_t PeUdata4 = 0x03;
+const uint8_t PeUdata8 = 0x04;
+const uint8_t PeSleb128 = 0x09;
+const uint8_t PeSdata2 = 0x0a;
+const uint8_t PeSdata4 = 0x0b;
+const uint8_t PeSdata8 = 0x0c;
+const uint8_t PePcrel = 0x10;
+const uint8_t PeIndirect = 0x80;
+const uint8_t PeOmit = 0xff;
+
+uint64_t readUleb128(const uint8_t **p) {
+  uint64_t result = 0;
+  int shift = 0;
+  uint8_t byte;
+  do {
+    byte = *(*p)++;
+    result |= (uint64_t)(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return result;
+}
+
+int64_t readSleb128(const uint8_t **p) {
+  uint64_t result = 0;
+  int shift = 0;
+  uint8_t byte;
+  do {
+    byte = *(*p)++;
+    result |= (uint64_t)(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  if (shift < 64 && (byte & 0x40)) {
+    result |= ~(uint64_t)0 << shift;
+  }
+  return (int64_t)result;
+}
+
+template <typename T> uintptr_t readData(const uint8_t **p) {
+  T value;
+  std::memcpy(&value, *p, sizeof(T));
+  *p += sizeof(T);
+  return (uintptr_t)value;
+}
+
+uintptr_t readEncoded(const uint8_t **p, uint8_t encoding) {
+  if (encoding == PeOmit) {
+    return 0;
+  }
+  const uint8_t *start = *p;
+  uintptr_t result;
+  switch (encoding & 0x0f) {
+  case PeAbsptr:
+    result = readData<uintptr_t>(p);
+    break;
+  case PeUleb128:
+    result = (uintptr_t)readUleb128(p);
+    break;
+  case PeUdata2:
+    result = readData<uint16_t>(p);
+    break;
+  case PeUdata4:
+    result = readData<uint32_t>(p);
+    break;
+  case PeUdata8:
+    result = readData<uint64_t>(p);
+    break;
+  case PeSleb128:
+    result = (uintptr_t)readSleb128(p);
+    break;
+  case PeSdata2:
+    result = readData<int16_t>(p);
+    break;
+  case PeSdata4:
+    result = readData<int32_t>(p);
+    break;
+  case PeSdata8:
+    result = readData<int64_t>(p);
+    break;
+  default:
+    std::fprintf(stderr, "dimrt: unknown pointer encoding 0x%x\n", encoding);
+    std::abort();
+  }
+  // only pc relative and absolute pointers are generated by LLVM
+  if (result && (encoding & 0x70) == PePcrel) {
+    result += (uintptr_t)start;
+  }
+  if (result && (encoding & PeIndirect)) {
+    result = *reinterpret_cast<const uintptr_t *>(result);
+  }
+  return result;
+}
+
+} // namespace
+
+void Exception::raise(int64_t value) {
+  Exception *e = new Exception();
+  std::memset(&e->header_, 0, sizeof(e->header_));
+  e->header_.exception_class = Class;
+  e->header_.exception_cleanup = destroy;
+  e->value_ = value;
+  // returns only if no landing pad catches it
+  _Unwind_RaiseException(&e->header_);
+  std::fprintf(stderr, "dimrt: uncaught exception %lld\n", (long long)value);
+  std::abort();
+}
+
+int64_t Exception::release(_Unwind_Exception *header) {
+  if (header->exception_class != Class) {
+    _Unwind_DeleteException(header);
+    return 0;
+  }
+  // header is the first member
+  Exception *e = reinterpret_cast<Exception *>(header);
+  int64_t value = e->value_;
+  delete e;
+  return value;
+}
+
+void Exception::destroy(_Unwind_Reason_Code reason,
+                        _Unwind_Exception *header) {
+  delete reinterpret_cast<Exception *>(header);
+}
+
+_Unwind_Reason_Code Exception::personality(int version,
+                                           _Unwind_Action actions,
+                                           uint64_t exceptionClass,
+                                           _Unwind_Exception *header,
+                                           _Unwind_Context *context) {
+  if (version != 1 || !header || !context) {
+    return _URC_FATAL_PHASE1_ERROR;
+  }
+  const uint8_t *lsda = static_cast<const uint8_t *>(
+      _Unwind_GetLanguageSpecificData(context));
+  if (!lsda) {
+    return _URC_CONTINUE_UNWIND;
+  }
+  uintptr_t function = _Unwind_GetRegionStart(context);
+  int ipBefore = 0;
+  uintptr_t ip = _Unwind_GetIPInfo(context, &ipBefore);
+  // return address is after the call
+  if (!ipBefore) {
+    ip--;
+  }
+
+  uint8_t lpStartEncoding = *lsda++;
+  uintptr_t lpStart = lpStartEncoding == PeOmit
+                          ? function
+                          : readEncoded(&lsda, lpStartEncoding);
+  uint8_t typeEncoding = *lsda++;
+  // type table is not read, all catch clauses are `catch i8* null`
+  if (typeEncoding != PeOmit) {
+    readUleb128(&lsda);
+  }
+  uint8_t callSiteEncoding = *lsda++;
+  uint64_t callSiteLength = readUleb128(&lsda);
+  const uint8_t *callSite = lsda;
+  const uint8_t *actionTable = lsda + callSiteLength;
+
+  while (callSite < actionTable) {
+    uintptr_t start = readEncoded(&callSite, callSiteEncoding);
+    uintptr_t length = readEncoded(&callSite, callSiteEncoding);
+    uintptr_t landingPad = readEncoded(&callSite, callSiteEncoding);
+    uint64_t action = readUleb128(&callSite);
+    // call sites are sorted by start
+    if (ip < function + start) {
+      break;
+    }
+    if (ip >= function + start + length) {
+      continue;
+    }
+    if (!landingPad) {
+      return _URC_CONTINUE_UNWIND;
+    }
+
+    // action records form a chain of type filters, positive filter is a
+    // catch clause, zero is cleanup
+    bool cleanup = action == 0;
+    int64_t selector = 0;
+    if (action) {
+      const uint8_t *record = actionTable + action - 1;
+      while (true) {
+        int64_t filter = readSleb128(&record);
+        const uint8_t *next = record;
+        int64_t offset = readSleb128(&record);
+        if (filter > 0) {
+          selector = filter;
+          break;
+        }
+        if (filter == 0) {
+          cleanup = true;
+        }
+        if (!offset) {
+          break;
+        }
+        record = next + offset;
+      }
+    }
+    // forced unwinding (e.g. thread cancellation) is never caught
+    if ((actions & _UA_FORCE_UNWIND) || !(actions & _UA_HANDLER_FRAME)) {
+      if (actions & _UA_SEARCH_PHASE) {
+        return selector > 0 && !(actions & _UA_FORCE_UNWIND)
+                   ? _URC_HANDLER_FOUND
+                   : _URC_CONTINUE_UNWIND;
+      }
+      selector = 0;
+    }
+    if (!selector && !cleanup) {
+      return _URC_CONTINUE_UNWIND;
+    }
+    _Unwind_SetGR(context, __builtin_eh_return_data_regno(0),
+                  reinterpret_cast<uintptr_t>(header));
+    _Unwind_SetGR(context, __builtin_eh_return_data_regno(1),
+                  (uintptr_t)selector);
+    _Unwind_SetIP(context, lpStart + landingPad);
+    return _URC_INSTALL_CONTEXT;
+  }
+  return _URC_CONTINUE_UNWIND;
+}
+
+} // namespace dimrt
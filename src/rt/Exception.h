@@ -0,0 +1,46 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include <cstdint>
+#include <unwind.h>
+
+namespace dimrt {
+
+/**
+ * Exception of `throw`, raised by the Itanium C++ ABI unwinder, so code
+ * inside `try` runs without any check, only a throw pays for unwinding.
+ *
+ * IrBuilder lowers calls inside `try` (or inside a scope with cleanup) to
+ * `invoke`, whose landing pad catches any exception by `catch i8* null`, or
+ * only runs cleanup. `personality` reads call site table of a function from
+ * its LSDA, which is generated by LLVM:
+ *
+ * 1. In search phase, it returns `_URC_HANDLER_FOUND` if call site has a
+ *    landing pad with catch clause.
+ * 2. In cleanup phase, it installs landing pad of call site, with exception in
+ *    first landing pad register, and selector in second one.
+ */
+class Exception {
+public:
+  // "DIM\0DIM\0"
+  static const uint64_t Class = 0x44494d0044494d00ULL;
+
+  // throw exception with value, abort if nothing catches it
+  [[noreturn]] static void raise(int64_t value);
+  // value of caught exception, which is released, it's 0 if exception is
+  // not thrown by `raise`
+  static int64_t release(_Unwind_Exception *header);
+  static _Unwind_Reason_Code personality(int version, _Unwind_Action actions,
+                                         uint64_t exceptionClass,
+                                         _Unwind_Exception *header,
+                                         _Unwind_Context *context);
+
+private:
+  static void destroy(_Unwind_Reason_Code reason, _Unwind_Exception *header);
+
+  _Unwind_Exception header_;
+  int64_t value_;
+};
+
+} // namespace dimrt
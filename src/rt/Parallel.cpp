@@ -0,0 +1,103 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Parallel.h"
+#include <algorithm>
+
+namespace dimrt {
+
+struct Parallel::Loop {
+  Scheduler *scheduler;
+  Body body;
+  void *context;
+  uint64_t grain;
+  // task of calling thread, parent of all forked chunks
+  Task task;
+};
+
+// forked chunk, whose first word is its resume function like a frame of
+// LLVM coroutine
+struct Parallel::Chunk {
+  void (*resume)(void *);
+  Task task;
+  Loop *loop;
+  uint64_t begin;
+  uint64_t end;
+};
+
+void Parallel::run(Scheduler *scheduler, uint64_t n, Body body,
+                   void *context) noexcept {
+  if (n == 0) {
+    return;
+  }
+  Loop loop;
+  loop.scheduler = scheduler;
+  loop.body = body;
+  loop.context = context;
+  loop.grain = grain(scheduler, n);
+  loop.task.handle = nullptr;
+  loop.task.parent = nullptr;
+  loop.task.pending.store(1, std::memory_order_relaxed);
+  execute(&loop, 0, n);
+  scheduler->wait(&loop.task);
+}
+
+uint64_t Parallel::grain(const Scheduler *scheduler, uint64_t n) {
+  uint64_t chunks = (uint64_t)scheduler->workers() * ChunksPerWorker;
+  return std::max<uint64_t>(n / chunks, 1);
+}
+
+// accumulator is memory of generated code, not a std::atomic, chunks are
+// ordered with loop by its task so relaxed ordering is enough
+void Parallel::add(int64_t *accumulator, int64_t value) {
+  __atomic_fetch_add(accumulator, value, __ATOMIC_RELAXED);
+}
+
+void Parallel::min(int64_t *accumulator, int64_t value) {
+  int64_t old = __atomic_load_n(accumulator, __ATOMIC_RELAXED);
+  while (value < old &&
+         !__atomic_compare_exchange_n(accumulator, &old, value, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+void Parallel::max(int64_t *accumulator, int64_t value) {
+  int64_t old = __atomic_load_n(accumulator, __ATOMIC_RELAXED);
+  while (value > old &&
+         !__atomic_compare_exchange_n(accumulator, &old, value, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+void Parallel::execute(Loop *loop, uint64_t begin, uint64_t end) {
+  while (begin < end) {
+    uint64_t rest = end - begin;
+    if (rest > loop->grain && loop->scheduler->queued() == 0) {
+      Chunk *chunk = new Chunk();
+      chunk->resume = resume;
+      chunk->task.handle = chunk;
+      chunk->task.parent = nullptr;
+      chunk->task.pending.store(1, std::memory_order_relaxed);
+      chunk->loop = loop;
+      chunk->begin = begin + rest / 2;
+      chunk->end = end;
+      end = chunk->begin;
+      loop->scheduler->fork(&loop->task, &chunk->task);
+      continue;
+    }
+    uint64_t stop = begin + std::min(rest, loop->grain);
+    loop->body(loop->context, begin, stop);
+    begin = stop;
+  }
+}
+
+void Parallel::resume(void *frame) noexcept {
+  Chunk *chunk = static_cast<Chunk *>(frame);
+  Scheduler *scheduler = chunk->loop->scheduler;
+  execute(chunk->loop, chunk->begin, chunk->end);
+  // loop may return as soon as its last chunk completes
+  scheduler->complete(&chunk->task);
+  delete chunk;
+}
+
+} // namespace dimrt
@@ -0,0 +1,49 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "rt/Scheduler.h"
+#include <cstdint>
+
+namespace dimrt {
+
+/**
+ * Parallel runs iterations [0, n) of a `foreach` loop on Scheduler, its body
+ * outlined by IrBuilder runs a chunk [begin, end) of them.
+ *
+ * Chunks are split lazily: the calling thread starts with the whole range and
+ * runs it grain by grain. Before each grain it forks the second half of the
+ * rest as a new task, if nothing it forked before is still queued, i.e. other
+ * workers have taken them. So a busy scheduler splits few chunks, an idle one
+ * splits down to grains, and grain only bounds the overhead of tiny bodies.
+ */
+class Parallel {
+public:
+  typedef void (*Body)(void *context, uint64_t begin, uint64_t end);
+
+  // chunks per worker when all workers are idle
+  static const uint64_t ChunksPerWorker = 8;
+
+  // returns after all iterations complete, an exception thrown by body
+  // terminates the program
+  static void run(Scheduler *scheduler, uint64_t n, Body body,
+                  void *context) noexcept;
+  // minimum iterations of a chunk
+  static uint64_t grain(const Scheduler *scheduler, uint64_t n);
+
+  // reductions of `foreach`, each chunk combines its partial result into the
+  // shared accumulator once, atomically
+  static void add(int64_t *accumulator, int64_t value);
+  static void min(int64_t *accumulator, int64_t value);
+  static void max(int64_t *accumulator, int64_t value);
+
+private:
+  struct Loop;
+  struct Chunk;
+
+  static void execute(Loop *loop, uint64_t begin, uint64_t end);
+  // resume function of forked chunk
+  static void resume(void *frame) noexcept;
+};
+
+} // namespace dimrt
@@ -0,0 +1,86 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Parker.h"
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace dimrt {
+
+#ifdef __linux__
+
+void futexWait(std::atomic<int32_t> *word, int32_t value) {
+  syscall(SYS_futex, reinterpret_cast<int32_t *>(word), FUTEX_WAIT_PRIVATE,
+          value, nullptr, nullptr, 0);
+}
+
+void futexWake(std::atomic<int32_t> *word, int count) {
+  syscall(SYS_futex, reinterpret_cast<int32_t *>(word), FUTEX_WAKE_PRIVATE,
+          count, nullptr, nullptr, 0);
+}
+
+#else
+
+namespace {
+
+// all words share one condition variable, waiters re-check their own word
+std::mutex &futexLock() {
+  static std::mutex *lock = new std::mutex();
+  return *lock;
+}
+
+std::condition_variable &futexCondition() {
+  static std::condition_variable *cv = new std::condition_variable();
+  return *cv;
+}
+
+} // namespace
+
+void futexWait(std::atomic<int32_t> *word, int32_t value) {
+  std::unique_lock<std::mutex> guard(futexLock());
+  if (word->load() == value) {
+    futexCondition().wait(guard);
+  }
+}
+
+void futexWake(std::atomic<int32_t> *word, int count) {
+  std::lock_guard<std::mutex> guard(futexLock());
+  futexCondition().notify_all();
+}
+
+#endif
+
+const int32_t Parker::Empty;
+const int32_t Parker::Parked;
+const int32_t Parker::Notified;
+
+Parker::Parker() : state_(Empty) {}
+
+void Parker::park() {
+  // consume notification, or become parked
+  if (state_.fetch_sub(1, std::memory_order_acquire) == Notified) {
+    return;
+  }
+  while (true) {
+    futexWait(&state_, Parked);
+    int32_t notified = Notified;
+    if (state_.compare_exchange_strong(notified, Empty,
+                                       std::memory_order_acquire)) {
+      return;
+    }
+  }
+}
+
+void Parker::unpark() {
+  if (state_.exchange(Notified, std::memory_order_release) == Parked) {
+    futexWake(&state_, 1);
+  }
+}
+
+} // namespace dimrt
@@ -0,0 +1,36 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace dimrt {
+
+// block while `*word == value`, may return spuriously
+void futexWait(std::atomic<int32_t> *word, int32_t value);
+// wake at most `count` threads blocked on `word`
+void futexWake(std::atomic<int32_t> *word, int count);
+
+/**
+ * Parker blocks an idle worker thread until it's unparked, on a futex on
+ * Linux, or a condition variable elsewhere.
+ *
+ * A notification is remembered, so `unpark` before `park` makes next `park`
+ * return immediately and no wakeup is lost.
+ */
+class Parker {
+public:
+  Parker();
+  void park();
+  void unpark();
+
+private:
+  static const int32_t Empty = 0;
+  static const int32_t Parked = -1;
+  static const int32_t Notified = 1;
+
+  std::atomic<int32_t> state_;
+};
+
+} // namespace dimrt
@@ -0,0 +1,150 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Reactor.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+namespace dimrt {
+
+namespace {
+
+void fail(const char *what) {
+  std::fprintf(stderr, "dimrt: reactor %s failed: %s\n", what,
+               std::strerror(errno));
+  std::abort();
+}
+
+} // namespace
+
+#ifdef __linux__
+
+Reactor::Reactor()
+    : epoll_(epoll_create1(EPOLL_CLOEXEC)),
+      event_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), waiting_(0) {
+  if (epoll_ < 0 || event_ < 0) {
+    fail("create");
+  }
+  // eventfd is level triggered
+  epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = event_;
+  if (epoll_ctl(epoll_, EPOLL_CTL_ADD, event_, &ev) < 0) {
+    fail("epoll_ctl");
+  }
+}
+
+Reactor::~Reactor() {
+  close(event_);
+  close(epoll_);
+}
+
+void Reactor::wait(int fd, uint32_t events, Task *task) {
+  epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  ev.events = events | EPOLLONESHOT;
+  ev.data.fd = fd;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    Task *&armed = armed_[fd];
+    if (!armed) {
+      waiting_++;
+    }
+    armed = task;
+  }
+  // descriptor stays registered after it's ready once
+  if (epoll_ctl(epoll_, EPOLL_CTL_MOD, fd, &ev) < 0) {
+    if (errno != ENOENT || epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      fail("epoll_ctl");
+    }
+  }
+}
+
+void Reactor::remove(int fd) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (armed_.erase(fd)) {
+      waiting_--;
+    }
+  }
+  epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int Reactor::poll(int timeoutMs, std::vector<Task *> *ready) {
+  const int MaxEvents = 64;
+  epoll_event events[MaxEvents];
+  int n = epoll_wait(epoll_, events, MaxEvents, timeoutMs);
+  if (n < 0) {
+    if (errno != EINTR) {
+      fail("epoll_wait");
+    }
+    return 0;
+  }
+  int tasks = 0;
+  std::lock_guard<std::mutex> guard(lock_);
+  for (int i = 0; i < n; i++) {
+    int fd = events[i].data.fd;
+    if (fd == event_) {
+      uint64_t count;
+      while (read(event_, &count, sizeof(count)) > 0) {
+      }
+      continue;
+    }
+    // descriptor removed after it's ready is not resumed
+    auto armed = armed_.find(fd);
+    if (armed == armed_.end()) {
+      continue;
+    }
+    ready->push_back(armed->second);
+    armed_.erase(armed);
+    tasks++;
+  }
+  waiting_ -= tasks;
+  return tasks;
+}
+
+void Reactor::wake() {
+  uint64_t one = 1;
+  while (write(event_, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+}
+
+#else
+
+Reactor::Reactor() : epoll_(-1), event_(-1), waiting_(0) {}
+
+Reactor::~Reactor() {}
+
+void Reactor::wait(int fd, uint32_t events, Task *task) {
+  errno = ENOSYS;
+  fail("wait");
+}
+
+void Reactor::remove(int fd) {}
+
+int Reactor::poll(int timeoutMs, std::vector<Task *> *ready) {
+  // nothing is ever registered
+  if (timeoutMs > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+  }
+  return 0;
+}
+
+void Reactor::wake() {}
+
+#endif
+
+int Reactor::waiting() const { return waiting_.load(); }
+
+} // namespace dimrt
@@ -0,0 +1,54 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace dimrt {
+
+struct Task;
+
+/**
+ * Reactor waits for readiness of file descriptors on epoll, a task waiting
+ * for I/O is resumed when its descriptor is ready, instead of blocking a
+ * thread.
+ *
+ * Registration is one-shot: a ready descriptor is disabled until next `wait`.
+ * An idle worker of Scheduler blocks in `poll`, `wake` interrupts it through
+ * an eventfd.
+ */
+class Reactor {
+public:
+  Reactor();
+  ~Reactor();
+
+  // resume task when fd is ready for `events` (EPOLLIN, EPOLLOUT)
+  void wait(int fd, uint32_t events, Task *task);
+  // stop waiting for fd, before it's closed
+  void remove(int fd);
+
+  // append tasks whose descriptors are ready, blocks at most `timeoutMs`
+  // milliseconds (-1 is forever) until a descriptor is ready or woken,
+  // returns the number of ready tasks
+  int poll(int timeoutMs, std::vector<Task *> *ready);
+  // interrupt a blocking poll
+  void wake();
+
+  // tasks registered and not ready yet
+  int waiting() const;
+
+private:
+  int epoll_;
+  int event_;
+  // descriptors registered and not ready yet, a ready or removed one is
+  // erased exactly once, so waiting_ counts each wait once
+  std::mutex lock_;
+  std::unordered_map<int, Task *> armed_;
+  std::atomic<int> waiting_;
+};
+
+} // namespace dimrt
@@ -0,0 +1,53 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Region.h"
+#include "rt/Allocator.h"
+
+namespace dimrt {
+
+// chunk header keeps objects aligned
+static const uint64_t HeaderSize =
+    (sizeof(void *) + sizeof(uint64_t) + Region::Alignment - 1) &
+    ~(Region::Alignment - 1);
+
+const uint64_t Region::ChunkSize;
+const uint64_t Region::Alignment;
+
+Region::Region()
+    : current_(nullptr), end_(nullptr), chunks_(nullptr), chunkBytes_(0) {}
+
+Region::~Region() {
+  while (chunks_) {
+    Chunk *c = chunks_;
+    chunks_ = c->next;
+    Allocator::deallocate(c, c->bytes);
+  }
+}
+
+uint64_t Region::chunkBytes() const { return chunkBytes_; }
+
+void *Region::allocateSlow(uint64_t size) {
+  if (size > (ChunkSize - HeaderSize) / 4) {
+    // large object has its own chunk, current chunk keeps bumping
+    Chunk *c = newChunk(HeaderSize + size);
+    return reinterpret_cast<char *>(c) + HeaderSize;
+  }
+  Chunk *c = newChunk(ChunkSize);
+  current_ = reinterpret_cast<char *>(c) + HeaderSize;
+  end_ = reinterpret_cast<char *>(c) + ChunkSize;
+  void *p = current_;
+  current_ += size;
+  return p;
+}
+
+Region::Chunk *Region::newChunk(uint64_t bytes) {
+  Chunk *c = static_cast<Chunk *>(Allocator::allocate(bytes));
+  c->next = chunks_;
+  c->bytes = bytes;
+  chunks_ = c;
+  chunkBytes_ += bytes;
+  return c;
+}
+
+} // namespace dimrt
@@ -0,0 +1,57 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include <cstdint>
+
+namespace dimrt {
+
+/**
+ * Region is a bump allocator of `region { ... }` block.
+ *
+ * Memory is carved from chunks by bumping a pointer, objects are never freed
+ * one by one, all chunks are released together when region is destroyed at
+ * block exit. Chunks come from Allocator, so they're reused by next region of
+ * the same thread.
+ *
+ * Objects larger than a quarter of chunk get their own chunk, so a chunk never
+ * wastes more than a quarter of it.
+ */
+class Region {
+public:
+  static const uint64_t ChunkSize = 64 * 1024;
+  static const uint64_t Alignment = 16;
+
+  Region();
+  ~Region();
+
+  // allocate `size` bytes aligned to `Alignment`, not initialized
+  void *allocate(uint64_t size) {
+    size = (size + Alignment - 1) & ~(Alignment - 1);
+    if (size <= (uint64_t)(end_ - current_)) {
+      void *p = current_;
+      current_ += size;
+      return p;
+    }
+    return allocateSlow(size);
+  }
+
+  // bytes of chunks held by region
+  uint64_t chunkBytes() const;
+
+private:
+  struct Chunk {
+    Chunk *next;
+    uint64_t bytes;
+  };
+
+  void *allocateSlow(uint64_t size);
+  Chunk *newChunk(uint64_t bytes);
+
+  char *current_;
+  char *end_;
+  Chunk *chunks_;
+  uint64_t chunkBytes_;
+};
+
+} // namespace dimrt
@@ -0,0 +1,97 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Runtime.h"
+#include "rt/Allocator.h"
+#include "rt/Exception.h"
+#include "rt/Parallel.h"
+#include "rt/Region.h"
+#include "rt/Scheduler.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+void *dimrt_alloc(uint64_t size) { return dimrt::Allocator::allocate(size); }
+
+void dimrt_free(void *p, uint64_t size) {
+  dimrt::Allocator::deallocate(p, size);
+}
+
+void dimrt_bounds(int64_t index, int64_t length) {
+  std::fprintf(stderr, "dimrt: index %lld out of bounds of length %lld\n",
+               (long long)index, (long long)length);
+  std::abort();
+}
+
+void *dimrt_region_begin() {
+  return new (dimrt::Allocator::allocate(sizeof(dimrt::Region)))
+      dimrt::Region();
+}
+
+void *dimrt_region_alloc(void *region, uint64_t size) {
+  return static_cast<dimrt::Region *>(region)->allocate(size);
+}
+
+void dimrt_region_end(void *region) {
+  dimrt::Region *r = static_cast<dimrt::Region *>(region);
+  r->~Region();
+  dimrt::Allocator::deallocate(r, sizeof(dimrt::Region));
+}
+
+void dimrt_task_init(void *task, void *handle) {
+  dimrt::Task *t = static_cast<dimrt::Task *>(task);
+  t->handle = handle;
+  t->parent = nullptr;
+  t->pending.store(1, std::memory_order_relaxed);
+}
+
+void dimrt_task_spawn(void *parent, void *child) {
+  dimrt::Scheduler::instance().fork(static_cast<dimrt::Task *>(parent),
+                                    static_cast<dimrt::Task *>(child));
+}
+
+int32_t dimrt_task_join(void *task) {
+  return dimrt::Scheduler::join(static_cast<dimrt::Task *>(task)) ? 1 : 0;
+}
+
+void dimrt_task_wait(void *task) {
+  dimrt::Scheduler::instance().wait(static_cast<dimrt::Task *>(task));
+}
+
+void dimrt_task_complete(void *task) {
+  dimrt::Scheduler::instance().complete(static_cast<dimrt::Task *>(task));
+}
+
+void dimrt_parallel_for(uint64_t n,
+                        void (*body)(void *context, uint64_t begin,
+                                     uint64_t end),
+                        void *context) {
+  dimrt::Parallel::run(&dimrt::Scheduler::instance(), n, body, context);
+}
+
+void dimrt_reduce_add(int64_t *accumulator, int64_t value) {
+  dimrt::Parallel::add(accumulator, value);
+}
+
+void dimrt_reduce_min(int64_t *accumulator, int64_t value) {
+  dimrt::Parallel::min(accumulator, value);
+}
+
+void dimrt_reduce_max(int64_t *accumulator, int64_t value) {
+  dimrt::Parallel::max(accumulator, value);
+}
+
+void dimrt_throw(int64_t value) { dimrt::Exception::raise(value); }
+
+int64_t dimrt_catch(void *exception) {
+  return dimrt::Exception::release(
+      static_cast<_Unwind_Exception *>(exception));
+}
+
+_Unwind_Reason_Code dimrt_personality(int version, _Unwind_Action actions,
+                                      uint64_t exceptionClass,
+                                      _Unwind_Exception *exception,
+                                      _Unwind_Context *context) {
+  return dimrt::Exception::personality(version, actions, exceptionClass,
+                                       exception, context);
+}
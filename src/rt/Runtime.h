@@ -0,0 +1,63 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include <cstdint>
+#include <unwind.h>
+
+/**
+ * dimrt is the runtime library of dim programs, functions here are called by
+ * code lowered by IrBuilder, and linked into JIT by RuntimeSymbols.
+ */
+extern "C" {
+
+// memory of `new`, not initialized
+void *dimrt_alloc(uint64_t size);
+// memory of `delete`, size is the same as allocated
+void dimrt_free(void *p, uint64_t size);
+// index of `a[i]`, or end of slice `a[i..j]`, is out of bounds of array
+// length, it never returns but aborts
+void dimrt_bounds(int64_t index, int64_t length);
+
+// region of `region { ... }` block, created at block entry
+void *dimrt_region_begin();
+// memory of `new` inside region, not initialized
+void *dimrt_region_alloc(void *region, uint64_t size);
+// all memory of region is released at block exit
+void dimrt_region_end(void *region);
+
+// task in promise of async function, see rt/Scheduler.h. `handle` is its
+// coroutine, or null for a task of a thread blocked in dimrt_task_wait
+void dimrt_task_init(void *task, void *handle);
+// run child task of `await` on a worker
+void dimrt_task_spawn(void *parent, void *child);
+// returns 1 if task must suspend until its children complete, the last one
+// resumes it, or 0 if they're completed
+int32_t dimrt_task_join(void *task);
+// block current thread until children of task complete
+void dimrt_task_wait(void *task);
+// async function returns, its parent is resumed if it's the last child
+void dimrt_task_complete(void *task);
+
+// run body of `foreach` over chunks of iterations [0, n) on workers, and
+// return after all of them complete, see rt/Parallel.h
+void dimrt_parallel_for(uint64_t n,
+                        void (*body)(void *context, uint64_t begin,
+                                     uint64_t end),
+                        void *context);
+// combine partial result of a `foreach` chunk into accumulator of reduction,
+// unsigned values are offset by 2^63 so `min` and `max` compare them signed
+void dimrt_reduce_add(int64_t *accumulator, int64_t value);
+void dimrt_reduce_min(int64_t *accumulator, int64_t value);
+void dimrt_reduce_max(int64_t *accumulator, int64_t value);
+
+// `throw value`, it never returns, see rt/Exception.h
+void dimrt_throw(int64_t value);
+// exception caught by landing pad of `try`, returns its value and releases it
+int64_t dimrt_catch(void *exception);
+// personality routine of functions with landing pads
+_Unwind_Reason_Code dimrt_personality(int version, _Unwind_Action actions,
+                                      uint64_t exceptionClass,
+                                      _Unwind_Exception *exception,
+                                      _Unwind_Context *context);
+}
@@ -0,0 +1,314 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Scheduler.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace dimrt {
+
+namespace {
+
+int defaultWorkers() {
+  const char *env = std::getenv("DIMRT_WORKERS");
+  int n = env ? std::atoi(env) : 0;
+  if (n <= 0) {
+    n = (int)std::thread::hardware_concurrency();
+  }
+  return std::max(n, 1);
+}
+
+uint64_t xorshift(uint64_t *seed) {
+  uint64_t x = *seed;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *seed = x;
+  return x;
+}
+
+} // namespace
+
+thread_local Scheduler::Worker *Scheduler::current_ = nullptr;
+
+Scheduler::Scheduler(int workers)
+    : injectedSize_(0), sleepers_(0), polling_(false), stop_(false) {
+  for (int i = 0; i < workers; i++) {
+    Worker *worker = new Worker();
+    worker->owner = this;
+    worker->index = i;
+    worker->polling = false;
+    worker->seed = 0x9e3779b97f4a7c15ULL * (uint64_t)(i + 1);
+    workers_.push_back(worker);
+  }
+  for (Worker *worker : workers_) {
+    worker->thread = std::thread(&Scheduler::run, this, worker);
+  }
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stop_ = true;
+  }
+  for (Worker *worker : workers_) {
+    worker->parker.unpark();
+  }
+  reactor_.wake();
+  // workers steal from each other until all of them exit
+  for (Worker *worker : workers_) {
+    worker->thread.join();
+  }
+  for (Worker *worker : workers_) {
+    delete worker;
+  }
+}
+
+void Scheduler::spawn(Task *task) {
+  Worker *worker = current_;
+  if (worker && worker->owner == this) {
+    worker->deque.push(task);
+  } else {
+    std::lock_guard<std::mutex> guard(lock_);
+    injected_.push_back(task);
+    injectedSize_++;
+  }
+  notify();
+}
+
+void Scheduler::waitIo(Task *task, int fd, uint32_t events) {
+  reactor_.wait(fd, events, task);
+  bool polling;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    polling = polling_;
+  }
+  // a sleeping worker comes back to block in reactor
+  if (!polling) {
+    notify();
+  }
+}
+
+void Scheduler::fork(Task *parent, Task *child) {
+  child->parent = parent;
+  parent->pending.fetch_add(1, std::memory_order_relaxed);
+  spawn(child);
+}
+
+bool Scheduler::join(Task *task) {
+  if (task->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    task->pending.store(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void Scheduler::wait(Task *task) {
+  if (!join(task)) {
+    return;
+  }
+  Worker *worker = current_;
+  int32_t pending;
+  while ((pending = task->pending.load(std::memory_order_acquire)) != 0) {
+    Task *other = worker && worker->owner == this ? find(worker) : nullptr;
+    if (other) {
+      resume(other);
+    } else {
+      futexWait(&task->pending, pending);
+    }
+  }
+  task->pending.store(1, std::memory_order_relaxed);
+}
+
+void Scheduler::complete(Task *task) {
+  // a blocked thread returns as soon as pending is 0, its task is not read
+  // after that
+  Task *parent = task->parent;
+  void *handle = parent->handle;
+  if (parent->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  if (handle) {
+    parent->pending.store(1, std::memory_order_relaxed);
+    spawn(parent);
+  } else {
+    futexWake(&parent->pending, 1);
+  }
+}
+
+int Scheduler::workers() const { return (int)workers_.size(); }
+
+int Scheduler::queued() const {
+  Worker *worker = current_;
+  if (worker && worker->owner == this) {
+    return (int)worker->deque.size();
+  }
+  return injectedSize_.load(std::memory_order_relaxed);
+}
+
+Scheduler &Scheduler::instance() {
+  // never destroyed, tasks may still run when main returns
+  static Scheduler *scheduler = new Scheduler(defaultWorkers());
+  return *scheduler;
+}
+
+void Scheduler::resume(Task *task) {
+  void *handle = task->handle;
+  (*static_cast<void (**)(void *)>(handle))(handle);
+}
+
+void Scheduler::run(Worker *worker) {
+  current_ = worker;
+  while (true) {
+    Task *task = find(worker);
+    if (task) {
+      resume(task);
+    } else if (!sleep(worker)) {
+      break;
+    }
+  }
+  current_ = nullptr;
+}
+
+Task *Scheduler::find(Worker *worker) {
+  Task *task = nullptr;
+  if (worker->deque.pop(&task)) {
+    return task;
+  }
+  if (injectedSize_.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!injected_.empty()) {
+      task = injected_.front();
+      injected_.pop_front();
+      injectedSize_--;
+      return task;
+    }
+  }
+  task = steal(worker);
+  if (task) {
+    return task;
+  }
+  if (reactor_.waiting() > 0) {
+    std::vector<Task *> ready;
+    if (reactor_.poll(0, &ready) > 0) {
+      pushReady(worker, ready);
+      if (worker->deque.pop(&task)) {
+        return task;
+      }
+    }
+  }
+  return nullptr;
+}
+
+Task *Scheduler::steal(Worker *worker) {
+  int n = (int)workers_.size();
+  if (n <= 1) {
+    return nullptr;
+  }
+  // start from a random victim, so thieves don't contend on one deque
+  int start = (int)(xorshift(&worker->seed) % (uint64_t)n);
+  Task *task = nullptr;
+  for (int i = 0; i < n; i++) {
+    Worker *victim = workers_[(start + i) % n];
+    if (victim != worker && victim->deque.steal(&task)) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+bool Scheduler::hasWork() const {
+  if (injectedSize_.load() > 0) {
+    return true;
+  }
+  for (Worker *worker : workers_) {
+    if (!worker->deque.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Scheduler::sleep(Worker *worker) {
+  bool poll;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (stop_) {
+      return false;
+    }
+    // only one worker blocks in reactor
+    poll = !polling_ && reactor_.waiting() > 0;
+    polling_ = polling_ || poll;
+    worker->polling = poll;
+    sleeping_.push_back(worker);
+    sleepers_++;
+  }
+  // a task spawned before the worker is seen as sleeping is found here, a
+  // task spawned after it notifies the worker
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!hasWork()) {
+    if (poll) {
+      std::vector<Task *> ready;
+      reactor_.poll(-1, &ready);
+      pushReady(worker, ready);
+    } else {
+      worker->parker.park();
+    }
+  }
+  wakeUp(worker);
+  return !stop_;
+}
+
+void Scheduler::wakeUp(Worker *worker) {
+  std::lock_guard<std::mutex> guard(lock_);
+  std::vector<Worker *>::iterator it =
+      std::find(sleeping_.begin(), sleeping_.end(), worker);
+  if (it != sleeping_.end()) {
+    sleeping_.erase(it);
+    sleepers_--;
+  }
+  if (worker->polling) {
+    polling_ = false;
+    worker->polling = false;
+  }
+}
+
+void Scheduler::notify() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  Worker *worker = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (sleeping_.empty()) {
+      return;
+    }
+    // the worker blocked in reactor is woken last
+    std::vector<Worker *>::reverse_iterator it = std::find_if(
+        sleeping_.rbegin(), sleeping_.rend(),
+        [](const Worker *w) { return !w->polling; });
+    if (it == sleeping_.rend()) {
+      it = sleeping_.rbegin();
+    }
+    worker = *it;
+    sleeping_.erase(std::next(it).base());
+    sleepers_--;
+    if (worker->polling) {
+      reactor_.wake();
+      return;
+    }
+  }
+  worker->parker.unpark();
+}
+
+void Scheduler::pushReady(Worker *worker, const std::vector<Task *> &ready) {
+  for (Task *task : ready) {
+    worker->deque.push(task);
+  }
+  if (ready.size() > 1) {
+    notify();
+  }
+}
+
+} // namespace dimrt
@@ -0,0 +1,111 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "rt/Deque.h"
+#include "rt/Parker.h"
+#include "rt/Reactor.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dimrt {
+
+/**
+ * Task is the header of the promise of an async function, its layout is
+ * known by IrBuilder.
+ *
+ * `pending` counts children not completed, plus 1 while the task itself runs,
+ * the child completing it to 0 resumes the parent.
+ */
+struct Task {
+  // coroutine handle, whose first word is its resume function, or null for a
+  // thread blocked in `dimrt_task_wait`
+  void *handle;
+  Task *parent;
+  std::atomic<int32_t> pending;
+};
+
+/**
+ * Scheduler runs tasks on worker threads, each worker owns a Chase-Lev deque:
+ *
+ * 1. A task spawned on a worker is pushed to its own deque, others are
+ *    injected to a shared queue.
+ * 2. A worker pops its own deque in LIFO order, then takes injected tasks,
+ *    then steals from other workers in FIFO order.
+ * 3. A worker without work parks on a futex, one of them blocks in Reactor
+ *    instead if any task waits for I/O.
+ */
+class Scheduler {
+public:
+  explicit Scheduler(int workers);
+  ~Scheduler();
+
+  // run task on a worker
+  void spawn(Task *task);
+  // spawn task when fd is ready for `events`
+  void waitIo(Task *task, int fd, uint32_t events);
+
+  // spawn child of parent
+  void fork(Task *parent, Task *child);
+  // returns true if task must suspend until its children complete, the last
+  // one spawns it, or false if they're completed
+  static bool join(Task *task);
+  // block current thread until children of task complete, a worker runs
+  // other tasks meanwhile
+  void wait(Task *task);
+  // task is completed, spawn its parent if it's the last child
+  void complete(Task *task);
+
+  int workers() const;
+  // tasks spawned by current thread and not taken yet: size of deque of
+  // current worker, or injected tasks outside workers
+  int queued() const;
+
+  // scheduler of async functions, it has a worker per core, or
+  // `DIMRT_WORKERS` workers
+  static Scheduler &instance();
+  static void resume(Task *task);
+
+private:
+  struct Worker {
+    Scheduler *owner;
+    int index;
+    Deque<Task *> deque;
+    Parker parker;
+    // sleeping in reactor instead of parker, guarded by lock_
+    bool polling;
+    uint64_t seed;
+    std::thread thread;
+  };
+
+  void run(Worker *worker);
+  // next task of worker, or null
+  Task *find(Worker *worker);
+  Task *steal(Worker *worker);
+  bool hasWork() const;
+  // park worker until notified, returns false when scheduler stops
+  bool sleep(Worker *worker);
+  void wakeUp(Worker *worker);
+  // wake a sleeping worker if any
+  void notify();
+  void pushReady(Worker *worker, const std::vector<Task *> &ready);
+
+  std::vector<Worker *> workers_;
+  std::mutex lock_;
+  std::deque<Task *> injected_;
+  std::atomic<int> injectedSize_;
+  std::vector<Worker *> sleeping_;
+  std::atomic<int> sleepers_;
+  bool polling_;
+  Reactor reactor_;
+  std::atomic<bool> stop_;
+
+  // worker of current thread, or null
+  static thread_local Worker *current_;
+};
+
+} // namespace dimrt
@@ -0,0 +1,124 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "JitModule.h"
+#include "Repl.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// test/case/array.dim
+typedef int64_t (*Sum)(DimArray<int64_t>, int32_t);
+typedef int64_t (*Sum4)(DimArray<int64_t>);
+typedef int64_t (*SumSlice)(DimArray<int64_t>, int32_t, int32_t);
+
+TEST_CASE("Array", "[Array]") {
+  SECTION("lowering") {
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/array.dim", optimize);
+      llvm::Module *m = module.llvmModule();
+      // hoisted check of a fixed-size array is in bounds at compile time
+      REQUIRE(calls(m, "sum4", "dimrt_bounds") == 0);
+      REQUIRE(calls(m, "iota4", "dimrt_bounds") == 0);
+      REQUIRE(calls(m, "sumCondition", "dimrt_bounds") > 0);
+      // body of nested foreach is outlined, its check is not hoisted into
+      // the enclosing function
+      REQUIRE(calls(m, "sumNested", "dimrt_bounds") > 0);
+      if (optimize) {
+        // loop is versioned on its hoisted check, the version in bounds is
+        // vectorized
+        REQUIRE(vectorInstructions(m, "sumRange") > 0);
+      } else {
+        // slice is checked once, in place of each element
+        REQUIRE(calls(m, "sumSlice", "dimrt_bounds") == 1);
+        REQUIRE(calls(m, "sumRange", "dimrt_bounds") == 1);
+      }
+    }
+  }
+
+  SECTION("run") {
+    JitModule::run("test/case/array.dim");
+
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/array.dim", optimize);
+      Sum sumRange = module.function<Sum>("sumRange");
+      Sum sumCondition = module.function<Sum>("sumCondition");
+      Sum4 sum4 = module.function<Sum4>("sum4");
+      Sum sumNested = module.function<Sum>("sumNested");
+      SumSlice sumSlice = module.function<SumSlice>("sumSlice");
+      for (int32_t n : {0, 1, 4, 33, 1001}) {
+        std::vector<int64_t> a(n);
+        for (int32_t i = 0; i < n; i++) {
+          a[i] = i;
+        }
+        DimArray<int64_t> x = {a.data(), n};
+        REQUIRE(sumRange(x, n) == (int64_t)n * (n - 1) / 2);
+        REQUIRE(sumCondition(x, n) == (int64_t)n * (n - 1) / 2);
+        REQUIRE(sumNested(x, n) == (int64_t)n * (n - 1) / 2);
+        REQUIRE(sumSlice(x, n / 2, n) ==
+                (int64_t)n * (n - 1) / 2 - (int64_t)(n / 2) * (n / 2 - 1) / 2);
+        if (n == 4) {
+          REQUIRE(sum4(x) == 6);
+        }
+      }
+    }
+  }
+
+  SECTION("error") {
+    Repl repl;
+    // constant index of fixed-size array is checked at compile time
+    REQUIRE_THROWS_AS(repl.eval("def f1():long { var a:long[4] = new long[4];"
+                                " return a[4]; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f2():long { var a:long[4] = new long[4];"
+                                " var b:long[] = a[2..5]; return b[0]; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f3():long { var a:long[4] = new long[4];"
+                                " var b:long[] = a[3..2]; return b[0]; }"),
+                      Exception);
+    // only an array of the same length is stored to `T[N]`
+    REQUIRE_THROWS_AS(repl.eval("def f4():long { var a:long[4] = new long[3];"
+                                " return a[0]; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f5(n:int):long {"
+                                " var a:long[4] = new long[n]; return a[0]; }"),
+                      Exception);
+    REQUIRE(repl.eval("def first(a:long[4]):long { return a[0]; }") == "");
+    REQUIRE_THROWS_AS(repl.eval("def f6(a:long[]):long { return first(a); }"),
+                      Exception);
+    // slice is not assigned
+    REQUIRE_THROWS_AS(repl.eval("def f7(a:long[], b:long[]):int {"
+                                " a[0..2] = b; return 0; }"),
+                      Exception);
+    REQUIRE(repl.eval("def f8():long { var a:long[4] = new long[4];"
+                      " a[0] = 0L; a[2] = 7L; var b:long[] = a[1..3];"
+                      " b[0] = 1L; return b[1] + a[1] + first(a); }") == "");
+    REQUIRE(repl.eval("f8()") == "8");
+  }
+}
+
+TEST_CASE("Array benchmark", "[.benchmark][Array]") {
+  const int32_t n = 100000;
+  std::vector<int64_t> a(n, 1L);
+  DimArray<int64_t> x = {a.data(), n};
+
+  // native loop without any check
+  BENCHMARK("sum unchecked") {
+    int64_t s = 0;
+    for (int32_t i = 0; i < n; i++) {
+      s += a[i];
+    }
+    return s;
+  };
+  for (bool optimize : {false, true}) {
+    JitModule module("test/case/array.dim", optimize);
+    Sum sumRange = module.function<Sum>("sumRange");
+    Sum sumCondition = module.function<Sum>("sumCondition");
+    std::string suffix = optimize ? " (optimized)" : "";
+
+    BENCHMARK("sum hoisted" + suffix) { return sumRange(x, n); };
+    BENCHMARK("sum checked" + suffix) { return sumCondition(x, n); };
+  }
+}
@@ -0,0 +1,121 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "AstWalker.h"
+#include "Ast.h"
+#include "Dumper.h"
+#include "IrBuilder.h"
+#include "Scanner.h"
+#include "SymbolBuilder.h"
+#include "SymbolResolver.h"
+#include "boost/filesystem.hpp"
+#include "catch2/catch.hpp"
+#include "fmt/format.h"
+#include "iface/Phase.h"
+#include "infra/Files.h"
+
+namespace fs = boost::filesystem;
+
+class CountPhase : public FusiblePhase {
+public:
+  CountPhase(PhaseOrder order, const std::vector<AstKind> &kinds = {})
+      : FusiblePhase("CountPhase", order, kinds), enters(0), leaves(0) {}
+  virtual void enter(Ast *ast) { enters++; }
+  virtual void leave(Ast *ast) { leaves++; }
+  int enters;
+  int leaves;
+};
+
+static void testAstWalker(const Cowstr &fileName) {
+  Scanner scanner(fileName);
+  REQUIRE(scanner.parse() == 0);
+
+  CountPhase all(PhaseOrder::PrePostOrder);
+  CountPhase pre(PhaseOrder::PreOrder);
+  CountPhase post(PhaseOrder::PostOrder);
+  CountPhase varId(PhaseOrder::PrePostOrder, {AstKind::VarId});
+  all.run(scanner.compileUnit());
+  REQUIRE(all.enters > 0);
+  REQUIRE(all.enters == all.leaves);
+
+  AstWalker walker({&pre, &post, &varId});
+  walker.walk(scanner.compileUnit());
+  REQUIRE(pre.enters == all.enters);
+  REQUIRE(pre.leaves == 0);
+  REQUIRE(post.enters == 0);
+  REQUIRE(post.leaves == all.leaves);
+  REQUIRE(varId.enters > 0);
+  REQUIRE(varId.enters < all.enters);
+  REQUIRE(varId.enters == varId.leaves);
+}
+
+static void testFusion(const Cowstr &fileName) {
+  Scanner scanner(fileName);
+  REQUIRE(scanner.parse() == 0);
+
+  SymbolBuilder builder;
+  SymbolResolver resolver;
+  CountPhase counter(PhaseOrder::PreOrder);
+  Dumper dumper;
+
+  // resolver, counter and dumper are fused into one tree walk
+  PhaseManager pm({&builder, &resolver, &counter, &dumper});
+  pm.run(scanner.compileUnit());
+  REQUIRE(counter.enters == (int)dumper.dump().size());
+}
+
+// n statements in a block, and an infix expression with n operands
+static void generateDeepAst(const Cowstr &fileName, int n) {
+  FileWriter fwriter(fileName);
+  fwriter.writeln("def deep():int {");
+  for (int i = 0; i < n; i++) {
+    fwriter.writeln(fmt::format("    var a{}:int = {};", i, i));
+  }
+  fwriter.write("    var s:int = 0");
+  for (int i = 0; i < n; i++) {
+    fwriter.write(" + 1");
+  }
+  fwriter.writeln(";");
+  fwriter.writeln("    return s;");
+  fwriter.writeln("}");
+  fwriter.flush();
+}
+
+// generated source is written to a temporary file, removed once it's parsed
+static void testDeepAst(int n) {
+  fs::path fileName =
+      fs::temp_directory_path() / fs::unique_path("dim-deep-ast-%%%%-%%%%.dim");
+  generateDeepAst(fileName.string(), n);
+  Scanner scanner(fileName.string());
+  int parsed = scanner.parse();
+  fs::remove(fileName);
+  REQUIRE(parsed == 0);
+
+  SymbolBuilder builder;
+  SymbolResolver resolver;
+  CountPhase counter(PhaseOrder::PrePostOrder);
+  IrBuilder irBuilder(false);
+  PhaseManager pm({&builder, &resolver, &counter, &irBuilder});
+  pm.run(scanner.compileUnit());
+  REQUIRE(counter.enters > n * 2);
+  REQUIRE(counter.enters == counter.leaves);
+  REQUIRE(irBuilder.llvmModule());
+}
+
+TEST_CASE("AstWalker", "[AstWalker]") {
+  SECTION("walk ast") {
+    testAstWalker("test/case/parse-1.dim");
+    testAstWalker("test/case/parse-2.dim");
+    testAstWalker("test/case/parse-3.dim");
+    testAstWalker("test/case/parse-4.dim");
+  }
+  SECTION("fuse phases") {
+    testFusion("test/case/parse-1.dim");
+    testFusion("test/case/parse-2.dim");
+    testFusion("test/case/parse-3.dim");
+    testFusion("test/case/parse-4.dim");
+  }
+  SECTION("deep ast") { testDeepAst(2000); }
+}
+
+TEST_CASE("AstWalker deep ast", "[.][AstWalker]") { testDeepAst(200000); }
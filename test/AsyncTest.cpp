@@ -0,0 +1,67 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "JitModule.h"
+#include "Repl.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include <cstdint>
+
+// test/case/async.dim
+typedef int64_t (*Function)(int64_t);
+
+TEST_CASE("Async", "[Async]") {
+  SECTION("lowering") {
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/async.dim", optimize);
+      llvm::Module *m = module.llvmModule();
+      REQUIRE(coroutines(m) == 0);
+      // thread outside scheduler blocks, async function suspends, calls of
+      // its resume and destroy functions are counted too
+      REQUIRE(calls(m, "fibAsync", "dimrt_task_wait") == 1);
+      REQUIRE(calls(m, "fibAsync", "dimrt_task_join") == 0);
+      REQUIRE(calls(m, "fib", "dimrt_task_wait") == 0);
+      if (!optimize) {
+        REQUIRE(calls(m, "fib", "dimrt_task_spawn") == 2);
+        REQUIRE(calls(m, "fib", "dimrt_task_join") == 1);
+        REQUIRE(calls(m, "sum4", "dimrt_task_spawn") == 4);
+      }
+    }
+  }
+
+  SECTION("run") {
+    JitModule::run("test/case/async.dim");
+
+    JitModule module("test/case/async.dim", true);
+    REQUIRE(module.function<Function>("fibAsync")(1L) == 1L);
+    REQUIRE(module.function<Function>("fibAsync")(20L) == 6765L);
+    REQUIRE(module.function<Function>("sumAsync")(1000L) == 499500L);
+  }
+
+  SECTION("error") {
+    Repl repl;
+    REQUIRE(repl.eval("async def a(n:int):int = n") == "");
+    // async function is only called in await
+    REQUIRE_THROWS_AS(repl.eval("def f1():int = a(1)"), Exception);
+    REQUIRE_THROWS_AS(repl.eval("async def f2(n:int):int { yield n; }"),
+                      Exception);
+    // await without async call
+    REQUIRE_THROWS_AS(repl.eval("def f3(n:int):int = await n"), Exception);
+    REQUIRE(repl.eval("def gen(n:int):int { yield n; }") == "");
+    REQUIRE_THROWS_AS(repl.eval("def f4():int { var s:int = 0; "
+                                "for (x:int <- gen(1)) { s += 1; } "
+                                "yield await a(s); }"),
+                      Exception);
+  }
+}
+
+TEST_CASE("Async benchmark", "[.benchmark][Async]") {
+  JitModule module("test/case/async.dim", true);
+  Function fibAsync = module.function<Function>("fibAsync");
+  Function fibSerial = module.function<Function>("fibSerial");
+  Function sumAsync = module.function<Function>("sumAsync");
+
+  BENCHMARK("await fib(25)") { return fibAsync(25L); };
+  BENCHMARK("serial fib(25)") { return fibSerial(25L); };
+  BENCHMARK("await fan-out/fan-in of 4 sums") { return sumAsync(1000000L); };
+}
@@ -0,0 +1,95 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "ConstantFolder.h"
+#include "Ast.h"
+#include "IrBuilder.h"
+#include "Scanner.h"
+#include "SymbolBuilder.h"
+#include "SymbolResolver.h"
+#include "catch2/catch.hpp"
+#include "iface/Phase.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/raw_ostream.h"
+#include <unordered_map>
+
+// count ast nodes by kind
+class KindCounter : public FusiblePhase {
+public:
+  KindCounter()
+      : FusiblePhase("KindCounter", PhaseOrder::PreOrder), unscoped(0) {}
+  virtual void enter(Ast *ast) {
+    counts[ast->kind()._to_integral()]++;
+    if (ast->kind() == +AstKind::Block &&
+        !static_cast<A_Block *>(ast)->scope()) {
+      unscoped++;
+    }
+  }
+  int count(AstKind kind) { return counts[kind._to_integral()]; }
+  std::unordered_map<int, int> counts;
+  // blocks without scope
+  int unscoped;
+};
+
+static Ast *literal(const Cowstr &literal, AstKind kind) {
+  switch (kind) {
+  case AstKind::Integer:
+    return new A_Integer(literal, Location());
+  case AstKind::Float:
+    return new A_Float(literal, Location());
+  default:
+    return new A_Boolean(literal, Location());
+  }
+}
+
+// fold `a op b`, returns folded literal name
+static Cowstr fold(const Cowstr &a, int op, const Cowstr &b, AstKind kind) {
+  A_Infix infix(literal(a, kind), op, literal(b, kind), Location());
+  Ast *result = ConstantFolder::fold(&infix);
+  if (!result) {
+    return "";
+  }
+  Cowstr name = result->name();
+  delete result;
+  return name;
+}
+
+TEST_CASE("ConstantFolder", "[ConstantFolder]") {
+  SECTION("fold infix") {
+    REQUIRE(fold("1", T_PLUS, "2", AstKind::Integer) == "3");
+    REQUIRE(fold("7", T_SLASH, "2", AstKind::Integer) == "3");
+    REQUIRE(fold("7", T_PERCENT, "0", AstKind::Integer) == "");
+    REQUIRE(fold("2147483647", T_PLUS, "1", AstKind::Integer) ==
+            "-2147483648");
+    REQUIRE(fold("4294967295u", T_PLUS, "1u", AstKind::Integer) == "0u");
+    REQUIRE(fold("3l", T_ASTERISK, "5l", AstKind::Integer) == "15l");
+    REQUIRE(fold("1", T_PLUS, "1l", AstKind::Integer) == "");
+    REQUIRE(fold("3", T_LT, "5", AstKind::Integer) == "true");
+    REQUIRE(fold("1.5d", T_ASTERISK, "2.0d", AstKind::Float) == "3d");
+    REQUIRE(fold("true", T_AND, "false", AstKind::Boolean) == "false");
+    REQUIRE(fold("true", T_BAR2, "false", AstKind::Boolean) == "true");
+  }
+
+  SECTION("fold compile unit") {
+    Scanner scanner("test/case/constant-folder.dim");
+    REQUIRE(scanner.parse() == 0);
+    SymbolBuilder symbolBuilder;
+    SymbolResolver symbolResolver;
+    ConstantFolder constantFolder;
+    PhaseManager pm({&symbolBuilder, &symbolResolver, &constantFolder});
+    pm.run(scanner.compileUnit());
+    KindCounter counter;
+    counter.run(scanner.compileUnit());
+
+    // `a + k` in f, `x * a` in h are left
+    REQUIRE(counter.count(AstKind::Infix) == 2);
+    REQUIRE(counter.count(AstKind::Prefix) == 0);
+    REQUIRE(counter.count(AstKind::If) == 0);
+    // `if (false)` without else in h is replaced by an empty block
+    REQUIRE(counter.unscoped == 0);
+
+    IrBuilder irBuilder(false);
+    irBuilder.run(scanner.compileUnit());
+    REQUIRE(!llvm::verifyModule(*irBuilder.llvmModule(), &llvm::errs()));
+  }
+}
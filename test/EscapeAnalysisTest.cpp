@@ -0,0 +1,164 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "EscapeAnalysis.h"
+#include "Compiler.h"
+#include "ConstantFolder.h"
+#include "IrBuilder.h"
+#include "Repl.h"
+#include "Scanner.h"
+#include "SymbolBuilder.h"
+#include "SymbolResolver.h"
+#include "catch2/catch.hpp"
+#include "iface/Phase.h"
+#include "infra/Log.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+
+// instructions of function in module, whose link name starts with name
+static std::vector<llvm::Instruction *> instructions(llvm::Module *module,
+                                                    const std::string &name) {
+  std::vector<llvm::Instruction *> result;
+  for (llvm::Function &f : *module) {
+    if (f.getName().str().rfind(name + ".", 0) != 0) {
+      continue;
+    }
+    for (llvm::Instruction &i : llvm::instructions(f)) {
+      result.push_back(&i);
+    }
+  }
+  return result;
+}
+
+static int allocas(llvm::Module *module, const std::string &name) {
+  int n = 0;
+  for (llvm::Instruction *i : instructions(module, name)) {
+    n += llvm::isa<llvm::AllocaInst>(i) ? 1 : 0;
+  }
+  return n;
+}
+
+// calls to runtime function
+static int calls(llvm::Module *module, const std::string &name,
+                 const std::string &callee) {
+  int n = 0;
+  for (llvm::Instruction *i : instructions(module, name)) {
+    llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(i);
+    if (call && call->getCalledFunction() &&
+        call->getCalledFunction()->getName() == callee) {
+      n++;
+    }
+  }
+  return n;
+}
+
+// calls to runtime allocation
+static int heapAllocations(llvm::Module *module, const std::string &name) {
+  return calls(module, name, "dimrt_alloc");
+}
+
+TEST_CASE("EscapeAnalysis", "[EscapeAnalysis]") {
+  SECTION("stack") {
+    Scanner scanner("test/case/escape.dim");
+    REQUIRE(scanner.parse() == 0);
+    SymbolBuilder symbolBuilder;
+    SymbolResolver symbolResolver;
+    ConstantFolder constantFolder;
+    EscapeAnalysis escapeAnalysis;
+    IrBuilder irBuilder(true);
+    PhaseManager pm({&symbolBuilder, &symbolResolver, &constantFolder,
+                     &escapeAnalysis, &irBuilder});
+    pm.run(scanner.compileUnit());
+    REQUIRE(escapeAnalysis.eliminated() == 2);
+
+    llvm::Module *m = irBuilder.llvmModule();
+    REQUIRE(!llvm::verifyModule(*m, &llvm::errs()));
+    // heap arrays call runtime, stack arrays don't
+    REQUIRE(heapAllocations(m, "local") == 0);
+    REQUIRE(heapAllocations(m, "scalar") == 0);
+    REQUIRE(heapAllocations(m, "returned") == 1);
+    REQUIRE(heapAllocations(m, "passed") == 1);
+    REQUIRE(heapAllocations(m, "dynamic") == 1);
+    REQUIRE(heapAllocations(m, "large") == 1);
+    REQUIRE(allocas(m, "local") == 1);
+    // elements with constant index are promoted to SSA values
+    REQUIRE(allocas(m, "scalar") == 0);
+  }
+
+  SECTION("run") { REQUIRE(Compiler::run("test/case/escape.dim") == 0); }
+
+  SECTION("region") {
+    Scanner scanner("test/case/region.dim");
+    REQUIRE(scanner.parse() == 0);
+    SymbolBuilder symbolBuilder;
+    SymbolResolver symbolResolver;
+    ConstantFolder constantFolder;
+    EscapeAnalysis escapeAnalysis;
+    IrBuilder irBuilder(false);
+    PhaseManager pm({&symbolBuilder, &symbolResolver, &constantFolder,
+                     &escapeAnalysis, &irBuilder});
+    pm.run(scanner.compileUnit());
+
+    llvm::Module *m = irBuilder.llvmModule();
+    REQUIRE(!llvm::verifyModule(*m, &llvm::errs()));
+    // arrays in region are bumped from it, delete is dropped
+    REQUIRE(calls(m, "squares", "dimrt_region_alloc") == 2);
+    REQUIRE(calls(m, "squares", "dimrt_alloc") == 0);
+    REQUIRE(calls(m, "squares", "dimrt_free") == 0);
+    // each region is also released before break and return jump out of it
+    REQUIRE(calls(m, "first", "dimrt_region_begin") == 3);
+    REQUIRE(calls(m, "first", "dimrt_region_end") == 6);
+    REQUIRE(Compiler::run("test/case/region.dim") == 0);
+  }
+
+  SECTION("region escape") {
+    Repl repl;
+    // returned
+    REQUIRE_THROWS_AS(repl.eval("def f1(n:int):int[] {\n"
+                                "  region {\n"
+                                "    var a:int[] = new int[n];\n"
+                                "    return a;\n"
+                                "  }\n"
+                                "}"),
+                      Exception);
+    // assigned to variable out of region
+    REQUIRE_THROWS_AS(repl.eval("def f2(n:int):int {\n"
+                                "  var a:int[] = new int[n];\n"
+                                "  region {\n"
+                                "    a = new int[n];\n"
+                                "  }\n"
+                                "  return 0;\n"
+                                "}"),
+                      Exception);
+    // copied
+    REQUIRE_THROWS_AS(repl.eval("def f3(n:int):int {\n"
+                                "  region {\n"
+                                "    var a:int[] = new int[n];\n"
+                                "    var b:int[] = a;\n"
+                                "  }\n"
+                                "  return 0;\n"
+                                "}"),
+                      Exception);
+    // passed to call returning array
+    REQUIRE(repl.eval("def id(a:int[]):int[] = a") == "");
+    REQUIRE_THROWS_AS(repl.eval("def f5(n:int):int {\n"
+                                "  region {\n"
+                                "    var a:int[] = new int[n];\n"
+                                "    return id(a)[0];\n"
+                                "  }\n"
+                                "}"),
+                      Exception);
+    REQUIRE(repl.eval("def f4(n:int):int {\n"
+                      "  region {\n"
+                      "    var a:int[] = new int[n];\n"
+                      "    a[0] = n;\n"
+                      "    return a[0];\n"
+                      "  }\n"
+                      "}") == "");
+    REQUIRE(repl.eval("f4(5)") == "5");
+  }
+}
@@ -0,0 +1,72 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "JitModule.h"
+#include "Repl.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include "llvm/IR/Instructions.h"
+#include <cstdint>
+
+// test/case/exception.dim
+typedef int64_t (*Function)(int64_t);
+
+// landing pads in functions whose link name starts with name
+static int landingPads(llvm::Module *module, const std::string &name) {
+  return instructions(module, name, [](llvm::Instruction &i) {
+    return llvm::isa<llvm::LandingPadInst>(&i);
+  });
+}
+
+TEST_CASE("Exception", "[Exception]") {
+  SECTION("lowering") {
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/exception.dim", optimize);
+      llvm::Module *m = module.llvmModule();
+      // function without try has no landing pad
+      REQUIRE(landingPads(m, "sum") == 0);
+      REQUIRE(landingPads(m, "middle") == 0);
+      REQUIRE(landingPads(m, "sumInTry") == 1);
+      if (!optimize) {
+        REQUIRE(calls(m, "check", "dimrt_throw") == 1);
+        REQUIRE(calls(m, "catches", "dimrt_catch") == 1);
+        // exception of inner catch unwinds to cleanup pad of inner finally,
+        // which also catches it for outer try
+        REQUIRE(landingPads(m, "nested") == 2);
+      }
+    }
+  }
+
+  SECTION("run") {
+    JitModule::run("test/case/exception.dim");
+
+    JitModule module("test/case/exception.dim", true);
+    REQUIRE(module.function<Function>("catches")(1L) == 2L);
+    REQUIRE(module.function<Function>("catches")(100L) == 999L);
+    REQUIRE(module.function<Function>("nested")(200L) == 110L);
+    REQUIRE(module.function<Function>("sumInTry")(100L) == 4950L);
+  }
+
+  SECTION("error") {
+    Repl repl;
+    // only integer is thrown
+    REQUIRE_THROWS_AS(repl.eval("def f1():int { throw 1.5; }"), Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f2():int { throw true; }"), Exception);
+    REQUIRE(repl.eval("def f3(x:int):int { try { throw x; } catch { x += 1; }"
+                      " return x; }") == "");
+    REQUIRE(repl.eval("f3(1)") == "2");
+  }
+}
+
+TEST_CASE("Exception benchmark", "[.benchmark][Exception]") {
+  const int64_t n = 100000;
+  JitModule module("test/case/exception.dim", true);
+  Function sum = module.function<Function>("sum");
+  Function sumInTry = module.function<Function>("sumInTry");
+  Function catches = module.function<Function>("catches");
+
+  // code inside try runs the same instructions as outside it
+  BENCHMARK("calls outside try") { return sum(n); };
+  BENCHMARK("calls inside try") { return sumInTry(n); };
+  BENCHMARK("throw and catch") { return catches(100L); };
+}
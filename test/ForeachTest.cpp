@@ -0,0 +1,134 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "JitModule.h"
+#include "Repl.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// test/case/foreach.dim
+typedef int64_t (*Sum)(DimArray<int64_t>, int32_t);
+typedef int32_t (*Scale)(DimArray<int64_t>, DimArray<int64_t>, int32_t,
+                         int64_t);
+typedef int64_t (*Spread)(DimArray<int64_t>, int32_t, int32_t);
+typedef uint64_t (*Triangle)(uint64_t);
+
+// vector instructions in outlined bodies of function name
+static int foreachVectorInstructions(llvm::Module *module,
+                                     const std::string &name) {
+  return instructions(module, name, [](llvm::Instruction &i) {
+    return i.getType()->isVectorTy() &&
+           i.getFunction()->getName().contains(".foreach");
+  });
+}
+
+TEST_CASE("Foreach", "[Foreach]") {
+  SECTION("lowering") {
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/foreach.dim", optimize);
+      llvm::Module *m = module.llvmModule();
+      REQUIRE(calls(m, "sum", "dimrt_parallel_for") == 1);
+      REQUIRE(calls(m, "sumRange", "dimrt_parallel_for") == 0);
+      // each chunk combines its partial result once, outside its loop
+      REQUIRE(calls(m, "sum", "dimrt_reduce_add") == 1);
+      REQUIRE(calls(m, "spread", "dimrt_reduce_min") == 1);
+      REQUIRE(calls(m, "spread", "dimrt_reduce_max") == 1);
+      REQUIRE(calls(m, "scale", "dimrt_reduce_add") == 0);
+      if (optimize) {
+        // outlined body is a counted loop like `for (i:T <- a..b)`
+        REQUIRE(foreachVectorInstructions(m, "sum") > 0);
+        REQUIRE(foreachVectorInstructions(m, "scale") > 0);
+      }
+    }
+  }
+
+  SECTION("run") {
+    JitModule::run("test/case/foreach.dim");
+
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/foreach.dim", optimize);
+      Sum sum = module.function<Sum>("sum");
+      Scale scale = module.function<Scale>("scale");
+      Spread spread = module.function<Spread>("spread");
+      Triangle triangle = module.function<Triangle>("triangle");
+      for (int32_t n : {0, 1, 7, 33, 100001}) {
+        std::vector<int64_t> a(n), b(n);
+        for (int32_t i = 0; i < n; i++) {
+          a[i] = i;
+        }
+        DimArray<int64_t> x = {a.data(), n};
+        DimArray<int64_t> y = {b.data(), n};
+        REQUIRE(sum(x, n) == (int64_t)n * (n - 1) / 2);
+        REQUIRE(scale(x, y, n, 3L) == 0);
+        REQUIRE(sum(y, n) == (int64_t)n * (n - 1) / 2 * 3);
+        if (n > 0) {
+          REQUIRE(spread(x, 0, n) == n - 1);
+          REQUIRE(spread(x, n / 2, n) == n - 1 - n / 2);
+        }
+      }
+      // unsigned reductions
+      for (uint64_t n : {0UL, 1UL, 100UL, 1000UL}) {
+        REQUIRE(triangle(n) == (n == 0 ? 0 : n * (n - 1) / 2));
+      }
+    }
+  }
+
+  SECTION("error") {
+    Repl repl;
+    // body cannot leave foreach
+    REQUIRE_THROWS_AS(repl.eval("def f1(n:int):int { foreach (i:int <- 0..n)"
+                                " { return i; } return 0; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f2(n:int):int { foreach (i:int <- 0..n)"
+                                " { break; } return 0; }"),
+                      Exception);
+    // variables of enclosing function are read-only, except reductions
+    REQUIRE_THROWS_AS(repl.eval("def f3(n:int):int { var s:int = 0;"
+                                " foreach (i:int <- 0..n) { s += i; }"
+                                " return s; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f4(n:int):double { var s:double = 0.0;"
+                                " foreach (i:int <- 0..n; + s) {}"
+                                " return s; }"),
+                      Exception);
+    // only a range is enumerated
+    REQUIRE_THROWS_AS(repl.eval("def f5(n:int):int { var s:int = 0;"
+                                " foreach (i:int <- n; + s) {} return s; }"),
+                      Exception);
+    // reduction is assigned, it cannot be a val
+    REQUIRE_THROWS_AS(repl.eval("def f7(n:int):int { val s:int = 0;"
+                                " foreach (i:int <- 0..n; + s) {} return s; }"),
+                      Exception);
+    REQUIRE(repl.eval("def f6(n:int):int { var s:int = 0;"
+                      " foreach (i:int <- 1..n + 1; + s) {"
+                      " for (j:int <- 0..i) { if (j == 2) { break; } }"
+                      " var t:int = i; s += t; } return s; }") == "");
+    REQUIRE(repl.eval("f6(10)") == "55");
+  }
+}
+
+TEST_CASE("Foreach benchmark", "[.benchmark][Foreach]") {
+  const int32_t n = 1 << 22;
+  std::vector<int64_t> a(n, 1L), b(n);
+  DimArray<int64_t> x = {a.data(), n};
+  DimArray<int64_t> y = {b.data(), n};
+
+  for (bool optimize : {false, true}) {
+    JitModule module("test/case/foreach.dim", optimize);
+    Sum sum = module.function<Sum>("sum");
+    Sum sumRange = module.function<Sum>("sumRange");
+    Scale scale = module.function<Scale>("scale");
+    Scale scaleRange = module.function<Scale>("scaleRange");
+    std::string suffix = optimize ? " (optimized)" : "";
+
+    BENCHMARK("sum by foreach" + suffix) { return sum(x, n); };
+    BENCHMARK("sum by range" + suffix) { return sumRange(x, n); };
+    BENCHMARK("scale by foreach" + suffix) { return scale(x, y, n, 3L); };
+    BENCHMARK("scale by range" + suffix) {
+      return scaleRange(x, y, n, 3L);
+    };
+  }
+}
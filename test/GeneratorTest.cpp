@@ -0,0 +1,75 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "JitModule.h"
+#include "Repl.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include <cstdint>
+
+// test/case/generator.dim
+typedef int64_t (*Sum)(int64_t);
+
+TEST_CASE("Generator", "[Generator]") {
+  SECTION("lowering") {
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/generator.dim", optimize);
+      llvm::Module *m = module.llvmModule();
+      REQUIRE(coroutines(m) == 0);
+      if (optimize) {
+        // frame of a generator consumed by its caller is elided after inlining
+        REQUIRE(calls(m, "sumGenerator", "dimrt_alloc") == 0);
+        REQUIRE(calls(m, "sumGenerator", "range") == 0);
+        REQUIRE(calls(m, "firstAbove", "dimrt_alloc") == 0);
+      } else {
+        REQUIRE(calls(m, "sumGenerator", "range") == 1);
+        REQUIRE(calls(m, "range", "dimrt_alloc") == 1);
+      }
+    }
+  }
+
+  SECTION("run") {
+    JitModule::run("test/case/generator.dim");
+
+    JitModule module("test/case/generator.dim", true);
+    REQUIRE(module.function<Sum>("sumGenerator")(0L) == 0L);
+    REQUIRE(module.function<Sum>("sumGenerator")(1000L) == 499500L);
+    REQUIRE(module.function<Sum>("sumIterator")(1000L) == 499500L);
+  }
+
+  SECTION("error") {
+    Repl repl;
+    REQUIRE(repl.eval("def gen(n:int):int { yield n; }") == "");
+    // a generator is only enumerated by for loop
+    REQUIRE_THROWS_AS(repl.eval("def f1():int = gen(1)"), Exception);
+    REQUIRE_THROWS_AS(
+        repl.eval("def f2():int { var x:int = 0; gen(1); return x; }"),
+        Exception);
+    // element type of loop variable
+    REQUIRE_THROWS_AS(repl.eval("def f3():int { var s:int = 0; "
+                                "for (x:long <- gen(1)) { s += 1; } "
+                                "return s; }"),
+                      Exception);
+    // return of generator has no value
+    REQUIRE_THROWS_AS(repl.eval("def f4(n:int):int { yield n; return n; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f5():void { yield 1; }"), Exception);
+  }
+}
+
+TEST_CASE("Generator benchmark", "[.benchmark][Generator]") {
+  const int64_t n = 100000;
+  JitModule optimized("test/case/generator.dim", true);
+  JitModule unoptimized("test/case/generator.dim", false);
+  Sum sumGenerator = optimized.function<Sum>("sumGenerator");
+  Sum sumIterator = optimized.function<Sum>("sumIterator");
+  Sum sumHeapGenerator = unoptimized.function<Sum>("sumGenerator");
+  Sum sumHeapIterator = unoptimized.function<Sum>("sumIterator");
+
+  BENCHMARK("generator") { return sumGenerator(n); };
+  BENCHMARK("hand-written iterator") { return sumIterator(n); };
+  BENCHMARK("generator without elision") { return sumHeapGenerator(n); };
+  BENCHMARK("hand-written iterator without optimization") {
+    return sumHeapIterator(n);
+  };
+}
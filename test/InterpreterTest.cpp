@@ -0,0 +1,88 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Interpreter.h"
+#include "Ast.h"
+#include "ConstantFolder.h"
+#include "IrBuilder.h"
+#include "Scanner.h"
+#include "SymbolBuilder.h"
+#include "SymbolResolver.h"
+#include "catch2/catch.hpp"
+#include "iface/Phase.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/raw_ostream.h"
+
+static A_FuncDef *findFuncDef(A_CompileUnit *compileUnit, const Cowstr &name) {
+  for (A_TopStats *e = compileUnit->topStats; e; e = e->next) {
+    if (e->topStat->kind() == +AstKind::FuncDef &&
+        static_cast<A_FuncDef *>(e->topStat)->getId()->name() == name) {
+      return static_cast<A_FuncDef *>(e->topStat);
+    }
+  }
+  return nullptr;
+}
+
+class CallCounter : public FusiblePhase {
+public:
+  CallCounter()
+      : FusiblePhase("CallCounter", PhaseOrder::PreOrder, {AstKind::Call}),
+        calls(0) {}
+  virtual void enter(Ast *ast) { calls++; }
+  int calls;
+};
+
+TEST_CASE("Interpreter", "[Interpreter]") {
+  Scanner scanner("test/case/interpreter.dim");
+  REQUIRE(scanner.parse() == 0);
+  A_CompileUnit *compileUnit =
+      static_cast<A_CompileUnit *>(scanner.compileUnit());
+  SymbolBuilder symbolBuilder;
+  SymbolResolver symbolResolver;
+  PhaseManager pm({&symbolBuilder, &symbolResolver});
+  pm.run(compileUnit);
+
+  A_FuncDef *fib = findFuncDef(compileUnit, "fib");
+  A_FuncDef *fact = findFuncDef(compileUnit, "fact");
+  A_FuncDef *forever = findFuncDef(compileUnit, "forever");
+  REQUIRE(fib);
+  REQUIRE(fact);
+  REQUIRE(forever);
+
+  SECTION("call") {
+    Interpreter interpreter;
+    Constant r = interpreter.call(fib, {Constant::fromInteger(10)});
+    REQUIRE(r.valid());
+    REQUIRE(r.str() == "55");
+    r = interpreter.call(fact, {Constant::fromInteger((int64_t)20)});
+    REQUIRE(r.valid());
+    REQUIRE(r.str() == "2432902008176640000l");
+    // argument type mismatch
+    r = interpreter.call(fib, {Constant::fromInteger((int64_t)10)});
+    REQUIRE(!r.valid());
+  }
+
+  SECTION("limits") {
+    Interpreter interpreter;
+    REQUIRE(!interpreter.call(forever, {Constant::fromInteger(1)}).valid());
+    Interpreter steps(100);
+    REQUIRE(!steps.call(fib, {Constant::fromInteger(1000)}).valid());
+    REQUIRE(steps.call(fib, {Constant::fromInteger(1)}).valid());
+    Interpreter depth(1000000, 8);
+    REQUIRE(!depth.call(fact, {Constant::fromInteger((int64_t)10)}).valid());
+    REQUIRE(depth.call(fact, {Constant::fromInteger((int64_t)5)}).valid());
+  }
+
+  SECTION("constant folder") {
+    ConstantFolder constantFolder;
+    constantFolder.run(compileUnit);
+    CallCounter counter;
+    counter.run(compileUnit);
+    // fact(n - 1l) in fact, forever(1), fib(x) in user are left
+    REQUIRE(counter.calls == 3);
+
+    IrBuilder irBuilder(false);
+    irBuilder.run(compileUnit);
+    REQUIRE(!llvm::verifyModule(*irBuilder.llvmModule(), &llvm::errs()));
+  }
+}
@@ -7,9 +7,12 @@
 #include "SymbolBuilder.h"
 #include "SymbolResolver.h"
 #include "catch2/catch.hpp"
+#include "fmt/format.h"
 #include "iface/Phase.h"
 #include "infra/Cowstr.h"
 #include "infra/Files.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/raw_ostream.h"
 
 static void testIrBuilder(const Cowstr &fileName, bool enableFunctionPass) {
   Scanner scanner(fileName);
@@ -24,6 +27,69 @@ static void testIrBuilder(const Cowstr &fileName, bool enableFunctionPass) {
   fwriter.write(Cowstr::from(irBuilder.llvmModule()));
 }
 
+// local variables are SSA values, no stack slot is allocated
+static void testSsaIrBuilder(const Cowstr &fileName, bool enableFunctionPass) {
+  Scanner scanner(fileName);
+  REQUIRE(scanner.parse() == 0);
+  SymbolBuilder symbolBuilder;
+  SymbolResolver symbolResolver;
+  IrBuilder irBuilder(enableFunctionPass);
+  PhaseManager pm({&symbolBuilder, &symbolResolver, &irBuilder});
+  pm.run(scanner.compileUnit());
+  llvm::Module *m = irBuilder.llvmModule();
+  REQUIRE(!llvm::verifyModule(*m, &llvm::errs()));
+  for (llvm::Module::iterator f = m->begin(); f != m->end(); ++f) {
+    for (llvm::Function::iterator b = f->begin(); b != f->end(); ++b) {
+      for (llvm::BasicBlock::iterator i = b->begin(); i != b->end(); ++i) {
+        REQUIRE(!llvm::isa<llvm::AllocaInst>(&*i));
+      }
+    }
+  }
+}
+
+// n functions, each has m local variables computed by arithmetic expressions
+static void generateArithmetic(const Cowstr &fileName, int n, int m) {
+  FileWriter fwriter(fileName);
+  for (int i = 0; i < n; i++) {
+    fwriter.writeln(fmt::format("def f{}():int {{", i));
+    fwriter.writeln(fmt::format("    var a0:int = {};", i));
+    for (int j = 1; j < m; j++) {
+      fwriter.writeln(fmt::format(
+          "    var a{}:int = a{} * 3 + a{} / 2 - {} % 7 + (a{} - 1) * 5;", j,
+          j - 1, j / 2, j, j - 1));
+    }
+    fwriter.writeln(fmt::format("    return a{};", m - 1));
+    fwriter.writeln("}");
+  }
+  fwriter.flush();
+}
+
+static void testParallelIrBuilder(const Cowstr &fileName, int threads) {
+  Scanner scanner(fileName);
+  REQUIRE(scanner.parse() == 0);
+  SymbolBuilder symbolBuilder;
+  SymbolResolver symbolResolver;
+  IrBuilder irBuilder(true);
+  ParallelIrBuilder parallelIrBuilder(true, threads);
+  PhaseManager pm(
+      {&symbolBuilder, &symbolResolver, &irBuilder, &parallelIrBuilder});
+  pm.run(scanner.compileUnit());
+
+  // linked module has same functions and globals as sequential one
+  llvm::Module *m = parallelIrBuilder.llvmModule();
+  REQUIRE(m);
+  REQUIRE(!llvm::verifyModule(*m, &llvm::errs()));
+  REQUIRE(m->size() == irBuilder.llvmModule()->size());
+  REQUIRE(m->global_size() == irBuilder.llvmModule()->global_size());
+  for (llvm::Module::iterator it = m->begin(); it != m->end(); ++it) {
+    REQUIRE(!it->isDeclaration());
+  }
+  for (llvm::Module::global_iterator it = m->global_begin();
+       it != m->global_end(); ++it) {
+    REQUIRE(it->hasInitializer());
+  }
+}
+
 TEST_CASE("IrBuilder", "[IrBuilder]") {
   SECTION("ir builder without LLVM::FunctionPass") {
     testIrBuilder("test/case/ir-var-def-1.dim", false);
@@ -34,4 +100,44 @@ TEST_CASE("IrBuilder", "[IrBuilder]") {
     testIrBuilder("test/case/ir-var-def-1.dim", true);
     testIrBuilder("test/case/ir-var-def-2.dim", true);
   }
+
+  SECTION("ir builder with control flow") {
+    testSsaIrBuilder("test/case/ir-ssa.dim", false);
+    testSsaIrBuilder("test/case/ir-ssa.dim", true);
+  }
+
+  SECTION("parallel ir builder") {
+    testParallelIrBuilder("test/case/ir-var-def-1.dim", 4);
+    testParallelIrBuilder("test/case/ir-var-def-2.dim", 4);
+    testParallelIrBuilder("test/case/ir-ssa.dim", 2);
+    generateArithmetic("test/case/ir-arithmetic.dim", 16, 10);
+    testParallelIrBuilder("test/case/ir-arithmetic.dim", 1);
+    testParallelIrBuilder("test/case/ir-arithmetic.dim", 3);
+  }
+}
+
+TEST_CASE("IrBuilder benchmark", "[.benchmark][IrBuilder]") {
+  generateArithmetic("test/case/ir-arithmetic.dim", 200, 100);
+  Scanner scanner("test/case/ir-arithmetic.dim");
+  REQUIRE(scanner.parse() == 0);
+  SymbolBuilder symbolBuilder;
+  SymbolResolver symbolResolver;
+  PhaseManager pm({&symbolBuilder, &symbolResolver});
+  pm.run(scanner.compileUnit());
+
+  BENCHMARK("ir arithmetic") {
+    IrBuilder irBuilder(false);
+    irBuilder.run(scanner.compileUnit());
+    return irBuilder.llvmModule() != nullptr;
+  };
+  BENCHMARK("ir arithmetic with LLVM::FunctionPass") {
+    IrBuilder irBuilder(true);
+    irBuilder.run(scanner.compileUnit());
+    return irBuilder.llvmModule() != nullptr;
+  };
+  BENCHMARK("parallel ir arithmetic with LLVM::FunctionPass") {
+    ParallelIrBuilder parallelIrBuilder(true);
+    parallelIrBuilder.run(scanner.compileUnit());
+    return parallelIrBuilder.llvmModule() != nullptr;
+  };
 }
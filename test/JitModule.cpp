@@ -0,0 +1,96 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "JitModule.h"
+#include "Compiler.h"
+#include "RuntimeSymbols.h"
+#include "Symbol.h"
+#include "catch2/catch.hpp"
+#include "iface/Phase.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+JitModule::JitModule(const Cowstr &fileName, bool optimize)
+    : scanner_(fileName), irBuilder_(optimize) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmParser();
+  llvm::InitializeNativeTargetAsmPrinter();
+  REQUIRE(scanner_.parse() == 0);
+  PhaseManager pm({&symbolBuilder_, &symbolResolver_, &constantFolder_,
+                   &escapeAnalysis_, &irBuilder_});
+  pm.run(scanner_.compileUnit());
+  REQUIRE(!llvm::verifyModule(*irBuilder_.llvmModule(), &llvm::errs()));
+
+  std::unique_ptr<llvm::LLVMContext> context(new llvm::LLVMContext());
+  std::unique_ptr<llvm::Module> module = irBuilder_.copyModule(*context);
+  llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>> jit =
+      llvm::orc::LLJITBuilder().create();
+  REQUIRE(!!jit);
+  jit_ = std::move(*jit);
+  RuntimeSymbols::define(*jit_);
+  module->setDataLayout(jit_->getDataLayout());
+  REQUIRE(!jit_->addIRModule(
+      llvm::orc::ThreadSafeModule(std::move(module), std::move(context))));
+}
+
+llvm::Module *JitModule::llvmModule() const {
+  return irBuilder_.llvmModule();
+}
+
+uint64_t JitModule::address(const char *name) {
+  Scope *global = static_cast<A_CompileUnit *>(scanner_.compileUnit())->scope();
+  llvm::Expected<llvm::JITEvaluatedSymbol> symbol =
+      jit_->lookup(IrBuilder::linkName(global->s_resolve(name)).str());
+  REQUIRE(!!symbol);
+  return symbol->getAddress();
+}
+
+void JitModule::run(const Cowstr &fileName) {
+  REQUIRE(Compiler::run(fileName) == 0);
+  REQUIRE(Compiler::run(fileName, 2) == 0);
+}
+
+int instructions(llvm::Module *module, const std::string &name,
+                 const std::function<bool(llvm::Instruction &)> &pred) {
+  int n = 0;
+  for (llvm::Function &f : *module) {
+    if (f.getName().str().rfind(name + ".", 0) != 0) {
+      continue;
+    }
+    for (llvm::Instruction &i : llvm::instructions(f)) {
+      if (pred(i)) {
+        n++;
+      }
+    }
+  }
+  return n;
+}
+
+int calls(llvm::Module *module, const std::string &name,
+          const std::string &prefix) {
+  return instructions(module, name, [&prefix](llvm::Instruction &i) {
+    llvm::CallBase *call = llvm::dyn_cast<llvm::CallBase>(&i);
+    return call && call->getCalledFunction() &&
+           call->getCalledFunction()->getName().str().rfind(prefix, 0) == 0;
+  });
+}
+
+int vectorInstructions(llvm::Module *module, const std::string &name) {
+  return instructions(module, name, [](llvm::Instruction &i) {
+    return i.getType()->isVectorTy();
+  });
+}
+
+int coroutines(llvm::Module *module) {
+  int n = 0;
+  for (llvm::Function &f : *module) {
+    if (f.getName().startswith("llvm.coro.") && !f.use_empty()) {
+      n++;
+    }
+  }
+  return n;
+}
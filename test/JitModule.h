@@ -0,0 +1,72 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#pragma once
+#include "ConstantFolder.h"
+#include "EscapeAnalysis.h"
+#include "IrBuilder.h"
+#include "Scanner.h"
+#include "SymbolBuilder.h"
+#include "SymbolResolver.h"
+#include "infra/Cowstr.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// `T[]` or `T[N]` of dim, `{T*, i64}` is passed in two registers like this
+// struct
+template <typename T> struct DimArray {
+  T *data;
+  int64_t length;
+};
+
+/**
+ * Source file lowered by the phases of Compiler, and then JIT compiled with
+ * runtime library, for tests of code generation.
+ *
+ * `llvmModule()` is the lowered module, `function<T>(name)` is the native
+ * function of a top-level function.
+ */
+class JitModule {
+public:
+  JitModule(const Cowstr &fileName, bool optimize);
+  virtual ~JitModule() = default;
+
+  llvm::Module *llvmModule() const;
+  uint64_t address(const char *name);
+  template <typename T> T function(const char *name) {
+    return reinterpret_cast<T>(address(name));
+  }
+
+  // main of file returns 0, compiled without and with optimization
+  static void run(const Cowstr &fileName);
+
+private:
+  Scanner scanner_;
+  SymbolBuilder symbolBuilder_;
+  SymbolResolver symbolResolver_;
+  ConstantFolder constantFolder_;
+  EscapeAnalysis escapeAnalysis_;
+  IrBuilder irBuilder_;
+  std::unique_ptr<llvm::orc::LLJIT> jit_;
+};
+
+// instructions satisfying pred, in functions whose link name starts with name,
+// including functions outlined or split from them
+int instructions(llvm::Module *module, const std::string &name,
+                 const std::function<bool(llvm::Instruction &)> &pred);
+
+// calls and invokes to callees whose name starts with prefix, in functions
+// whose link name starts with name
+int calls(llvm::Module *module, const std::string &name,
+          const std::string &prefix);
+
+// vector instructions in functions whose link name starts with name
+int vectorInstructions(llvm::Module *module, const std::string &name);
+
+// coroutine intrinsics still used after lowering
+int coroutines(llvm::Module *module);
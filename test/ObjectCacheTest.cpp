@@ -0,0 +1,77 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "ObjectCache.h"
+#include "Compiler.h"
+#include "boost/filesystem.hpp"
+#include "catch2/catch.hpp"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+namespace fs = boost::filesystem;
+
+static int countObjects(const fs::path &directory) {
+  int n = 0;
+  for (fs::directory_iterator it(directory); it != fs::directory_iterator();
+       ++it) {
+    n += it->path().extension() == ".o";
+  }
+  return n;
+}
+
+TEST_CASE("ObjectCache", "[ObjectCache]") {
+  fs::path directory =
+      fs::temp_directory_path() / fs::unique_path("dim-cache-%%%%-%%%%");
+
+  SECTION("hit and miss") {
+    llvm::LLVMContext context;
+    llvm::Module module("test", context);
+    llvm::Module other("other", context);
+    ObjectCache cache(directory.string(), "x86_64-generic-O0");
+
+    REQUIRE(!cache.getObject(&module));
+    cache.notifyObjectCompiled(
+        &module, llvm::MemoryBufferRef(llvm::StringRef("object"), "test"));
+    std::unique_ptr<llvm::MemoryBuffer> object = cache.getObject(&module);
+    REQUIRE(object);
+    REQUIRE(object->getBuffer() == "object");
+    REQUIRE(!cache.getObject(&other));
+
+    ObjectCache::Stats stats = cache.stats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 2);
+    REQUIRE(countObjects(directory) == 1);
+
+    // entries are shared by caches in the same directory and target
+    ObjectCache same(directory.string(), "x86_64-generic-O0");
+    REQUIRE(same.getObject(&module));
+    ObjectCache target(directory.string(), "x86_64-generic-O2");
+    REQUIRE(!target.getObject(&module));
+  }
+
+  SECTION("run") {
+    REQUIRE(Compiler::run("test/case/vm.dim", 0, 1, directory.string()) == 0);
+    REQUIRE(countObjects(directory) == 1);
+    // machine code is loaded from cache
+    REQUIRE(Compiler::run("test/case/vm.dim", 0, 1, directory.string()) == 0);
+    REQUIRE(countObjects(directory) == 1);
+    REQUIRE(Compiler::run("test/case/vm.dim", 2, 1, directory.string()) == 0);
+    REQUIRE(countObjects(directory) == 2);
+    REQUIRE(Compiler::run("test/case/vm.dim") == 0);
+  }
+
+  fs::remove_all(directory);
+}
+
+TEST_CASE("ObjectCache benchmark", "[.benchmark][ObjectCache]") {
+  fs::path directory =
+      fs::temp_directory_path() / fs::unique_path("dim-cache-%%%%-%%%%");
+  BENCHMARK("run without cache") {
+    return Compiler::run("test/case/vm.dim", 2);
+  };
+  Compiler::run("test/case/vm.dim", 2, 1, directory.string());
+  BENCHMARK("run with cache") {
+    return Compiler::run("test/case/vm.dim", 2, 1, directory.string());
+  };
+  fs::remove_all(directory);
+}
@@ -0,0 +1,36 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "PerfMap.h"
+#include "Compiler.h"
+#include "catch2/catch.hpp"
+#include <fstream>
+#include <sstream>
+
+TEST_CASE("PerfMap", "[PerfMap]") {
+  SECTION("demangle") {
+    REQUIRE(PerfMap::demangle("fib.6_1_15_1", "vm.dim") == "fib (vm.dim:6)");
+    REQUIRE(PerfMap::demangle("fib.6_1_15_1") == "fib (line 6)");
+    REQUIRE(PerfMap::demangle("a.b.12_3_12_20") == "a.b (line 12)");
+    REQUIRE(PerfMap::demangle("main") == "main");
+    REQUIRE(PerfMap::demangle("fib.tier") == "fib.tier");
+    REQUIRE(PerfMap::demangle("fib.6_1_15") == "fib.6_1_15");
+    REQUIRE(PerfMap::demangle("fib.6_1_15_") == "fib.6_1_15_");
+    REQUIRE(PerfMap::demangle("fib.6_1_15_1_2") == "fib.6_1_15_1_2");
+    REQUIRE(PerfMap::demangle(".6_1_15_1") == ".6_1_15_1");
+  }
+
+  SECTION("run") {
+    PerfMap::enable(true);
+    int functions = PerfMap::instance().functions();
+    REQUIRE(Compiler::run("test/case/vm.dim") == 0);
+    PerfMap::enable(false);
+    REQUIRE(PerfMap::instance().functions() > functions);
+
+    std::ifstream in(PerfMap::instance().fileName().str());
+    std::stringstream ss;
+    ss << in.rdbuf();
+    REQUIRE(ss.str().find("fib (test/case/vm.dim:6)") != std::string::npos);
+    REQUIRE(ss.str().find("rfib (test/case/vm.dim:17)") != std::string::npos);
+  }
+}
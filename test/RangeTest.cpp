@@ -0,0 +1,109 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "JitModule.h"
+#include "Repl.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include "llvm/IR/Instructions.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// test/case/range.dim
+typedef int64_t (*Sum)(DimArray<int64_t>, int32_t);
+typedef int32_t (*Scale)(DimArray<int64_t>, DimArray<int64_t>, int32_t,
+                         int64_t);
+
+// calls in functions whose link name starts with name, except failures of
+// bounds checks
+static int callsExceptBounds(llvm::Module *module, const std::string &name) {
+  return instructions(module, name, [](llvm::Instruction &i) {
+    llvm::CallBase *call = llvm::dyn_cast<llvm::CallBase>(&i);
+    return call && !(call->getCalledFunction() &&
+                     call->getCalledFunction()->getName() == "dimrt_bounds");
+  });
+}
+
+TEST_CASE("Range", "[Range]") {
+  SECTION("lowering") {
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/range.dim", optimize);
+      llvm::Module *m = module.llvmModule();
+      if (optimize) {
+        REQUIRE(vectorInstructions(m, "sumRange") > 0);
+        REQUIRE(vectorInstructions(m, "scaleRange") > 0);
+      } else {
+        // no iterator is called
+        REQUIRE(callsExceptBounds(m, "sumRange") == 0);
+        REQUIRE(callsExceptBounds(m, "scaleRange") == 0);
+        REQUIRE(vectorInstructions(m, "sumRange") == 0);
+      }
+    }
+  }
+
+  SECTION("run") {
+    JitModule::run("test/case/range.dim");
+
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/range.dim", optimize);
+      Sum sum = module.function<Sum>("sumRange");
+      Scale scale = module.function<Scale>("scaleRange");
+      // odd lengths leave a remainder after vectorized iterations
+      for (int32_t n : {0, 1, 7, 33, 1001}) {
+        std::vector<int64_t> a(n), b(n);
+        for (int32_t i = 0; i < n; i++) {
+          a[i] = i;
+        }
+        DimArray<int64_t> x = {a.data(), n};
+        DimArray<int64_t> y = {b.data(), n};
+        REQUIRE(sum(x, n) == (int64_t)n * (n - 1) / 2);
+        REQUIRE(scale(x, y, n, 3L) == 0);
+        REQUIRE(sum(y, n) == (int64_t)n * (n - 1) / 2 * 3);
+      }
+    }
+  }
+
+  SECTION("error") {
+    Repl repl;
+    // range is only enumerated
+    REQUIRE_THROWS_AS(repl.eval("def f1():int { var r:int = 0..3; return r; }"),
+                      Exception);
+    // bounds are of loop variable type
+    REQUIRE_THROWS_AS(repl.eval("def f2():int { for (i:long <- 0..3) {}"
+                                " return 0; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f3():int { for (i:double <- 0..3) {}"
+                                " return 0; }"),
+                      Exception);
+    REQUIRE(repl.eval("def f4(n:int):int { var s:int = 0;"
+                      " for (i:int <- 1..n + 1) { s += i; } return s; }") ==
+            "");
+    REQUIRE(repl.eval("f4(10)") == "55");
+  }
+}
+
+TEST_CASE("Range benchmark", "[.benchmark][Range]") {
+  const int32_t n = 100000;
+  std::vector<int64_t> a(n, 1L), b(n);
+  DimArray<int64_t> x = {a.data(), n};
+  DimArray<int64_t> y = {b.data(), n};
+
+  for (bool optimize : {false, true}) {
+    JitModule module("test/case/range.dim", optimize);
+    Sum sumRange = module.function<Sum>("sumRange");
+    Sum sumCondition = module.function<Sum>("sumCondition");
+    Scale scaleRange = module.function<Scale>("scaleRange");
+    Scale scaleCondition = module.function<Scale>("scaleCondition");
+    std::string suffix = optimize ? " (optimized)" : "";
+
+    BENCHMARK("sum by range" + suffix) { return sumRange(x, n); };
+    BENCHMARK("sum by condition" + suffix) { return sumCondition(x, n); };
+    BENCHMARK("scale by range" + suffix) {
+      return scaleRange(x, y, n, 3L);
+    };
+    BENCHMARK("scale by condition" + suffix) {
+      return scaleCondition(x, y, n, 3L);
+    };
+  }
+}
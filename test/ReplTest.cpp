@@ -0,0 +1,54 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Repl.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include <sstream>
+
+TEST_CASE("Repl", "[Repl]") {
+  SECTION("eval") {
+    Repl repl;
+    REQUIRE(repl.eval("def add(a:int, b:int):int = a + b") == "");
+    REQUIRE(repl.eval("def mul(a:int, b:int):int = a * b") == "");
+    REQUIRE(repl.eval("def unused(a:int):int = a - 1") == "");
+    REQUIRE(repl.eval("var g:int = 10") == "");
+    // nothing is compiled until called
+    REQUIRE(repl.compiled() == 0);
+
+    REQUIRE(repl.eval("add(1, 2)") == "3");
+    REQUIRE(repl.compiled() > 0);
+    int compiled = repl.compiled();
+    REQUIRE(repl.eval("add(3, 4)") == "7");
+    // add is compiled only once
+    REQUIRE(repl.compiled() == compiled + 1);
+
+    REQUIRE(repl.eval("mul(g, 3)") == "30");
+    REQUIRE(repl.eval("g = 20") == "20");
+    REQUIRE(repl.eval("g") == "20");
+    REQUIRE(repl.eval("add(1, 2) < 4") == "true");
+    REQUIRE(repl.eval("2.5") == "2.5");
+  }
+
+  SECTION("errors") {
+    Repl repl;
+    REQUIRE(repl.eval("def f(a:int):int = a + 1") == "");
+    REQUIRE_THROWS_AS(repl.eval("def f(a:int):int = a"), Exception);
+    REQUIRE_THROWS_AS(repl.eval("h(1)"), Exception);
+    REQUIRE_THROWS_AS(repl.eval("def g(a:int):int = k(a)"), Exception);
+    // failed input is dropped, so g can be defined again
+    REQUIRE(repl.eval("def g(a:int):int = f(a) * 2") == "");
+    REQUIRE(repl.eval("g(20)") == "42");
+  }
+
+  SECTION("run") {
+    Repl repl;
+    std::stringstream in("def twice(x:int):int {\n"
+                         "  return x * 2\n"
+                         "}\n"
+                         "twice(21)\n");
+    std::stringstream out;
+    repl.run(in, out);
+    REQUIRE(out.str().find("42") != std::string::npos);
+  }
+}
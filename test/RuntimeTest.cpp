@@ -0,0 +1,35 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Runtime.h"
+#include "Compiler.h"
+#include "Repl.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include <cstring>
+
+TEST_CASE("Runtime", "[Runtime]") {
+  SECTION("alloc") {
+    for (uint64_t size = 0; size < 300000; size = size * 2 + 1) {
+      char *p = static_cast<char *>(dimrt_alloc(size));
+      REQUIRE(p);
+      std::memset(p, 1, size);
+      dimrt_free(p, size);
+    }
+  }
+
+  SECTION("new") { REQUIRE(Compiler::run("test/case/new.dim") == 0); }
+
+  SECTION("repl") {
+    Repl repl;
+    REQUIRE(repl.eval("def squares(n:int):int[] {\n"
+                      "  var a:int[] = new int[n];\n"
+                      "  for (var i:int = 0; i < n; i += 1) {\n"
+                      "    a[i] = i * i;\n"
+                      "  }\n"
+                      "  return a;\n"
+                      "}") == "");
+    REQUIRE(repl.eval("squares(10)[9]") == "81");
+    REQUIRE_THROWS_AS(repl.eval("var g:int[] = new int[1]"), Exception);
+  }
+}
@@ -7,15 +7,92 @@
 #include "Symbol.h"
 #include "SymbolBuilder.h"
 #include "catch2/catch.hpp"
+#include "fmt/format.h"
 #include "iface/Phase.h"
+#include "infra/Files.h"
 
-static void testSymbolResolver(const Cowstr &fileName) {
+// check local variables and parameters have slots
+class SlotChecker : public FusiblePhase {
+public:
+  SlotChecker()
+      : FusiblePhase("SlotChecker", PhaseOrder::PreOrder, {AstKind::VarId}),
+        slots(0) {}
+  virtual void enter(Ast *ast) {
+    A_VarId *varId = static_cast<A_VarId *>(ast);
+    Symbol *sym = varId->symbol();
+    if (!sym) {
+      REQUIRE(!varId->hasSlot());
+      return;
+    }
+    REQUIRE(varId->slotDepth() == sym->slotDepth());
+    REQUIRE(varId->slotIndex() == sym->slotIndex());
+    if (sym->kind() == +SymbolKind::Param) {
+      REQUIRE(sym->slotDepth() == 0);
+    }
+    if (sym->kind() == +SymbolKind::Func) {
+      REQUIRE(!sym->hasSlot());
+    }
+    if (varId->hasSlot()) {
+      slots++;
+    }
+  }
+  int slots;
+};
+
+static int testSymbolResolver(const Cowstr &fileName, int threads = 0) {
   Scanner scanner(fileName);
   REQUIRE(scanner.parse() == 0);
   SymbolBuilder builder;
   SymbolResolver resolver;
-  PhaseManager pm({&builder, &resolver});
+  ParallelSymbolResolver parallelResolver(threads > 0 ? threads : 1);
+  SlotChecker checker;
+  PhaseManager pm({&builder,
+                   threads > 0 ? static_cast<Phase *>(&parallelResolver)
+                               : static_cast<Phase *>(&resolver),
+                   &checker});
   pm.run(scanner.compileUnit());
+  return checker.slots;
+}
+
+// depth nested blocks, each block defines width variables, and reads the
+// variables defined in the outermost and the enclosing block
+static void generateDeepScope(const Cowstr &fileName, int depth, int width) {
+  FileWriter fwriter(fileName);
+  fwriter.writeln("def deep():int {");
+  for (int k = 0; k < width; k++) {
+    fwriter.writeln(fmt::format("    var v0_{}:int = {};", k, k));
+  }
+  for (int d = 1; d < depth; d++) {
+    fwriter.writeln("    {");
+    for (int k = 0; k < width; k++) {
+      fwriter.writeln(fmt::format("    var v{}_{}:int = v{}_{} + v0_{};", d,
+                                  k, d - 1, k, (k + 1) % width));
+    }
+  }
+  for (int d = 1; d < depth; d++) {
+    fwriter.writeln("    }");
+  }
+  fwriter.writeln("    return v0_0;");
+  fwriter.writeln("}");
+  fwriter.flush();
+}
+
+// n functions read global variables, and locals defined in nested block
+static void generateFunctions(const Cowstr &fileName, int n) {
+  FileWriter fwriter(fileName);
+  fwriter.writeln("var g0:int = 0;");
+  fwriter.writeln("var g1:int = 1;");
+  for (int i = 0; i < n; i++) {
+    fwriter.writeln(fmt::format("def f{}():int {{", i));
+    fwriter.writeln(fmt::format("    var a:int = g0 + {};", i));
+    fwriter.writeln("    {");
+    fwriter.writeln("        var b:int = a * g1;");
+    fwriter.writeln("        var c:int = b + a - g0;");
+    fwriter.writeln("    }");
+    fwriter.writeln("    return a;");
+    fwriter.writeln("}");
+  }
+  fwriter.flush();
 }
 
 TEST_CASE("SymbolResolver", "[SymbolResolver]") {
@@ -25,4 +102,51 @@ TEST_CASE("SymbolResolver", "[SymbolResolver]") {
     testSymbolResolver("test/case/parse-3.dim");
     testSymbolResolver("test/case/parse-4.dim");
   }
+  SECTION("deep scope") {
+    generateDeepScope("test/case/deep-scope.dim", 64, 32);
+    // 64 * 32 definitions, each reads 2 variables except in outermost scope,
+    // and 1 in return
+    REQUIRE(testSymbolResolver("test/case/deep-scope.dim") ==
+            64 * 32 * 3 - 32 * 2 + 1);
+  }
+  SECTION("parallel resolve") {
+    testSymbolResolver("test/case/parse-1.dim", 4);
+    testSymbolResolver("test/case/parse-2.dim", 4);
+    testSymbolResolver("test/case/parse-3.dim", 4);
+    testSymbolResolver("test/case/parse-4.dim", 4);
+    generateFunctions("test/case/many-functions.dim", 1000);
+    int slots = testSymbolResolver("test/case/many-functions.dim");
+    REQUIRE(slots == 1000 * 7);
+    REQUIRE(testSymbolResolver("test/case/many-functions.dim", 4) == slots);
+  }
+}
+
+TEST_CASE("SymbolResolver benchmark", "[.benchmark][SymbolResolver]") {
+  generateDeepScope("test/case/deep-scope.dim", 256, 64);
+  Scanner scanner("test/case/deep-scope.dim");
+  REQUIRE(scanner.parse() == 0);
+  SymbolBuilder builder;
+  builder.run(scanner.compileUnit());
+
+  BENCHMARK("resolve deep scope") {
+    SymbolResolver resolver;
+    resolver.run(scanner.compileUnit());
+  };
+}
+
+TEST_CASE("ParallelSymbolResolver benchmark",
+          "[.benchmark][SymbolResolver]") {
+  generateFunctions("test/case/many-functions.dim", 5000);
+  Scanner scanner("test/case/many-functions.dim");
+  REQUIRE(scanner.parse() == 0);
+  SymbolBuilder builder;
+  builder.run(scanner.compileUnit());
+
+  for (int threads = 1; threads <= ThreadPool::defaultThreads();
+       threads *= 2) {
+    BENCHMARK(fmt::format("resolve 5000 functions with {} threads", threads)) {
+      ParallelSymbolResolver resolver(threads);
+      resolver.run(scanner.compileUnit());
+    };
+  }
 }
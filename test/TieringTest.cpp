@@ -0,0 +1,99 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Tiering.h"
+#include "BytecodeBuilder.h"
+#include "Compiler.h"
+#include "ConstantFolder.h"
+#include "Scanner.h"
+#include "SymbolBuilder.h"
+#include "SymbolResolver.h"
+#include "catch2/catch.hpp"
+#include "iface/Phase.h"
+
+static bytecode::Value integer(int64_t i) {
+  bytecode::Value v;
+  v.i = i;
+  return v;
+}
+
+struct TieringFixture {
+  Scanner scanner;
+  SymbolBuilder symbolBuilder;
+  SymbolResolver symbolResolver;
+  ConstantFolder constantFolder;
+  BytecodeBuilder bytecodeBuilder;
+
+  TieringFixture(const Cowstr &fileName) : scanner(fileName) {
+    REQUIRE(scanner.parse() == 0);
+    PhaseManager pm(
+        {&symbolBuilder, &symbolResolver, &constantFolder, &bytecodeBuilder});
+    pm.run(scanner.compileUnit());
+    REQUIRE(bytecodeBuilder.module());
+  }
+
+  int find(const Cowstr &name) {
+    int index = bytecodeBuilder.module()->find(name);
+    REQUIRE(index > 0);
+    return index;
+  }
+};
+
+TEST_CASE("Tiering", "[Tiering]") {
+  SECTION("tier up") {
+    TieringFixture fixture("test/case/vm.dim");
+    Vm vm(fixture.bytecodeBuilder.module());
+    Tiering tiering(&vm, fixture.scanner.compileUnit(),
+                    &fixture.bytecodeBuilder, 10);
+    int fib = fixture.find("fib");
+    int primes = fixture.find("primes");
+    int main = fixture.find("main");
+    REQUIRE(tiering.eligible(fib));
+    REQUIRE(tiering.eligible(primes));
+    // main writes global variable
+    REQUIRE(!tiering.eligible(main));
+
+    // loop in fib makes it hot at first call
+    REQUIRE(vm.call(fib, {integer(20)}).i == 6765);
+    tiering.wait();
+    REQUIRE(vm.native(fib));
+    REQUIRE(!vm.native(primes));
+    REQUIRE(vm.call(fib, {integer(10)}).i == 55);
+    // int wraps around in native code too
+    REQUIRE(vm.call(fib, {integer(48)}).i == 512559680);
+
+    // main is hot after 10 calls
+    for (int i = 0; i < 10; i++) {
+      REQUIRE(vm.call(main, {}).i == 0);
+    }
+    tiering.wait();
+    REQUIRE(!vm.native(main));
+    REQUIRE(vm.global(0).i == 10);
+
+    Tiering::Stats stats = tiering.stats();
+    REQUIRE(stats.compiled >= 2);
+    REQUIRE(stats.rejected >= 1);
+    REQUIRE(stats.hot == stats.compiled + stats.rejected);
+    REQUIRE(stats.decisions.size() >= 3);
+    REQUIRE(stats.nativeTime > 0);
+  }
+
+  SECTION("stay in interpreter") {
+    TieringFixture fixture("test/case/vm-types.dim");
+    Vm vm(fixture.bytecodeBuilder.module());
+    Tiering tiering(&vm, fixture.scanner.compileUnit(),
+                    &fixture.bytecodeBuilder, 1);
+    // unsigned, float and prefix operators are not lowered by IrBuilder
+    REQUIRE(!tiering.eligible(fixture.find("udiv")));
+    REQUIRE(!tiering.eligible(fixture.find("avg")));
+    REQUIRE(!tiering.eligible(fixture.find("neg")));
+    REQUIRE(vm.call(fixture.find("neg"), {integer(5)}).i == -5);
+    tiering.wait();
+    REQUIRE(!vm.native(fixture.find("neg")));
+    REQUIRE(tiering.stats().rejected >= 1);
+  }
+
+  SECTION("interpret") {
+    REQUIRE(Compiler::interpret("test/case/vm.dim", 1, 10) == 0);
+  }
+}
@@ -0,0 +1,117 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "JitModule.h"
+#include "Repl.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include "llvm/IR/Instructions.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// test/case/vector.dim, the length of `float8[]` is in vectors
+typedef float (*Dot)(DimArray<float>, DimArray<float>, int32_t);
+
+// calls of vector reduction intrinsics in functions whose link name starts
+// with name
+static int reductions(llvm::Module *module, const std::string &name) {
+  return instructions(module, name, [](llvm::Instruction &i) {
+    llvm::CallBase *call = llvm::dyn_cast<llvm::CallBase>(&i);
+    return call && call->getCalledFunction() &&
+           call->getCalledFunction()->getName().contains("vector.reduce");
+  });
+}
+
+TEST_CASE("Vector", "[Vector]") {
+  SECTION("lowering") {
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/vector.dim", optimize);
+      llvm::Module *m = module.llvmModule();
+      // float8 is lowered to <8 x float> without any loop vectorization
+      REQUIRE(vectorInstructions(m, "dot8") > 0);
+      REQUIRE(reductions(m, "dot8") == 1);
+      if (!optimize) {
+        REQUIRE(vectorInstructions(m, "dot") == 0);
+      }
+    }
+  }
+
+  SECTION("run") {
+    JitModule::run("test/case/vector.dim");
+
+    for (bool optimize : {false, true}) {
+      JitModule module("test/case/vector.dim", optimize);
+      Dot dot8 = module.function<Dot>("dot8");
+      Dot dot = module.function<Dot>("dot");
+      for (int32_t n : {0, 8, 64, 1024}) {
+        std::vector<float> a(n, 1.0f), b(n);
+        float expected = 0.0f;
+        for (int32_t i = 0; i < n; i++) {
+          b[i] = (float)(i % 4);
+          expected += b[i];
+        }
+        DimArray<float> x = {a.data(), n / 8};
+        DimArray<float> y = {b.data(), n / 8};
+        REQUIRE(dot8(x, y, n / 8) == expected);
+        x.length = y.length = n;
+        REQUIRE(dot(x, y, n) == expected);
+      }
+    }
+  }
+
+  SECTION("error") {
+    Repl repl;
+    // lane is a constant in bounds of vector
+    REQUIRE_THROWS_AS(repl.eval("def f1():int { var v:int4 = int4(1);"
+                                " return v[4]; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f2(i:int):int { var v:int4 = int4(1);"
+                                " return v[i]; }"),
+                      Exception);
+    // constructor takes 1 or all lanes of element type
+    REQUIRE_THROWS_AS(repl.eval("def f3():int { var v:int4 = int4(1, 2);"
+                                " return v[0]; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f4():float { var v:float4 = float4(1);"
+                                " return v[0]; }"),
+                      Exception);
+    // comparison of vectors has no type, reduction is of vector
+    REQUIRE_THROWS_AS(repl.eval("def f5(v:int4, w:int4):boolean {"
+                                " return v < w; }"),
+                      Exception);
+    REQUIRE_THROWS_AS(repl.eval("def f6(x:int):int { return reduce(+ x); }"),
+                      Exception);
+    REQUIRE(repl.eval("def f7(x:long):long { var v:long4 = long4(1L, 2L,"
+                      " 3L, 4L); v[1] += x; return reduce(+ v[1, 0]); }") ==
+            "");
+    REQUIRE(repl.eval("f7(5L)") == "8");
+  }
+}
+
+TEST_CASE("Vector benchmark", "[.benchmark][Vector]") {
+  const int32_t n = 100000;
+  std::vector<float> a(n, 1.0f), b(n, 1.0f);
+
+  // native loop, compiled ahead of time without fast math
+  BENCHMARK("dot native") {
+    float s = 0.0f;
+    for (int32_t i = 0; i < n; i++) {
+      s += a[i] * b[i];
+    }
+    return s;
+  };
+  for (bool optimize : {false, true}) {
+    JitModule module("test/case/vector.dim", optimize);
+    Dot dot8 = module.function<Dot>("dot8");
+    Dot dot = module.function<Dot>("dot");
+    DimArray<float> x = {a.data(), n / 8};
+    DimArray<float> y = {b.data(), n / 8};
+    DimArray<float> xs = {a.data(), n};
+    DimArray<float> ys = {b.data(), n};
+    std::string suffix = optimize ? " (optimized)" : "";
+
+    BENCHMARK("dot float8" + suffix) { return dot8(x, y, n / 8); };
+    BENCHMARK("dot float" + suffix) { return dot(xs, ys, n); };
+  }
+}
@@ -0,0 +1,120 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "Vm.h"
+#include "BytecodeBuilder.h"
+#include "Compiler.h"
+#include "ConstantFolder.h"
+#include "Scanner.h"
+#include "SymbolBuilder.h"
+#include "SymbolResolver.h"
+#include "catch2/catch.hpp"
+#include "fmt/format.h"
+#include "iface/Phase.h"
+#include <limits>
+
+static bytecode::Value integer(int64_t i) {
+  bytecode::Value v;
+  v.i = i;
+  return v;
+}
+
+static bytecode::Value real(double d) {
+  bytecode::Value v;
+  v.d = d;
+  return v;
+}
+
+struct VmFixture {
+  Scanner scanner;
+  SymbolBuilder symbolBuilder;
+  SymbolResolver symbolResolver;
+  ConstantFolder constantFolder;
+  BytecodeBuilder bytecodeBuilder;
+
+  VmFixture(const Cowstr &fileName) : scanner(fileName) {
+    REQUIRE(scanner.parse() == 0);
+    PhaseManager pm(
+        {&symbolBuilder, &symbolResolver, &constantFolder, &bytecodeBuilder});
+    pm.run(scanner.compileUnit());
+    REQUIRE(bytecodeBuilder.module());
+  }
+
+  int find(const Cowstr &name) {
+    int index = bytecodeBuilder.module()->find(name);
+    REQUIRE(index > 0);
+    return index;
+  }
+};
+
+TEST_CASE("Vm", "[Vm]") {
+  SECTION("control flow") {
+    VmFixture fixture("test/case/ir-ssa.dim");
+    Vm vm(fixture.bytecodeBuilder.module());
+    REQUIRE(vm.call(fixture.find("max"), {integer(3), integer(5)}).i == 5);
+    REQUIRE(vm.call(fixture.find("max"), {integer(7), integer(-1)}).i == 7);
+    REQUIRE(vm.call(fixture.find("sum"), {integer(10)}).i == 27);
+    REQUIRE(vm.call(fixture.find("count"), {integer(5)}).i == 32);
+    REQUIRE(vm.global(0).i == 10);
+    REQUIRE(vm.call(fixture.find("loop"), {integer(3)}).i == 13);
+    REQUIRE(vm.global(0).i == 13);
+  }
+
+  SECTION("calls") {
+    VmFixture fixture("test/case/vm.dim");
+    Vm vm(fixture.bytecodeBuilder.module());
+    REQUIRE(vm.call(fixture.find("fib"), {integer(10)}).i == 55);
+    // int wraps around
+    REQUIRE(vm.call(fixture.find("fib"), {integer(48)}).i == 512559680);
+    REQUIRE(vm.call(fixture.find("rfib"), {integer(20)}).i == 6765);
+    REQUIRE(vm.call(fixture.find("primes"), {integer(1000)}).i == 168);
+    REQUIRE(vm.call(fixture.find("main"), {}).i == 0);
+    REQUIRE(vm.global(0).i == 1);
+    REQUIRE(Compiler::interpret("test/case/vm.dim") == 0);
+  }
+
+  SECTION("types") {
+    VmFixture fixture("test/case/vm-types.dim");
+    Vm vm(fixture.bytecodeBuilder.module());
+    REQUIRE(vm.call(fixture.find("wrap"), {integer(7)}).i == 7);
+    REQUIRE(vm.call(fixture.find("uwrap"), {integer(0)}).u == 4294967295u);
+    REQUIRE(vm.call(fixture.find("udiv"), {integer(4294967295), integer(2)})
+                .u == 2147483647u);
+    REQUIRE(vm.call(fixture.find("neg"), {integer(5)}).i == -5);
+    REQUIRE(vm.call(fixture.find("inv"), {integer(0)}).i == -1);
+    REQUIRE(vm.call(fixture.find("ulast"), {integer(0)}).u ==
+            std::numeric_limits<uint64_t>::max());
+    REQUIRE(vm.call(fixture.find("less"), {integer(1), integer(-1)}).u == 1);
+    REQUIRE(vm.call(fixture.find("avg"), {real(1.0), real(2.0)}).d == 1.5);
+    REQUIRE(vm.call(fixture.find("negate"), {integer(1)}).u == 0);
+    REQUIRE(vm.call(fixture.find("later"), {integer(4)}).i == 9);
+    REQUIRE_THROWS(vm.call(fixture.find("div"), {integer(1), integer(0)}));
+  }
+}
+
+TEST_CASE("Vm benchmark", "[.benchmark][Vm]") {
+  // end-to-end latency: parse, resolve, then run bytecode or emit object file
+  std::vector<Cowstr> files = {"test/case/ir-var-def-1.dim",
+                               "test/case/ir-var-def-2.dim",
+                               "test/case/ir-ssa.dim", "test/case/vm.dim"};
+  for (int i = 0; i < (int)files.size(); i++) {
+    BENCHMARK(fmt::format("interpret {}", files[i])) {
+      return Compiler::interpret(files[i]);
+    };
+    BENCHMARK(fmt::format("codegen=obj {}", files[i])) {
+      Compiler::createObjectFile(files[i]);
+      return 0;
+    };
+  }
+
+  VmFixture fixture("test/case/vm.dim");
+  Vm vm(fixture.bytecodeBuilder.module());
+  int fib = fixture.find("fib");
+  int rfib = fixture.find("rfib");
+  int primes = fixture.find("primes");
+  BENCHMARK("vm fib(100000)") { return vm.call(fib, {integer(100000)}).i; };
+  BENCHMARK("vm rfib(25)") { return vm.call(rfib, {integer(25)}).i; };
+  BENCHMARK("vm primes(100000)") {
+    return vm.call(primes, {integer(100000)}).i;
+  };
+}
@@ -3,6 +3,8 @@
 
 #include "infra/Counter.h"
 #include "catch2/catch.hpp"
+#include <thread>
+#include <vector>
 
 #define MAX 1024ULL
 
@@ -12,5 +14,19 @@ TEST_CASE("Counter", "[Counter]") {
     for (unsigned long long i = 1; i < MAX; i++) {
       REQUIRE(c.count() == i);
     }
+  }  SECTION("Counter in threads") {
+    Counter c;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+      threads.push_back(std::thread([&c]() {
+        for (unsigned long long j = 0; j < MAX; j++) {
+          c.count();
+        }
+      }));
+    }
+    for (int i = 0; i < (int)threads.size(); i++) {
+      threads[i].join();
+    }
+    REQUIRE(c.total() == 1ULL + 4ULL * MAX);
   }
 }
@@ -0,0 +1,59 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "infra/FlatMap.h"
+#include "catch2/catch.hpp"
+#include "infra/FlatMap.hpp"
+#include <cstdlib>
+#include <vector>
+
+#define TEST_MAX 4096
+
+TEST_CASE("FlatMap", "[FlatMap]") {
+  SECTION("insert and find") {
+    FlatMap<int *> fm;
+    REQUIRE(fm.empty());
+    REQUIRE(fm.size() == 0);
+    REQUIRE(fm.capacity() == 0);
+    REQUIRE(fm.find(0) == nullptr);
+    REQUIRE(!fm.contains(0));
+
+    std::vector<int> values(TEST_MAX);
+    for (int i = 0; i < TEST_MAX; i++) {
+      values[i] = i;
+      REQUIRE(!fm.contains(i));
+      fm.insert(i, &values[i]);
+      REQUIRE(fm.contains(i));
+      REQUIRE(fm.find(i) == &values[i]);
+      REQUIRE(fm.size() == i + 1);
+      REQUIRE(fm.capacity() >= fm.size() * 2);
+    }
+    for (int i = 0; i < TEST_MAX; i++) {
+      REQUIRE(*fm.find(i) == i);
+    }
+    REQUIRE(fm.find(TEST_MAX) == nullptr);
+    fm.clear();
+    REQUIRE(fm.empty());
+    REQUIRE(fm.find(0) == nullptr);
+  }
+  SECTION("update") {
+    FlatMap<int> fm;
+    for (int i = 0; i < TEST_MAX; i++) {
+      int k = rand() % 128;
+      fm.insert(k, i + 1);
+      REQUIRE(fm.find(k) == i + 1);
+      REQUIRE(fm.size() <= 128);
+    }
+  }
+  SECTION("sparse keys") {
+    FlatMap<int> fm;
+    for (int i = 0; i < TEST_MAX; i++) {
+      fm.insert(i * 1024 + 7, i + 1);
+    }
+    REQUIRE(fm.size() == TEST_MAX);
+    for (int i = 0; i < TEST_MAX; i++) {
+      REQUIRE(fm.find(i * 1024 + 7) == i + 1);
+      REQUIRE(fm.find(i * 1024 + 8) == 0);
+    }
+  }
+}
@@ -0,0 +1,52 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "infra/Interner.h"
+#include "catch2/catch.hpp"
+#include "fmt/format.h"
+#include <thread>
+#include <vector>
+
+#define TEST_MAX 1024
+
+TEST_CASE("Interner", "[Interner]") {
+  SECTION("intern") {
+    int n = Interner::size();
+    REQUIRE(Interner::find("interner_test_not_exist") == -1);
+    for (int i = 0; i < TEST_MAX; i++) {
+      Cowstr name = fmt::format("interner_test_{}", i);
+      int id = Interner::intern(name);
+      REQUIRE(id == n + i);
+      REQUIRE(Interner::intern(name) == id);
+      REQUIRE(Interner::find(name) == id);
+      REQUIRE(Interner::name(id) == name);
+    }
+    REQUIRE(Interner::size() == n + TEST_MAX);
+  }
+  SECTION("intern in threads") {
+    int n = Interner::size();
+    std::vector<std::vector<int>> ids(4, std::vector<int>(TEST_MAX));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < (int)ids.size(); i++) {
+      threads.push_back(std::thread([&ids, i]() {
+        for (int j = 0; j < TEST_MAX; j++) {
+          Cowstr name = fmt::format("interner_thread_test_{}", j);
+          ids[i][j] = Interner::intern(name);
+          ids[i][j] = Interner::find(name) == ids[i][j] ? ids[i][j] : -1;
+        }
+      }));
+    }
+    for (int i = 0; i < (int)threads.size(); i++) {
+      threads[i].join();
+    }
+    REQUIRE(Interner::size() == n + TEST_MAX);
+    for (int j = 0; j < TEST_MAX; j++) {
+      REQUIRE(ids[0][j] >= n);
+      for (int i = 1; i < (int)ids.size(); i++) {
+        REQUIRE(ids[i][j] == ids[0][j]);
+      }
+      REQUIRE(Interner::name(ids[0][j]) ==
+              fmt::format("interner_thread_test_{}", j));
+    }
+  }
+}
@@ -0,0 +1,35 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "infra/ThreadPool.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include <atomic>
+#include <future>
+#include <vector>
+
+#define TEST_MAX 1024
+
+TEST_CASE("ThreadPool", "[ThreadPool]") {
+  SECTION("submit") {
+    std::atomic<int> sum(0);
+    {
+      ThreadPool pool(4);
+      REQUIRE(pool.threads() == 4);
+      std::vector<std::future<void>> futures;
+      for (int i = 1; i <= TEST_MAX; i++) {
+        futures.push_back(pool.submit([&sum, i]() { sum += i; }));
+      }
+      for (int i = 0; i < (int)futures.size(); i++) {
+        futures[i].get();
+      }
+    }
+    REQUIRE(sum == TEST_MAX * (TEST_MAX + 1) / 2);
+  }
+  SECTION("exception") {
+    ThreadPool pool(2);
+    std::future<void> f =
+        pool.submit([]() { ASSERT(false, "task {} failed", 1); });
+    REQUIRE_THROWS_AS(f.get(), Exception);
+  }
+}
@@ -0,0 +1,215 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Allocator.h"
+#include "catch2/catch.hpp"
+#include "infra/Log.h"
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using dimrt::Allocator;
+using dimrt::SizeClass;
+
+namespace {
+
+// sizes of small objects, mostly tiny
+std::vector<uint64_t> randomSizes(int n) {
+  std::mt19937 rng(20190101);
+  std::vector<uint64_t> sizes;
+  for (int i = 0; i < n; i++) {
+    uint64_t r = rng() % 100;
+    sizes.push_back(r < 80 ? 1 + rng() % 128
+                           : (r < 98 ? 129 + rng() % 4096
+                                     : 4097 + rng() % (64 * 1024)));
+  }
+  return sizes;
+}
+
+#if defined(__GLIBC__)
+uint64_t mallocBytes() {
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 mi = mallinfo2();
+#else
+  struct mallinfo mi = mallinfo();
+#endif
+  return (uint64_t)mi.arena + (uint64_t)mi.hblkhd;
+}
+#endif
+
+} // namespace
+
+TEST_CASE("Allocator", "[Allocator]") {
+  SECTION("size class") {
+    REQUIRE(SizeClass::index(1) == 0);
+    REQUIRE(SizeClass::index(16) == 0);
+    REQUIRE(SizeClass::index(17) == 1);
+    REQUIRE(SizeClass::index(SizeClass::MaxSmall) == SizeClass::Count - 1);
+    for (uint64_t size = 1; size <= SizeClass::MaxSmall;
+         size += 1 + size / 64) {
+      int cls = SizeClass::index(size);
+      REQUIRE(cls >= 0);
+      REQUIRE(cls < SizeClass::Count);
+      // smallest class holds size, rounding wastes at most 1/8
+      REQUIRE(SizeClass::size(cls) >= size);
+      REQUIRE((cls == 0 || SizeClass::size(cls - 1) < size));
+      REQUIRE((size <= 256 || SizeClass::size(cls) - size <= size / 8));
+      REQUIRE(SizeClass::size(cls) % 16 == 0);
+    }
+    for (int cls = 0; cls < SizeClass::Count; cls++) {
+      REQUIRE(SizeClass::index(SizeClass::size(cls)) == cls);
+      REQUIRE(SizeClass::batch(cls) >= 2);
+      REQUIRE(SizeClass::slabBytes(cls) >= SizeClass::size(cls));
+      REQUIRE(SizeClass::slabBytes(cls) <= dimrt::PageHeap::ChunkSize);
+    }
+  }
+
+  SECTION("allocate") {
+    std::vector<uint64_t> sizes = randomSizes(10000);
+    std::vector<unsigned char *> ps;
+    for (int i = 0; i < (int)sizes.size(); i++) {
+      unsigned char *p =
+          static_cast<unsigned char *>(Allocator::allocate(sizes[i]));
+      REQUIRE(p);
+      REQUIRE(reinterpret_cast<uintptr_t>(p) % 16 == 0);
+      std::memset(p, i & 0xff, sizes[i]);
+      ps.push_back(p);
+    }
+    // objects don't overlap
+    for (int i = 0; i < (int)ps.size(); i++) {
+      REQUIRE(ps[i][0] == (i & 0xff));
+      REQUIRE(ps[i][sizes[i] - 1] == (i & 0xff));
+    }
+    for (int i = 0; i < (int)ps.size(); i += 2) {
+      Allocator::deallocate(ps[i], sizes[i]);
+    }
+    for (int i = 1; i < (int)ps.size(); i += 2) {
+      Allocator::deallocate(ps[i], sizes[i]);
+    }
+    Allocator::deallocate(nullptr, 16);
+  }
+
+  SECTION("reuse") {
+    void *p = Allocator::allocate(40);
+    Allocator::deallocate(p, 40);
+    // freed objects are reused by the same size class
+    uint64_t mapped = Allocator::mappedBytes();
+    for (int i = 0; i < 100000; i++) {
+      p = Allocator::allocate(48);
+      Allocator::deallocate(p, 48);
+    }
+    REQUIRE(Allocator::mappedBytes() == mapped);
+  }
+
+  SECTION("large") {
+    uint64_t mapped = Allocator::mappedBytes();
+    uint64_t size = SizeClass::MaxSmall + 1;
+    char *p = static_cast<char *>(Allocator::allocate(size));
+    REQUIRE(Allocator::mappedBytes() > mapped);
+    p[0] = 1;
+    p[size - 1] = 1;
+    Allocator::deallocate(p, size);
+    REQUIRE(Allocator::mappedBytes() == mapped);
+  }
+
+  SECTION("threads") {
+    // objects allocated in one thread are freed in another
+    std::vector<std::vector<void *>> objects(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.push_back(std::thread([t, &objects]() {
+        for (int i = 0; i < 10000; i++) {
+          void *p = Allocator::allocate(8 + (i % 32) * 8);
+          std::memset(p, t, 8);
+          objects[t].push_back(p);
+        }
+      }));
+    }
+    for (int t = 0; t < 4; t++) {
+      threads[t].join();
+    }
+    threads.clear();
+    for (int t = 0; t < 4; t++) {
+      threads.push_back(std::thread([t, &objects]() {
+        std::vector<void *> &v = objects[(t + 1) % 4];
+        for (int i = 0; i < (int)v.size(); i++) {
+          Allocator::deallocate(v[i], 8 + (i % 32) * 8);
+        }
+      }));
+    }
+    for (int t = 0; t < 4; t++) {
+      threads[t].join();
+    }
+  }
+}
+
+TEST_CASE("Allocator benchmark", "[.benchmark][Allocator]") {
+  std::vector<uint64_t> sizes = randomSizes(100000);
+  std::vector<void *> ps(sizes.size());
+
+  // fragmentation: keep every 4th object alive, then allocate again, it runs
+  // before benchmarks so memory is not mapped by them
+#if defined(__GLIBC__)
+  uint64_t mallocBase = mallocBytes();
+  for (int i = 0; i < (int)sizes.size(); i++) {
+    ps[i] = std::malloc(sizes[i]);
+  }
+  for (int i = 0; i < (int)sizes.size(); i++) {
+    if (i % 4) {
+      std::free(ps[i]);
+    }
+  }
+  for (int i = 0; i < (int)sizes.size(); i++) {
+    if (i % 4) {
+      ps[i] = std::malloc(sizes[(i * 7) % sizes.size()]);
+    }
+  }
+  LOG_INFO("malloc footprint: {} bytes", mallocBytes() - mallocBase);
+  for (int i = 0; i < (int)sizes.size(); i++) {
+    std::free(ps[i]);
+  }
+#endif
+  uint64_t dimrtBase = Allocator::mappedBytes();
+  for (int i = 0; i < (int)sizes.size(); i++) {
+    ps[i] = Allocator::allocate(sizes[i]);
+  }
+  for (int i = 0; i < (int)sizes.size(); i++) {
+    if (i % 4) {
+      Allocator::deallocate(ps[i], sizes[i]);
+    }
+  }
+  for (int i = 0; i < (int)sizes.size(); i++) {
+    if (i % 4) {
+      ps[i] = Allocator::allocate(sizes[(i * 7) % sizes.size()]);
+    }
+  }
+  LOG_INFO("dimrt footprint: {} bytes", Allocator::mappedBytes() - dimrtBase);
+  for (int i = 0; i < (int)sizes.size(); i++) {
+    Allocator::deallocate(ps[i], i % 4 ? sizes[(i * 7) % sizes.size()]
+                                       : sizes[i]);
+  }
+
+  BENCHMARK("dimrt alloc/free") {
+    for (int i = 0; i < (int)sizes.size(); i++) {
+      ps[i] = Allocator::allocate(sizes[i]);
+    }
+    for (int i = 0; i < (int)sizes.size(); i++) {
+      Allocator::deallocate(ps[i], sizes[i]);
+    }
+    return ps.size();
+  };
+  BENCHMARK("malloc/free") {
+    for (int i = 0; i < (int)sizes.size(); i++) {
+      ps[i] = std::malloc(sizes[i]);
+    }
+    for (int i = 0; i < (int)sizes.size(); i++) {
+      std::free(ps[i]);
+    }
+    return ps.size();
+  };
+}
@@ -0,0 +1,92 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Deque.h"
+#include "catch2/catch.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using dimrt::Deque;
+
+TEST_CASE("Deque", "[Deque]") {
+  static int items[1000];
+
+  SECTION("owner") {
+    Deque<int *> deque(4);
+    int *x = nullptr;
+    REQUIRE(!deque.pop(&x));
+    for (int i = 0; i < 1000; i++) {
+      deque.push(&items[i]);
+    }
+    REQUIRE(deque.size() == 1000);
+    // owner pops newest
+    for (int i = 999; i >= 0; i--) {
+      REQUIRE(deque.pop(&x));
+      REQUIRE(x == &items[i]);
+    }
+    REQUIRE(!deque.pop(&x));
+    REQUIRE(deque.empty());
+  }
+
+  SECTION("steal") {
+    Deque<int *> deque(4);
+    int *x = nullptr;
+    REQUIRE(!deque.steal(&x));
+    for (int i = 0; i < 10; i++) {
+      deque.push(&items[i]);
+    }
+    // thief steals oldest
+    REQUIRE(deque.steal(&x));
+    REQUIRE(x == &items[0]);
+    REQUIRE(deque.pop(&x));
+    REQUIRE(x == &items[9]);
+    REQUIRE(deque.steal(&x));
+    REQUIRE(x == &items[1]);
+    REQUIRE(deque.size() == 7);
+  }
+
+  SECTION("concurrent") {
+    // every item is taken exactly once by owner or one of the thieves
+    const int n = 200000;
+    const int thieves = 3;
+    std::vector<int> values(n);
+    std::vector<std::atomic<int>> taken(n);
+    for (int i = 0; i < n; i++) {
+      values[i] = i;
+      taken[i] = 0;
+    }
+    Deque<int *> deque(16);
+    std::atomic<bool> done(false);
+    std::atomic<int> stolen(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thieves; t++) {
+      threads.emplace_back([&]() {
+        int *x = nullptr;
+        while (!done.load()) {
+          if (deque.steal(&x)) {
+            taken[*x]++;
+            stolen++;
+          }
+        }
+      });
+    }
+    int *x = nullptr;
+    for (int i = 0; i < n; i++) {
+      deque.push(&values[i]);
+      if (i % 3 == 0 && deque.pop(&x)) {
+        taken[*x]++;
+      }
+    }
+    while (deque.pop(&x)) {
+      taken[*x]++;
+    }
+    done = true;
+    for (std::thread &t : threads) {
+      t.join();
+    }
+    for (int i = 0; i < n; i++) {
+      REQUIRE(taken[i] == 1);
+    }
+  }
+}
@@ -0,0 +1,200 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Parallel.h"
+#include "catch2/catch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using dimrt::Parallel;
+using dimrt::Scheduler;
+
+namespace {
+
+// sum of i * i over iterations, each chunk adds its partial sum once like
+// reduction of `foreach`
+struct SumOfSquares {
+  static void body(void *context, uint64_t begin, uint64_t end) {
+    SumOfSquares *s = static_cast<SumOfSquares *>(context);
+    int64_t partial = 0;
+    for (uint64_t i = begin; i < end; i++) {
+      partial += (int64_t)(i * i);
+    }
+    s->sum.fetch_add(partial, std::memory_order_relaxed);
+    s->chunks.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::atomic<int64_t> sum{0};
+  std::atomic<int> chunks{0};
+};
+
+// b[i] = a[i] * k
+struct Scale {
+  static void body(void *context, uint64_t begin, uint64_t end) {
+    Scale *s = static_cast<Scale *>(context);
+    for (uint64_t i = begin; i < end; i++) {
+      s->b[i] = s->a[i] * s->k;
+    }
+  }
+
+  const int64_t *a;
+  int64_t *b;
+  int64_t k;
+};
+
+// iteration i marks visited[i], and runs a nested loop of i iterations
+struct Nested {
+  static void body(void *context, uint64_t begin, uint64_t end) {
+    Nested *n = static_cast<Nested *>(context);
+    for (uint64_t i = begin; i < end; i++) {
+      n->visited[i]++;
+      SumOfSquares inner;
+      Parallel::run(n->scheduler, i, SumOfSquares::body, &inner);
+      n->inner += inner.sum.load();
+    }
+  }
+
+  Scheduler *scheduler;
+  std::vector<std::atomic<int>> visited;
+  std::atomic<int64_t> inner{0};
+};
+
+int64_t sumOfSquares(Scheduler *scheduler, uint64_t n) {
+  SumOfSquares s;
+  Parallel::run(scheduler, n, SumOfSquares::body, &s);
+  return s.sum.load();
+}
+
+int64_t expectedSumOfSquares(uint64_t n) {
+  return n == 0 ? 0 : (int64_t)((n - 1) * n * (2 * n - 1) / 6);
+}
+
+std::vector<int> workerCounts() {
+  int cores = std::max(1, (int)std::thread::hardware_concurrency());
+  std::vector<int> counts;
+  for (int n = 1; n < cores; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(cores);
+  return counts;
+}
+
+} // namespace
+
+TEST_CASE("Parallel", "[Parallel]") {
+  SECTION("grain") {
+    Scheduler scheduler(4);
+    REQUIRE(Parallel::grain(&scheduler, 0) == 1);
+    REQUIRE(Parallel::grain(&scheduler, 10) == 1);
+    REQUIRE(Parallel::grain(&scheduler, 3200) == 100);
+  }
+
+  SECTION("reduction") {
+    for (int workers : {1, 2, 4}) {
+      Scheduler scheduler(workers);
+      for (uint64_t n : {0, 1, 7, 1000, 100000}) {
+        REQUIRE(sumOfSquares(&scheduler, n) == expectedSumOfSquares(n));
+      }
+    }
+  }
+
+  SECTION("map") {
+    Scheduler scheduler(3);
+    const int n = 100001;
+    std::vector<int64_t> a(n), b(n, -1);
+    for (int i = 0; i < n; i++) {
+      a[i] = i;
+    }
+    Scale s = {a.data(), b.data(), 3};
+    Parallel::run(&scheduler, n, Scale::body, &s);
+    for (int i = 0; i < n; i++) {
+      REQUIRE(b[i] == 3 * i);
+    }
+  }
+
+  SECTION("lazy splitting") {
+    // single worker never steals from calling thread, which splits only
+    // when its forked chunk is taken
+    Scheduler scheduler(1);
+    SumOfSquares s;
+    Parallel::run(&scheduler, 1000, SumOfSquares::body, &s);
+    REQUIRE(s.sum.load() == expectedSumOfSquares(1000));
+    REQUIRE(s.chunks.load() >= 1);
+    REQUIRE(s.chunks.load() <= 1000);
+  }
+
+  SECTION("atomic reductions") {
+    Scheduler scheduler(4);
+    std::vector<int64_t> values(10007);
+    for (size_t i = 0; i < values.size(); i++) {
+      values[i] = (int64_t)((i * 7919) % 10007) - 5000;
+    }
+    struct Reduce {
+      static void body(void *context, uint64_t begin, uint64_t end) {
+        Reduce *r = static_cast<Reduce *>(context);
+        for (uint64_t i = begin; i < end; i++) {
+          Parallel::add(&r->sum, (*r->values)[i]);
+          Parallel::min(&r->lo, (*r->values)[i]);
+          Parallel::max(&r->hi, (*r->values)[i]);
+        }
+      }
+      const std::vector<int64_t> *values;
+      int64_t sum, lo, hi;
+    } r = {&values, 0, INT64_MAX, INT64_MIN};
+    Parallel::run(&scheduler, values.size(), Reduce::body, &r);
+    int64_t sum = 0;
+    for (int64_t v : values) {
+      sum += v;
+    }
+    REQUIRE(r.sum == sum);
+    REQUIRE(r.lo == *std::min_element(values.begin(), values.end()));
+    REQUIRE(r.hi == *std::max_element(values.begin(), values.end()));
+  }
+
+  SECTION("nested") {
+    // chunk waiting for nested loop runs other chunks on its worker
+    for (int workers : {1, 4}) {
+      Scheduler scheduler(workers);
+      const int n = 200;
+      Nested nested;
+      nested.scheduler = &scheduler;
+      nested.visited = std::vector<std::atomic<int>>(n);
+      Parallel::run(&scheduler, n, Nested::body, &nested);
+      int64_t expected = 0;
+      for (int i = 0; i < n; i++) {
+        REQUIRE(nested.visited[i] == 1);
+        expected += expectedSumOfSquares(i);
+      }
+      REQUIRE(nested.inner.load() == expected);
+    }
+  }
+}
+
+TEST_CASE("Parallel benchmark", "[.benchmark][Parallel]") {
+  const int n = 1 << 22;
+  std::vector<int64_t> a(n, 1), b(n);
+  Scale scale = {a.data(), b.data(), 3};
+
+  BENCHMARK("reduction (sequential)") {
+    SumOfSquares s;
+    SumOfSquares::body(&s, 0, n);
+    return s.sum.load();
+  };
+  BENCHMARK("map (sequential)") {
+    Scale::body(&scale, 0, n);
+    return b[n - 1];
+  };
+  for (int workers : workerCounts()) {
+    Scheduler scheduler(workers);
+    std::string suffix = " (" + std::to_string(workers) + " workers)";
+
+    BENCHMARK("reduction" + suffix) { return sumOfSquares(&scheduler, n); };
+    BENCHMARK("map" + suffix) {
+      Parallel::run(&scheduler, n, Scale::body, &scale);
+      return b[n - 1];
+    };
+  }
+}
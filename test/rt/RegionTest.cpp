@@ -0,0 +1,96 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Region.h"
+#include "catch2/catch.hpp"
+#include "rt/Allocator.h"
+#include "rt/Runtime.h"
+#include <cstring>
+#include <vector>
+
+using dimrt::Allocator;
+using dimrt::Region;
+
+TEST_CASE("Region", "[Region]") {
+  SECTION("bump") {
+    Region region;
+    char *a = static_cast<char *>(region.allocate(1));
+    char *b = static_cast<char *>(region.allocate(24));
+    char *c = static_cast<char *>(region.allocate(16));
+    REQUIRE(reinterpret_cast<uintptr_t>(a) % Region::Alignment == 0);
+    // objects of one chunk are adjacent
+    REQUIRE(b == a + 16);
+    REQUIRE(c == b + 32);
+    REQUIRE(region.chunkBytes() == Region::ChunkSize);
+  }
+
+  SECTION("chunks") {
+    Region region;
+    std::vector<unsigned char *> ps;
+    for (int i = 0; i < 10000; i++) {
+      unsigned char *p =
+          static_cast<unsigned char *>(region.allocate(1 + i % 100));
+      REQUIRE(reinterpret_cast<uintptr_t>(p) % Region::Alignment == 0);
+      std::memset(p, i & 0xff, 1 + i % 100);
+      ps.push_back(p);
+    }
+    for (int i = 0; i < (int)ps.size(); i++) {
+      REQUIRE(ps[i][0] == (i & 0xff));
+      REQUIRE(ps[i][i % 100] == (i & 0xff));
+    }
+    REQUIRE(region.chunkBytes() > Region::ChunkSize);
+  }
+
+  SECTION("large") {
+    Region region;
+    char *a = static_cast<char *>(region.allocate(16));
+    char *p = static_cast<char *>(region.allocate(Region::ChunkSize));
+    p[0] = 1;
+    p[Region::ChunkSize - 1] = 1;
+    // large object doesn't break bump of current chunk
+    char *b = static_cast<char *>(region.allocate(16));
+    REQUIRE(b == a + 16);
+    REQUIRE(region.chunkBytes() > 2 * Region::ChunkSize);
+  }
+
+  SECTION("release") {
+    // chunks of a region are reused by next region
+    void *r = dimrt_region_begin();
+    for (int i = 0; i < 1000; i++) {
+      dimrt_region_alloc(r, 200);
+    }
+    dimrt_region_end(r);
+    uint64_t mapped = Allocator::mappedBytes();
+    for (int k = 0; k < 1000; k++) {
+      r = dimrt_region_begin();
+      for (int i = 0; i < 1000; i++) {
+        std::memset(dimrt_region_alloc(r, 200), k & 0xff, 200);
+      }
+      dimrt_region_end(r);
+    }
+    REQUIRE(Allocator::mappedBytes() == mapped);
+  }
+}
+
+TEST_CASE("Region benchmark", "[.benchmark][Region]") {
+  const int n = 100000;
+  std::vector<void *> ps(n);
+
+  BENCHMARK("region alloc/end") {
+    Region *region = new Region();
+    for (int i = 0; i < n; i++) {
+      ps[i] = region->allocate(8 + (i % 32) * 8);
+    }
+    delete region;
+    return ps.size();
+  };
+  BENCHMARK("dimrt alloc/free") {
+    for (int i = 0; i < n; i++) {
+      ps[i] = Allocator::allocate(8 + (i % 32) * 8);
+    }
+    for (int i = 0; i < n; i++) {
+      Allocator::deallocate(ps[i], 8 + (i % 32) * 8);
+    }
+    return ps.size();
+  };
+}
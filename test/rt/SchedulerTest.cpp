@@ -0,0 +1,242 @@
+// Copyright 2019- <dim-lang>
+// Apache License Version 2.0
+
+#include "rt/Scheduler.h"
+#include "catch2/catch.hpp"
+#include "rt/Parker.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+using dimrt::Parker;
+using dimrt::Scheduler;
+using dimrt::Task;
+
+namespace {
+
+// frame of a hand-written coroutine, whose first word is its resume function
+// like a frame of LLVM coroutine
+struct Frame {
+  explicit Frame(void (*a_resume)(Frame *)) : resume(a_resume) {
+    task.handle = this;
+    task.parent = nullptr;
+    task.pending = 1;
+  }
+
+  void (*resume)(Frame *);
+  Task task;
+};
+
+// task of a thread blocked in Scheduler::wait
+struct Waiter {
+  Waiter() {
+    task.handle = nullptr;
+    task.parent = nullptr;
+    task.pending = 1;
+  }
+  Task task;
+};
+
+struct Counter : Frame {
+  Counter(Scheduler *a_scheduler, std::atomic<int> *a_count)
+      : Frame(run), scheduler(a_scheduler), count(a_count) {}
+
+  static void run(Frame *frame) {
+    Counter *c = static_cast<Counter *>(frame);
+    (*c->count)++;
+    c->scheduler->complete(&c->task);
+  }
+
+  Scheduler *scheduler;
+  std::atomic<int> *count;
+};
+
+// fib(n) forks fib(n-1) and fib(n-2), and suspends until both complete
+struct Fib : Frame {
+  Fib(Scheduler *a_scheduler, int a_n)
+      : Frame(run), scheduler(a_scheduler), n(a_n), state(0), result(0) {}
+
+  static void run(Frame *frame) {
+    Fib *f = static_cast<Fib *>(frame);
+    if (f->state == 0) {
+      if (f->n < 2) {
+        f->result = f->n;
+        f->scheduler->complete(&f->task);
+        return;
+      }
+      f->children[0] = new Fib(f->scheduler, f->n - 1);
+      f->children[1] = new Fib(f->scheduler, f->n - 2);
+      // state is saved before children may resume it
+      f->state = 1;
+      f->scheduler->fork(&f->task, &f->children[0]->task);
+      f->scheduler->fork(&f->task, &f->children[1]->task);
+      if (Scheduler::join(&f->task)) {
+        return;
+      }
+    }
+    f->result = f->children[0]->result + f->children[1]->result;
+    delete f->children[0];
+    delete f->children[1];
+    f->scheduler->complete(&f->task);
+  }
+
+  Scheduler *scheduler;
+  int n;
+  int state;
+  int64_t result;
+  Fib *children[2];
+};
+
+int64_t fib(Scheduler *scheduler, int n) {
+  Waiter waiter;
+  Fib root(scheduler, n);
+  scheduler->fork(&waiter.task, &root.task);
+  scheduler->wait(&waiter.task);
+  return root.result;
+}
+
+// spawn n counters from current thread and wait for them
+int fanOut(Scheduler *scheduler, int n) {
+  std::atomic<int> count(0);
+  std::deque<Counter> counters;
+  Waiter waiter;
+  for (int i = 0; i < n; i++) {
+    counters.emplace_back(scheduler, &count);
+    scheduler->fork(&waiter.task, &counters.back().task);
+  }
+  scheduler->wait(&waiter.task);
+  return count.load();
+}
+
+std::vector<int> workerCounts() {
+  int cores = std::max(1, (int)std::thread::hardware_concurrency());
+  std::vector<int> counts;
+  for (int n = 1; n < cores; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(cores);
+  return counts;
+}
+
+} // namespace
+
+TEST_CASE("Scheduler", "[Scheduler]") {
+  SECTION("parker") {
+    Parker parker;
+    // notification before park is not lost
+    parker.unpark();
+    parker.park();
+    std::thread t([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      parker.unpark();
+    });
+    parker.park();
+    t.join();
+  }
+
+  SECTION("fan out") {
+    for (int workers : {1, 2, 4}) {
+      Scheduler scheduler(workers);
+      REQUIRE(scheduler.workers() == workers);
+      REQUIRE(fanOut(&scheduler, 10000) == 10000);
+      REQUIRE(fanOut(&scheduler, 1) == 1);
+    }
+  }
+
+  SECTION("fork join") {
+    for (int workers : {1, 3, 8}) {
+      Scheduler scheduler(workers);
+      REQUIRE(fib(&scheduler, 1) == 1);
+      REQUIRE(fib(&scheduler, 20) == 6765);
+    }
+  }
+
+  SECTION("wait in worker") {
+    // a task blocked in wait runs other tasks, even on the only worker
+    Scheduler scheduler(1);
+    struct Blocking : Frame {
+      Blocking(Scheduler *a_scheduler)
+          : Frame(run), scheduler(a_scheduler), result(0) {}
+      static void run(Frame *frame) {
+        Blocking *b = static_cast<Blocking *>(frame);
+        b->result = fib(b->scheduler, 15);
+        b->scheduler->complete(&b->task);
+      }
+      Scheduler *scheduler;
+      int64_t result;
+    };
+    Waiter waiter;
+    Blocking blocking(&scheduler);
+    scheduler.fork(&waiter.task, &blocking.task);
+    scheduler.wait(&waiter.task);
+    REQUIRE(blocking.result == 610);
+  }
+
+#ifdef __linux__
+  SECTION("reactor") {
+    // task reading a pipe is resumed when writer writes it
+    Scheduler scheduler(2);
+    struct Reader : Frame {
+      Reader(Scheduler *a_scheduler, int a_fd)
+          : Frame(run), scheduler(a_scheduler), fd(a_fd), c(0) {}
+      static void run(Frame *frame) {
+        Reader *r = static_cast<Reader *>(frame);
+        if (read(r->fd, &r->c, 1) != 1) {
+          r->c = 0;
+        }
+        r->scheduler->complete(&r->task);
+      }
+      Scheduler *scheduler;
+      int fd;
+      char c;
+    };
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    for (char c : {'a', 'b'}) {
+      Waiter waiter;
+      Reader reader(&scheduler, fds[0]);
+      reader.task.parent = &waiter.task;
+      waiter.task.pending++;
+      scheduler.waitIo(&reader.task, fds[0], EPOLLIN);
+      std::thread writer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ssize_t written = write(fds[1], &c, 1);
+        (void)written;
+      });
+      scheduler.wait(&waiter.task);
+      writer.join();
+      REQUIRE(reader.c == c);
+    }
+    close(fds[0]);
+    close(fds[1]);
+  }
+#endif
+}
+
+TEST_CASE("Scheduler benchmark", "[.benchmark][Scheduler]") {
+  for (int workers : workerCounts()) {
+    Scheduler scheduler(workers);
+    std::string suffix = " (" + std::to_string(workers) + " workers)";
+
+    // round trip of a task spawned by a thread outside scheduler
+    BENCHMARK("spawn latency" + suffix) { return fanOut(&scheduler, 1); };
+    BENCHMARK("fan-out/fan-in 10000 tasks" + suffix) {
+      return fanOut(&scheduler, 10000);
+    };
+    BENCHMARK("fork/join fib(25)" + suffix) { return fib(&scheduler, 25); };
+  }
+  BENCHMARK("thread spawn/join") {
+    int x = 0;
+    std::thread t([&]() { x = 1; });
+    t.join();
+    return x;
+  };
+}